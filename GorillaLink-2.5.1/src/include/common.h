@@ -1,4 +1,5 @@
 #pragma once
+#include <stdint.h>
 
 #ifndef UNIT_TEST
 #include "targets.h"
@@ -75,15 +76,16 @@ typedef enum
 
 typedef enum
 {
-    RATE_500HZ = 0,
-    RATE_250HZ = 1,
-    RATE_200HZ = 2,
-    RATE_150HZ = 3,
-    RATE_100HZ = 4,
-    RATE_50HZ = 5,
-    RATE_25HZ = 6,
-    RATE_4HZ = 7,
-    RATE_ENUM_MAX = 8
+    RATE_1000HZ = 0,
+    RATE_500HZ = 1,
+    RATE_250HZ = 2,
+    RATE_200HZ = 3,
+    RATE_150HZ = 4,
+    RATE_100HZ = 5,
+    RATE_50HZ = 6,
+    RATE_25HZ = 7,
+    RATE_4HZ = 8,
+    RATE_ENUM_MAX = 9
 } expresslrs_RFrates_e; // Max value of 16 since only 4 bits have been assigned in the sync package.
 
 typedef struct expresslrs_rf_pref_params_s
@@ -121,16 +123,18 @@ typedef struct expresslrs_mod_settings_s
 #endif
 
 #if defined(Regulatory_Domain_ISM_2400)
-#define RATE_MAX 4
+// The FLRC rate is last so the stored LoRa rate indexes keep their meaning
+#define RATE_MAX 5
 #define RATE_DEFAULT 0
 #define RATE_BINDING 3 // 50Hz bind mode
 typedef struct expresslrs_mod_settings_s
 {
     int8_t index;
     expresslrs_RFrates_e enum_rate; // Max value of 16 since only 4 bits have been assigned in the sync package.
-    SX1280_RadioLoRaBandwidths_t bw;
-    SX1280_RadioLoRaSpreadingFactors_t sf;
-    SX1280_RadioLoRaCodingRates_t cr;
+    SX1280_RadioPacketTypes_t packetType; // SX1280_PACKET_TYPE_LORA or SX1280_PACKET_TYPE_FLRC
+    uint8_t bw;                         // SX1280_RadioLoRaBandwidths_t, FLRC: SX1280_RadioFLRCBandwidths_t (bitrate)
+    uint8_t sf;                         // SX1280_RadioLoRaSpreadingFactors_t, FLRC: SX1280_RadioFLRCBandwidthTimes_t
+    uint8_t cr;                         // SX1280_RadioLoRaCodingRates_t, FLRC: SX1280_RadioFLRCCodingRates_t
     uint32_t interval;                  // interval in us seconds that corresponds to that frequency
     expresslrs_tlm_ratio_e TLMinterval; // every X packets is a response TLM packet, should be a power of 2
     uint8_t FHSShopInterval;            // every X packets we hop to a new frequency. Max value of 16 since only 4 bits have been assigned in the sync package.
@@ -142,7 +146,9 @@ typedef struct expresslrs_mod_settings_s
 
 
 expresslrs_mod_settings_s *get_elrs_airRateConfig(int8_t index);
+expresslrs_mod_settings_s *get_elrs_airRateConfigFullRes(int8_t index);
 expresslrs_rf_pref_params_s *get_elrs_RFperfParams(int8_t index);
+expresslrs_rf_pref_params_s *get_elrs_RFperfParamsFullRes(int8_t index);
 
 uint8_t ICACHE_RAM_ATTR TLMratioEnumToValue(expresslrs_tlm_ratio_e enumval);
 uint16_t RateEnumToHz(expresslrs_RFrates_e eRate);
@@ -10,7 +10,6 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <math.h>
-#include <sys/time.h>
 
 typedef uint8_t byte;
 
@@ -31,7 +30,16 @@ public:
 
     // Print methods
     virtual size_t write(uint8_t c) = 0;
-    virtual size_t write(uint8_t *s, int l) = 0;
+    virtual size_t write(const uint8_t *s, size_t l) {
+        size_t n = 0;
+        while (l--) n += write(*s++);
+        return n;
+    }
+    virtual size_t write(uint8_t *s, int l) { return write((const uint8_t *)s, (size_t)l); }
+
+    int print(const char *s) {return 0;}
+    int println() {return 0;}
+    int println(const char *s) {return 0;}
 };
 
 class HardwareSerial: public Stream {
@@ -61,22 +69,158 @@ public:
 
 static HardwareSerial Serial;
 
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t val) {}
+inline int digitalRead(uint8_t pin) { return LOW; }
+
+#define bit(b) (1UL << (b))
+
 inline void interrupts() {}
 inline void noInterrupts() {}
 
-inline unsigned long micros() {
-    struct timeval tv;
-    gettimeofday(&tv,NULL);
-    return tv.tv_sec*(uint64_t)1000000+tv.tv_usec;
-}
-
-inline void delay(int32_t time) {
-    usleep(time);
-}
+/**
+ * Virtual clock of native builds, micros(), millis() and delay() all run on
+ * it so tests are repeatable. Nothing moves it but advance(), which services
+ * the interrupts that come due on the way at their exact time. A lower irq
+ * number is a higher priority: of two due together it runs first, and only
+ * it is serviced when an ISR itself advances the clock (busy waits). The
+ * ISRs and what the native hwTimer does are kept in an event log.
+ **/
+#define NATIVE_IRQ_COUNT 4
+#define NATIVE_EVENT_LOG_SIZE 256
+
+typedef enum
+{
+    nativeIsrEnter,     // value: the irq it preempted, -1 for the main code
+    nativeIsrExit,
+    nativeTimerTick,    // value: us to the tock
+    nativeTimerTock,    // value: the phase shift applied, us
+    nativeTimerPause,   // value: the pause duration, us
+    nativeTimerResume,
+    nativeTimerStop,
+} nativeEvent_e;
+
+typedef struct
+{
+    uint64_t us;
+    int8_t irq;         // running when it was logged, -1 for the main code
+    uint8_t event;      // nativeEvent_e
+    int32_t value;
+} nativeEvent_t;
 
+class NativeClock
+{
+public:
+    static uint64_t now() { return state().now; }
+    static int8_t activeIrq() { return state().active; }
+
+    // Back to 0us, no interrupts attached and an empty log
+    static void reset()
+    {
+        state() = initialState();
+    }
+
+    static void attachInterrupt(uint8_t irq, void (*isr)()) { state().isr[irq] = isr; }
+    static void detachInterrupt(uint8_t irq)
+    {
+        state().isr[irq] = nullptr;
+        state().armed &= ~(1U << irq);
+    }
+    // Raise irq at us, or as soon as it gets to run if that has passed
+    static void trigger(uint8_t irq, uint64_t us)
+    {
+        state().due[irq] = us;
+        state().armed |= 1U << irq;
+    }
+    static void cancel(uint8_t irq) { state().armed &= ~(1U << irq); }
+
+    static void advance(uint64_t us)
+    {
+        State &s = state();
+        const uint64_t until = s.now + us;
+        int8_t irq;
+        while ((irq = nextDue(until)) >= 0)
+        {
+            if (s.due[irq] > s.now)
+                s.now = s.due[irq];
+            s.armed &= ~(1U << irq);
+            const int8_t preempted = s.active;
+            log(nativeIsrEnter, preempted);
+            s.active = irq;
+            s.isr[irq]();
+            s.active = preempted;
+            log(nativeIsrExit, irq);
+        }
+        if (until > s.now)
+            s.now = until;
+    }
+
+    static void log(uint8_t event, int32_t value)
+    {
+        State &s = state();
+        nativeEvent_t &e = s.events[s.eventCount++ % NATIVE_EVENT_LOG_SIZE];
+        e.us = s.now;
+        e.irq = s.active;
+        e.event = event;
+        e.value = value;
+    }
+    // Number of events logged since the reset, the last NATIVE_EVENT_LOG_SIZE are kept
+    static uint32_t eventCount() { return state().eventCount; }
+    static const nativeEvent_t &event(uint32_t index) { return state().events[index % NATIVE_EVENT_LOG_SIZE]; }
+
+private:
+    typedef struct
+    {
+        uint64_t now;
+        int8_t active;
+        uint8_t armed;
+        uint64_t due[NATIVE_IRQ_COUNT];
+        void (*isr[NATIVE_IRQ_COUNT])();
+        uint32_t eventCount;
+        nativeEvent_t events[NATIVE_EVENT_LOG_SIZE];
+    } State;
+
+    static State &state()
+    {
+        static State s = initialState();
+        return s;
+    }
+
+    static State initialState()
+    {
+        State s = {};
+        s.active = -1;
+        return s;
+    }
+
+    // The interrupt to service next before until, or what an ISR has made
+    // overdue by busy waiting past it. -1 if none can preempt what is running
+    static int8_t nextDue(uint64_t until)
+    {
+        const State &s = state();
+        const int8_t levels = s.active < 0 ? NATIVE_IRQ_COUNT : s.active;
+        int8_t next = -1;
+        for (int8_t irq = 0; irq < levels; ++irq)
+        {
+            if (!(s.armed & (1U << irq)) || !s.isr[irq] || s.due[irq] > std::max(until, s.now))
+                continue;
+            if (next < 0 || s.due[irq] < s.due[next])
+                next = irq;
+        }
+        return next;
+    }
+};
 
-inline unsigned long millis() { return 0; }
-inline void delayMicroseconds(int delay) { }
+// 32 bits like the Arduino cores, so the firmware sees them wrap
+inline unsigned long micros() { return (uint32_t)NativeClock::now(); }
+inline unsigned long millis() { return (uint32_t)(NativeClock::now() / 1000); }
+inline void delay(int32_t time) { NativeClock::advance(time * 1000ULL); }
+inline void delayMicroseconds(int delay) { NativeClock::advance(delay); }
 
 const char device_name[] = "testing";
 const uint8_t device_name_size = sizeof(device_name);
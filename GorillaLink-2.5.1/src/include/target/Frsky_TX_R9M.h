@@ -23,6 +23,9 @@
 #define GPIO_PIN_SCL                    PB6
 #define GPIO_PIN_RCSIGNAL_RX            PB11 // not yet confirmed
 #define GPIO_PIN_RCSIGNAL_TX            PB10 // not yet confirmed
+#define CRSF_RX_DMA_CHANNEL             DMA1_Channel3 // USART3_RX, for USE_CRSF_RX_DMA
+#define CRSF_RX_DMA_IRQn                DMA1_Channel3_IRQn
+#define CRSF_RX_DMA_IRQHandler          DMA1_Channel3_IRQHandler
 #define GPIO_PIN_LED_RED                PA11 // Red LED
 #define GPIO_PIN_LED_GREEN              PA12 // Green LED
 #define GPIO_PIN_BUTTON                 PA8 // pullup e.g. LOW when pressed
@@ -99,7 +99,8 @@ device_t BLE_device = {
   .initialize = NULL,
   .start = NULL,
   .event = event,
-  .timeout = timeout
+  .timeout = timeout,
+  .eventMask = EVENT_CONNECTION_CHANGED
 };
 
 #endif
\ No newline at end of file
@@ -34,7 +34,7 @@ static void cyclePower()
         {
             POWERMGNT::incPower();
         }
-        devicesTriggerEvent();
+        devicesTriggerEvent(EVENT_CONFIG_CHANGED);
     }
 };
 #endif
@@ -78,7 +78,8 @@ device_t Button_device = {
     .initialize = initialize,
     .start = start,
     .event = NULL,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = 0
 };
 
 #endif
\ No newline at end of file
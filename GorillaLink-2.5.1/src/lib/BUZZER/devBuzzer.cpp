@@ -146,7 +146,8 @@ device_t Buzzer_device = {
     .initialize = initializeBuzzer,
     .start = start,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = EVENT_CONNECTION_CHANGED
 };
 
 #endif
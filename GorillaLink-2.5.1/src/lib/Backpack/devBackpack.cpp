@@ -212,5 +212,6 @@ device_t Backpack_device = {
     .initialize = initialize,
     .start = start,
     .event = NULL,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = 0
 };
@@ -94,7 +94,11 @@ TxConfig::Load()
 void
 TxConfig::Load()
 {
-    m_eeprom->Get(0, m_config);
+    // Configs from before ConfigStore are where the first copy goes
+    if (!m_store.Load(&m_config, sizeof(m_config)))
+    {
+        m_eeprom->Get(0, m_config);
+    }
     m_modified = 0;
 
     // Check if version number matches
@@ -162,13 +166,43 @@ TxConfig::Commit()
     }
     nvs_commit(handle);
 #else
-    // Write the struct to eeprom
-    m_eeprom->Put(0, m_config);
-    m_eeprom->Commit();
+    // Only copied here, CommitSlice() writes it to eeprom
+    if (!m_store.Stage(&m_config, sizeof(m_config)))
+    {
+        ERRLN("Config too big for the EEPROM, not saved");
+    }
 #endif
     m_modified = 0;
 }
 
+void
+TxConfig::CommitSlice()
+{
+#if !defined(PLATFORM_ESP32)
+    m_store.Poll();
+#endif
+}
+
+bool
+TxConfig::IsCommitPending() const
+{
+#if defined(PLATFORM_ESP32)
+    return false;
+#else
+    return m_store.IsPending();
+#endif
+}
+
+bool
+TxConfig::IsLastCommitSlice() const
+{
+#if defined(PLATFORM_ESP32)
+    return false;
+#else
+    return m_store.IsLastSlice();
+#endif
+}
+
 // Setters
 void
 TxConfig::SetRate(uint8_t rate)
@@ -310,6 +344,9 @@ TxConfig::SetStorageProvider(ELRS_EEPROM *eeprom)
     if (eeprom)
     {
         m_eeprom = eeprom;
+#if !defined(PLATFORM_ESP32)
+        m_store.SetStorageProvider(eeprom);
+#endif
     }
 }
 
@@ -514,8 +551,12 @@ TxConfig::SetModelId(uint8_t modelId)
 void
 RxConfig::Load()
 {
-    // Populate the struct from eeprom
-    m_eeprom->Get(0, m_config);
+    // Populate the struct from eeprom, configs from before ConfigStore are
+    // where the first copy goes
+    if (!m_store.Load(&m_config, sizeof(m_config)))
+    {
+        m_eeprom->Get(0, m_config);
+    }
 
     // Check if version number matches
     if (m_config.version != (uint32_t)(RX_CONFIG_VERSION | RX_CONFIG_MAGIC))
@@ -537,9 +578,11 @@ RxConfig::Commit()
         return;
     }
 
-    // Write the struct to eeprom
-    m_eeprom->Put(0, m_config);
-    m_eeprom->Commit();
+    // Write the struct to eeprom, the RX only commits while not flying
+    if (!m_store.Write(&m_config, sizeof(m_config)))
+    {
+        ERRLN("Config too big for the EEPROM, not saved");
+    }
 
     m_modified = false;
 }
@@ -608,6 +651,7 @@ RxConfig::SetStorageProvider(ELRS_EEPROM *eeprom)
     if (eeprom)
     {
         m_eeprom = eeprom;
+        m_store.SetStorageProvider(eeprom);
     }
 }
 
@@ -2,6 +2,7 @@
 
 #include "targets.h"
 #include "elrs_eeprom.h"
+#include "ConfigStore.h"
 
 #if defined(PLATFORM_ESP32)
 #include <nvs_flash.h>
@@ -16,6 +17,11 @@
 #define RX_CONFIG_VERSION   4
 #define UID_LEN             6
 
+// Two copies of the config in the EEPROM, see ConfigStore. The TX writes a
+// copy of its config a slice at a time, the RX writes all of it at once.
+typedef ConfigStore<ELRS_EEPROM, RESERVED_EEPROM_SIZE / 2> ConfigStore_t;
+typedef StagedConfigStore<ELRS_EEPROM, RESERVED_EEPROM_SIZE / 2> StagedConfigStore_t;
+
 #if defined(TARGET_TX)
 typedef struct {
     uint8_t     rate:3;
@@ -44,12 +50,20 @@ typedef struct {
     uint8_t         dvrStopDelay:3;
 } tx_config_t;
 
+static_assert(sizeof(tx_config_t) <= ConfigStore_t::maxLength, "tx_config_t does not fit in a ConfigStore slot");
+
 class TxConfig
 {
 public:
     TxConfig();
     void Load();
+    // Stage the changes, CommitSlice() writes them out
     void Commit();
+    // Write the next slice of the staged changes, if any
+    void CommitSlice();
+    bool IsCommitPending() const;
+    // The next CommitSlice() commits the EEPROM
+    bool IsLastCommitSlice() const;
 
     // Getters
     uint8_t GetRate() const { return m_model->rate; }
@@ -109,6 +123,8 @@ private:
     uint8_t     m_modelId;
 #if defined(PLATFORM_ESP32)
     nvs_handle  handle;
+#else
+    StagedConfigStore_t m_store;
 #endif
 };
 
@@ -142,6 +158,8 @@ typedef struct {
     rx_config_pwm_t pwmChannels[PWM_MAX_CHANNELS];
 } rx_config_t;
 
+static_assert(sizeof(rx_config_t) <= ConfigStore_t::maxLength, "rx_config_t does not fit in a ConfigStore slot");
+
 class RxConfig
 {
 public:
@@ -184,6 +202,7 @@ private:
     rx_config_t m_config;
     ELRS_EEPROM *m_eeprom;
     bool        m_modified;
+    ConfigStore_t m_store;
 };
 
 extern RxConfig config;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdint.h>
+#include "targets.h"
+
+/**
+ * CRC8 computed by a hardware CRC unit with a programmable polynomial, a
+ * drop in replacement for GENERIC_CRC8 that needs no table at all.
+ * CrcUnit provides the register access (see STM32_CrcUnit below), the unit is
+ * shared between the main loop and ISRs so each calculation runs locked.
+ **/
+template <uint8_t poly, class CrcUnit>
+class HW_CRC8
+{
+public:
+    uint8_t calc(const uint8_t data) const { return calc(&data, 1, 0); }
+    uint8_t calc(const uint8_t *data, uint8_t len, uint8_t crc = 0) const
+    {
+        const uint32_t lockState = CrcUnit::lock();
+        CrcUnit::reset(poly, crc);
+        while (len--)
+        {
+            CrcUnit::write(*data++);
+        }
+        crc = CrcUnit::read();
+        CrcUnit::unlock(lockState);
+        return crc;
+    }
+};
+
+/**
+ * The STM32 CRC peripheral, only on parts where the polynomial and its size
+ * are programmable (CRC_CR_POLYSIZE: F0x1/F0x2/F0x8, F3, F7, L4, G0, G4...).
+ * The F1 unit is fixed to CRC32 and cannot be used.
+ **/
+#if defined(PLATFORM_STM32) && defined(CRC_CR_POLYSIZE)
+#define HAS_HW_CRC8
+
+struct STM32_CrcUnit
+{
+    static uint32_t lock()
+    {
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        return primask;
+    }
+
+    static void unlock(uint32_t primask)
+    {
+        __set_PRIMASK(primask);
+    }
+
+    static void reset(uint8_t poly, uint8_t init)
+    {
+        __HAL_RCC_CRC_CLK_ENABLE();
+        CRC->POL = poly;
+        CRC->INIT = init;
+        // 8 bit polynomial, no input or output bit reversal, load INIT
+        CRC->CR = CRC_CR_POLYSIZE_1 | CRC_CR_RESET;
+    }
+
+    static void write(uint8_t data)
+    {
+        // Byte access so the unit only shifts in 8 bits
+        *(__IO uint8_t *)&CRC->DR = data;
+    }
+
+    static uint8_t read()
+    {
+        return CRC->DR;
+    }
+};
+#endif
@@ -2,28 +2,149 @@
 #include <stdint.h>
 #include "targets.h"
 
-#define crclen 256
+/**
+ * Compile time index sequence (C++11 has no std::index_sequence), built by
+ * halving so the instantiation depth stays at log2(N) for the large tables
+ **/
+template <uint16_t... Is> struct CrcIndexSeq { typedef CrcIndexSeq type; };
 
+template <class A, class B> struct CrcConcatSeq;
+template <uint16_t... A, uint16_t... B>
+struct CrcConcatSeq<CrcIndexSeq<A...>, CrcIndexSeq<B...> > : CrcIndexSeq<A..., (sizeof...(A) + B)...> {};
+
+template <uint16_t N> struct CrcMakeSeq
+    : CrcConcatSeq<typename CrcMakeSeq<N / 2>::type, typename CrcMakeSeq<N - N / 2>::type> {};
+template <> struct CrcMakeSeq<0> : CrcIndexSeq<> {};
+template <> struct CrcMakeSeq<1> : CrcIndexSeq<0> {};
+
+/**
+ * The loops the ISRs run, in crc.cpp with ICACHE_RAM_ATTR. GCC drops the
+ * section attribute of template instantiations, so the classes below only
+ * hand them their tables.
+ **/
+uint8_t crc8Calc(const uint8_t *table, const uint8_t *data, uint8_t len, uint8_t crc);
+uint16_t crc14Calc(const uint16_t *tables, const uint8_t *data, uint8_t len, uint16_t crc);
+uint16_t crc14Calc(const uint16_t *tables, const volatile uint8_t *data, uint8_t len, uint16_t crc);
+
+/**
+ * CRC8 with the lookup table generated at compile time, so it lives in
+ * flash instead of being built in RAM during static init
+ **/
+template <uint8_t poly>
 class GENERIC_CRC8
 {
-private:
-    uint8_t crc8tab[crclen];
-    uint8_t crcpoly;
+    static constexpr uint8_t entry(uint8_t crc, uint8_t bits)
+    {
+        return bits == 0 ? crc : entry((uint8_t)((crc << 1) ^ ((crc & 0x80) ? poly : 0)), bits - 1);
+    }
+    template <uint16_t... Is>
+    struct Table
+    {
+        static constexpr uint8_t table[sizeof...(Is)] = { entry(Is, 8)... };
+    };
+    template <uint16_t... Is>
+    static constexpr const uint8_t *tableFor(CrcIndexSeq<Is...>) { return Table<Is...>::table; }
+
+    static inline __attribute__((always_inline)) const uint8_t *tab() { return tableFor(typename CrcMakeSeq<256>::type()); }
 
 public:
-    GENERIC_CRC8(uint8_t poly);
-    uint8_t calc(const uint8_t data);
-    uint8_t calc(const uint8_t *data, uint8_t len, uint8_t crc = 0);
+    inline __attribute__((always_inline)) uint8_t calc(const uint8_t data) const { return tab()[data]; }
+    inline __attribute__((always_inline)) uint8_t calc(const uint8_t *data, uint8_t len, uint8_t crc = 0) const { return crc8Calc(tab(), data, len, crc); }
+};
+
+template <uint8_t poly>
+template <uint16_t... Is>
+constexpr uint8_t GENERIC_CRC8<poly>::Table<Is...>::table[sizeof...(Is)];
+
+// Number of slicing tables used by GENERIC_CRC14, each one is 512 bytes of const data
+#if !defined(CRC14_SLICES)
+#define CRC14_SLICES 4
+#endif
+
+/**
+ * Slicing-by-N over the tables of GENERIC_CRC14, table k at tables + k * 256.
+ * The CRC is kept left aligned in 16 bits (poly << 2) which lets N bytes go
+ * through N independent lookups.
+ **/
+template <uint8_t slices>
+struct Crc14Slicer
+{
+    // Process len (2..slices) bytes as one slice, the 16 bit CRC is folded into the first two
+    template <typename T>
+    static inline __attribute__((always_inline)) uint16_t slice(const uint16_t *tables, T *data, uint8_t len, uint16_t crc)
+    {
+        uint16_t result = tables[(len - 1) * 256 + (uint8_t)(data[0] ^ (crc >> 8))]
+                        ^ tables[(len - 2) * 256 + (uint8_t)(data[1] ^ crc)];
+        for (uint8_t i = 2; i < len; ++i)
+            result ^= tables[(len - 1 - i) * 256 + data[i]];
+        return result;
+    }
+
+    template <typename T>
+    static inline __attribute__((always_inline)) uint16_t calc(const uint16_t *tables, T *data, uint8_t len, uint16_t crc)
+    {
+        crc <<= 2;
+        while (len >= slices)
+        {
+            crc = slice(tables, data, slices, crc);
+            data += slices;
+            len -= slices;
+        }
+        if (len >= 2)
+            crc = slice(tables, data, len, crc);
+        else if (len == 1)
+            crc = (uint16_t)(crc << 8) ^ tables[(uint8_t)(*data ^ (crc >> 8))];
+        return crc >> 2;
+    }
 };
 
+/**
+ * CRC14 with the lookup tables generated at compile time, so nothing is built
+ * in RAM at boot. table[k][b] is the CRC of byte b followed by k zero bytes.
+ * The default CRC14_SLICES goes through crc14Calc(), other widths are only
+ * for comparing them and run inline.
+ **/
+template <uint16_t poly, uint8_t slices = CRC14_SLICES>
 class GENERIC_CRC14
 {
-private:
-    uint16_t crc14tab[crclen];
-    uint16_t crcpoly;
+    static_assert(slices >= 2 && slices <= 8, "CRC14 needs 2 to 8 slicing tables");
+
+    static constexpr uint16_t poly16 = poly << 2;
+
+    static constexpr uint16_t bitStep(uint16_t crc, uint8_t bits)
+    {
+        return bits == 0 ? crc : bitStep((uint16_t)((crc << 1) ^ ((crc & 0x8000) ? poly16 : 0)), bits - 1);
+    }
+    // Push one zero byte through the CRC
+    static constexpr uint16_t zeroByte(uint16_t crc)
+    {
+        return (uint16_t)(crc << 8) ^ bitStep((uint16_t)(crc & 0xFF00), 8);
+    }
+    static constexpr uint16_t entry(uint8_t k, uint16_t b)
+    {
+        return k == 0 ? bitStep((uint16_t)(b << 8), 8) : zeroByte(entry(k - 1, b));
+    }
+    template <uint16_t... Is>
+    struct Tables
+    {
+        static constexpr uint16_t table[sizeof...(Is)] = { entry(Is / 256, Is % 256)... };
+    };
+    template <uint16_t... Is>
+    static constexpr const uint16_t *tablesFor(CrcIndexSeq<Is...>) { return Tables<Is...>::table; }
+
+    static inline __attribute__((always_inline)) const uint16_t *tab() { return tablesFor(typename CrcMakeSeq<slices * 256>::type()); }
 
 public:
-    GENERIC_CRC14(uint16_t poly);
-    uint16_t calc(uint8_t *data, uint8_t len, uint16_t crc);
-    uint16_t calc(volatile uint8_t *data, uint8_t len, uint16_t crc);
+    inline __attribute__((always_inline)) uint16_t calc(const uint8_t *data, uint8_t len, uint16_t crc) const
+    {
+        return slices == CRC14_SLICES ? crc14Calc(tab(), data, len, crc) : Crc14Slicer<slices>::calc(tab(), data, len, crc);
+    }
+    inline __attribute__((always_inline)) uint16_t calc(const volatile uint8_t *data, uint8_t len, uint16_t crc) const
+    {
+        return slices == CRC14_SLICES ? crc14Calc(tab(), data, len, crc) : Crc14Slicer<slices>::calc(tab(), data, len, crc);
+    }
 };
+
+template <uint16_t poly, uint8_t slices>
+template <uint16_t... Is>
+constexpr uint16_t GENERIC_CRC14<poly, slices>::Tables<Is...>::table[sizeof...(Is)];
@@ -1,8 +1,9 @@
 #include "CRSF.h"
-#include "FIFO.h"
+#include "PacketFIFO.h"
 #include "telemetry_protocol.h"
 #include "logging.h"
 #include "helpers.h"
+#include "ISRTIMING.h"
 
 #if defined(PLATFORM_ESP32)
 #include "device.h"
@@ -10,7 +11,6 @@
 // UART0 is used since for DupleTX we can connect directly through IO_MUX and not the Matrix
 // for better performance, and on other targets (mostly using pin 13), it always uses Matrix
 HardwareSerial CRSF::Port(0);
-portMUX_TYPE FIFOmux = portMUX_INITIALIZER_UNLOCKED;
 
 RTC_DATA_ATTR int rtcModelId = 0;
 #elif defined(PLATFORM_ESP8266)
@@ -29,10 +29,10 @@ HardwareSerial CRSF::Port = Serial;
 #endif
 Stream *CRSF::PortSecondary;
 
-GENERIC_CRC8 crsf_crc(CRSF_CRC_POLY);
+CRSF_CRC8 crsf_crc;
 
-///Out FIFO to buffer messages///
-static FIFO SerialOutFIFO;
+///Out FIFO to buffer messages, filled by the loop and emptied by handleUARTout() or the RX timer ISR///
+static PacketFIFO<256> SerialOutFIFO;
 
 volatile uint16_t CRSF::ChannelDataIn[16] = {0};
 
@@ -43,7 +43,35 @@ volatile crsfPayloadLinkstatistics_s CRSF::LinkStatistics;
 #if CRSF_TX_MODULE
 #define HANDSET_TELEMETRY_FIFO_SIZE 128 // this is the smallest telemetry FIFO size in ETX with CRSF defined
 
-static FIFO MspWriteFIFO;
+static PacketFIFO<1024> MspWriteFIFO;
+
+// PacketFIFO takes one producer at a time. On the ESP32 the TX queues from the
+// CRSF input on core 0 and from lua and the devices on core 1, so everything
+// from reserve() to commit() goes under the lock.
+#if defined(PLATFORM_ESP32)
+// The CRSF input has a task of its own on core 0 so the device task can sleep
+// between timeouts. It spins, as the handset frames are taken and timestamped
+// for the OpenTX sync as they come in, at idle priority so the device task
+// preempts it whenever it wakes. End() clears inputTaskRun and waits for it to go.
+static TaskHandle_t xInputTask = NULL;
+static volatile bool inputTaskRun;
+static void inputTask(void *pvArgs)
+{
+    while (inputTaskRun)
+    {
+        CRSF::handleUARTin();
+    }
+    xInputTask = NULL;
+    vTaskDelete(NULL);
+}
+
+static portMUX_TYPE FIFOmux = portMUX_INITIALIZER_UNLOCKED;
+#define FIFO_PRODUCER_LOCK() portENTER_CRITICAL(&FIFOmux)
+#define FIFO_PRODUCER_UNLOCK() portEXIT_CRITICAL(&FIFOmux)
+#else
+#define FIFO_PRODUCER_LOCK()
+#define FIFO_PRODUCER_UNLOCK()
+#endif
 
 void inline CRSF::nullCallback(void) {}
 
@@ -129,6 +157,8 @@ void CRSF::Begin()
         modelId = rtcModelId;
         RecvModelUpdate();
     }
+    inputTaskRun = true;
+    xTaskCreatePinnedToCore(inputTask, "crsfInputTask", 3000, NULL, 0, &xInputTask, 0);
 #elif defined(PLATFORM_ESP8266)
     CRSF::Port.flush();
     CRSF::Port.updateBaudRate(TxToHandsetBauds[UARTcurrentBaudIdx]);
@@ -162,6 +192,10 @@ void CRSF::Begin()
     USART2->CR1 &= ~USART_CR1_UE;
     USART2->CR2 |= USART_CR2_RXINV | USART_CR2_TXINV; //inverted
     USART2->CR1 |= USART_CR1_UE;
+#endif
+#if defined(CRSF_RX_DMA_ACTIVE)
+    // handleUARTin() restarts it after baud changes and UART errors
+    CRSFRxDMA::start(CRSF::Port);
 #endif
     DBGLN("STM32 CRSF UART LISTEN TASK STARTED");
     CRSF::Port.flush();
@@ -177,8 +211,15 @@ void CRSF::Begin()
 void CRSF::End()
 {
 #if CRSF_TX_MODULE
+#if defined(PLATFORM_ESP32)
+    inputTaskRun = false;
+    while (xInputTask)
+    {
+        vTaskDelay(1);
+    }
+#endif
     uint32_t startTime = millis();
-    while (SerialOutFIFO.peek() > 0)
+    while (!SerialOutFIFO.empty())
     {
         handleUARTin();
         if (millis() - startTime > 1000)
@@ -193,6 +234,9 @@ void CRSF::End()
 
 void CRSF::flush_port_input(void)
 {
+#if defined(CRSF_RX_DMA_ACTIVE)
+    CRSFRxDMA::ring.flush(CRSFRxDMA::writePos());
+#endif
     // Make sure there is no garbage on the UART at the start
     while (CRSF::Port.available())
     {
@@ -208,28 +252,25 @@ void ICACHE_RAM_ATTR CRSF::sendLinkStatisticsToTX()
         return;
     }
 
-    constexpr uint8_t outBuffer[4] = {
-        LinkStatisticsFrameLength + 4,
+    constexpr uint8_t outBuffer[3] = {
         CRSF_ADDRESS_RADIO_TRANSMITTER,
         LinkStatisticsFrameLength + 2,
         CRSF_FRAMETYPE_LINK_STATISTICS
     };
 
-    uint8_t crc = crsf_crc.calc(outBuffer[3]);
+    uint8_t crc = crsf_crc.calc(outBuffer[2]);
     crc = crsf_crc.calc((byte *)&LinkStatistics, LinkStatisticsFrameLength, crc);
 
-#ifdef PLATFORM_ESP32
-    portENTER_CRITICAL(&FIFOmux);
-#endif
-    if (SerialOutFIFO.ensure(outBuffer[0] + 1))
+    FIFO_PRODUCER_LOCK();
+    uint8_t *out = SerialOutFIFO.reserve(sizeof(outBuffer) + LinkStatisticsFrameLength + 1);
+    if (out != nullptr)
     {
-        SerialOutFIFO.pushBytes(outBuffer, sizeof(outBuffer));
-        SerialOutFIFO.pushBytes((byte *)&LinkStatistics, LinkStatisticsFrameLength);
-        SerialOutFIFO.push(crc);
+        memcpy(out, outBuffer, sizeof(outBuffer));
+        memcpy(out + sizeof(outBuffer), (byte *)&LinkStatistics, LinkStatisticsFrameLength);
+        out[sizeof(outBuffer) + LinkStatisticsFrameLength] = crc;
+        SerialOutFIFO.commit();
     }
-#ifdef PLATFORM_ESP32
-    portEXIT_CRITICAL(&FIFOmux);
-#endif
+    FIFO_PRODUCER_UNLOCK();
 }
 
 /**
@@ -241,8 +282,7 @@ void CRSF::packetQueueExtended(uint8_t type, void *data, uint8_t len)
     if (!CRSF::CRSFstate)
         return;
 
-    uint8_t buf[6] = {
-        (uint8_t)(len + 6),
+    uint8_t buf[5] = {
         CRSF_ADDRESS_RADIO_TRANSMITTER,
         (uint8_t)(len + 4),
         type,
@@ -251,21 +291,19 @@ void CRSF::packetQueueExtended(uint8_t type, void *data, uint8_t len)
     };
 
     // CRC - Starts at type, ends before CRC
-    uint8_t crc = crsf_crc.calc(&buf[3], sizeof(buf)-3);
+    uint8_t crc = crsf_crc.calc(&buf[2], sizeof(buf)-2);
     crc = crsf_crc.calc((byte *)data, len, crc);
 
-#ifdef PLATFORM_ESP32
-    portENTER_CRITICAL(&FIFOmux);
-#endif
-    if (SerialOutFIFO.ensure(buf[0] + 1))
+    FIFO_PRODUCER_LOCK();
+    uint8_t *out = SerialOutFIFO.reserve(sizeof(buf) + len + 1);
+    if (out != nullptr)
     {
-        SerialOutFIFO.pushBytes(buf, sizeof(buf));
-        SerialOutFIFO.pushBytes((byte *)data, len);
-        SerialOutFIFO.push(crc);
+        memcpy(out, buf, sizeof(buf));
+        memcpy(out + sizeof(buf), data, len);
+        out[sizeof(buf) + len] = crc;
+        SerialOutFIFO.commit();
     }
-#ifdef PLATFORM_ESP32
-    portEXIT_CRITICAL(&FIFOmux);
-#endif
+    FIFO_PRODUCER_UNLOCK();
 }
 
 void ICACHE_RAM_ATTR CRSF::sendTelemetryToTX(uint8_t *data)
@@ -279,18 +317,9 @@ void ICACHE_RAM_ATTR CRSF::sendTelemetryToTX(uint8_t *data)
     if (CRSF::CRSFstate)
     {
         data[0] = CRSF_ADDRESS_RADIO_TRANSMITTER;
-#ifdef PLATFORM_ESP32
-        portENTER_CRITICAL(&FIFOmux);
-#endif
-        uint8_t size = CRSF_FRAME_SIZE(data[CRSF_TELEMETRY_LENGTH_INDEX]);
-        if (SerialOutFIFO.ensure(size + 1))
-        {
-            SerialOutFIFO.push(size); // length
-            SerialOutFIFO.pushBytes(data, size);
-        }
-#ifdef PLATFORM_ESP32
-        portEXIT_CRITICAL(&FIFOmux);
-#endif
+        FIFO_PRODUCER_LOCK();
+        SerialOutFIFO.push(data, CRSF_FRAME_SIZE(data[CRSF_TELEMETRY_LENGTH_INDEX]));
+        FIFO_PRODUCER_UNLOCK();
     }
 }
 
@@ -377,9 +406,8 @@ void ICACHE_RAM_ATTR CRSF::sendSyncPacketToTX() // in values in us.
     }
 }
 
-void ICACHE_RAM_ATTR CRSF::GetChannelDataIn() // data is packed as 11 bits per channel
+void ICACHE_RAM_ATTR CRSF::GetChannelDataIn(const volatile crsf_channels_t *rcChannels) // data is packed as 11 bits per channel
 {
-    const volatile crsf_channels_t *rcChannels = &CRSF::inBuffer.asRCPacket_t.channels;
     ChannelDataIn[0] = (rcChannels->ch0);
     ChannelDataIn[1] = (rcChannels->ch1);
     ChannelDataIn[2] = (rcChannels->ch2);
@@ -398,7 +426,7 @@ void ICACHE_RAM_ATTR CRSF::GetChannelDataIn() // data is packed as 11 bits per c
     ChannelDataIn[15] = (rcChannels->ch15);
 }
 
-bool ICACHE_RAM_ATTR CRSF::ProcessPacket()
+bool ICACHE_RAM_ATTR CRSF::ProcessPacket(const volatile uint8_t *SerialInBuffer, uint32_t frameTime)
 {
     bool packetReceived = false;
 
@@ -415,13 +443,12 @@ bool ICACHE_RAM_ATTR CRSF::ProcessPacket()
         connected();
     }
 
-    const uint8_t packetType = CRSF::inBuffer.asRCPacket_t.header.type;
-    volatile uint8_t *SerialInBuffer = CRSF::inBuffer.asUint8_t;
+    const uint8_t packetType = SerialInBuffer[2];
 
     if (packetType == CRSF_FRAMETYPE_RC_CHANNELS_PACKED)
     {
-        CRSF::RCdataLastRecv = micros();
-        GetChannelDataIn();
+        CRSF::RCdataLastRecv = frameTime;
+        GetChannelDataIn((const volatile crsf_channels_t *)&SerialInBuffer[sizeof(crsf_header_t)]);
         packetReceived = true;
     }
     // check for all extended frames that are a broadcast or a message to the FC
@@ -433,7 +460,7 @@ bool ICACHE_RAM_ATTR CRSF::ProcessPacket()
         // unless connected
         if (ForwardDevicePings || packetType != CRSF_FRAMETYPE_DEVICE_PING)
         {
-            const uint8_t length = CRSF::inBuffer.asRCPacket_t.header.frame_size + 2;
+            const uint8_t length = SerialInBuffer[1] + 2;
             AddMspMessage(length, SerialInBuffer);
         }
         packetReceived = true;
@@ -469,6 +496,20 @@ bool ICACHE_RAM_ATTR CRSF::ProcessPacket()
 
 void CRSF::GetMspMessage(uint8_t **data, uint8_t *len)
 {
+    // Batch up as many of the queued writes as fit, unless the message has
+    // already been handed out
+    if (MspDataLength == 0)
+    {
+        uint8_t queuedLen;
+        const uint8_t *queued;
+        while ((queued = MspWriteFIFO.peek(queuedLen)) != nullptr && MspDataLength + queuedLen <= ELRS_MSP_BUFFER)
+        {
+            memcpy(&MspData[MspDataLength], queued, queuedLen);
+            MspDataLength += queuedLen;
+            MspWriteFIFO.consume();
+        }
+    }
+
     *len = MspDataLength;
     *data = (MspDataLength > 0) ? MspData : nullptr;
 }
@@ -482,26 +523,17 @@ void CRSF::ResetMspQueue()
 
 void CRSF::UnlockMspMessage()
 {
-    // current msp message is sent so restore next buffered write
-    if (MspWriteFIFO.peek() > 0)
-    {
-        uint8_t length = MspWriteFIFO.pop();
-        MspDataLength = length;
-        MspWriteFIFO.popBytes(MspData, length);
-    }
-    else
-    {
-        // no msp message is ready to send currently
-        MspDataLength = 0;
-        memset(MspData, 0, ELRS_MSP_BUFFER);
-    }
+    // current msp message is sent, the next one is put together from the
+    // buffered writes by GetMspMessage()
+    MspDataLength = 0;
+    memset(MspData, 0, ELRS_MSP_BUFFER);
 }
 
-void ICACHE_RAM_ATTR CRSF::AddMspMessage(mspPacket_t* packet)
+bool ICACHE_RAM_ATTR CRSF::AddMspMessage(mspPacket_t* packet)
 {
     if (packet->payloadSize > ENCAPSULATED_MSP_MAX_PAYLOAD_SIZE)
     {
-        return;
+        return false;
     }
 
     const uint8_t totalBufferLen = packet->payloadSize + ENCAPSULATED_MSP_HEADER_CRC_LEN + CRSF_FRAME_LENGTH_EXT_TYPE_CRC + CRSF_FRAME_NOT_COUNTED_BYTES;
@@ -515,7 +547,7 @@ void ICACHE_RAM_ATTR CRSF::AddMspMessage(mspPacket_t* packet)
     outBuffer[4] = CRSF_ADDRESS_RADIO_TRANSMITTER;                              // origin
 
     // Encapsulated MSP payload
-    outBuffer[5] = 0x30;                // header
+    outBuffer[5] = ENCAPSULATED_MSP_STATUS_VERSION_1 | ENCAPSULATED_MSP_STATUS_START; // header
     outBuffer[6] = packet->payloadSize; // mspPayloadSize
     outBuffer[7] = packet->function;    // packet->cmd
     for (uint8_t i = 0; i < packet->payloadSize; ++i)
@@ -528,45 +560,61 @@ void ICACHE_RAM_ATTR CRSF::AddMspMessage(mspPacket_t* packet)
 
     // CRSF frame crc
     outBuffer[totalBufferLen - 1] = crsf_crc.calc(&outBuffer[2], packet->payloadSize + ENCAPSULATED_MSP_HEADER_CRC_LEN + CRSF_FRAME_LENGTH_EXT_TYPE_CRC - 1);
-    AddMspMessage(totalBufferLen, outBuffer);
+    return AddMspMessage(totalBufferLen, outBuffer);
 }
 
-void ICACHE_RAM_ATTR CRSF::AddMspMessage(const uint8_t length, volatile uint8_t* data)
+bool ICACHE_RAM_ATTR CRSF::AddMspMessage(const uint8_t length, const volatile uint8_t* data)
 {
     if (length > ELRS_MSP_BUFFER)
     {
-        return;
+        return false;
     }
 
-    // store next msp message
-    if (MspDataLength == 0)
+    // store all write requests since an update does send multiple writes,
+    // when the queue is full the new one is dropped
+    FIFO_PRODUCER_LOCK();
+    uint8_t *queued = MspWriteFIFO.reserve(length);
+    if (queued != nullptr)
     {
         for (uint8_t i = 0; i < length; i++)
         {
-            MspData[i] = data[i];
-        }
-        MspDataLength = length;
-    }
-    // store all write requests since an update does send multiple writes
-    else
-    {
-        if (MspWriteFIFO.ensure(length + 1))
-        {
-            MspWriteFIFO.push(length);
-            MspWriteFIFO.pushBytes((const uint8_t *)data, length);
+            queued[i] = data[i];
         }
+        MspWriteFIFO.commit();
     }
+    FIFO_PRODUCER_UNLOCK();
+    return queued != nullptr;
 }
 
 void ICACHE_RAM_ATTR CRSF::handleUARTin()
 {
-    uint8_t *SerialInBuffer = CRSF::inBuffer.asUint8_t;
+    ISR_TIMING_SCOPE(isrCRSFin);
 
     if (UARTwdt())
     {
         return;
     }
 
+#if defined(CRSF_RX_DMA_ACTIVE)
+    if (!CRSFRxDMA::running())
+    {
+        CRSFRxDMA::start(CRSF::Port);
+    }
+
+    const volatile uint8_t *frame;
+    while ((frame = CRSFRxDMA::ring.nextFrame(crsf_crc, BadPktsCount)) != nullptr)
+    {
+        GoodPktsCount++;
+        // Timestamped by the idle line interrupt instead of when the loop got here
+        if (ProcessPacket(frame, CRSFRxDMA::ring.frameTime()))
+        {
+            handleUARTout();
+            RCdataCallback();
+        }
+    }
+#else
+    uint8_t *SerialInBuffer = CRSF::inBuffer.asUint8_t;
+
     while (CRSF::Port.available())
     {
         if (CRSFframeActive == false)
@@ -631,12 +679,12 @@ void ICACHE_RAM_ATTR CRSF::handleUARTin()
 
             if (SerialInPacketPtr >= (SerialInPacketLen + 2)) // plus 2 because the packlen is referenced from the start of the 'type' flag, IE there are an extra 2 bytes.
             {
-                char CalculatedCRC = crsf_crc.calc(SerialInBuffer + 2, SerialInPacketPtr - 3);
+                uint8_t CalculatedCRC = crsf_crc.calc(SerialInBuffer + 2, SerialInPacketPtr - 3);
 
                 if (CalculatedCRC == SerialInBuffer[SerialInPacketPtr-1])
                 {
                     GoodPktsCount++;
-                    if (ProcessPacket())
+                    if (ProcessPacket(SerialInBuffer, micros()))
                     {
                         //delayMicroseconds(50);
                         handleUARTout();
@@ -656,6 +704,7 @@ void ICACHE_RAM_ATTR CRSF::handleUARTin()
             }
         }
     }
+#endif // CRSF_RX_DMA_ACTIVE
 }
 
 void ICACHE_RAM_ATTR CRSF::handleUARTout()
@@ -670,24 +719,17 @@ void ICACHE_RAM_ATTR CRSF::handleUARTout()
     }
 
     // if partial package remaining, or data in the output FIFO that needs to be written
-    if (packageLengthRemaining > 0 || SerialOutFIFO.size() > 0) {
+    if (packageLengthRemaining > 0 || !SerialOutFIFO.empty()) {
         duplex_set_TX();
 
         uint8_t periodBytesRemaining = maxPeriodBytes;
         while (periodBytesRemaining)
         {
-#ifdef PLATFORM_ESP32
-            portENTER_CRITICAL(&FIFOmux); // stops other tasks from writing to the FIFO when we want to read it
-#endif
             // no package is in transit so get new data from the fifo
             if (packageLengthRemaining == 0) {
-                packageLengthRemaining = SerialOutFIFO.pop();
-                SerialOutFIFO.popBytes(CRSFoutBuffer, packageLengthRemaining);
+                packageLengthRemaining = SerialOutFIFO.pop(CRSFoutBuffer, sizeof(CRSFoutBuffer));
                 sendingOffset = 0;
             }
-#ifdef PLATFORM_ESP32
-            portEXIT_CRITICAL(&FIFOmux); // stops other tasks from writing to the FIFO when we want to read it
-#endif
 
             // if the package is long we need to split it up so it fits in the sending interval
             uint8_t writeLength;
@@ -710,7 +752,7 @@ void ICACHE_RAM_ATTR CRSF::handleUARTout()
             periodBytesRemaining -= writeLength;
 
             // No bytes left to send, exit
-            if (SerialOutFIFO.size() == 0)
+            if (SerialOutFIFO.empty())
                 break;
         }
         CRSF::Port.flush();
@@ -861,19 +903,13 @@ bool CRSF::UARTwdt()
 bool CRSF::RXhandleUARTout()
 {
 #if !defined(CRSF_RCVR_NO_SERIAL)
-    uint8_t peekVal = SerialOutFIFO.peek(); // check if we have data in the output FIFO that needs to be written
-    if (peekVal > 0)
+    uint8_t OutPktLen;
+    const uint8_t *OutData = SerialOutFIFO.peek(OutPktLen); // check if we have data in the output FIFO that needs to be written
+    if (OutData != nullptr)
     {
-        if (SerialOutFIFO.size() > (peekVal))
-        {
-            noInterrupts();
-            uint8_t OutPktLen = SerialOutFIFO.pop();
-            uint8_t OutData[OutPktLen];
-            SerialOutFIFO.popBytes(OutData, OutPktLen);
-            interrupts();
-            this->_dev->write(OutData, OutPktLen); // write the packet out
-            return true;
-        }
+        this->_dev->write(OutData, OutPktLen); // write the packet out
+        SerialOutFIFO.consume();
+        return true;
     }
 #endif // CRSF_RCVR_NO_SERIAL
     return false;
@@ -882,20 +918,22 @@ bool CRSF::RXhandleUARTout()
 void ICACHE_RAM_ATTR CRSF::sendLinkStatisticsToFC()
 {
 #if !defined(CRSF_RCVR_NO_SERIAL) && !defined(DEBUG_CRSF_NO_OUTPUT)
-    constexpr uint8_t outBuffer[4] = {
-        LinkStatisticsFrameLength + 4,
+    constexpr uint8_t outBuffer[3] = {
         CRSF_ADDRESS_FLIGHT_CONTROLLER,
         LinkStatisticsFrameLength + 2,
         CRSF_FRAMETYPE_LINK_STATISTICS
     };
 
-    uint8_t crc = crsf_crc.calc(outBuffer[3]);
+    uint8_t crc = crsf_crc.calc(outBuffer[2]);
     crc = crsf_crc.calc((byte *)&LinkStatistics, LinkStatisticsFrameLength, crc);
 
-    if (SerialOutFIFO.ensure(outBuffer[0] + 1)) {
-        SerialOutFIFO.pushBytes(outBuffer, sizeof(outBuffer));
-        SerialOutFIFO.pushBytes((byte *)&LinkStatistics, LinkStatisticsFrameLength);
-        SerialOutFIFO.push(crc);
+    uint8_t *out = SerialOutFIFO.reserve(sizeof(outBuffer) + LinkStatisticsFrameLength + 1);
+    if (out != nullptr)
+    {
+        memcpy(out, outBuffer, sizeof(outBuffer));
+        memcpy(out + sizeof(outBuffer), (byte *)&LinkStatistics, LinkStatisticsFrameLength);
+        out[sizeof(outBuffer) + LinkStatisticsFrameLength] = crc;
+        SerialOutFIFO.commit();
     }
 
     //this->_dev->write(outBuffer, LinkStatisticsFrameLength + 4);
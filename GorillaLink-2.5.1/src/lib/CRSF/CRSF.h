@@ -10,7 +10,9 @@
 #include "msptypes.h"
 #include "LowPassFilter.h"
 #include "../CRC/crc.h"
+#include "../CRC/STM32_crc.h"
 #include "telemetry_protocol.h"
+#include "CRSFRxDMA.h"
 
 #ifdef PLATFORM_ESP32
 #include "esp32-hal-uart.h"
@@ -96,8 +98,8 @@ public:
 
     static void GetMspMessage(uint8_t **data, uint8_t *len);
     static void UnlockMspMessage();
-    static void AddMspMessage(const uint8_t length, volatile uint8_t* data);
-    static void AddMspMessage(mspPacket_t* packet);
+    static bool AddMspMessage(const uint8_t length, const volatile uint8_t* data);
+    static bool AddMspMessage(mspPacket_t* packet);
     static void ResetMspQueue();
     static volatile uint32_t OpenTXsyncLastSent;
     static uint8_t GetMaxPacketBytes() { return maxPacketBytes; }
@@ -105,7 +107,7 @@ public:
 
     static uint32_t ICACHE_RAM_ATTR GetRCdataLastRecv();
     static void ICACHE_RAM_ATTR updateSwitchValues();
-    static void ICACHE_RAM_ATTR GetChannelDataIn();
+    static void ICACHE_RAM_ATTR GetChannelDataIn(const volatile crsf_channels_t *rcChannels);
     #endif
 
     #ifdef CRSF_RX_MODULE
@@ -153,7 +155,7 @@ private:
     static void ICACHE_RAM_ATTR adjustMaxPacketSize();
     static void duplex_set_RX();
     static void duplex_set_TX();
-    static bool ProcessPacket();
+    static bool ProcessPacket(const volatile uint8_t *SerialInBuffer, uint32_t frameTime);
     static void handleUARTout();
     static bool UARTwdt();
 #endif
@@ -161,6 +163,12 @@ private:
     static void flush_port_input(void);
 };
 
-extern GENERIC_CRC8 crsf_crc;
+// USE_HARDWARE_CRC8 moves the CRSF CRC onto the MCU's CRC unit where there is one
+#if defined(USE_HARDWARE_CRC8) && defined(HAS_HW_CRC8)
+typedef HW_CRC8<CRSF_CRC_POLY, STM32_CrcUnit> CRSF_CRC8;
+#else
+typedef GENERIC_CRC8<CRSF_CRC_POLY> CRSF_CRC8;
+#endif
+extern CRSF_CRC8 crsf_crc;
 
 #endif
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <stdint.h>
+#include "targets.h"
+#include "crsf_protocol.h"
+
+#if !defined(CRSF_RX_RING_SIZE)
+#define CRSF_RX_RING_SIZE 256
+#endif
+
+/**
+ * Receive buffer of a CRSF UART that a DMA channel writes into circularly.
+ * The UART's idle line interrupt calls markIdle() with the DMA write position,
+ * the handset sends each frame in one burst so every idle gap is a frame
+ * boundary. nextFrame() validates the frames up to the last boundary where
+ * they lie in the buffer, only a frame that wraps around the end is copied.
+ **/
+template <uint16_t size>
+class CRSFRxRing
+{
+    static_assert((size & (size - 1)) == 0, "CRSF RX ring size must be a power of two");
+    static_assert(size >= 4 * CRSF_MAX_PACKET_LEN, "CRSF RX ring must hold several frames");
+
+    static constexpr uint16_t mask = size - 1;
+
+public:
+    volatile uint8_t buffer[size]; // written by the DMA
+
+    // The DMA (re)starts writing at the beginning of the buffer
+    void reset()
+    {
+        readPos = 0;
+        idlePos = 0;
+        idleTime = 0;
+        ++idleSeq;
+    }
+
+    // From the idle line interrupt, time is when the bus went idle after the frame
+    void ICACHE_RAM_ATTR markIdle(uint16_t writePos, uint32_t time)
+    {
+        idlePos = writePos & mask;
+        idleTime = time;
+        ++idleSeq;
+    }
+
+    // Drop everything received up to the current DMA write position
+    void flush(uint16_t writePos)
+    {
+        readPos = writePos & mask;
+        idlePos = readPos;
+    }
+
+    // Time of the idle line that ended the last frame returned by nextFrame()
+    uint32_t frameTime() const { return frameIdleTime; }
+
+    /**
+     * Returns the next frame with a valid CRC that the idle line has marked
+     * complete, or nullptr. The frame stays valid until the DMA comes around
+     * the ring again. A bad CRC or a burst that ends mid frame drops the rest
+     * of that burst and counts in badFrames.
+     **/
+    template <class CRC>
+    const volatile uint8_t *nextFrame(const CRC &crc, uint32_t &badFrames)
+    {
+        // The interrupt can mark a new boundary at any time, take a consistent copy
+        uint16_t end;
+        uint8_t seq;
+        do
+        {
+            seq = idleSeq;
+            end = idlePos;
+            frameIdleTime = idleTime;
+        } while (seq != idleSeq);
+
+        while (readPos != end)
+        {
+            const uint16_t available = (end - readPos) & mask;
+            const uint8_t sync = buffer[readPos];
+            if (sync != CRSF_ADDRESS_CRSF_TRANSMITTER && sync != CRSF_SYNC_BYTE)
+            {
+                readPos = (readPos + 1) & mask;
+                continue;
+            }
+            if (available < 2)
+            {
+                break;
+            }
+            const uint8_t frameSize = buffer[(readPos + 1) & mask];
+            if (frameSize < 2 || frameSize > CRSF_MAX_PACKET_LEN - CRSF_FRAME_NOT_COUNTED_BYTES)
+            {
+                readPos = (readPos + 1) & mask;
+                continue;
+            }
+            const uint8_t len = frameSize + CRSF_FRAME_NOT_COUNTED_BYTES;
+            if (available < len)
+            {
+                break;
+            }
+
+            const volatile uint8_t *frame = &buffer[readPos];
+            if (readPos + len > size)
+            {
+                for (uint8_t i = 0; i < len; ++i)
+                {
+                    wrapped[i] = buffer[(readPos + i) & mask];
+                }
+                frame = wrapped;
+            }
+            readPos = (readPos + len) & mask;
+
+            // The DMA is writing behind the idle mark, so the frame can be read as plain memory
+            if (crc.calc((const uint8_t *)frame + 2, len - 3) == frame[len - 1])
+            {
+                return frame;
+            }
+            ++badFrames;
+            readPos = end;
+            return nullptr;
+        }
+
+        if (readPos != end)
+        {
+            ++badFrames;
+            readPos = end;
+        }
+        return nullptr;
+    }
+
+private:
+    uint16_t readPos;
+    volatile uint16_t idlePos;
+    volatile uint32_t idleTime;
+    volatile uint8_t idleSeq;
+    uint32_t frameIdleTime;
+    uint8_t wrapped[CRSF_MAX_PACKET_LEN];
+};
+
+/**
+ * A UART RX DMA channel in circular mode with the idle line interrupt on
+ * (see STM32_CRSFRxDMA.cpp). The target selects the channel that serves its
+ * CRSF UART with CRSF_RX_DMA_CHANNEL, CRSF_RX_DMA_IRQn and
+ * CRSF_RX_DMA_IRQHandler, USE_CRSF_RX_DMA then switches the TX module's CRSF
+ * input from the byte wise Port.read() loop to the ring.
+ **/
+#if defined(PLATFORM_STM32) && defined(CRSF_RX_DMA_CHANNEL)
+#define HAS_CRSF_RX_DMA
+#endif
+
+#if defined(USE_CRSF_RX_DMA) && defined(HAS_CRSF_RX_DMA) && defined(CRSF_TX_MODULE)
+#define CRSF_RX_DMA_ACTIVE
+
+class CRSFRxDMA
+{
+public:
+    static CRSFRxRing<CRSF_RX_RING_SIZE> ring;
+
+    // Take over reception from the port, again after every port.begin()
+    static void start(HardwareSerial &port);
+    // false once a UART error has stopped the transfer
+    static bool running();
+    static uint16_t writePos();
+};
+#endif
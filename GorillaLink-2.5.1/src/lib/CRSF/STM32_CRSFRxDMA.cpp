@@ -0,0 +1,77 @@
+#include "CRSF.h"
+
+#if defined(PLATFORM_STM32) && defined(CRSF_RX_DMA_ACTIVE)
+
+CRSFRxRing<CRSF_RX_RING_SIZE> CRSFRxDMA::ring;
+
+static DMA_HandleTypeDef hdmaRx;
+static UART_HandleTypeDef *huartRx = nullptr;
+
+// The core keeps the UART handle in a protected member and services the UART
+// interrupt with it, the DMA reception has to run on that same handle
+class HardwareSerialHandle : public HardwareSerial
+{
+public:
+    static UART_HandleTypeDef *of(HardwareSerial &port)
+    {
+        return &(static_cast<HardwareSerialHandle &>(port)._serial.handle);
+    }
+};
+
+extern "C" void CRSF_RX_DMA_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&hdmaRx);
+}
+
+// Called by HAL_UART_IRQHandler() when the line goes idle after a frame
+extern "C" void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    if (huart == huartRx)
+    {
+        CRSFRxDMA::ring.markIdle(CRSFRxDMA::writePos(), micros());
+    }
+}
+
+void CRSFRxDMA::start(HardwareSerial &port)
+{
+    huartRx = HardwareSerialHandle::of(port);
+    // HardwareSerial receives one byte per interrupt, stop that
+    HAL_UART_AbortReceive(huartRx);
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    hdmaRx.Instance = CRSF_RX_DMA_CHANNEL;
+    hdmaRx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    hdmaRx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdmaRx.Init.MemInc = DMA_MINC_ENABLE;
+    hdmaRx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdmaRx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdmaRx.Init.Mode = DMA_CIRCULAR;
+    hdmaRx.Init.Priority = DMA_PRIORITY_HIGH;
+    HAL_DMA_DeInit(&hdmaRx);
+    HAL_DMA_Init(&hdmaRx);
+    __HAL_LINKDMA(huartRx, hdmarx, hdmaRx);
+
+    HAL_NVIC_SetPriority(CRSF_RX_DMA_IRQn, 1, 0);
+    HAL_NVIC_EnableIRQ(CRSF_RX_DMA_IRQn);
+
+    ring.reset();
+    HAL_UARTEx_ReceiveToIdle_DMA(huartRx, (uint8_t *)ring.buffer, CRSF_RX_RING_SIZE);
+    // Only the idle line marks a frame boundary, reaching half or the end of
+    // the buffer is just a position in the ring
+    __HAL_DMA_DISABLE_IT(&hdmaRx, DMA_IT_HT | DMA_IT_TC);
+}
+
+bool CRSFRxDMA::running()
+{
+    // Overrun and DMA errors abort the reception, the core may also rearm its own
+    return huartRx != nullptr &&
+           huartRx->RxState == HAL_UART_STATE_BUSY_RX &&
+           huartRx->ReceptionType == HAL_UART_RECEPTION_TOIDLE;
+}
+
+uint16_t ICACHE_RAM_ATTR CRSFRxDMA::writePos()
+{
+    return (CRSF_RX_RING_SIZE - __HAL_DMA_GET_COUNTER(&hdmaRx)) & (CRSF_RX_RING_SIZE - 1);
+}
+
+#endif
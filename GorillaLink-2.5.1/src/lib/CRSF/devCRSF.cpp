@@ -12,7 +12,12 @@ static int start()
     crsf.CRSFstate = true;
     UARTconnected();
 #endif
+#if defined(PLATFORM_ESP32)
+    // Begin() started a task for the input
+    return DURATION_NEVER;
+#else
     return DURATION_IMMEDIATELY;
+#endif
 }
 
 static int timeout()
@@ -25,6 +30,7 @@ device_t CRSF_device = {
     .initialize = nullptr,
     .start = start,
     .event = nullptr,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = 0
 };
 #endif
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "crc.h"
+
+/**
+ * Double buffered config storage that is written a slice at a time. The
+ * storage is split into two slots, each holding a copy of the config with a
+ * footer at the end of the slot: a sequence number, the length and a CRC of
+ * the three. Load() takes the good copy with the highest sequence number.
+ *
+ * Write() programs the config into the slot not holding the newest copy,
+ * and the footer last, so a slot only becomes good once all of it is there.
+ * It writes straight from the caller's config and returns once it is done.
+ * StagedConfigStore takes a copy instead, for Poll() to program
+ * CONFIG_STORE_SLICE_SIZE bytes of at a time while the config keeps changing.
+ *
+ * Losing power part way leaves the old copy or the new one where the writes
+ * to one slot can't touch the other: byte writes (I2C EEPROM), storage that
+ * commits atomically (ESP32 NVS) or appends (the STM32 FlashLog), or slots in
+ * separate erase units. Where both slots share the unit Commit() erases (the
+ * ESP8266 EEPROM sector, the STM32 EEPROM page) power lost between the erase
+ * and the program takes both, as it would a single copy.
+ *
+ * The storage is anything with ReadByte(), WriteByte() and Commit() like
+ * ELRS_EEPROM. Commit() is only called once, by the last Poll() after the
+ * footer has been written, for storage that buffers the writes until then.
+ **/
+
+#ifndef CONFIG_STORE_SLICE_SIZE
+#define CONFIG_STORE_SLICE_SIZE 16
+#endif
+// Same as ELRS_CRC14_POLY
+#define CONFIG_STORE_CRC14_POLY 0x2E57
+
+template <class Storage, uint16_t slotSize>
+class ConfigStore
+{
+public:
+    typedef struct {
+        uint32_t sequence;
+        uint16_t length;
+        uint16_t crc;
+    } footer_t;
+
+    static constexpr uint16_t maxLength = slotSize - sizeof(footer_t);
+
+    ConfigStore() : storage(nullptr), source(nullptr), sequence(0), newest(-1), length(0), written(0), footerWritten(false), pending(false) {}
+
+    void SetStorageProvider(Storage *provider) { storage = provider; }
+
+    // Copy the newest good config of length bytes to data, false if neither slot has one
+    bool Load(void *data, uint16_t len)
+    {
+        newest = -1;
+        pending = false;
+        footer_t footers[2];
+        for (uint8_t slot = 0; slot < 2; ++slot)
+        {
+            if (!readFooter(slot, footers[slot]) || footers[slot].length != len)
+                continue;
+            if (newest < 0 || (int32_t)(footers[slot].sequence - footers[newest].sequence) > 0)
+                newest = slot;
+        }
+        if (newest < 0)
+            return false;
+
+        uint8_t *p = (uint8_t *)data;
+        for (uint16_t i = 0; i < len; ++i)
+            p[i] = storage->ReadByte(slotAddress(newest) + i);
+        sequence = footers[newest].sequence;
+        return true;
+    }
+
+    // Write all of the config, false if it is longer than a slot holds
+    bool Write(const void *data, uint16_t len)
+    {
+        if (!start(data, len))
+            return false;
+        Flush();
+        return true;
+    }
+
+    bool IsPending() const { return pending; }
+    // The next Poll() commits the storage, everything has been written to it
+    bool IsLastSlice() const { return pending && footerWritten; }
+
+    // Program the next slice, returns true while there is more to do
+    bool Poll()
+    {
+        if (!pending)
+            return false;
+
+        const uint8_t slot = newest == 1 ? 0 : 1;
+        const uint32_t address = slotAddress(slot);
+        if (written < length)
+        {
+            uint16_t end = written + CONFIG_STORE_SLICE_SIZE;
+            if (end > length)
+                end = length;
+            for (; written < end; ++written)
+                storage->WriteByte(address + written, source[written]);
+            return true;
+        }
+
+        footer_t footer;
+        footer.sequence = sequence + 1;
+        if (!footerWritten)
+        {
+            footer.length = length;
+            footer.crc = calcCrc(source, length, footer);
+            const uint8_t *p = (const uint8_t *)&footer;
+            for (uint8_t i = 0; i < sizeof(footer); ++i)
+                storage->WriteByte(address + maxLength + i, p[i]);
+            footerWritten = true;
+            return true;
+        }
+        storage->Commit();
+
+        sequence = footer.sequence;
+        newest = slot;
+        pending = false;
+        source = nullptr;
+        return false;
+    }
+
+    // Write out all that is staged
+    void Flush()
+    {
+        while (Poll())
+            ;
+    }
+
+protected:
+    // Start writing len bytes of data, which must stay as they are until it is done
+    bool start(const void *data, uint16_t len)
+    {
+        if (len > maxLength)
+            return false;
+        source = (const uint8_t *)data;
+        length = len;
+        written = 0;
+        footerWritten = false;
+        pending = true;
+        return true;
+    }
+
+private:
+    Storage *storage;
+    const uint8_t *source;  // what is being written
+    uint32_t sequence;  // of the newest good copy
+    int8_t newest;      // slot holding it, -1 for none
+    uint16_t length;
+    uint16_t written;
+    bool footerWritten;
+    bool pending;
+    GENERIC_CRC14<CONFIG_STORE_CRC14_POLY> crc;
+
+    static uint32_t slotAddress(uint8_t slot) { return (uint32_t)slot * slotSize; }
+
+    uint16_t calcCrc(const uint8_t *data, uint16_t len, const footer_t &footer) const
+    {
+        // The sequence and length, then the config
+        uint16_t result = crc.calc((const uint8_t *)&footer, sizeof(footer.sequence) + sizeof(footer.length), 0);
+        while (len)
+        {
+            const uint8_t chunk = len > 255 ? 255 : len;
+            result = crc.calc(data, chunk, result);
+            data += chunk;
+            len -= chunk;
+        }
+        return result;
+    }
+
+    bool readFooter(uint8_t slot, footer_t &footer) const
+    {
+        uint8_t *p = (uint8_t *)&footer;
+        for (uint8_t i = 0; i < sizeof(footer); ++i)
+            p[i] = storage->ReadByte(slotAddress(slot) + maxLength + i);
+        if (footer.length == 0 || footer.length > maxLength)
+            return false;
+
+        uint16_t result = crc.calc(p, sizeof(footer.sequence) + sizeof(footer.length), 0);
+        uint8_t chunk[CONFIG_STORE_SLICE_SIZE];
+        for (uint16_t i = 0; i < footer.length; i += sizeof(chunk))
+        {
+            const uint16_t left = footer.length - i;
+            const uint8_t len = left < sizeof(chunk) ? left : sizeof(chunk);
+            for (uint8_t j = 0; j < len; ++j)
+                chunk[j] = storage->ReadByte(slotAddress(slot) + i + j);
+            result = crc.calc(chunk, len, result);
+        }
+        return result == footer.crc;
+    }
+};
+
+/**
+ * ConfigStore with a shadow buffer of a slot, so the config can change while
+ * Poll() is writing the copy taken of it. Staging again while a commit is
+ * running starts it over.
+ **/
+template <class Storage, uint16_t slotSize>
+class StagedConfigStore : public ConfigStore<Storage, slotSize>
+{
+public:
+    typedef ConfigStore<Storage, slotSize> Base;
+
+    // Take a copy of the config to be written by Poll(), false if it is longer than a slot holds
+    bool Stage(const void *data, uint16_t len)
+    {
+        if (len > Base::maxLength)
+            return false;
+        memcpy(shadow, data, len);
+        return Base::start(shadow, len);
+    }
+
+private:
+    uint8_t shadow[Base::maxLength];
+};
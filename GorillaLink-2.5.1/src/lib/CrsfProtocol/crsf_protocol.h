@@ -370,6 +370,20 @@ static inline uint16_t ICACHE_RAM_ATTR CRSF_to_N(uint16_t val, uint16_t cnt)
     return (val - CRSF_CHANNEL_VALUE_1000) * cnt / (CRSF_CHANNEL_VALUE_2000 - CRSF_CHANNEL_VALUE_1000 + 1);
 }
 
+// CRSF_to_N() for a constant cnt up to 128, branchless and with the division
+// by the span replaced by a multiply with its scaled reciprocal. 24 bits of
+// fraction keep it exact for every 11 bit input.
+template <uint16_t cnt>
+static inline uint16_t ICACHE_RAM_ATTR CRSF_to_N(uint16_t val)
+{
+    static_assert(cnt > 0 && cnt <= 128, "CRSF_to_N<cnt> is only exact up to 128");
+    constexpr uint32_t span = CRSF_CHANNEL_VALUE_2000 - CRSF_CHANNEL_VALUE_1000 + 1;
+    constexpr uint32_t reciprocal = (((uint32_t)cnt << 24) + span - 1) / span;
+    val = (val < CRSF_CHANNEL_VALUE_1000) ? CRSF_CHANNEL_VALUE_1000 : val;
+    val = (val > CRSF_CHANNEL_VALUE_2000) ? CRSF_CHANNEL_VALUE_2000 : val;
+    return ((uint32_t)(val - CRSF_CHANNEL_VALUE_1000) * reciprocal) >> 24;
+}
+
 // 3b switches use 0-5 to represent 6 positions switches and "7" to represent middle
 // The calculation is a bit non-linear all the way to the endpoints due to where
 // Ardupilot defines its modes
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Timeouts of the devices of one core, kept in a binary min-heap on the
+ * deadline so an update with nothing due looks at one entry instead of
+ * every device. Devices that want their timeout() every update
+ * (DURATION_IMMEDIATELY, like LUA and CRSF) are polled from a bit mask
+ * instead of going in and out of the heap each time. Deadlines are in ms and
+ * compared wrap-safe, so they have to be within 24 days of now. takeDue()
+ * hands the devices out in index order, the order they were registered in.
+ **/
+template <uint8_t maxDevices>
+class DeviceScheduler
+{
+    static_assert(maxDevices <= 32, "DeviceScheduler keeps the devices in a 32 bit mask");
+    static constexpr uint8_t NOT_SCHEDULED = 0xFF;
+
+public:
+    DeviceScheduler() { clear(); }
+
+    void clear()
+    {
+        count = 0;
+        polled = 0;
+        for (uint8_t i = 0; i < maxDevices; ++i)
+            position[i] = NOT_SCHEDULED;
+    }
+
+    // Call timeout() of device at deadline, moving it if it was already scheduled
+    void schedule(uint8_t device, uint32_t at)
+    {
+        polled &= ~maskOf(device);
+        deadline[device] = at;
+        if (position[device] == NOT_SCHEDULED)
+        {
+            position[device] = count;
+            heap[count++] = device;
+        }
+        siftDown(siftUp(position[device]));
+    }
+
+    // Call timeout() of device at every takeDue() until it is scheduled or cancelled
+    void poll(uint8_t device)
+    {
+        unheap(device);
+        polled |= maskOf(device);
+    }
+
+    void cancel(uint8_t device)
+    {
+        polled &= ~maskOf(device);
+        unheap(device);
+    }
+
+    bool isScheduled(uint8_t device) const { return position[device] != NOT_SCHEDULED || (polled & maskOf(device)); }
+    uint8_t size() const
+    {
+        uint8_t n = count;
+        for (uint32_t p = polled; p; p &= p - 1)
+            ++n;
+        return n;
+    }
+
+    // ms from now to the first deadline, 0 if one is due and UINT32_MAX if none is scheduled
+    uint32_t timeToNext(uint32_t now) const
+    {
+        if (polled)
+            return 0;
+        if (count == 0)
+            return UINT32_MAX;
+        const int32_t wait = (int32_t)(deadline[heap[0]] - now);
+        return wait > 0 ? wait : 0;
+    }
+
+    /**
+     * Unschedule every device due at now and put them in due[] in index
+     * order, returns how many. A device scheduled again for now, or polled,
+     * from its timeout() is only due at the next call.
+     **/
+    uint8_t takeDue(uint32_t now, uint8_t *due)
+    {
+        uint32_t mask = polled;
+        polled = 0;
+        while (count && !before(now, deadline[heap[0]]))
+        {
+            mask |= maskOf(heap[0]);
+            unheap(heap[0]);
+        }
+        uint8_t n = 0;
+        for (uint8_t device = 0; mask; ++device, mask >>= 1)
+        {
+            if (mask & 1)
+                due[n++] = device;
+        }
+        return n;
+    }
+
+private:
+    uint32_t deadline[maxDevices];
+    uint8_t heap[maxDevices];       // device indexes, heap[0] is due first
+    uint8_t position[maxDevices];   // of each device in heap
+    uint8_t count;
+    uint32_t polled;                // bit per device
+
+    static uint32_t maskOf(uint8_t device) { return 1UL << device; }
+
+    void unheap(uint8_t device)
+    {
+        const uint8_t pos = position[device];
+        if (pos == NOT_SCHEDULED)
+            return;
+        position[device] = NOT_SCHEDULED;
+        if (pos == --count)
+            return;
+        place(pos, heap[count]);
+        siftDown(siftUp(pos));
+    }
+
+    static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+    bool earlier(uint8_t a, uint8_t b) const
+    {
+        return before(deadline[a], deadline[b]);
+    }
+
+    void place(uint8_t pos, uint8_t device)
+    {
+        heap[pos] = device;
+        position[device] = pos;
+    }
+
+    uint8_t siftUp(uint8_t pos)
+    {
+        const uint8_t device = heap[pos];
+        while (pos > 0)
+        {
+            const uint8_t parent = (pos - 1) / 2;
+            if (!earlier(device, heap[parent]))
+                break;
+            place(pos, heap[parent]);
+            pos = parent;
+        }
+        place(pos, device);
+        return pos;
+    }
+
+    void siftDown(uint8_t pos)
+    {
+        const uint8_t device = heap[pos];
+        for (;;)
+        {
+            uint8_t child = 2 * pos + 1;
+            if (child >= count)
+                break;
+            if (child + 1 < count && earlier(heap[child + 1], heap[child]))
+                ++child;
+            if (!earlier(heap[child], device))
+                break;
+            place(pos, heap[child]);
+            pos = child;
+        }
+        place(pos, device);
+    }
+};
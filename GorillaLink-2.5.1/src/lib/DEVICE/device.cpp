@@ -3,6 +3,7 @@
 #include "logging.h"
 #include "helpers.h"
 #include "device.h"
+#include "DeviceScheduler.h"
 
 ///////////////////////////////////////
 // Even though we aren't using anything this keeps the PIO dependency analyzer happy!
@@ -20,12 +21,19 @@
 static device_affinity_t *uiDevices;
 static uint8_t deviceCount;
 
-static bool eventFired[2] = {false, false};
+// The events in each bit of EVENT_, set by devicesTriggerEvent() for each core
+#define EVENT_COUNT 3
+static volatile bool eventFired[2][EVENT_COUNT] = {{false}};
 static connectionState_e lastConnectionState[2] = {disconnected, disconnected};
 
-static unsigned long deviceTimeout[16] = {0};
+static DeviceScheduler<DEVICE_MAX_COUNT> scheduler[2];
 
 #if defined(PLATFORM_ESP32)
+// Longest the device task sleeps, to notice connectionState changing. Only the
+// devices see the wait: the CRSF input runs in its own task (see CRSF::Begin())
+// so the handset frames are not held up by it, nor by a slow screen or sensor
+// device on core 0.
+#define DEVICE_TASK_MAX_WAIT 10
 static TaskHandle_t xDeviceTask = NULL;
 static SemaphoreHandle_t taskSemaphore;
 static SemaphoreHandle_t completeSemaphore;
@@ -35,16 +43,34 @@ static void deviceTask(void *pvArgs);
 #define CURRENT_CORE -1
 #endif
 
+// Schedule device i after delay ms from now, as returned by start(), event() or timeout()
+static void scheduleDevice(DeviceScheduler<DEVICE_MAX_COUNT> &s, uint8_t i, unsigned long now, int delay)
+{
+    if (delay == DURATION_NEVER || uiDevices[i].device->timeout == nullptr)
+    {
+        s.cancel(i);
+    }
+    else if (delay == DURATION_IMMEDIATELY)
+    {
+        s.poll(i);
+    }
+    else
+    {
+        s.schedule(i, now + delay);
+    }
+}
+
 void devicesRegister(device_affinity_t *devices, uint8_t count)
 {
     uiDevices = devices;
-    deviceCount = count;
+    deviceCount = count < DEVICE_MAX_COUNT ? count : DEVICE_MAX_COUNT;
 
     #if defined(PLATFORM_ESP32)
         taskSemaphore = xSemaphoreCreateBinary();
         completeSemaphore = xSemaphoreCreateBinary();
         disableCore0WDT();
-        xTaskCreatePinnedToCore(deviceTask, "deviceTask", 3000, NULL, 0, &xDeviceTask, 0);
+        // Above the CRSF input task, which never blocks
+        xTaskCreatePinnedToCore(deviceTask, "deviceTask", 3000, NULL, 1, &xDeviceTask, 0);
     #endif
 }
 
@@ -72,15 +98,16 @@ void devicesStart()
 {
     int32_t core = CURRENT_CORE;
     unsigned long now = millis();
+    DeviceScheduler<DEVICE_MAX_COUNT> &s = scheduler[core==-1?0:core];
 
+    s.clear();
     for(size_t i=0 ; i<deviceCount ; i++)
     {
         if (uiDevices[i].core == core || core == -1) {
-            deviceTimeout[i] = 0xFFFFFFFF;
             if (uiDevices[i].device->start)
             {
                 int delay = (uiDevices[i].device->start)();
-                deviceTimeout[i] = delay == DURATION_NEVER ? 0xFFFFFFFF : now + delay;
+                scheduleDevice(s, i, now, delay);
             }
         }
     }
@@ -100,46 +127,86 @@ void devicesStop()
     #endif
 }
 
-void devicesTriggerEvent()
+void devicesTriggerEvent(uint8_t events)
+{
+    for (uint8_t e = 0; e < EVENT_COUNT; ++e)
+    {
+        if (events & (1 << e))
+        {
+            eventFired[0][e] = true;
+            eventFired[1][e] = true;
+        }
+    }
+    #if defined(PLATFORM_ESP32)
+    if (xDeviceTask)
+    {
+        xTaskNotifyGive(xDeviceTask);
+    }
+    #endif
+}
+
+// Take the events fired for core, cleared before any event() runs so one
+// fired while they do comes round again
+static uint8_t takeEvents(uint8_t core)
 {
-    eventFired[0] = true;
-    eventFired[1] = true;
+    uint8_t events = 0;
+    for (uint8_t e = 0; e < EVENT_COUNT; ++e)
+    {
+        if (eventFired[core][e])
+        {
+            eventFired[core][e] = false;
+            events |= 1 << e;
+        }
+    }
+    if (lastConnectionState[core] != connectionState)
+    {
+        lastConnectionState[core] = connectionState;
+        events |= EVENT_CONNECTION_CHANGED;
+    }
+    return events;
 }
 
 void devicesUpdate(unsigned long now)
 {
     int32_t core = CURRENT_CORE;
+    DeviceScheduler<DEVICE_MAX_COUNT> &s = scheduler[core==-1?0:core];
 
-    bool handleEvents = eventFired[core==-1?0:core];
-    eventFired[core==-1?0:core] = false;
-
-    for(size_t i=0 ; i<deviceCount ; i++)
+    uint8_t events = takeEvents(core==-1?0:core);
+    if (events)
     {
-        if (uiDevices[i].core == core || core == -1) {
-            if ((handleEvents || lastConnectionState[core==-1?0:core] != connectionState) && uiDevices[i].device->event)
-            {
-                int delay = (uiDevices[i].device->event)();
-                if (delay != DURATION_IGNORE)
+        for(size_t i=0 ; i<deviceCount ; i++)
+        {
+            if (uiDevices[i].core == core || core == -1) {
+                const device_t *device = uiDevices[i].device;
+                const uint8_t mask = device->eventMask ? device->eventMask : EVENT_ALL;
+                if ((events & mask) && device->event)
                 {
-                    deviceTimeout[i] = delay == DURATION_NEVER ? 0xFFFFFFFF : now + delay;
+                    int delay = (device->event)();
+                    if (delay != DURATION_IGNORE)
+                    {
+                        scheduleDevice(s, i, now, delay);
+                    }
                 }
             }
         }
     }
-    lastConnectionState[core==-1?0:core] = connectionState;
 
-    for(size_t i=0 ; i<deviceCount ; i++)
+    uint8_t due[DEVICE_MAX_COUNT];
+    uint8_t dueCount = s.takeDue(now, due);
+    for (uint8_t n = 0 ; n < dueCount ; n++)
     {
-        if (uiDevices[i].core == core || core == -1) {
-            if (uiDevices[i].device->timeout && now >= deviceTimeout[i])
-            {
-                int delay = (uiDevices[i].device->timeout)();
-                deviceTimeout[i] = delay == DURATION_NEVER ? 0xFFFFFFFF : now + delay;
-            }
-        }
+        uint8_t i = due[n];
+        int delay = (uiDevices[i].device->timeout)();
+        scheduleDevice(s, i, now, delay);
     }
 }
 
+uint32_t devicesTimeToNext(unsigned long now)
+{
+    int32_t core = CURRENT_CORE;
+    return scheduler[core==-1?0:core].timeToNext(now);
+}
+
 #if defined(PLATFORM_ESP32)
 static void deviceTask(void *pvArgs)
 {
@@ -152,6 +219,16 @@ static void deviceTask(void *pvArgs)
     for (;;)
     {
         devicesUpdate(millis());
+        // Sleep until the next timeout or devicesTriggerEvent()
+        uint32_t wait = devicesTimeToNext(millis());
+        if (wait > 0)
+        {
+            if (wait > DEVICE_TASK_MAX_WAIT)
+            {
+                wait = DEVICE_TASK_MAX_WAIT;
+            }
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+        }
     }
 }
 #endif
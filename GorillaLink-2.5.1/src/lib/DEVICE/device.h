@@ -8,6 +8,16 @@
 #define DURATION_NEVER -1       // timeout() will not be called, only event()
 #define DURATION_IMMEDIATELY 0  // timeout() will be called each loop
 
+// Events a device's event() is called for, eventMask is the ones it wants.
+// A device that leaves it 0 gets every event.
+#define EVENT_CONNECTION_CHANGED 0x01   // connectionState changed
+#define EVENT_CONFIG_CHANGED     0x02   // a setting, the power, or binding mode changed
+#define EVENT_ARM_CHANGED        0x04   // the arm switch changed
+#define EVENT_ALL                0xFF
+
+// Devices that can be registered
+#define DEVICE_MAX_COUNT 32
+
 typedef struct {
     // Called at the beginning of setup() so the device can configure IO pins etc
     void (*initialize)();
@@ -17,6 +27,8 @@ typedef struct {
     int (*event)();
     // The duration has passed so take appropriate action and return a new duration, this function should never return DURATION_IGNORE
     int (*timeout)();
+    // EVENT_ flags of the events to call event() for
+    uint8_t eventMask;
 } device_t;
 
 typedef struct {
@@ -28,5 +40,7 @@ void devicesRegister(device_affinity_t *devices, uint8_t count);
 void devicesInit();
 void devicesStart();
 void devicesUpdate(unsigned long now);
-void devicesTriggerEvent();
+// ms until devicesUpdate() has a timeout() to call, 0 if one is due now
+uint32_t devicesTimeToNext(unsigned long now);
+void devicesTriggerEvent(uint8_t events = EVENT_ALL);
 void devicesStop();
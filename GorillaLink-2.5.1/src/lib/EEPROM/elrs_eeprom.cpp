@@ -17,16 +17,106 @@
     #else
         #define STM32_USE_FLASH
         #include <utility/stm32_eeprom.h>
+        #if defined(STM32F1xx) || defined(STM32F3xx) || defined(STM32L4xx)
+            #define STM32_USE_FLASH_LOG
+        #endif
     #endif
 #else
     #include <EEPROM.h>
 #endif
 
+#if defined(STM32_USE_FLASH_LOG)
+#include "FlashLog.h"
+
+// From the ldscript
+extern "C" uint8_t _flash_log_start[];
+
+/**
+ * The FLASH_LOG region the ldscript keeps after the code, 4KB at the end of
+ * the app's flash, as the two banks of a FlashLog. A config change programs
+ * a few half (double on L4) words instead of erasing the page.
+ **/
+class STM32Flash
+{
+public:
+    static constexpr uint32_t BankSize = 2048;
+#if defined(STM32L4xx)
+    static constexpr uint8_t ProgramUnit = 8;
+#else
+    static constexpr uint8_t ProgramUnit = 2;
+#endif
+
+    void Read(uint8_t bank, uint32_t offset, void *data, uint32_t len)
+    {
+        memcpy(data, (const void *)(address(bank) + offset), len);
+    }
+
+    void Program(uint8_t bank, uint32_t offset, const void *data, uint32_t len)
+    {
+        const uint8_t *p = (const uint8_t *)data;
+        HAL_FLASH_Unlock();
+        for (uint32_t i = 0; i < len; i += ProgramUnit)
+        {
+#if defined(STM32L4xx)
+            uint64_t unit;
+            memcpy(&unit, p + i, sizeof(unit));
+            HAL_FLASH_Program(FLASH_TYPEPROGRAM_DOUBLEWORD, address(bank) + offset + i, unit);
+#else
+            uint16_t unit;
+            memcpy(&unit, p + i, sizeof(unit));
+            HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, address(bank) + offset + i, unit);
+#endif
+        }
+        HAL_FLASH_Lock();
+    }
+
+    void Erase(uint8_t bank)
+    {
+        FLASH_EraseInitTypeDef erase = {};
+        uint32_t pageError;
+        erase.TypeErase = FLASH_TYPEERASE_PAGES;
+#if defined(STM32L4xx)
+        erase.Banks = FLASH_BANK_1;
+        erase.Page = (address(bank) - FLASH_BASE) / FLASH_PAGE_SIZE;
+#else
+        erase.PageAddress = address(bank);
+#endif
+        erase.NbPages = BankSize / FLASH_PAGE_SIZE;
+        HAL_FLASH_Unlock();
+#if defined(STM32L4xx)
+        __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_ALL_ERRORS);
+#endif
+        HAL_FLASHEx_Erase(&erase, &pageError);
+        HAL_FLASH_Lock();
+    }
+
+private:
+    static uint32_t address(uint8_t bank)
+    {
+        return (uint32_t)_flash_log_start + bank * BankSize;
+    }
+};
+
+static STM32Flash stm32Flash;
+static FlashEeprom<STM32Flash, RESERVED_EEPROM_SIZE> flashEeprom(stm32Flash);
+#endif
+
 void
 ELRS_EEPROM::Begin()
 {
 #if defined(PLATFORM_STM32)
-    #if defined(STM32_USE_FLASH)
+    #if defined(STM32_USE_FLASH_LOG)
+        if (!flashEeprom.Begin())
+        {
+            // First boot with the log, bring over what the core's EEPROM page held
+            eeprom_buffer_fill();
+            for (uint32_t address = 0; address < RESERVED_EEPROM_SIZE; ++address)
+            {
+                flashEeprom.WriteByte(address, eeprom_buffered_read_byte(address));
+            }
+            flashEeprom.Commit();
+        }
+    #elif defined(STM32_USE_FLASH)
         eeprom_buffer_fill();
     #else // !STM32_USE_FLASH
         /* Initialize I2C */
@@ -54,7 +144,9 @@ ELRS_EEPROM::ReadByte(const uint32_t address)
         ERRLN("EEPROM address is out of bounds");
         return 0;
     }
-#if defined(STM32_USE_FLASH)
+#if defined(STM32_USE_FLASH_LOG)
+    return flashEeprom.ReadByte(address);
+#elif defined(STM32_USE_FLASH)
     return eeprom_buffered_read_byte(address);
 #else
     return EEPROM.read(address);
@@ -70,7 +162,9 @@ ELRS_EEPROM::WriteByte(const uint32_t address, const uint8_t value)
         ERRLN("EEPROM address is out of bounds");
         return;
     }
-#if defined(STM32_USE_FLASH)
+#if defined(STM32_USE_FLASH_LOG)
+    flashEeprom.WriteByte(address, value);
+#elif defined(STM32_USE_FLASH)
     eeprom_buffered_write_byte(address, value);
 #elif defined(PLATFORM_STM32)
     EEPROM.update(address, value);
@@ -87,7 +181,21 @@ ELRS_EEPROM::Commit()
     {
       ERRLN("EEPROM commit failed");
     }
+#elif defined(STM32_USE_FLASH_LOG)
+    flashEeprom.Commit();
 #elif defined(STM32_USE_FLASH)
     eeprom_buffer_flush();
 #endif
 }
+
+bool
+ELRS_EEPROM::CommitWillErase()
+{
+#if defined(STM32_USE_FLASH_LOG)
+    return flashEeprom.CommitWillErase();
+#elif defined(STM32_USE_FLASH)
+    return true;
+#else
+    return false;
+#endif
+}
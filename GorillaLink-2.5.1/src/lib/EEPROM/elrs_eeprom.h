@@ -12,6 +12,9 @@ public:
     uint8_t ReadByte(const uint32_t address);
     void WriteByte(const uint32_t address, const uint8_t value);
     void Commit();
+    // Commit() will erase the STM32 internal flash, stopping the CPU for
+    // tens of ms. Always false for the other storages.
+    bool CommitWillErase();
 
     // The extEEPROM lib that we use for STM doesn't have the get and put templates
     // These templates need to be reimplemented here
@@ -245,6 +245,280 @@ uint8_t volatile FHSSptr;
 uint_fast8_t sync_channel;
 // Offset from the predefined frequency determined by AFC on Team900 (register units)
 int32_t FreqCorrection;
+// FHSSfreqs with FreqCorrection applied, ready to send to the radio
+fhss_channel_t FHSSchannels[FHSS_FREQ_CNT];
+// The channel used in place of each entry of FHSSsequence, itself unless blacklisted
+uint8_t FHSSchannelMap[FHSS_FREQ_CNT];
+// The prepared blacklist takes over at the next start of the sequence
+volatile bool FHSSblacklistArmed;
+
+// Packets after which the statistics of a channel are halved, so they follow changes
+#define FHSS_STATS_WINDOW 64
+// Packets a channel needs before it can be blacklisted
+#define FHSS_BLACKLIST_MIN_PERIODS 16
+// A channel is blacklisted when it loses this many percent and twice the average
+#define FHSS_BLACKLIST_LOSS_PERCENT 25
+
+typedef struct {
+    uint8_t periods;
+    uint8_t missed;
+} fhss_channel_stats_t;
+
+static fhss_channel_stats_t FHSSstats[FHSS_FREQ_CNT];
+static fhss_blacklist_t FHSSblacklist;
+static fhss_blacklist_t FHSSpendingBlacklist;
+static uint8_t FHSSpendingMap[FHSS_FREQ_CNT];
+static volatile bool FHSSblacklistPrepared;
+// Set by FHSSresetBlacklist() in loop(), the ISR does the reset so it never hops on a half rewritten map
+static volatile bool FHSSblacklistResetPending;
+
+static void ICACHE_RAM_ATTR FHSSbuildChannels()
+{
+    for (uint8_t i = 0; i < FHSS_FREQ_CNT; i++)
+    {
+        const uint32_t freq = FHSSfreqs[FHSSchannelMap[i]] - FreqCorrection;
+        FHSSchannels[i].freq = freq;
+        FHSSradio_t::BuildFrequencyCmd(freq, FHSSchannels[i].cmd);
+    }
+}
+
+void ICACHE_RAM_ATTR FHSSsetFreqCorrection(const int32_t value)
+{
+    if (value != FreqCorrection)
+    {
+        FreqCorrection = value;
+        FHSSbuildChannels();
+    }
+}
+
+static void ICACHE_RAM_ATTR FHSSapplyBlacklistReset()
+{
+    FHSSblacklistResetPending = false;
+    FHSSblacklistArmed = false;
+    FHSSblacklistPrepared = false;
+    memset(&FHSSblacklist, 0, sizeof(FHSSblacklist));
+    memset(FHSSstats, 0, sizeof(FHSSstats));
+    for (uint8_t i = 0; i < FHSS_FREQ_CNT; i++)
+    {
+        FHSSchannelMap[i] = i;
+    }
+    FHSSbuildChannels();
+}
+
+void FHSSresetBlacklist()
+{
+    FHSSblacklistResetPending = true;
+}
+
+void ICACHE_RAM_ATTR FHSSresetBlacklistPending()
+{
+    if (FHSSblacklistResetPending)
+    {
+        FHSSapplyBlacklistReset();
+    }
+}
+
+void ICACHE_RAM_ATTR FHSSrecordPacket(const uint8_t channel, const bool received)
+{
+    if (FHSSblacklistResetPending)
+    {
+        return;
+    }
+    fhss_channel_stats_t &stats = FHSSstats[channel];
+    if (stats.periods == FHSS_STATS_WINDOW)
+    {
+        stats.periods /= 2;
+        stats.missed /= 2;
+    }
+    stats.periods++;
+    if (!received)
+    {
+        stats.missed++;
+    }
+}
+
+void FHSSpickBlacklist(fhss_blacklist_t &list)
+{
+    // Loss of every channel with enough packets, in percent
+    uint8_t loss[FHSS_FREQ_CNT];
+    uint32_t lossSum = 0;
+    uint8_t measured = 0;
+    for (uint8_t i = 0; i < FHSS_FREQ_CNT; i++)
+    {
+        const fhss_channel_stats_t &stats = FHSSstats[i];
+        loss[i] = 0;
+        if (stats.periods >= FHSS_BLACKLIST_MIN_PERIODS)
+        {
+            loss[i] = stats.missed * 100U / stats.periods;
+            lossSum += loss[i];
+            measured++;
+        }
+    }
+
+    // The worst ones first, sync_channel always stays
+    list.count = 0;
+    while (list.count < FHSS_BLACKLIST_MAX)
+    {
+        uint8_t worst = 0;
+        for (uint8_t i = 0; i < FHSS_FREQ_CNT; i++)
+        {
+            if (i != sync_channel && loss[i] > loss[worst])
+            {
+                worst = i;
+            }
+        }
+        if (loss[worst] < FHSS_BLACKLIST_LOSS_PERCENT || loss[worst] * measured < 2 * lossSum || worst == sync_channel)
+        {
+            break;
+        }
+        list.channels[list.count++] = worst;
+        loss[worst] = 0;
+    }
+
+    // In channel order so the same channels always make the same list
+    for (uint8_t i = 1; i < list.count; i++)
+    {
+        for (uint8_t j = i; j > 0 && list.channels[j - 1] > list.channels[j]; j--)
+        {
+            const uint8_t temp = list.channels[j];
+            list.channels[j] = list.channels[j - 1];
+            list.channels[j - 1] = temp;
+        }
+    }
+}
+
+void FHSSgetBlacklist(fhss_blacklist_t &list)
+{
+    list = FHSSblacklist;
+}
+
+bool ICACHE_RAM_ATTR FHSSgetPendingBlacklist(fhss_blacklist_t &list)
+{
+    if (!FHSSblacklistPrepared || FHSSblacklistArmed || FHSSblacklistResetPending)
+    {
+        return false;
+    }
+    list = FHSSpendingBlacklist;
+    return true;
+}
+
+static bool FHSSisBlacklisted(const fhss_blacklist_t &list, const uint8_t channel)
+{
+    for (uint8_t i = 0; i < list.count; i++)
+    {
+        if (list.channels[i] == channel)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Each blacklisted channel is replaced by a good channel about half the band
+ * away, as the channels next to a jammed one are often not much better. The
+ * replacement is never the sync channel, never used for two blacklisted
+ * channels and never comes right before or after the blacklisted channel in
+ * the sequence, so no channel is ever used twice in a row.
+ **/
+void FHSSprepareBlacklist(const fhss_blacklist_t &list)
+{
+    if (FHSSblacklistArmed)
+    {
+        return;
+    }
+
+    bool used[FHSS_FREQ_CNT];
+    for (uint8_t i = 0; i < FHSS_FREQ_CNT; i++)
+    {
+        FHSSpendingMap[i] = i;
+        used[i] = FHSSisBlacklisted(list, i);
+    }
+
+    for (uint8_t n = 0; n < list.count; n++)
+    {
+        const uint8_t channel = list.channels[n];
+        if (channel >= FHSS_FREQ_CNT || channel == sync_channel)
+        {
+            continue;
+        }
+
+        bool neighbour[FHSS_FREQ_CNT] = {false};
+        for (uint8_t i = 0; i < FHSS_SEQUENCE_CNT; i++)
+        {
+            if (FHSSsequence[i] == channel)
+            {
+                neighbour[FHSSsequence[(i + FHSS_SEQUENCE_CNT - 1) % FHSS_SEQUENCE_CNT]] = true;
+                neighbour[FHSSsequence[(i + 1) % FHSS_SEQUENCE_CNT]] = true;
+            }
+        }
+
+        for (uint8_t i = 0; i < FHSS_FREQ_CNT; i++)
+        {
+            const uint8_t candidate = (channel + FHSS_FREQ_CNT / 2 + i) % FHSS_FREQ_CNT;
+            if (candidate != sync_channel && !used[candidate] && !neighbour[candidate])
+            {
+                FHSSpendingMap[channel] = candidate;
+                used[candidate] = true;
+                break;
+            }
+        }
+    }
+
+    FHSSpendingBlacklist = list;
+    FHSSblacklistPrepared = true;
+}
+
+bool ICACHE_RAM_ATTR FHSSblacklistPending()
+{
+    return FHSSblacklistPrepared || FHSSblacklistResetPending;
+}
+
+uint8_t ICACHE_RAM_ATTR FHSSannounceBlacklist()
+{
+    FHSSresetBlacklistPending();
+    if (FHSSblacklistPrepared)
+    {
+        FHSSblacklistArmed = true;
+        return FHSSpendingBlacklist.epoch;
+    }
+    return FHSSblacklist.epoch;
+}
+
+bool ICACHE_RAM_ATTR FHSSfollowBlacklist(const uint8_t epoch)
+{
+    FHSSresetBlacklistPending();
+    if (epoch == FHSSblacklist.epoch)
+    {
+        return true;
+    }
+    if (FHSSblacklistPrepared && epoch == FHSSpendingBlacklist.epoch)
+    {
+        FHSSblacklistArmed = true;
+        return true;
+    }
+
+    // Out of step, the TX kept a list over a restart of this end or the other way around
+    FHSSblacklistArmed = false;
+    FHSSblacklistPrepared = false;
+    FHSSblacklist.epoch = epoch;
+    FHSSblacklist.count = 0;
+    for (uint8_t i = 0; i < FHSS_FREQ_CNT; i++)
+    {
+        FHSSchannelMap[i] = i;
+    }
+    FHSSbuildChannels();
+    return false;
+}
+
+void ICACHE_RAM_ATTR FHSSapplyBlacklist()
+{
+    memcpy(FHSSchannelMap, FHSSpendingMap, sizeof(FHSSchannelMap));
+    FHSSblacklist = FHSSpendingBlacklist;
+    FHSSblacklistArmed = false;
+    FHSSblacklistPrepared = false;
+    FHSSbuildChannels();
+}
 
 /**
 Requirements:
@@ -315,6 +589,8 @@ void FHSSrandomiseFHSSsequence(const uint32_t seed)
         }
     }
 
+    FHSSapplyBlacklistReset();
+
     // output FHSS sequence
     for (uint8_t i=0; i < FHSS_SEQUENCE_CNT; i++)
     {
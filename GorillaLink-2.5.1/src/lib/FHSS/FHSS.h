@@ -4,8 +4,10 @@
 
 #if defined(Regulatory_Domain_AU_915) || defined(Regulatory_Domain_EU_868) || defined(Regulatory_Domain_IN_866) || defined(Regulatory_Domain_FCC_915) || defined(Regulatory_Domain_AU_433) || defined(Regulatory_Domain_EU_433)
 #include "SX127xDriver.h"
+typedef SX127xDriver FHSSradio_t;
 #elif Regulatory_Domain_ISM_2400
 #include "SX1280Driver.h"
+typedef SX1280Driver FHSSradio_t;
 #endif
 
 #include "random.h"
@@ -33,8 +35,28 @@
 
 #define FREQ_HZ_TO_REG_VAL(freq) ((uint32_t)((double)freq/(double)FREQ_STEP))
 
+// A channel as the radio is tuned to it for a hop: the frequency with
+// FreqCorrection applied and the SPI transfer that sets it
+typedef struct {
+    uint32_t freq;
+    WORD_ALIGNED_ATTR uint8_t cmd[FREQ_CMD_SIZE];
+} fhss_channel_t;
+
+// Most channels that can be blacklisted at once
+#define FHSS_BLACKLIST_MAX 4
+
+// Channels to hop around, the epoch bit tells one list from the next
+typedef struct {
+    uint8_t epoch;
+    uint8_t count;
+    uint8_t channels[FHSS_BLACKLIST_MAX]; // ascending
+} fhss_blacklist_t;
+
 extern volatile uint8_t FHSSptr;
 extern int32_t FreqCorrection;
+extern fhss_channel_t FHSSchannels[];
+extern uint8_t FHSSchannelMap[];
+extern volatile bool FHSSblacklistArmed;
 extern uint8_t FHSSsequence[];
 extern const uint32_t FHSSfreqs[];
 extern uint_fast8_t sync_channel;
@@ -44,6 +66,44 @@ extern const uint8_t FHSS_SEQUENCE_CNT;
 void FHSSrandomiseFHSSsequence(uint32_t seed);
 // The number of frequencies for this regulatory domain
 uint32_t FHSSgetChannelCount(void);
+// Change FreqCorrection, rebuilding the channel commands if it moved
+void FHSSsetFreqCorrection(int32_t value);
+
+/**
+ * Adaptive channel blacklisting. The RX counts the packets it receives and
+ * misses on every channel and picks the ones that do much worse than the
+ * rest, which it proposes to the TX over telemetry. Both ends turn the list
+ * into the same map from each blacklisted channel to a good one that never
+ * hops to or from it, and switch to that map together at the start of the
+ * sequence after the TX has announced it in a SYNC packet. The sync channel
+ * is never blacklisted.
+ **/
+// Hop on every channel again under epoch 0 and forget the statistics. Only
+// flags it, the next hop, SYNC or announce does it in the ISR.
+void FHSSresetBlacklist();
+// ISR: do a reset flagged by FHSSresetBlacklist()
+void FHSSresetBlacklistPending();
+// RX: count a packet period on the channel the radio was tuned to
+void FHSSrecordPacket(uint8_t channel, bool received);
+// RX: the channels that currently do much worse than the others, leaves the epoch alone
+void FHSSpickBlacklist(fhss_blacklist_t &list);
+// The list in use
+void FHSSgetBlacklist(fhss_blacklist_t &list);
+// The list waiting to be announced (TX) or proposed (RX), false if none
+bool FHSSgetPendingBlacklist(fhss_blacklist_t &list);
+// Build the map for a list and hold it until it is armed
+void FHSSprepareBlacklist(const fhss_blacklist_t &list);
+// A list is prepared or armed
+bool FHSSblacklistPending();
+// TX: arm the prepared list to take effect at the next start of the
+// sequence, returns the epoch to announce in the SYNC packet
+uint8_t FHSSannounceBlacklist();
+// RX: the TX announced epoch, arm the prepared list if it is the one being
+// announced. Returns false if the TX is on a list this end doesn't have, it
+// then goes back to every channel and the caller has to propose again.
+bool FHSSfollowBlacklist(uint8_t epoch);
+// Switch to the armed list, called at the start of the sequence
+void FHSSapplyBlacklist();
 
 // get the initial frequency, which is also the sync channel
 static inline uint32_t GetInitialFreq()
@@ -63,12 +123,27 @@ static inline void FHSSsetCurrIndex(const uint8_t value)
     FHSSptr = value % FHSS_SEQUENCE_CNT;
 }
 
+// The channel the radio is tuned to for the current hop
+static inline uint8_t FHSSgetCurrChannel()
+{
+    return FHSSchannelMap[FHSSsequence[FHSSptr]];
+}
+
+// Advance the pointer to the next hop and return the channel to tune to, pass
+// it on with Radio.SetFrequencyCmd(channel.freq, channel.cmd)
+static inline const fhss_channel_t &FHSSgetNextChannel()
+{
+    FHSSptr = (FHSSptr + 1) % FHSS_SEQUENCE_CNT;
+    FHSSresetBlacklistPending();
+    if (FHSSptr == 0 && FHSSblacklistArmed)
+        FHSSapplyBlacklist();
+    return FHSSchannels[FHSSsequence[FHSSptr]];
+}
+
 // Advance the pointer to the next hop and return the frequency of that channel
 static inline uint32_t FHSSgetNextFreq()
 {
-    FHSSptr = (FHSSptr + 1) % FHSS_SEQUENCE_CNT;
-    uint32_t freq = FHSSfreqs[FHSSsequence[FHSSptr]] - FreqCorrection;
-    return freq;
+    return FHSSgetNextChannel().freq;
 }
 
 // get the number of entries in the FHSS sequence
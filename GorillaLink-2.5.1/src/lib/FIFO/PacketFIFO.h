@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include "targets.h"
+
+/**
+ * Single producer, single consumer queue of length-prefixed packets. The
+ * producer only ever moves tail and the consumer only ever moves head, so
+ * the two sides can run in different contexts (loop and ISR, or two cores)
+ * without disabling interrupts. Where more than one context produces, they
+ * have to share a lock held from reserve() to commit(), or push().
+ *
+ * A full queue refuses the new packet rather than evicting the oldest ones,
+ * since only the consumer may move head.
+ *
+ * Every packet is stored contiguously as [len][len bytes], so it can be built
+ * in place with reserve()/commit() and read in place with peek()/consume().
+ * A packet that would not fit before the end of the buffer leaves a zero
+ * length byte behind and starts again at the beginning.
+ **/
+template <uint16_t capacity>
+class PacketFIFO
+{
+    static_assert(capacity >= 64 && capacity <= 32768 && (capacity & (capacity - 1)) == 0,
+                  "PacketFIFO capacity must be a power of two from 64 to 32768");
+
+    static constexpr uint16_t mask = capacity - 1;
+    static constexpr uint8_t WRAP = 0;
+
+public:
+    PacketFIFO() : head(0), tail(0), reservedLen(0), reservedSkip(0) {}
+
+    ///// Producer side /////
+
+    // Space for a len byte packet, or nullptr if it does not fit right now
+    uint8_t *ICACHE_RAM_ATTR reserve(uint8_t len)
+    {
+        if (len == 0)
+        {
+            return nullptr;
+        }
+        const uint16_t t = tail.load(std::memory_order_relaxed);
+        const uint16_t free = capacity - (uint16_t)(t - head.load(std::memory_order_acquire));
+        const uint16_t pos = t & mask;
+        const uint16_t skip = (pos + len + 1 > capacity) ? capacity - pos : 0;
+        if (skip + len + 1 > free)
+        {
+            return nullptr;
+        }
+        reservedLen = len;
+        reservedSkip = skip;
+        if (skip)
+        {
+            buffer[pos] = WRAP;
+        }
+        return &buffer[((t + skip) & mask) + 1];
+    }
+
+    // Publish the packet written to the space from the last reserve()
+    void ICACHE_RAM_ATTR commit()
+    {
+        const uint16_t t = tail.load(std::memory_order_relaxed) + reservedSkip;
+        buffer[t & mask] = reservedLen;
+        tail.store(t + reservedLen + 1, std::memory_order_release);
+        reservedLen = 0;
+        reservedSkip = 0;
+    }
+
+    // Copy in a whole packet, false if it did not fit
+    bool ICACHE_RAM_ATTR push(const uint8_t *data, uint8_t len)
+    {
+        uint8_t *dest = reserve(len);
+        if (dest == nullptr)
+        {
+            return false;
+        }
+        memcpy(dest, data, len);
+        commit();
+        return true;
+    }
+
+    ///// Consumer side /////
+
+    // The oldest packet, left in the queue until consume(), or nullptr if empty
+    const uint8_t *ICACHE_RAM_ATTR peek(uint8_t &len)
+    {
+        uint16_t h = head.load(std::memory_order_relaxed);
+        const uint16_t t = tail.load(std::memory_order_acquire);
+        if (h == t)
+        {
+            return nullptr;
+        }
+        uint16_t pos = h & mask;
+        if (buffer[pos] == WRAP)
+        {
+            h += capacity - pos;
+            head.store(h, std::memory_order_release);
+            pos = 0;
+        }
+        len = buffer[pos];
+        return &buffer[pos + 1];
+    }
+
+    // Drop the packet returned by peek()
+    void ICACHE_RAM_ATTR consume()
+    {
+        const uint16_t h = head.load(std::memory_order_relaxed);
+        head.store(h + buffer[h & mask] + 1, std::memory_order_release);
+    }
+
+    // Copy out the oldest packet, returns its length or 0 if empty. A packet
+    // longer than maxLen is dropped.
+    uint8_t ICACHE_RAM_ATTR pop(uint8_t *data, uint8_t maxLen)
+    {
+        uint8_t len;
+        const uint8_t *src = peek(len);
+        if (src == nullptr)
+        {
+            return 0;
+        }
+        if (len > maxLen)
+        {
+            len = 0;
+        }
+        memcpy(data, src, len);
+        consume();
+        return len;
+    }
+
+    // Drop everything that has been committed so far
+    void ICACHE_RAM_ATTR flush()
+    {
+        head.store(tail.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    ///// Either side /////
+
+    bool ICACHE_RAM_ATTR empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    // Bytes in use, including the length prefixes
+    uint16_t ICACHE_RAM_ATTR size() const
+    {
+        // head first, tail only grows so the difference can't go negative
+        const uint16_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+
+private:
+    std::atomic<uint16_t> head;
+    std::atomic<uint16_t> tail;
+    uint8_t reservedLen;
+    uint16_t reservedSkip;
+    uint8_t buffer[capacity];
+};
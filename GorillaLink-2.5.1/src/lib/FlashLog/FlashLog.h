@@ -0,0 +1,293 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "crc.h"
+
+/**
+ * Append-only log of key/value records in flash. Changing a value only
+ * programs a new record for it after the last one, nothing is erased until
+ * the log is full. Then the latest value of every key is copied into a
+ * freshly erased bank (compaction), so the two banks take turns and wear
+ * evenly.
+ *
+ * Each bank starts with a header, the magic and a generation count, that is
+ * programmed only once the bank is complete. The bank with the newest
+ * generation is the log. A record is the key, the value length, the value
+ * and a CRC over the three, padded to the flash program unit. Records are
+ * read back in the order they were written, so the last good one of a key
+ * is its value. A record cut short by losing power fails its CRC and is
+ * skipped, a compaction cut short leaves the old bank as the log.
+ *
+ * The Flash class has two banks (0 and 1) of BankSize bytes, programmed in
+ * units of ProgramUnit bytes that must still be erased:
+ *   void Read(uint8_t bank, uint32_t offset, void *data, uint32_t len);
+ *   void Program(uint8_t bank, uint32_t offset, const void *data, uint32_t len);
+ *   void Erase(uint8_t bank);
+ **/
+
+#define FLASH_LOG_MAGIC 0x474F4C45 // "ELOG"
+// Same as ELRS_CRC14_POLY
+#define FLASH_LOG_CRC14_POLY 0x2E57
+#define FLASH_LOG_MAX_VALUE 64
+
+template <class Flash>
+class FlashLog
+{
+public:
+    typedef struct {
+        uint32_t magic;
+        uint32_t generation;
+    } bankHeader_t;
+
+    typedef struct {
+        uint16_t key;
+        uint8_t length;
+        uint8_t reserved;
+    } recordHeader_t;
+
+    static constexpr uint16_t ERASED_KEY = 0xFFFF;
+    typedef void (*apply_t)(void *ctx, uint16_t key, const uint8_t *value, uint8_t length);
+    typedef void (*fill_t)(void *ctx);
+
+    explicit FlashLog(Flash &flash) : flash(flash), bank(-1), generation(0), writeOffset(0), overflowed(false) {}
+
+    // Space a record of a length byte value takes
+    static constexpr uint32_t RecordSize(uint8_t length)
+    {
+        return (sizeof(recordHeader_t) + length + sizeof(uint16_t) + Flash::ProgramUnit - 1) / Flash::ProgramUnit * Flash::ProgramUnit;
+    }
+
+    /**
+     * Find the log and hand every good record to apply() in the order they
+     * were written. False if neither bank holds a log.
+     **/
+    bool Load(apply_t apply, void *ctx)
+    {
+        bank = -1;
+        bankHeader_t headers[2];
+        for (uint8_t b = 0; b < 2; ++b)
+        {
+            flash.Read(b, 0, &headers[b], sizeof(headers[b]));
+            if (headers[b].magic != FLASH_LOG_MAGIC)
+                continue;
+            if (bank < 0 || (int32_t)(headers[b].generation - headers[bank].generation) > 0)
+                bank = b;
+        }
+        if (bank < 0)
+            return false;
+        generation = headers[bank].generation;
+
+        writeOffset = headerSize();
+        uint8_t record[RecordSize(FLASH_LOG_MAX_VALUE)];
+        const recordHeader_t *header = (const recordHeader_t *)record;
+        while (writeOffset + RecordSize(0) <= Flash::BankSize)
+        {
+            flash.Read(bank, writeOffset, record, sizeof(recordHeader_t));
+            if (header->key == ERASED_KEY && header->length == 0xFF)
+                break;
+            const uint32_t size = RecordSize(header->length);
+            if (header->key == ERASED_KEY || header->length > FLASH_LOG_MAX_VALUE || writeOffset + size > Flash::BankSize)
+            {
+                // A header cut short, nothing after it can be trusted.
+                // Leave no room so the next Append() compacts.
+                writeOffset = Flash::BankSize;
+                break;
+            }
+            flash.Read(bank, writeOffset + sizeof(recordHeader_t), record + sizeof(recordHeader_t), size - sizeof(recordHeader_t));
+            uint16_t stored;
+            memcpy(&stored, record + size - sizeof(stored), sizeof(stored));
+            if (stored == calcCrc(record, header->length))
+                apply(ctx, header->key, record + sizeof(recordHeader_t), header->length);
+            writeOffset += size;
+        }
+        return true;
+    }
+
+    bool IsFormatted() const { return bank >= 0; }
+    // Bytes left for records in the log
+    uint32_t Free() const { return bank < 0 ? 0 : Flash::BankSize - writeOffset; }
+
+    // Add a record, false if it doesn't fit and the log needs compacting first
+    bool Append(uint16_t key, const void *value, uint8_t length)
+    {
+        const uint32_t size = RecordSize(length);
+        if (key == ERASED_KEY || length > FLASH_LOG_MAX_VALUE || size > Free())
+            return false;
+
+        uint8_t record[RecordSize(FLASH_LOG_MAX_VALUE)];
+        memset(record, 0xFF, size);
+        recordHeader_t *header = (recordHeader_t *)record;
+        header->key = key;
+        header->length = length;
+        memcpy(record + sizeof(recordHeader_t), value, length);
+        const uint16_t crc = calcCrc(record, length);
+        memcpy(record + size - sizeof(crc), &crc, sizeof(crc));
+        flash.Program(bank, writeOffset, record, size);
+        writeOffset += size;
+        return true;
+    }
+
+    /**
+     * Start the log over in the other bank, fill() Append()s the latest value
+     * of every key to it. It only becomes the log once fill() returns, false
+     * if not everything fitted.
+     **/
+    bool Compact(fill_t fill, void *ctx)
+    {
+        const uint8_t target = bank == 0 ? 1 : 0;
+        flash.Erase(target);
+        const int8_t previousBank = bank;
+        const uint32_t previousOffset = writeOffset;
+        bank = target;
+        writeOffset = headerSize();
+        fill(ctx);
+        if (overflowed)
+        {
+            // Without its header the bank is ignored, the log stays where it was
+            overflowed = false;
+            bank = previousBank;
+            writeOffset = previousOffset;
+            return false;
+        }
+
+        bankHeader_t header;
+        header.magic = FLASH_LOG_MAGIC;
+        header.generation = generation + 1;
+        uint8_t unit[headerSize()];
+        memset(unit, 0xFF, sizeof(unit));
+        memcpy(unit, &header, sizeof(header));
+        flash.Program(target, 0, unit, sizeof(unit));
+        generation = header.generation;
+        return true;
+    }
+
+    // Append() from a fill() that must not fail, a miss makes the Compact() fail
+    void CompactAppend(uint16_t key, const void *value, uint8_t length)
+    {
+        if (!Append(key, value, length))
+            overflowed = true;
+    }
+
+private:
+    Flash &flash;
+    int8_t bank;            // holding the log, -1 for none
+    uint32_t generation;
+    uint32_t writeOffset;   // of the next record in the bank
+    bool overflowed;        // a CompactAppend() didn't fit
+    GENERIC_CRC14<FLASH_LOG_CRC14_POLY> crc;
+
+    static constexpr uint32_t headerSize()
+    {
+        return (sizeof(bankHeader_t) + Flash::ProgramUnit - 1) / Flash::ProgramUnit * Flash::ProgramUnit;
+    }
+
+    uint16_t calcCrc(const uint8_t *record, uint8_t length) const
+    {
+        return crc.calc(record, sizeof(recordHeader_t) + length, 0);
+    }
+};
+
+/**
+ * Byte addressed EEPROM of size bytes kept in a FlashLog, in the shape of
+ * ELRS_EEPROM. The bytes live in RAM, Commit() appends a record for every
+ * block of blockSize bytes written since the last one, so a change costs
+ * about a block of programming rather than a page erase. Blocks never
+ * written are left out of the log and read back erased.
+ **/
+template <class Flash, uint16_t size, uint8_t blockSize = 16>
+class FlashEeprom
+{
+    static_assert(size % blockSize == 0, "FlashEeprom size must be whole blocks");
+    static_assert(blockSize <= FLASH_LOG_MAX_VALUE, "FlashEeprom block too big for a record");
+    static constexpr uint16_t blocks = size / blockSize;
+
+public:
+    explicit FlashEeprom(Flash &flash) : log(flash)
+    {
+        memset(image, 0xFF, sizeof(image));
+        memset(dirty, 0, sizeof(dirty));
+        memset(used, 0, sizeof(used));
+    }
+
+    // Rebuild the bytes from the log, false if there is none yet
+    bool Begin()
+    {
+        memset(image, 0xFF, sizeof(image));
+        memset(dirty, 0, sizeof(dirty));
+        memset(used, 0, sizeof(used));
+        return log.Load(&applyRecord, this);
+    }
+
+    uint8_t ReadByte(const uint32_t address) const
+    {
+        return address < size ? image[address] : 0;
+    }
+
+    void WriteByte(const uint32_t address, const uint8_t value)
+    {
+        if (address >= size || image[address] == value)
+            return;
+        image[address] = value;
+        setBit(dirty, address / blockSize);
+    }
+
+    void Commit()
+    {
+        for (uint16_t block = 0; block < blocks; ++block)
+        {
+            if (!getBit(dirty, block))
+                continue;
+            if (!log.Append(block, &image[block * blockSize], blockSize))
+            {
+                // Full, the compaction takes the rest along
+                log.Compact(&fillBlocks, this);
+                break;
+            }
+            clearBit(dirty, block);
+            setBit(used, block);
+        }
+        memset(dirty, 0, sizeof(dirty));
+    }
+
+    // Commit() has to erase a bank to fit what has been written
+    bool CommitWillErase() const
+    {
+        uint32_t needed = 0;
+        for (uint16_t block = 0; block < blocks; ++block)
+            if (getBit(dirty, block))
+                needed += FlashLog<Flash>::RecordSize(blockSize);
+        return needed > log.Free();
+    }
+
+private:
+    FlashLog<Flash> log;
+    uint8_t image[size];
+    uint8_t dirty[(blocks + 7) / 8];
+    uint8_t used[(blocks + 7) / 8];     // blocks in the log
+
+    static bool getBit(const uint8_t *bits, uint16_t n) { return bits[n / 8] & (1 << (n % 8)); }
+    static void setBit(uint8_t *bits, uint16_t n) { bits[n / 8] |= 1 << (n % 8); }
+    static void clearBit(uint8_t *bits, uint16_t n) { bits[n / 8] &= ~(1 << (n % 8)); }
+
+    static void applyRecord(void *ctx, uint16_t key, const uint8_t *value, uint8_t length)
+    {
+        FlashEeprom *self = (FlashEeprom *)ctx;
+        if (key >= blocks || length != blockSize)
+            return;
+        memcpy(&self->image[key * blockSize], value, blockSize);
+        setBit(self->used, key);
+    }
+
+    static void fillBlocks(void *ctx)
+    {
+        FlashEeprom *self = (FlashEeprom *)ctx;
+        for (uint16_t block = 0; block < blocks; ++block)
+        {
+            if (getBit(self->dirty, block))
+                setBit(self->used, block);
+            if (getBit(self->used, block))
+                self->log.CompactAppend(block, &self->image[block * blockSize], blockSize);
+        }
+    }
+};
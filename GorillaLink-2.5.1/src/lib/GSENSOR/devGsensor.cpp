@@ -59,7 +59,8 @@ device_t Gsensor_device = {
     .initialize = initialize,
     .start = start,
     .event = NULL,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = 0
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,122 @@
+#if defined(TARGET_NATIVE)
+#include <algorithm>
+#include "NATIVE_hwTimer.h"
+
+void inline hwTimer::nullCallback(void) {}
+
+void (*hwTimer::callbackTick)() = &nullCallback;
+void (*hwTimer::callbackTock)() = &nullCallback;
+
+volatile uint32_t hwTimer::HWtimerInterval = TimerIntervalUSDefault;
+volatile bool hwTimer::isTick = false;
+volatile int32_t hwTimer::PhaseShift = 0;
+volatile int32_t hwTimer::FreqOffset = 0;
+volatile uint32_t hwTimer::PauseDuration = 0;
+bool hwTimer::running = false;
+uint64_t hwTimer::NextTimeout = 0;
+
+void hwTimer::init()
+{
+    NativeClock::attachInterrupt(HWTIMER_IRQ, hwTimer::callback);
+    running = false;
+}
+
+void hwTimer::stop()
+{
+    running = false;
+    PauseDuration = 0;
+    NativeClock::cancel(HWTIMER_IRQ);
+    NativeClock::log(nativeTimerStop, 0);
+}
+
+/*
+ * Schedule a pause of the specified duration, in us. Like the STM32 TX it
+ * spins until the tick ISR has taken it, then the next tock fires
+ * duration - interval/2 after that tick.
+ */
+void hwTimer::pause(uint32_t duration)
+{
+    NativeClock::log(nativeTimerPause, duration);
+    PauseDuration = duration;
+    while (PauseDuration && running)
+        NativeClock::advance(1);
+}
+
+void hwTimer::resume()
+{
+    isTick = false;
+    running = true;
+    NextTimeout = NativeClock::now();
+    NativeClock::log(nativeTimerResume, 0);
+    NativeClock::trigger(HWTIMER_IRQ, NextTimeout);
+}
+
+void hwTimer::updateInterval(uint32_t newTimerInterval)
+{
+    // timer should not be running when updateInterval() is called
+    hwTimer::HWtimerInterval = newTimerInterval;
+}
+
+void hwTimer::resetFreqOffset()
+{
+    FreqOffset = 0;
+}
+
+void hwTimer::incFreqOffset()
+{
+    FreqOffset++;
+}
+
+void hwTimer::decFreqOffset()
+{
+    FreqOffset--;
+}
+
+void hwTimer::phaseShift(int32_t newPhaseShift)
+{
+    const int32_t maxVal = hwTimer::HWtimerInterval >> 2;
+    hwTimer::PhaseShift = std::max(-maxVal, std::min(newPhaseShift, maxVal));
+}
+
+void hwTimer::callback(void)
+{
+    if (!running)
+    {
+        return;
+    }
+
+    // The next interrupt is set up before the callbacks, which may stop the timer
+    if (hwTimer::isTick)
+    {
+        if (PauseDuration)
+        {
+            const int32_t toTock = PauseDuration - (hwTimer::HWtimerInterval >> 1);
+            NextTimeout += toTock;
+            PauseDuration = 0;
+            hwTimer::isTick = false;
+            NativeClock::trigger(HWTIMER_IRQ, NextTimeout);
+            NativeClock::log(nativeTimerTick, toTock);
+            // No tick callback
+        }
+        else
+        {
+            const int32_t toTock = (hwTimer::HWtimerInterval >> 1) + FreqOffset;
+            NextTimeout += toTock;
+            hwTimer::isTick = false;
+            NativeClock::trigger(HWTIMER_IRQ, NextTimeout);
+            NativeClock::log(nativeTimerTick, toTock);
+            hwTimer::callbackTick();
+        }
+    }
+    else
+    {
+        const int32_t shift = hwTimer::PhaseShift;
+        NextTimeout += (hwTimer::HWtimerInterval >> 1) + shift + FreqOffset;
+        hwTimer::PhaseShift = 0;
+        hwTimer::isTick = true;
+        NativeClock::trigger(HWTIMER_IRQ, NextTimeout);
+        NativeClock::log(nativeTimerTock, shift);
+        hwTimer::callbackTock();
+    }
+}
+#endif
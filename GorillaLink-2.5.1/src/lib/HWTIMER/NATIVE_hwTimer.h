@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdio.h>
+#include "targets.h"
+
+#define TimerIntervalUSDefault 20000
+// NativeClock interrupt the timer raises
+#define HWTIMER_IRQ 1
+
+/**
+ * The STM32 timer on the native virtual clock (NativeClock in native.h):
+ * tock fires as soon as it is resumed, PhaseShift is applied on the tock,
+ * FreqOffset (in us) on every half interval and pause() stretches the tick
+ * to tock half like TARGET_TX does. Everything it does goes to the
+ * NativeClock event log.
+ **/
+class hwTimer
+{
+public:
+    static volatile uint32_t HWtimerInterval;
+    static volatile bool isTick;
+    static volatile int32_t PhaseShift;
+    static volatile int32_t FreqOffset;
+    static volatile uint32_t PauseDuration;
+    static bool running;
+    static uint64_t NextTimeout;
+
+    static void init();
+    static void stop();
+    static void pause(uint32_t duration);
+    static void resume();
+    static void callback(void);
+    static void updateInterval(uint32_t newTimerInterval);
+    static void resetFreqOffset();
+    static void incFreqOffset();
+    static void decFreqOffset();
+    static void phaseShift(int32_t newPhaseShift);
+
+    static void inline nullCallback(void);
+    static void (*callbackTick)();
+    static void (*callbackTock)();
+};
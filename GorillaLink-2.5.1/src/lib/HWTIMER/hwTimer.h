@@ -10,3 +10,7 @@
 #ifdef PLATFORM_STM32
 #include "STM32_hwTimer.h"
 #endif
+
+#ifdef TARGET_NATIVE
+#include "NATIVE_hwTimer.h"
+#endif
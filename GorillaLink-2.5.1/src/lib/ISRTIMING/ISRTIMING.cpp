@@ -0,0 +1,94 @@
+#include "ISRTIMING.h"
+
+#if defined(DEBUG_ISR_TIMING)
+
+#include "logging.h"
+
+isrTimingStats_t ISRTiming::stats[isrTimingCount];
+uint32_t ISRTiming::lastDump;
+
+static const char *const pointNames[isrTimingCount] = {
+    "Tick",
+    "Tock",
+    "RFPacket",
+    "SendRC",
+    "RadioIsr",
+    "CRSFin",
+    "TxTock",
+};
+
+void ISRTiming::init()
+{
+#if defined(PLATFORM_STM32) && defined(DWT_CTRL_CYCCNTENA_Msk)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+    reset();
+}
+
+void ISRTiming::reset()
+{
+    for (uint8_t i = 0; i < isrTimingCount; ++i)
+    {
+        stats[i] = isrTimingStats_t();
+        stats[i].min = UINT32_MAX;
+    }
+}
+
+void ICACHE_RAM_ATTR ISRTiming::record(isrTimingPoint_e point, uint32_t cycles)
+{
+    isrTimingStats_t &s = stats[point];
+    ++s.count;
+    s.total += cycles;
+    if (cycles < s.min)
+        s.min = cycles;
+    if (cycles > s.max)
+        s.max = cycles;
+
+    uint32_t us = cycles / cyclesPerUs();
+    uint8_t bucket = 0;
+    while (us && bucket < ISR_TIMING_BUCKETS - 1)
+    {
+        us >>= 1;
+        ++bucket;
+    }
+    ++s.histogram[bucket];
+}
+
+void ISRTiming::get(isrTimingPoint_e point, isrTimingStats_t &out)
+{
+    out = stats[point];
+}
+
+const char *ISRTiming::name(isrTimingPoint_e point)
+{
+    return pointNames[point];
+}
+
+void ISRTiming::dump()
+{
+    for (uint8_t i = 0; i < isrTimingCount; ++i)
+    {
+        isrTimingStats_t s;
+        get((isrTimingPoint_e)i, s);
+        if (s.count == 0)
+            continue;
+        DBGLN("ISR %s n=%u min=%u avg=%u max=%u us", pointNames[i], s.count,
+            toMicros(s.min), toMicros((uint32_t)(s.total / s.count)), toMicros(s.max));
+        DBGLN("  hist %u %u %u %u %u %u %u %u", s.histogram[0], s.histogram[1],
+            s.histogram[2], s.histogram[3], s.histogram[4], s.histogram[5],
+            s.histogram[6], s.histogram[7]);
+    }
+}
+
+void ISRTiming::update(uint32_t now)
+{
+    if (now - lastDump >= ISR_TIMING_DUMP_INTERVAL)
+    {
+        lastDump = now;
+        dump();
+    }
+}
+
+#endif
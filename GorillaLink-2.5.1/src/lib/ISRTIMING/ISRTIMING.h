@@ -0,0 +1,118 @@
+#pragma once
+
+#include <stdint.h>
+#include "targets.h"
+
+/**
+ * Execution time of the interrupt hot paths, compiled in with
+ * DEBUG_ISR_TIMING. Each instrumented function opens with
+ * ISR_TIMING_SCOPE(point), which counts the cycles until it returns: DWT
+ * CYCCNT on STM32, CCOUNT on ESP and a host clock in ns on native builds.
+ * Time spent in an interrupt that preempts the function is included.
+ * Without DEBUG_ISR_TIMING the macros expand to nothing.
+ **/
+
+typedef enum
+{
+    isrTimerTick,       // RX HWtimerCallbackTick
+    isrTimerTock,       // RX HWtimerCallbackTock
+    isrProcessRFPacket, // RX ProcessRFPacket
+    isrSendRCdata,      // TX SendRCdataToRF
+    isrRadio,           // Radio driver IsrCallback
+    isrCRSFin,          // TX CRSF::handleUARTin
+    isrTxTimerTock,     // TX timerCallbackNormal
+    isrTimingCount
+} isrTimingPoint_e;
+
+// Histogram of the run time in us: <1, <2, <4 ... <64, >=64
+#define ISR_TIMING_BUCKETS 8
+// Period of the stats dump to the debug log
+#define ISR_TIMING_DUMP_INTERVAL 5000
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t min; // cycles
+    uint32_t max; // cycles
+    uint64_t total; // cycles
+    uint32_t histogram[ISR_TIMING_BUCKETS];
+} isrTimingStats_t;
+
+#if defined(DEBUG_ISR_TIMING)
+
+#if defined(TARGET_NATIVE)
+#include <time.h>
+#endif
+
+class ISRTiming
+{
+public:
+    // Start the cycle counter
+    static void init();
+    static void reset();
+    static void record(isrTimingPoint_e point, uint32_t cycles);
+    // Copy of the stats of point, a sample behind if it is running right now
+    static void get(isrTimingPoint_e point, isrTimingStats_t &out);
+    static uint32_t toMicros(uint32_t cycles) { return cycles / cyclesPerUs(); }
+    static const char *name(isrTimingPoint_e point);
+    // Dump all the stats to the debug log
+    static void dump();
+    // Dump every ISR_TIMING_DUMP_INTERVAL, from the main loop
+    static void update(uint32_t now);
+
+    static inline uint32_t cycles()
+    {
+#if defined(PLATFORM_STM32) && defined(DWT_CTRL_CYCCNTENA_Msk)
+        return DWT->CYCCNT;
+#elif defined(PLATFORM_ESP32) || defined(PLATFORM_ESP8266)
+        return ESP.getCycleCount();
+#elif defined(TARGET_NATIVE)
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint32_t)ts.tv_sec * 1000000000U + (uint32_t)ts.tv_nsec;
+#else
+        // No cycle counter (Cortex-M0), fall back to us
+        return micros();
+#endif
+    }
+
+    static inline uint32_t cyclesPerUs()
+    {
+#if defined(PLATFORM_STM32) && defined(DWT_CTRL_CYCCNTENA_Msk)
+        return SystemCoreClock / 1000000U;
+#elif defined(PLATFORM_ESP32) || defined(PLATFORM_ESP8266)
+        return ESP.getCpuFreqMHz();
+#elif defined(TARGET_NATIVE)
+        return 1000U;
+#else
+        return 1U;
+#endif
+    }
+
+private:
+    static isrTimingStats_t stats[isrTimingCount];
+    static uint32_t lastDump;
+};
+
+class ISRTimingScope
+{
+public:
+    inline ISRTimingScope(isrTimingPoint_e point) : point(point), start(ISRTiming::cycles()) {}
+    inline ~ISRTimingScope() { ISRTiming::record(point, ISRTiming::cycles() - start); }
+
+private:
+    const isrTimingPoint_e point;
+    const uint32_t start;
+};
+
+#define ISR_TIMING_INIT()         ISRTiming::init()
+#define ISR_TIMING_SCOPE(point)   ISRTimingScope isrTimingScope(point)
+#define ISR_TIMING_UPDATE(now)    ISRTiming::update(now)
+
+#else
+
+#define ISR_TIMING_INIT()
+#define ISR_TIMING_SCOPE(point)
+#define ISR_TIMING_UPDATE(now)
+
+#endif
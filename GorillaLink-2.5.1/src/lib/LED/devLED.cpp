@@ -227,5 +227,6 @@ device_t LED_device = {
     .initialize = initialize,
     .start = event,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = EVENT_CONNECTION_CHANGED | EVENT_CONFIG_CHANGED
 };
@@ -190,7 +190,10 @@ constexpr uint8_t rate_hue[RATE_MAX] =
     170,     // 500/200 hz  blue
     85,      // 250/100 hz  green
     21,      // 150/50 hz   orange
-    0        // 50/25 hz    red
+    0,       // 50/25 hz    red
+#if defined(Regulatory_Domain_ISM_2400)
+    213      // 1000 hz     purple
+#endif
 };
 
 static blinkyColor_t blinkyColor;
@@ -298,7 +301,8 @@ device_t RGB_device = {
     .initialize = initialize,
     .start = start,
     .event = timeout,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = EVENT_CONNECTION_CHANGED | EVENT_CONFIG_CHANGED
 };
 
 #else
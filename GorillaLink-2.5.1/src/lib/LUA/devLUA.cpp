@@ -10,6 +10,8 @@
 #include "lua.h"
 #include "OTA.h"
 #include "hwTimer.h"
+#include "helpers.h"
+#include "ISRTIMING.h"
 
 #if defined(Regulatory_Domain_AU_915) || defined(Regulatory_Domain_EU_868) || defined(Regulatory_Domain_IN_866) || defined(Regulatory_Domain_FCC_915) || defined(Regulatory_Domain_AU_433) || defined(Regulatory_Domain_EU_433)
 #include "SX127xDriver.h"
@@ -24,14 +26,18 @@ extern SX1280Driver Radio;
 static const char emptySpace[1] = {0};
 static char strPowerLevels[] = "10;25;50;100;250;500;1000;2000";
 
-static struct luaItem_selection luaAirRate = {
-    {"Packet Rate", CRSF_TEXT_SELECTION},
-    0, // value
 #if defined(Regulatory_Domain_AU_915) || defined(Regulatory_Domain_EU_868) || defined(Regulatory_Domain_FCC_915) || defined(Regulatory_Domain_IN_866) || defined(Regulatory_Domain_AU_433) || defined(Regulatory_Domain_EU_433)
-    "25(-123dbm);50(-120dbm);100(-117dbm);200(-112dbm)",
+static const char strAirRates[] = "25(-123dbm);50(-120dbm);100(-117dbm);200(-112dbm)";
+static const char strAirRatesFullRes[] = "25 CR4/8(-120dbm);25(-120dbm);50(-117dbm);100(-112dbm)";
 #elif defined(Regulatory_Domain_ISM_2400)
-    "50(-117dbm);150(-112dbm);250(-108dbm);500(-105dbm)",
+static const char strAirRates[] = "50(-117dbm);150(-112dbm);250(-108dbm);500(-105dbm);1000(-104dbm)";
+static const char strAirRatesFullRes[] = "25(-117dbm);50(-112dbm);150(-108dbm);250(-105dbm);1000(-104dbm)";
 #endif
+
+static struct luaItem_selection luaAirRate = {
+    {"Packet Rate", CRSF_TEXT_SELECTION},
+    0, // value
+    strAirRates,
     "Hz"
 };
 
@@ -82,7 +88,7 @@ static struct luaItem_string luaCELimit = {
 static struct luaItem_selection luaSwitch = {
     {"Switch Mode", CRSF_TEXT_SELECTION},
     0, // value
-    "Hybrid;Wide",
+    "Hybrid;Wide;Full",
     emptySpace
 };
 
@@ -230,6 +236,31 @@ static struct luaItem_selection luaDvrStopDelay = {
 
 //---------------------------- BACKPACK ------------------
 
+#if defined(DEBUG_ISR_TIMING)
+//---------------------------- ISR TIMING ----------------
+static struct luaItem_folder luaIsrTimingFolder = {
+    {"ISR Timing", CRSF_FOLDER},
+};
+
+// avg/max us of the points that run on the TX
+static const isrTimingPoint_e luaIsrTimingPoints[] = {isrSendRCdata, isrRadio, isrCRSFin};
+
+static struct luaItem_string luaIsrTiming[] = {
+    {{"SendRC", CRSF_INFO}, emptySpace},
+    {{"RadioIsr", CRSF_INFO}, emptySpace},
+    {{"CRSFin", CRSF_INFO}, emptySpace},
+};
+
+static char luaIsrTimingStrings[ARRAY_SIZE(luaIsrTimingPoints)][16];
+
+static struct luaItem_command luaIsrTimingReset = {
+    {"Reset", CRSF_COMMAND},
+    0, // step
+    emptySpace
+};
+//---------------------------- ISR TIMING ----------------
+#endif
+
 static char luaBadGoodString[10];
 
 extern TxConfig config;
@@ -279,12 +310,44 @@ static void luadevGeneratePowerOpts()
   *out = '\0';
 }
 
+// smFullRes runs the rate indexes at the rates of its own table
+static expresslrs_mod_settings_s *luaAirRateConfig(uint8_t rate)
+{
+  return config.GetSwitchMode() == smFullRes ? get_elrs_airRateConfigFullRes(rate) : get_elrs_airRateConfig(rate);
+}
+
+// The Packet Rate options go from the slowest to the fastest rate, which is
+// not the rate index order once the FLRC rate is appended to the table. Of
+// two indexes at the same rate the higher one is the slower option.
+static uint8_t rateToLuaOption(uint8_t rate)
+{
+  const expresslrs_RFrates_e enumRate = luaAirRateConfig(rate)->enum_rate;
+  uint8_t option = 0;
+  for (uint8_t i = 0; i < RATE_MAX; i++)
+  {
+    const expresslrs_RFrates_e other = luaAirRateConfig(i)->enum_rate;
+    if (other > enumRate || (other == enumRate && i > rate))
+      ++option;
+  }
+  return option;
+}
+
+static uint8_t luaOptionToRate(uint8_t option)
+{
+  for (uint8_t i = 0; i < RATE_MAX; i++)
+  {
+    if (rateToLuaOption(i) == option)
+      return i;
+  }
+  return RATE_DEFAULT;
+}
+
 static void registerLuaParameters()
 {
   registerLUAParameter(&luaAirRate, [](uint8_t id, uint8_t arg){
     if ((arg < RATE_MAX) && (arg >= 0))
     {
-      uint8_t rate = RATE_MAX - 1 - arg;
+      uint8_t rate = luaOptionToRate(arg);
       rate = adjustPacketRateForBaud(rate);
       config.SetRate(rate);
     }
@@ -298,7 +361,7 @@ static void registerLuaParameters()
   #if defined(TARGET_TX_FM30)
   registerLUAParameter(&luaBluetoothTelem, [](uint8_t id, uint8_t arg) {
     digitalWrite(GPIO_PIN_BLUETOOTH_EN, !arg);
-    devicesTriggerEvent();
+    devicesTriggerEvent(EVENT_CONFIG_CHANGED);
   });
   #endif
   registerLUAParameter(&luaSwitch, [](uint8_t id, uint8_t arg){
@@ -310,7 +373,10 @@ static void registerLuaParameters()
       // The modes should be updated for 1.1RC so mode 0 can be smHybrid
       uint32_t newSwitchMode = (arg + 1) & 0b11;
       config.SetSwitchMode(newSwitchMode);
-      OtaSetSwitchMode((OtaSwitchMode_e)newSwitchMode);
+      // Going to or from smFullRes changes the packet length, that waits for
+      // the new air rate when the config is committed
+      if ((newSwitchMode == smFullRes) == (OtaSwitchModeCurrent == smFullRes))
+        OtaSetSwitchMode((OtaSwitchMode_e)newSwitchMode);
     }
   });
   registerLUAParameter(&luaModelMatch, [](uint8_t id, uint8_t arg){
@@ -469,17 +535,50 @@ static void registerLuaParameters()
     sendLuaCommandResponse(&luaBind, arg < 5 ? 2 : 0, arg < 5 ? "Binding..." : "");
   });
 
+  #if defined(DEBUG_ISR_TIMING)
+  registerLUAParameter(&luaIsrTimingFolder);
+  for (uint8_t i = 0; i < ARRAY_SIZE(luaIsrTiming); ++i)
+  {
+    registerLUAParameter(&luaIsrTiming[i], NULL, luaIsrTimingFolder.common.id);
+  }
+  registerLUAParameter(&luaIsrTimingReset, [](uint8_t id, uint8_t arg){
+    if (arg < 5) {
+      ISRTiming::reset();
+    }
+    sendLuaCommandResponse(&luaIsrTimingReset, 0, emptySpace);
+  }, luaIsrTimingFolder.common.id);
+  #endif
+
   registerLUAParameter(&luaInfo);
   registerLUAParameter(&luaELRSversion);
   registerLUAParameter(NULL);
 }
 
+#if defined(DEBUG_ISR_TIMING)
+static void luadevUpdateIsrTiming()
+{
+  for (uint8_t i = 0; i < ARRAY_SIZE(luaIsrTimingPoints); ++i)
+  {
+    isrTimingStats_t stats;
+    ISRTiming::get(luaIsrTimingPoints[i], stats);
+    char *str = luaIsrTimingStrings[i];
+    const uint32_t avg = stats.count ? (uint32_t)(stats.total / stats.count) : 0;
+    itoa(ISRTiming::toMicros(avg), str, 10);
+    strcat(str, "/");
+    itoa(ISRTiming::toMicros(stats.max), str + strlen(str), 10);
+    strcat(str, "us");
+    setLuaStringValue(&luaIsrTiming[i], str);
+  }
+}
+#endif
+
 static int event()
 {
   setLuaWarningFlag(LUA_FLAG_MODEL_MATCH, connectionState == connected && connectionHasModelMatch == false);
   setLuaWarningFlag(LUA_FLAG_CONNECTED, connectionState == connected);
   uint8_t rate = adjustPacketRateForBaud(config.GetRate());
-  setLuaTextSelectionValue(&luaAirRate, RATE_MAX - 1 - rate);
+  luaAirRate.options = config.GetSwitchMode() == smFullRes ? strAirRatesFullRes : strAirRates;
+  setLuaTextSelectionValue(&luaAirRate, rateToLuaOption(rate));
   setLuaTextSelectionValue(&luaTlmRate, config.GetTlm());
   setLuaTextSelectionValue(&luaSwitch,(uint8_t)(config.GetSwitchMode() - 1)); // -1 for missing sm1Bit
   setLuaTextSelectionValue(&luaModelMatch,(uint8_t)config.GetModelMatch());
@@ -525,6 +624,9 @@ static int start()
     strcat(luaBadGoodString, "/");
     itoa(CRSF::GoodPktsCountResult, luaBadGoodString + strlen(luaBadGoodString), 10);
     setLuaStringValue(&luaInfo, luaBadGoodString);
+    #if defined(DEBUG_ISR_TIMING)
+    luadevUpdateIsrTiming();
+    #endif
   });
   event();
   return DURATION_IMMEDIATELY;
@@ -534,7 +636,8 @@ device_t LUA_device = {
   .initialize = NULL,
   .start = start,
   .event = event,
-  .timeout = timeout
+  .timeout = timeout,
+  .eventMask = EVENT_CONNECTION_CHANGED | EVENT_CONFIG_CHANGED
 };
 
 #endif
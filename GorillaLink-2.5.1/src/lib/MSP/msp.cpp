@@ -93,15 +93,25 @@ MSP::processReceivedByte(uint8_t c)
                 m_packet.flags = header->flags;
                 // reset the offset iterator for re-use in payload below
                 m_offset = 0;
-                m_inputState = MSP_PAYLOAD_V2_NATIVE;
+                m_inputState = (m_packet.payloadSize == 0) ? MSP_CHECKSUM_V2_NATIVE : MSP_PAYLOAD_V2_NATIVE;
             }
             break;
 
         case MSP_PAYLOAD_V2_NATIVE:
-            // Read bytes until we reach payloadSize
-            m_packet.payload[m_offset++] = c;
+            // Keep the start of the payload in the packet, and pass all of
+            // it on to the callback a chunk at a time
+            if (m_offset < MSP_PORT_INBUF_SIZE) {
+                m_packet.payload[m_offset] = c;
+            }
+            m_inputBuffer[m_offset % MSP_PORT_CHUNK_SIZE] = c;
+            m_offset++;
             m_crc = crc8_dvb_s2(m_crc, c);
 
+            if (m_payloadCallback && (m_offset % MSP_PORT_CHUNK_SIZE == 0 || m_offset == m_packet.payloadSize)) {
+                const uint16_t chunkStart = (m_offset - 1) / MSP_PORT_CHUNK_SIZE * MSP_PORT_CHUNK_SIZE;
+                m_payloadCallback(&m_packet, chunkStart, m_inputBuffer, m_offset - chunkStart);
+            }
+
             // If we've received the correct amount of bytes for payload
             if (m_offset == m_packet.payloadSize) {
                 // Then we're up to the CRC
@@ -161,6 +171,11 @@ MSP::sendPacket(mspPacket_t* packet, Stream* port)
         // Response packet with no payload
         return false;
     }
+
+    if (packet->payloadSize > MSP_PORT_INBUF_SIZE) {
+        // Only what is kept of the payload can be sent
+        return false;
+    }
     
     // Write out the framing chars
     port->write('$');
@@ -2,11 +2,12 @@
 
 #include "targets.h"
 
-// TODO: MSP_PORT_INBUF_SIZE should be changed to
-// dynamically allocate array length based on the payload size
-// Hardcoding payload size to 8 bytes for now, since MSP is
-// limited to a 4 byte payload on the BF side
+// Only the start of the payload is kept in mspPacket_t, which is all the ELRS
+// functions need since MSP is limited to a 4 byte payload on the BF side.
+// Payloads of any length up to 65535 are handed to the payload callback in
+// chunks of up to MSP_PORT_CHUNK_SIZE as they arrive.
 #define MSP_PORT_INBUF_SIZE 8
+#define MSP_PORT_CHUNK_SIZE 64
 
 #define CHECK_PACKET_PARSING() \
   if (packet->readError) {\
@@ -58,6 +59,10 @@ typedef struct {
 
     void addByte(uint8_t b)
     {
+        if (payloadSize >= MSP_PORT_INBUF_SIZE) {
+            readError = true;
+            return;
+        }
         payload[payloadSize++] = b;
     }
 
@@ -73,8 +78,9 @@ typedef struct {
 
     uint8_t readByte()
     {
-        if (payloadReadIterator >= payloadSize) {
-            // We are trying to read beyond the length of the payload
+        if (payloadReadIterator >= payloadSize || payloadReadIterator >= MSP_PORT_INBUF_SIZE) {
+            // We are trying to read beyond the length of the payload,
+            // or the part of it that was kept
             readError = true;
             return 0;
         }
@@ -83,6 +89,14 @@ typedef struct {
     }
 } mspPacket_t;
 
+/**
+ * Called with each chunk of the payload of the packet being received, offset
+ * is where data starts in the payload. The chunks have not been checked yet,
+ * they only count once processReceivedByte() returns true for the packet, and
+ * one at offset 0 means the packet before was dropped.
+ **/
+typedef void (*mspPayloadCallback_t)(const mspPacket_t *packet, uint16_t offset, const uint8_t *data, uint8_t len);
+
 /////////////////////////////////////////////////
 
 class MSP
@@ -91,12 +105,14 @@ public:
     bool            processReceivedByte(uint8_t c);
     mspPacket_t*    getReceivedPacket();
     void            markPacketReceived();
+    void            setPayloadCallback(mspPayloadCallback_t callback) { m_payloadCallback = callback; }
     static bool     sendPacket(mspPacket_t* packet, Stream* port);
 
 private:
-    mspState_e  m_inputState;
+    mspState_e  m_inputState = MSP_IDLE;
     uint16_t    m_offset;
-    uint8_t     m_inputBuffer[MSP_PORT_INBUF_SIZE];
+    uint8_t     m_inputBuffer[MSP_PORT_CHUNK_SIZE];
     mspPacket_t m_packet;
     uint8_t     m_crc;
+    mspPayloadCallback_t m_payloadCallback = nullptr;
 };
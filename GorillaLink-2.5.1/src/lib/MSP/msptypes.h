@@ -25,6 +25,12 @@
 #define ENCAPSULATED_MSP_HEADER_CRC_LEN     4
 #define ENCAPSULATED_MSP_MAX_PAYLOAD_SIZE   4
 #define ENCAPSULATED_MSP_MAX_FRAME_LEN      (ENCAPSULATED_MSP_HEADER_CRC_LEN + ENCAPSULATED_MSP_MAX_PAYLOAD_SIZE)
+// The header byte of MSP over CRSF: the MSP version, whether the frame starts
+// a packet and a sequence number that counts the frames of the packet
+#define ENCAPSULATED_MSP_STATUS_VERSION_1   0x20
+#define ENCAPSULATED_MSP_STATUS_VERSION_2   0x40
+#define ENCAPSULATED_MSP_STATUS_START       0x10
+#define ENCAPSULATED_MSP_STATUS_SEQ_MASK    0x0F
 
 // ELRS backpack protocol opcodes
 // See: https://docs.google.com/document/d/1u3c7OTiO4sFL2snI-hIo-uRSLfgBK4h16UrbA08Pd6U/edit#heading=h.1xw7en7jmvsj
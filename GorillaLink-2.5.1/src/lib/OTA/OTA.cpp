@@ -62,10 +62,11 @@ void ICACHE_RAM_ATTR GenerateChannelDataHybrid8(volatile uint8_t* Buffer, CRSF *
     // If the two high bits are 0b11, the receiver knows it is the last switch and can use
     // that bit to store data
     uint8_t bitclearedSwitchIndex = Hybrid8NextSwitchIndex;
+    const uint16_t ch = crsf->ChannelDataIn[bitclearedSwitchIndex + 1 + 4];
     uint8_t value;
     // AUX8 is High Resolution 16-pos (4-bit)
     if (bitclearedSwitchIndex == 6)
-        value = CRSF_to_N(crsf->ChannelDataIn[6 + 1 + 4], 16);
+        value = CRSF_to_N<16>(ch);
     else
     {
         // AUX2-7 are Low Resolution, "7pos" 6+center (3-bit)
@@ -74,13 +75,9 @@ void ICACHE_RAM_ATTR GenerateChannelDataHybrid8(volatile uint8_t* Buffer, CRSF *
         // with switches with a middle position as well as 6-position
         const uint16_t CHANNEL_BIN_COUNT = 6;
         const uint16_t CHANNEL_BIN_SIZE = (CRSF_CHANNEL_VALUE_MAX - CRSF_CHANNEL_VALUE_MIN) / CHANNEL_BIN_COUNT;
-        uint16_t ch = crsf->ChannelDataIn[bitclearedSwitchIndex + 1 + 4];
         // If channel is within 1/4 a BIN of being in the middle use special value 7
-        if (ch < (CRSF_CHANNEL_VALUE_MID-CHANNEL_BIN_SIZE/4)
-            || ch > (CRSF_CHANNEL_VALUE_MID+CHANNEL_BIN_SIZE/4))
-            value = CRSF_to_N(ch, CHANNEL_BIN_COUNT);
-        else
-            value = 7;
+        const bool middle = (uint16_t)(ch - (CRSF_CHANNEL_VALUE_MID - CHANNEL_BIN_SIZE/4)) <= 2 * (CHANNEL_BIN_SIZE/4);
+        value = middle ? 7 : CRSF_to_N<CHANNEL_BIN_COUNT>(ch);
     } // If not 16-pos
 
     Buffer[6] =
@@ -102,13 +99,8 @@ void ICACHE_RAM_ATTR GenerateChannelDataHybrid8(volatile uint8_t* Buffer, CRSF *
  */
 static uint8_t ICACHE_RAM_ATTR HybridWideSwitchToOta(CRSF *crsf, uint8_t switchIdx, bool lowRes)
 {
-    uint16_t ch = crsf->ChannelDataIn[switchIdx + 4];
-    uint8_t binCount = (lowRes) ? 64 : 128;
-    ch = CRSF_to_N(ch, binCount);
-    if (lowRes)
-        return ch & 0b111111; // 6-bit
-    else
-        return ch & 0b1111111; // 7-bit
+    // The 64 bin value is the 128 bin value without its low bit
+    return CRSF_to_N<128>(crsf->ChannelDataIn[switchIdx + 4]) >> lowRes;
 }
 
 /**
@@ -153,6 +145,38 @@ void ICACHE_RAM_ATTR GenerateChannelDataHybridWide(volatile uint8_t* Buffer, CRS
         value;
 }
 
+/**
+ * Full resolution packet encoding for sending over the air
+ *
+ * All 12 channels are sent in every packet at the full 11 bit CRSF
+ * resolution, packed LSB first into Buffer[1] to Buffer[17], followed by
+ * the TelemetryStatus bit. Needs the OTA_FULLRES_PAYLOAD_LENGTH packet.
+ *
+ * Inputs: crsf.ChannelDataIn
+ * Outputs: Radio.TXdataBuffer
+ **/
+void ICACHE_RAM_ATTR GenerateChannelDataFullRes(volatile uint8_t* Buffer, CRSF *crsf, bool TelemetryStatus, uint8_t nonce, uint8_t tlmDenom)
+{
+    Buffer[0] = RC_DATA_PACKET & 0b11;
+
+    volatile uint8_t *dest = &Buffer[1];
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    for (uint8_t ch = 0; ch < OTA_FULLRES_CHANNELS; ++ch)
+    {
+        bits |= (uint32_t)(crsf->ChannelDataIn[ch] & 0x7ff) << bitCount;
+        bitCount += 11;
+        while (bitCount >= 8)
+        {
+            *dest++ = bits;
+            bits >>= 8;
+            bitCount -= 8;
+        }
+    }
+    // 4 bits of the last channel are left, the TelemetryStatus goes above them
+    *dest = bits | (TelemetryStatus << bitCount);
+}
+
 #endif
 
 #if TARGET_RX or defined UNIT_TEST
@@ -160,6 +184,48 @@ void ICACHE_RAM_ATTR GenerateChannelDataHybridWide(volatile uint8_t* Buffer, CRS
 // Current ChannelData unpacker function being used by RX
 UnpackChannelData_t UnpackChannelData;
 
+template <uint8_t... Is> struct OtaIndexSeq {};
+template <uint8_t N, uint8_t... Is> struct OtaMakeSeq : OtaMakeSeq<N - 1, N - 1, Is...> {};
+template <uint8_t... Is> struct OtaMakeSeq<0, Is...> { typedef OtaIndexSeq<Is...> type; };
+
+/**
+ * N_to_CRSF(n, max) for every n of the round-robin switch encodings,
+ * generated at compile time so the RX does no division per packet
+ **/
+template <uint8_t max, class Seq = typename OtaMakeSeq<max + 1>::type> struct NToCrsfTable;
+template <uint8_t max, uint8_t... Is>
+struct NToCrsfTable<max, OtaIndexSeq<Is...> >
+{
+    static constexpr uint16_t values[sizeof...(Is)] = {
+        (uint16_t)(Is * (CRSF_CHANNEL_VALUE_2000 - CRSF_CHANNEL_VALUE_1000) / max + CRSF_CHANNEL_VALUE_1000)... };
+};
+template <uint8_t max, uint8_t... Is>
+constexpr uint16_t NToCrsfTable<max, OtaIndexSeq<Is...> >::values[sizeof...(Is)];
+
+// SWITCH3b_to_CRSF() for each 3 bit value, filled in at startup
+static const uint16_t Switch3bToCrsf[8] = {
+    SWITCH3b_to_CRSF(0), SWITCH3b_to_CRSF(1), SWITCH3b_to_CRSF(2), SWITCH3b_to_CRSF(3),
+    SWITCH3b_to_CRSF(4), SWITCH3b_to_CRSF(5), SWITCH3b_to_CRSF(6), SWITCH3b_to_CRSF(7) };
+
+/**
+ * PackedRCdataOut is laid out as the CRSF frame, 16 channels of 11 bits
+ * LSB first, so a channel picked at run time is written straight into its
+ * bits instead of going through a switch over the bitfields. Only the 12
+ * OTA channels are written, the 3 byte window never passes the end.
+ **/
+static inline void ICACHE_RAM_ATTR SetPackedChannel(crsf_channels_t *channels, uint8_t idx, uint16_t value)
+{
+    const uint8_t bit = idx * 11;
+    const uint8_t shift = bit & 7;
+    uint8_t *window = (uint8_t *)channels + (bit >> 3);
+    const uint32_t mask = 0x7ffUL << shift;
+    uint32_t bits = window[0] | ((uint32_t)window[1] << 8) | ((uint32_t)window[2] << 16);
+    bits = (bits & ~mask) | ((uint32_t)value << shift);
+    window[0] = bits;
+    window[1] = bits >> 8;
+    window[2] = bits >> 16;
+}
+
 static void ICACHE_RAM_ATTR UnpackChannelDataHybridCommon(volatile uint8_t* Buffer, CRSF *crsf)
 {
     // The analog channels
@@ -192,32 +258,12 @@ bool ICACHE_RAM_ATTR UnpackChannelDataHybridSwitch8(volatile uint8_t* Buffer, CR
     // to leave the low bit open for switch 7 (sent as 0b11x)
     // where x is the high bit of switch 7
     uint8_t switchIndex = (switchByte & 0b111000) >> 3;
-    uint16_t switchValue = SWITCH3b_to_CRSF(switchByte & 0b111);
-
-    switch (switchIndex) {
-    case 0:
-        crsf->PackedRCdataOut.ch5 = switchValue;
-        break;
-    case 1:
-        crsf->PackedRCdataOut.ch6 = switchValue;
-        break;
-    case 2:
-        crsf->PackedRCdataOut.ch7 = switchValue;
-        break;
-    case 3:
-        crsf->PackedRCdataOut.ch8 = switchValue;
-        break;
-    case 4:
-        crsf->PackedRCdataOut.ch9 = switchValue;
-        break;
-    case 5:
-        crsf->PackedRCdataOut.ch10 = switchValue;
-        break;
-    case 6:   // Because AUX1 (index 0) is the low latency switch, the low bit
-    case 7:   // of the switchIndex can be used as data, and arrives as index "6"
-        crsf->PackedRCdataOut.ch11 = N_to_CRSF(switchByte & 0b1111, 15);
-        break;
-    }
+    // Because AUX1 (index 0) is the low latency switch, the low bit
+    // of the switchIndex can be used as data, and arrives as index "6"
+    const bool highRes = switchIndex >= 6;
+    const uint16_t switchValue = highRes ?
+        NToCrsfTable<15>::values[switchByte & 0b1111] : Switch3bToCrsf[switchByte & 0b111];
+    SetPackedChannel(&crsf->PackedRCdataOut, highRes ? 11 : switchIndex + 5, switchValue);
 
     // TelemetryStatus bit
     return switchByte & (1 << 7);
@@ -255,46 +301,43 @@ bool ICACHE_RAM_ATTR UnpackChannelDataHybridWide(volatile uint8_t* Buffer, CRSF
     }
     else
     {
-        uint8_t bins;
-        uint16_t switchValue;
-        if (telemInEveryPacket)
-        {
-            bins = 63;
-            switchValue = switchByte & 0b111111; // 6-bit
-        }
-        else
-        {
-            bins = 127;
-            switchValue = switchByte & 0b1111111; // 7-bit
-        }
+        const uint16_t switchValue = telemInEveryPacket ?
+            NToCrsfTable<63>::values[switchByte & 0b111111] : // 6-bit
+            NToCrsfTable<127>::values[switchByte & 0b1111111]; // 7-bit
+        SetPackedChannel(&crsf->PackedRCdataOut, switchIndex + 5, switchValue);
+    }
+
+    return TelemetryStatus;
+}
 
-        switchValue = N_to_CRSF(switchValue, bins);
-        switch (switchIndex) {
-            case 0:
-                crsf->PackedRCdataOut.ch5 = switchValue;
-                break;
-            case 1:
-                crsf->PackedRCdataOut.ch6 = switchValue;
-                break;
-            case 2:
-                crsf->PackedRCdataOut.ch7 = switchValue;
-                break;
-            case 3:
-                crsf->PackedRCdataOut.ch8 = switchValue;
-                break;
-            case 4:
-                crsf->PackedRCdataOut.ch9 = switchValue;
-                break;
-            case 5:
-                crsf->PackedRCdataOut.ch10 = switchValue;
-                break;
-            case 6:
-                crsf->PackedRCdataOut.ch11 = switchValue;
-                break;
+/**
+ * Full resolution decoding of over the air data
+ *
+ * 12 channels of 11 bits and the TelemetryStatus bit, see
+ * GenerateChannelDataFullRes()
+ *
+ * Output: crsf.PackedRCdataOut
+ * Returns: TelemetryStatus bit
+ **/
+bool ICACHE_RAM_ATTR UnpackChannelDataFullRes(volatile uint8_t* Buffer, CRSF *crsf, uint8_t nonce, uint8_t tlmDenom)
+{
+    volatile uint8_t *src = &Buffer[1];
+    uint32_t bits = 0;
+    uint8_t bitCount = 0;
+    for (uint8_t ch = 0; ch < OTA_FULLRES_CHANNELS; ++ch)
+    {
+        while (bitCount < 11)
+        {
+            bits |= (uint32_t)*src++ << bitCount;
+            bitCount += 8;
         }
+        SetPackedChannel(&crsf->PackedRCdataOut, ch, bits & 0x7ff);
+        bits >>= 11;
+        bitCount -= 11;
     }
 
-    return TelemetryStatus;
+    // TelemetryStatus bit, right above the last channel
+    return bits & 1;
 }
 #endif
 
@@ -321,6 +364,14 @@ void OtaSetSwitchMode(OtaSwitchMode_e switchMode)
         UnpackChannelData = &UnpackChannelDataHybridWide;
         #endif
         break;
+    case smFullRes:
+        #if defined(TARGET_TX) || defined(UNIT_TEST)
+        PackChannelData = &GenerateChannelDataFullRes;
+        #endif
+        #if defined(TARGET_RX) || defined(UNIT_TEST)
+        UnpackChannelData = &UnpackChannelDataFullRes;
+        #endif
+        break;
     }
 
     OtaSwitchModeCurrent = switchMode;
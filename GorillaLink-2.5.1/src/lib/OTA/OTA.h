@@ -1,7 +1,6 @@
 #ifndef H_OTA
 #define H_OTA
 
-#include <functional>
 #include "CRSF.h"
 
 // expresslrs packet header types
@@ -17,12 +16,17 @@
 // Mask used to XOR the ModelId into the SYNC packet for ModelMatch
 #define MODELMATCH_MASK 0x3f
 
-enum OtaSwitchMode_e { sm1Bit, smHybrid, smHybridWide };
+enum OtaSwitchMode_e { sm1Bit, smHybrid, smHybridWide, smFullRes };
+// smFullRes sends all 12 channels at full resolution in a longer packet, the
+// air rates for it come from ExpressLRS_AirRateConfigFullRes
+#define OTA_FULLRES_CHANNELS 12
+#define OTA_FULLRES_PAYLOAD_LENGTH 19
 void OtaSetSwitchMode(OtaSwitchMode_e mode);
 extern OtaSwitchMode_e OtaSwitchModeCurrent;
 
 #if defined(TARGET_TX) || defined(UNIT_TEST)
-typedef std::function<void (volatile uint8_t* Buffer, CRSF *crsf, bool TelemetryStatus, uint8_t nonce, uint8_t tlmDenom)> PackChannelData_t;
+// Plain function pointers, these are called from the TX and RX ISRs
+typedef void (*PackChannelData_t)(volatile uint8_t* Buffer, CRSF *crsf, bool TelemetryStatus, uint8_t nonce, uint8_t tlmDenom);
 extern PackChannelData_t PackChannelData;
 #if defined(UNIT_TEST)
 void OtaSetHybrid8NextSwitchIndex(uint8_t idx);
@@ -30,7 +34,7 @@ void OtaSetHybrid8NextSwitchIndex(uint8_t idx);
 #endif
 
 #if defined(TARGET_RX) || defined(UNIT_TEST)
-typedef std::function<bool (volatile uint8_t* Buffer, CRSF *crsf, uint8_t nonce, uint8_t tlmDenom)> UnpackChannelData_t;
+typedef bool (*UnpackChannelData_t)(volatile uint8_t* Buffer, CRSF *crsf, uint8_t nonce, uint8_t tlmDenom);
 extern UnpackChannelData_t UnpackChannelData;
 #endif
 
@@ -1,7 +1,6 @@
 #pragma once
-#include <Arduino.h>
 #include <stdio.h>
-#include "../../src/include/targets.h"
+#include "targets.h"
 
 class PFD
 {
@@ -31,9 +30,12 @@ public:
         gotIntEvent = false;
     }
 
-    inline void calcResult()
+    // False, and a result of 0, unless both events came in since the last reset
+    inline bool calcResult()
     {
-        result = (gotExtEvent && gotIntEvent) ? (int32_t)(extEventTime - intEventTime) : 0;
+        const bool valid = gotExtEvent && gotIntEvent;
+        result = valid ? (int32_t)(extEventTime - intEventTime) : 0;
+        return valid;
     }
 
     inline int32_t getResult()
@@ -0,0 +1,177 @@
+#pragma once
+#include <stdint.h>
+#include "targets.h"
+
+/**
+ * Second order loop locking the RX timer to the packets. Once per packet
+ * interval it takes the phase error the PFD measured, positive when the tock
+ * came before the packet, and returns the phase shift for the next tock in us.
+ *
+ * A shift only moves the tock after the next one, so the error the loop
+ * works on is the one expected at that next tock: the measured error, less
+ * the shift still on its way, plus an interval of the learnt clock error.
+ * While acquiring all of it is taken out at once. Tracking, it is a PI
+ * controller whose integral term is the clock error between the two ends, it
+ * keeps being applied in the intervals without a packet, which leave it
+ * untouched. Kp = (2N + 1)/N^2 and Ki = 1/N^2 put a critically damped double
+ * pole at 1 - 1/N, N being PLL_TIME_CONSTANT_US in packet intervals.
+ * Fractions of a us are carried over to the next interval, so the timer's
+ * whole us steps add up to the exact correction.
+ **/
+
+#define PLL_FRAC_BITS 16
+// Loop time constant, held to PLL_MIN_UPDATES..PLL_MAX_UPDATES packet intervals
+#define PLL_TIME_CONSTANT_US 40000
+#define PLL_MIN_UPDATES 4
+#define PLL_MAX_UPDATES 32
+// Largest clock error between TX and RX the integral term can take up
+#define PLL_MAX_FREQ_PPM 200
+// Largest phase error the PI loop takes on, beyond it the step is pulled in
+// without touching the integral term
+#define PLL_TRACK_ERROR_US 32
+// Smoothed phase error (getLockError) to consider the packets acquired
+#define PLL_ACQUIRE_ERROR_US 10
+// and then the loop locked, once it has run PLL_LOCK_UPDATES time constants
+#define PLL_LOCK_ERROR_US 5
+#define PLL_LOCK_UPDATES 3
+// Weight of the newest error in the smoothed ones, 1/2^n
+#define PLL_ERROR_SMOOTHING 1
+
+class PLL
+{
+private:
+    uint32_t interval = 0;
+    int32_t kp = 0;             // Q16
+    int32_t ki = 0;             // Q16
+    int32_t maxFreq = 0;        // integrator limit, Q16 us per interval
+    uint8_t lockUpdates = 0;
+    int32_t integrator = 0;     // Q16 us per interval
+    int32_t residual = 0;       // Q16 us not shifted yet
+    int32_t pending = 0;        // us, the last shift returned
+    int32_t errorFP = 0;        // Q4 us
+    int32_t lockErrorFP = 0;    // Q4 us
+    uint8_t trackingUpdates = 0;
+    bool needSmoothReset = true;
+
+    inline int32_t output(int32_t correction)
+    {
+        correction += residual;
+        const int32_t shift = correction >> PLL_FRAC_BITS;
+        residual = correction - shift * (1 << PLL_FRAC_BITS);
+        return hold(shift);
+    }
+
+    // hwTimer::phaseShift() limits the shift to a quarter interval
+    inline int32_t hold(int32_t shift)
+    {
+        const int32_t limit = interval >> 2;
+        if (shift > limit)
+            shift = limit;
+        else if (shift < -limit)
+            shift = -limit;
+        pending = shift;
+        return shift;
+    }
+
+    // a * b >> PLL_FRAC_BITS for a gain a and |b| up to a few ms in Q16
+    static inline int32_t mulFP(int32_t a, int32_t b)
+    {
+        return (a * (b >> 8)) >> (PLL_FRAC_BITS - 8);
+    }
+
+    inline void smooth(int32_t phaseError)
+    {
+        const int32_t absError = phaseError < 0 ? -phaseError : phaseError;
+        // Like LPF, the first error after a reset is taken as it is
+        if (needSmoothReset)
+        {
+            errorFP = phaseError * 16;
+            lockErrorFP = absError * 16;
+            needSmoothReset = false;
+            return;
+        }
+        errorFP += (phaseError * 16 - errorFP) >> PLL_ERROR_SMOOTHING;
+        lockErrorFP += (absError * 16 - lockErrorFP) >> PLL_ERROR_SMOOTHING;
+    }
+
+public:
+    // Derive the gains for the packet interval in us, and start over
+    void init(uint32_t newInterval)
+    {
+        uint32_t n = PLL_TIME_CONSTANT_US / newInterval;
+        if (n < PLL_MIN_UPDATES)
+            n = PLL_MIN_UPDATES;
+        else if (n > PLL_MAX_UPDATES)
+            n = PLL_MAX_UPDATES;
+
+        interval = newInterval;
+        kp = ((2 * n + 1) << PLL_FRAC_BITS) / (n * n);
+        ki = (1 << PLL_FRAC_BITS) / (n * n);
+        maxFreq = ((uint64_t)newInterval * PLL_MAX_FREQ_PPM << PLL_FRAC_BITS) / 1000000U;
+        lockUpdates = n * PLL_LOCK_UPDATES;
+        reset();
+    }
+
+    inline void reset()
+    {
+        integrator = 0;
+        residual = 0;
+        pending = 0;
+        errorFP = 0;
+        lockErrorFP = 0;
+        needSmoothReset = true;
+        trackingUpdates = 0;
+    }
+
+    // The phase error of this interval's packet, tracking once the link is
+    // connected. Returns the phase shift for the timer.
+    inline int32_t update(int32_t phaseError, bool tracking)
+    {
+        smooth(phaseError);
+        phaseError -= pending;
+        if (!tracking)
+        {
+            trackingUpdates = 0;
+            return hold(phaseError);
+        }
+        // More than the clock error could have built up is a phase step or
+        // an outlier, pull it in like acquiring rather than let it wind the
+        // integral term up
+        if (phaseError > PLL_TRACK_ERROR_US || phaseError < -PLL_TRACK_ERROR_US)
+        {
+            trackingUpdates = 0;
+            return output(phaseError * (1 << (PLL_FRAC_BITS - 1)) + integrator);
+        }
+
+        const int32_t expected = phaseError * (1 << PLL_FRAC_BITS) + integrator;
+        const int32_t shift = output(mulFP(kp, expected) + integrator);
+        integrator += mulFP(ki, expected);
+        if (integrator > maxFreq)
+            integrator = maxFreq;
+        else if (integrator < -maxFreq)
+            integrator = -maxFreq;
+        if (trackingUpdates < lockUpdates)
+            ++trackingUpdates;
+        return shift;
+    }
+
+    // No packet this interval, keep the timer running at the learnt frequency
+    inline int32_t coast()
+    {
+        return output(integrator);
+    }
+
+    // Smoothed phase error, us
+    inline int32_t getError() const { return errorFP >> 4; }
+    // Smoothed magnitude of the phase error, us, the lock quality
+    inline uint32_t getLockError() const { return lockErrorFP >> 4; }
+    inline bool isLocked() const
+    {
+        return trackingUpdates >= lockUpdates && getLockError() <= PLL_LOCK_ERROR_US;
+    }
+    // Clock error of the RX against the TX, positive when the RX runs fast
+    int32_t getFreqPpm() const
+    {
+        return interval ? ((int64_t)integrator * 1000000 / interval) >> PLL_FRAC_BITS : 0;
+    }
+};
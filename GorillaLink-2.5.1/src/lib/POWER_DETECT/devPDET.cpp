@@ -70,6 +70,7 @@ device_t PDET_device = {
     .initialize = NULL,
     .start = start,
     .event = NULL,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = 0
 };
 #endif
\ No newline at end of file
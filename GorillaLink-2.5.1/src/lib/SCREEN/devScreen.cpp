@@ -277,6 +277,7 @@ device_t Screen_device = {
     .initialize = initialize,
     .start = start,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = EVENT_CONNECTION_CHANGED | EVENT_CONFIG_CHANGED
 };
 #endif
\ No newline at end of file
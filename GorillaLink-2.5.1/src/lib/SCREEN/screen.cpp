@@ -11,7 +11,8 @@ const char *Screen::rate_string[RATE_MAX_NUMBER] = {
     "500Hz",
     "250Hz",
     "150Hz",
-    "50Hz"
+    "50Hz",
+    "1000Hz"
 };
 #else
 const char *Screen::rate_string[RATE_MAX_NUMBER] = {
@@ -3,7 +3,11 @@
 
 #include "targets.h"
 
+#ifdef Regulatory_Domain_ISM_2400
+#define RATE_MAX_NUMBER 5
+#else
 #define RATE_MAX_NUMBER 4
+#endif
 #define POWER_MAX_NUMBER 8
 #define RATIO_MAX_NUMBER 8
 #define POWERSAVING_MAX_NUMBER 2
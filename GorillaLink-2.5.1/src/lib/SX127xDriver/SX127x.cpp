@@ -1,5 +1,6 @@
 #include "SX127x.h"
 #include "logging.h"
+#include "ISRTIMING.h"
 
 SX127xHal hal;
 
@@ -234,6 +235,14 @@ void ICACHE_RAM_ATTR SX127xDriver::SetFrequencyReg(uint32_t freq)
   hal.writeRegisterBurst(SX127X_REG_FRF_MSB, outbuff, sizeof(outbuff));
 }
 
+void ICACHE_RAM_ATTR SX127xDriver::SetFrequencyCmd(uint32_t freq, const uint8_t *cmd)
+{
+  currFreq = freq;
+  SetMode(SX127x_OPMODE_STANDBY);
+
+  hal.writeRaw(cmd, FREQ_CMD_SIZE);
+}
+
 void ICACHE_RAM_ATTR SX127xDriver::SetRxTimeoutUs(uint32_t interval)
 {
   timeoutSymbols = 0; // no timeout i.e. use continuous mode
@@ -268,7 +277,7 @@ void ICACHE_RAM_ATTR SX127xDriver::SetRxTimeoutUs(uint32_t interval)
     timeoutSymbols = interval / symbolTimeUs;
     hal.setRegValue(SX127X_REG_MODEM_CONFIG_2, timeoutSymbols >> 8, 1, 0);  // set the timeout MSB
     hal.setRegValue(SX127X_REG_SYMB_TIMEOUT_LSB, timeoutSymbols & 0xFF);
-    DBGLN("SetRxTimeout(%u), symbolTime=%uus symbols=%u", interval, (uint32_t)symbolTimeUs, timeoutSymbols)
+    DBGLN("SetRxTimeout(%u), symbolTime=%uus symbols=%u", interval, (uint32_t)symbolTimeUs, timeoutSymbols);
   }
 }
 
@@ -337,6 +346,7 @@ void ICACHE_RAM_ATTR SX127xDriver::TXnb()
 
 void ICACHE_RAM_ATTR SX127xDriver::RXnbISR()
 {
+  LastPacketIsrMicros = hal.IsrMicros;
   hal.readRegisterFIFO(RXdataBuffer, PayloadLength);
   if (timeoutSymbols)
   {
@@ -389,7 +399,7 @@ void SX127xDriver::Config(SX127x_Bandwidth bw, SX127x_SpreadingFactor sf, SX127x
 
 void SX127xDriver::Config(SX127x_Bandwidth bw, SX127x_SpreadingFactor sf, SX127x_CodingRate cr, uint32_t freq, uint8_t preambleLen, uint8_t syncWord, bool InvertIQ, uint8_t PayloadLength, uint32_t interval)
 {
-  PayloadLength = PayloadLength;
+  this->PayloadLength = PayloadLength;
   IQinverted = InvertIQ;
   ConfigLoraDefaults();
   SetPreambleLength(preambleLen);
@@ -579,6 +589,7 @@ void ICACHE_RAM_ATTR SX127xDriver::ClearIrqFlags()
 
 void ICACHE_RAM_ATTR SX127xDriver::IsrCallback()
 {
+    ISR_TIMING_SCOPE(isrRadio);
     uint8_t irqStatus = instance->GetIrqFlags();
     instance->ClearIrqFlags();
     if ((irqStatus & SX127X_CLEAR_IRQ_FLAG_TX_DONE) && (instance->currOpmode == SX127x_OPMODE_TX))
@@ -23,7 +23,7 @@ public:
     static void (*RXtimeout)(); //function pointer for callback
 
 ///////////Radio Variables////////
-    #define TXRXBuffSize 16
+    #define TXRXBuffSize 20
     const uint8_t TXbuffLen = TXRXBuffSize;
     const uint8_t RXbuffLen = TXRXBuffSize;
 
@@ -51,6 +51,7 @@ public:
     /////////////Packet Stats//////////
     int8_t LastPacketRSSI;
     int8_t LastPacketSNR;
+    uint32_t LastPacketIsrMicros; // micros() at the RX done edge
     uint32_t TimeOnAir;
     uint32_t TXstartMicros;
     uint32_t TXspiTime;
@@ -83,6 +84,16 @@ public:
     #define FREQ_STEP 61.03515625
     void SetFrequencyHz(uint32_t freq);
     void SetFrequencyReg(uint32_t freq);
+    // The whole SPI write that tunes to freq (register units), so FHSS can build it ahead of the hop
+    #define FREQ_CMD_SIZE 4
+    static void BuildFrequencyCmd(uint32_t freq, uint8_t *cmd)
+    {
+        cmd[0] = SX127X_REG_FRF_MSB | SPI_WRITE;
+        cmd[1] = (uint8_t)((freq >> 16) & 0xFF);
+        cmd[2] = (uint8_t)((freq >> 8) & 0xFF);
+        cmd[3] = (uint8_t)(freq & 0xFF);
+    }
+    void SetFrequencyCmd(uint32_t freq, const uint8_t *cmd);
     int32_t GetFrequencyError();
     bool GetFrequencyErrorbool();
     void SetPPMoffsetReg(int32_t offset);
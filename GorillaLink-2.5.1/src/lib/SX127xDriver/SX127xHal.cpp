@@ -78,6 +78,8 @@ void SX127xHal::init()
   pinMode(GPIO_PIN_RST, INPUT); // leave floating
 #endif
 
+  invalidateRegisters(); // reset, or at least nothing known about it yet
+
   attachInterrupt(digitalPinToInterrupt(GPIO_PIN_DIO0), dioISR, RISING);
 }
 
@@ -102,18 +104,28 @@ void ICACHE_RAM_ATTR SX127xHal::readRegisterBurst(uint8_t reg, uint8_t numBytes,
   digitalWrite(GPIO_PIN_NSS, HIGH);
 
   memcpy(inBytes, buf + 1, numBytes);
+  for (uint8_t i = 0; i < numBytes; i++)
+  {
+    shadowSet(reg + i, inBytes[i]);
+  }
 }
 
 uint8_t ICACHE_RAM_ATTR SX127xHal::readRegister(uint8_t reg)
 {
   WORD_ALIGNED_ATTR uint8_t buf[2];
 
+  if (shadowGet(reg, &buf[1]))
+  {
+    return (buf[1]);
+  }
+
   buf[0] = reg | SPI_READ;
 
   digitalWrite(GPIO_PIN_NSS, LOW);
   SPI.transfer(buf, 2);
   digitalWrite(GPIO_PIN_NSS, HIGH);
 
+  shadowSet(reg, buf[1]);
   return (buf[1]);
 }
 
@@ -148,6 +160,8 @@ void ICACHE_RAM_ATTR SX127xHal::writeRegisterFIFO(volatile uint8_t *data, uint8_
   SPI.writeBytes(buf, numBytes + 1);
 #endif
   digitalWrite(GPIO_PIN_NSS, HIGH);
+
+  invalidateRegister(SX127X_REG_FIFO_ADDR_PTR);
 }
 
 void ICACHE_RAM_ATTR SX127xHal::readRegisterFIFO(volatile uint8_t *data, uint8_t numBytes)
@@ -159,6 +173,8 @@ void ICACHE_RAM_ATTR SX127xHal::readRegisterFIFO(volatile uint8_t *data, uint8_t
   SPI.transfer(buf, numBytes + 1);
   digitalWrite(GPIO_PIN_NSS, HIGH);
 
+  invalidateRegister(SX127X_REG_FIFO_ADDR_PTR);
+
   for (int i = 0; i < numBytes; i++) // todo check if this is the right want to handle volatiles
   {
     data[i] = buf[i + 1];
@@ -167,6 +183,11 @@ void ICACHE_RAM_ATTR SX127xHal::readRegisterFIFO(volatile uint8_t *data, uint8_t
 
 void ICACHE_RAM_ATTR SX127xHal::writeRegisterBurst(uint8_t reg, uint8_t *data, uint8_t numBytes)
 {
+  if (shadowMatches(reg, data, numBytes))
+  {
+    return;
+  }
+
   WORD_ALIGNED_ATTR uint8_t buf[numBytes + 1];
   buf[0] = reg | SPI_WRITE;
   memcpy(buf + 1,  data, numBytes);
@@ -178,10 +199,45 @@ void ICACHE_RAM_ATTR SX127xHal::writeRegisterBurst(uint8_t reg, uint8_t *data, u
   SPI.writeBytes(buf, numBytes + 1);
 #endif
   digitalWrite(GPIO_PIN_NSS, HIGH);
+
+  for (uint8_t i = 0; i < numBytes; i++)
+  {
+    shadowSet(reg + i, data[i]);
+  }
+}
+
+void ICACHE_RAM_ATTR SX127xHal::writeRaw(const uint8_t *data, uint8_t numBytes)
+{
+  const uint8_t reg = data[0] & ~SPI_WRITE;
+  if (shadowMatches(reg, data + 1, numBytes - 1))
+  {
+    return;
+  }
+
+  digitalWrite(GPIO_PIN_NSS, LOW);
+#ifdef PLATFORM_STM32
+  // transfer() reads back into the buffer, keep the caller's intact
+  WORD_ALIGNED_ATTR uint8_t buf[numBytes];
+  memcpy(buf, data, numBytes);
+  SPI.transfer(buf, numBytes);
+#else
+  SPI.writeBytes(data, numBytes);
+#endif
+  digitalWrite(GPIO_PIN_NSS, HIGH);
+
+  for (uint8_t i = 1; i < numBytes; i++)
+  {
+    shadowSet(reg + i - 1, data[i]);
+  }
 }
 
 void ICACHE_RAM_ATTR SX127xHal::writeRegister(uint8_t reg, uint8_t data)
 {
+  if (shadowMatches(reg, &data, 1))
+  {
+    return;
+  }
+
   WORD_ALIGNED_ATTR uint8_t buf[2];
 
   buf[0] = reg | SPI_WRITE;
@@ -194,6 +250,8 @@ void ICACHE_RAM_ATTR SX127xHal::writeRegister(uint8_t reg, uint8_t data)
   SPI.writeBytes(buf, 2);
 #endif
   digitalWrite(GPIO_PIN_NSS, HIGH);
+
+  shadowSet(reg, data);
 }
 
 void ICACHE_RAM_ATTR SX127xHal::TXenable()
@@ -237,6 +295,7 @@ void ICACHE_RAM_ATTR SX127xHal::TXRXdisable()
 
 void ICACHE_RAM_ATTR SX127xHal::dioISR()
 {
+    instance->IsrMicros = micros();
     if (instance->IsrCallback)
         instance->IsrCallback();
 }
@@ -5,6 +5,10 @@
 #ifndef UNIT_TEST
 #include <SPI.h>
 #endif
+#include <string.h>
+
+// Register addresses are 7 bits, the 8th is SPI_WRITE
+#define SX127X_REG_COUNT 0x80
 
 class SX127xHal
 {
@@ -19,6 +23,7 @@ public:
 
     static void ICACHE_RAM_ATTR dioISR();
     void (*IsrCallback)(); //function pointer for callback
+    volatile uint32_t IsrMicros; // micros() at the DIO edge, taken before any SPI
 
     void ICACHE_RAM_ATTR TXenable();
     void ICACHE_RAM_ATTR RXenable();
@@ -34,4 +39,91 @@ public:
     void ICACHE_RAM_ATTR writeRegisterFIFO(volatile uint8_t *data, uint8_t numBytes);
     void ICACHE_RAM_ATTR readRegisterFIFO(volatile uint8_t *data, uint8_t numBytes);
     void ICACHE_RAM_ATTR writeRegisterBurst(uint8_t reg, uint8_t *data, uint8_t numBytes);
+    // A complete SPI transfer that already starts with the register address
+    void ICACHE_RAM_ATTR writeRaw(const uint8_t *data, uint8_t numBytes);
+
+    // The register writes and reads keep a shadow of the register file, so
+    // writing the value a register already holds is skipped and setRegValue()
+    // doesn't read it back first. Registers the chip updates itself are never
+    // shadowed. The op mode is dropped from the shadow when it is one the chip
+    // leaves on its own (TX, RX single, CAD), the FIFO pointer whenever the
+    // FIFO is accessed or the modem enters TX or RX.
+    void ICACHE_RAM_ATTR invalidateRegister(uint8_t reg) { shadowValid[(reg & 0x7f) >> 3] &= ~(1 << (reg & 7)); }
+    void invalidateRegisters() { memset(shadowValid, 0, sizeof(shadowValid)); }
+
+private:
+    uint8_t shadow[SX127X_REG_COUNT];
+    uint8_t shadowValid[SX127X_REG_COUNT / 8];
+
+    static bool isVolatileRegister(uint8_t reg)
+    {
+        switch (reg)
+        {
+        case SX127X_REG_FIFO:
+        case SX127X_REG_FIFO_RX_CURRENT_ADDR:
+        case SX127X_REG_IRQ_FLAGS:
+        case SX127X_REG_RX_NB_BYTES:
+        case SX127X_REG_RX_HEADER_CNT_VALUE_MSB:
+        case SX127X_REG_RX_HEADER_CNT_VALUE_LSB:
+        case SX127X_REG_RX_PACKET_CNT_VALUE_MSB:
+        case SX127X_REG_RX_PACKET_CNT_VALUE_LSB:
+        case SX127X_REG_MODEM_STAT:
+        case SX127X_REG_PKT_SNR_VALUE:
+        case SX127X_REG_PKT_RSSI_VALUE:
+        case SX127X_REG_RSSI_VALUE:
+        case SX127X_REG_HOP_CHANNEL:
+        case SX127X_REG_FIFO_RX_BYTE_ADDR:
+        case SX127X_REG_FEI_MSB:
+        case SX127X_REG_FEI_MID:
+        case SX127X_REG_FEI_LSB:
+        case SX127X_REG_RSSI_WIDEBAND:
+        case SX127X_REG_VERSION:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // True with the value in *value if reg is in the shadow
+    bool shadowGet(uint8_t reg, uint8_t *value) const
+    {
+        reg &= 0x7f;
+        if (!(shadowValid[reg >> 3] & (1 << (reg & 7))))
+            return false;
+        *value = shadow[reg];
+        return true;
+    }
+
+    // True if the numBytes registers from reg already hold data
+    bool shadowMatches(uint8_t reg, const uint8_t *data, uint8_t numBytes) const
+    {
+        for (uint8_t i = 0; i < numBytes; i++)
+        {
+            uint8_t value;
+            if (!shadowGet(reg + i, &value) || value != data[i])
+                return false;
+        }
+        return true;
+    }
+
+    void shadowSet(uint8_t reg, uint8_t value)
+    {
+        reg &= 0x7f;
+        if (isVolatileRegister(reg))
+            return;
+        if (reg == SX127X_REG_OP_MODE)
+        {
+            const uint8_t mode = value & 0b111;
+            // The modem works the FIFO in TX and RX
+            if (mode == SX127x_OPMODE_TX || mode == SX127x_OPMODE_RXCONTINUOUS || mode == SX127x_OPMODE_RXSINGLE)
+                invalidateRegister(SX127X_REG_FIFO_ADDR_PTR);
+            if (mode == SX127x_OPMODE_TX || mode == SX127x_OPMODE_RXSINGLE || mode == SX127x_OPMODE_CAD)
+            {
+                invalidateRegister(reg);
+                return;
+            }
+        }
+        shadow[reg] = value;
+        shadowValid[reg >> 3] |= 1 << (reg & 7);
+    }
 };
\ No newline at end of file
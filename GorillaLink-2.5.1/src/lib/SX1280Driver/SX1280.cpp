@@ -2,6 +2,7 @@
 #include "SX1280_hal.h"
 #include "SX1280.h"
 #include "logging.h"
+#include "ISRTIMING.h"
 
 SX1280Hal hal;
 SX1280Driver *SX1280Driver::instance = NULL;
@@ -77,6 +78,7 @@ bool SX1280Driver::Begin()
 
     SetMode(SX1280_MODE_STDBY_RC);                                                                                                //Put in STDBY_RC mode
     hal.WriteCommand(SX1280_RADIO_SET_PACKETTYPE, SX1280_PACKET_TYPE_LORA);                                                       //Set packet type to LoRa
+    currPacketType = SX1280_PACKET_TYPE_LORA;
     ConfigLoRaModParams(currBW, currSF, currCR);                                                                                  //Configure Modulation Params
     hal.WriteCommand(SX1280_RADIO_SET_AUTOFS, 0x01);                                                                              //Enable auto FS
     hal.WriteRegister(0x0891, (hal.ReadRegister(0x0891) | 0xC0));                                                                 //default is low power mode, switch to high sensitivity instead
@@ -90,13 +92,28 @@ bool SX1280Driver::Begin()
     return true;
 }
 
-void SX1280Driver::Config(SX1280_RadioLoRaBandwidths_t bw, SX1280_RadioLoRaSpreadingFactors_t sf, SX1280_RadioLoRaCodingRates_t cr, uint32_t freq, uint8_t PreambleLength, bool InvertIQ, uint8_t PayloadLength, uint32_t interval)
+void SX1280Driver::Config(uint8_t bw, uint8_t sf, uint8_t cr, uint32_t freq, uint8_t PreambleLength, bool InvertIQ, uint8_t PayloadLength, uint32_t interval,
+                          SX1280_RadioPacketTypes_t packetType, uint32_t syncWord)
 {
-    PayloadLength = PayloadLength;
+    this->PayloadLength = PayloadLength;
     IQinverted = InvertIQ;
     SetMode(SX1280_MODE_STDBY_XOSC);
-    ConfigLoRaModParams(bw, sf, cr);
-    SetPacketParams(PreambleLength, SX1280_LORA_PACKET_IMPLICIT, PayloadLength, SX1280_LORA_CRC_OFF, (SX1280_RadioLoRaIQModes_t)((uint8_t)!IQinverted << 6)); // TODO don't make static etc. LORA_IQ_STD = 0x40, LORA_IQ_INVERTED = 0x00
+    // The packet type resets the modulation and packet params, only change it when it has to
+    if (packetType != currPacketType)
+    {
+        hal.WriteCommand(SX1280_RADIO_SET_PACKETTYPE, packetType);
+        currPacketType = packetType;
+    }
+    if (packetType == SX1280_PACKET_TYPE_FLRC)
+    {
+        ConfigFLRCModParams((SX1280_RadioFLRCBandwidths_t)bw, (SX1280_RadioFLRCCodingRates_t)cr, (SX1280_RadioFLRCBandwidthTimes_t)sf);
+        SetPacketParamsFLRC(PreambleLength, PayloadLength, syncWord);
+    }
+    else
+    {
+        ConfigLoRaModParams((SX1280_RadioLoRaBandwidths_t)bw, (SX1280_RadioLoRaSpreadingFactors_t)sf, (SX1280_RadioLoRaCodingRates_t)cr);
+        SetPacketParams(PreambleLength, SX1280_LORA_PACKET_IMPLICIT, PayloadLength, SX1280_LORA_CRC_OFF, (SX1280_RadioLoRaIQModes_t)((uint8_t)!IQinverted << 6)); // TODO don't make static etc. LORA_IQ_STD = 0x40, LORA_IQ_INVERTED = 0x00
+    }
     SetFrequencyReg(freq);
     SetRxTimeoutUs(interval);
 }
@@ -230,6 +247,43 @@ void SX1280Driver::ConfigLoRaModParams(SX1280_RadioLoRaBandwidths_t bw, SX1280_R
     }
 }
 
+void SX1280Driver::ConfigFLRCModParams(SX1280_RadioFLRCBandwidths_t bw, SX1280_RadioFLRCCodingRates_t cr, SX1280_RadioFLRCBandwidthTimes_t bt)
+{
+    WORD_ALIGNED_ATTR uint8_t rfparams[3];
+
+    rfparams[0] = (uint8_t)bw;
+    rfparams[1] = (uint8_t)cr;
+    rfparams[2] = (uint8_t)bt;
+
+    hal.WriteCommand(SX1280_RADIO_SET_MODULATIONPARAMS, rfparams, sizeof(rfparams));
+}
+
+void SX1280Driver::SetPacketParamsFLRC(uint8_t PreambleLength, uint8_t PayloadLength, uint32_t syncWord)
+{
+    if (PreambleLength < 8)
+        PreambleLength = 8;
+    if (PreambleLength > 32)
+        PreambleLength = 32;
+
+    uint8_t buf[7];
+    buf[0] = ((PreambleLength / 4) - 1) << 4; // SX1280_PREAMBLE_LENGTH_xx_BITS
+    buf[1] = SX1280_FLRC_SYNC_WORD_LEN_P32S;
+    buf[2] = SX1280_FLRC_RX_MATCH_SYNC_WORD_1;
+    buf[3] = SX1280_FLRC_PACKET_FIXED_LENGTH;
+    buf[4] = PayloadLength;
+    buf[5] = SX1280_FLRC_CRC_OFF; // the OTA packet carries its own CRC
+    buf[6] = SX1280_FLRC_WHITENING_DISABLE;
+    hal.WriteCommand(SX1280_RADIO_SET_PACKETPARAMS, buf, sizeof(buf));
+
+    // A sync word per binding phrase so FLRC links don't hear each other's packets
+    WORD_ALIGNED_ATTR uint8_t sync[4];
+    sync[0] = (uint8_t)(syncWord >> 24);
+    sync[1] = (uint8_t)(syncWord >> 16);
+    sync[2] = (uint8_t)(syncWord >> 8);
+    sync[3] = (uint8_t)syncWord;
+    hal.WriteRegister(SX1280_REG_FLRC_SYNC_WORD_1, sync, sizeof(sync));
+}
+
 void ICACHE_RAM_ATTR SX1280Driver::SetFrequencyHz(uint32_t Reqfreq)
 {
     WORD_ALIGNED_ATTR uint8_t buf[3] = {0};
@@ -255,6 +309,12 @@ void ICACHE_RAM_ATTR SX1280Driver::SetFrequencyReg(uint32_t freq)
     currFreq = freq;
 }
 
+void ICACHE_RAM_ATTR SX1280Driver::SetFrequencyCmd(uint32_t freq, const uint8_t *cmd)
+{
+    hal.WriteRaw(cmd, FREQ_CMD_SIZE);
+    currFreq = freq;
+}
+
 int32_t ICACHE_RAM_ATTR SX1280Driver::GetFrequencyError()
 {
     WORD_ALIGNED_ATTR uint8_t efeRaw[3] = {0};
@@ -344,7 +404,7 @@ void ICACHE_RAM_ATTR SX1280Driver::TXnb()
 #endif
 }
 
-void ICACHE_RAM_ATTR SX1280Driver::RXnbISR()
+void ICACHE_RAM_ATTR SX1280Driver::RXnbISR(const uint8_t *packetStatus)
 {
     // In continuous receive mode, the device stays in Rx mode
     if (timeout != 0xFFFF)
@@ -354,9 +414,8 @@ void ICACHE_RAM_ATTR SX1280Driver::RXnbISR()
         // but because we have AUTO_FS enabled we automatically transition to state SX1280_MODE_FS
         currOpmode = SX1280_MODE_FS;
     }
-    uint8_t FIFOaddr = GetRxBufferAddr();
-    hal.ReadBuffer(FIFOaddr, RXdataBuffer, PayloadLength);
-    GetLastPacketStats();
+    LastPacketIsrMicros = hal.IsrMicros;
+    DecodePacketStats(packetStatus);
     RXdoneCallback();
 }
 
@@ -398,6 +457,18 @@ void ICACHE_RAM_ATTR SX1280Driver::GetLastPacketStats()
     uint8_t status[2];
 
     hal.ReadCommand(SX1280_RADIO_GET_PACKETSTATUS, status, 2);
+    DecodePacketStats(status);
+}
+
+void ICACHE_RAM_ATTR SX1280Driver::DecodePacketStats(const uint8_t *status)
+{
+    if (currPacketType == SX1280_PACKET_TYPE_FLRC)
+    {
+        // No SNR in FLRC, the RSSI is in the second byte
+        LastPacketRSSI = -(int8_t)(status[1] / 2);
+        LastPacketSNR = 0;
+        return;
+    }
     LastPacketRSSI = -(int8_t)(status[0] / 2);
     LastPacketSNR = (int8_t)status[1] / 4;
     // https://www.mouser.com/datasheet/2/761/DS_SX1280-1_V2.2-1511144.pdf
@@ -408,10 +479,50 @@ void ICACHE_RAM_ATTR SX1280Driver::GetLastPacketStats()
 
 void ICACHE_RAM_ATTR SX1280Driver::IsrCallback()
 {
-    uint16_t irqStatus = instance->GetIrqStatus();
-    instance->ClearIrqStatus(SX1280_IRQ_RADIO_ALL);
-    if (irqStatus & SX1280_IRQ_TX_DONE)
-        instance->TXnbISR();
-    if (irqStatus & SX1280_IRQ_RX_DONE)
-        instance->RXnbISR();
+    ISR_TIMING_SCOPE(isrRadio);
+    SX1280Driver *radio = instance;
+
+    // The status reads go out as one batch, the payload and the IRQ clear as
+    // another. The clear is the only write and comes last, so nothing in here
+    // waits out a BusyDelay(). In TX the interrupt can only be TX done, skip the RX status.
+    const bool inTx = radio->currOpmode == SX1280_MODE_TX;
+    WORD_ALIGNED_ATTR uint8_t irqStatus[4] = {SX1280_RADIO_GET_IRQSTATUS, 0, 0, 0};
+    WORD_ALIGNED_ATTR uint8_t rxBufferStatus[4] = {SX1280_RADIO_GET_RXBUFFERSTATUS, 0, 0, 0};
+    WORD_ALIGNED_ATTR uint8_t packetStatus[4] = {SX1280_RADIO_GET_PACKETSTATUS, 0, 0, 0};
+    uint8_t *const reads[] = {irqStatus, rxBufferStatus, packetStatus};
+    const uint8_t readSizes[] = {sizeof(irqStatus), sizeof(rxBufferStatus), sizeof(packetStatus)};
+    hal.TransferBatch(reads, readSizes, inTx ? 1 : 3);
+
+    const uint16_t irq = irqStatus[2] << 8 | irqStatus[3];
+    const bool rxDone = irq & SX1280_IRQ_RX_DONE;
+    if (rxDone && inTx)
+        hal.TransferBatch(reads + 1, readSizes + 1, 2);
+
+    WORD_ALIGNED_ATTR uint8_t clearIrq[3] = {SX1280_RADIO_CLR_IRQSTATUS,
+        (uint8_t)(SX1280_IRQ_RADIO_ALL >> 8), (uint8_t)(SX1280_IRQ_RADIO_ALL & 0xFF)};
+    if (rxDone)
+    {
+        const uint8_t size = radio->PayloadLength;
+        WORD_ALIGNED_ATTR uint8_t payload[size + 3];
+        payload[0] = SX1280_RADIO_READ_BUFFER;
+        payload[1] = rxBufferStatus[3]; // the RX start pointer
+        payload[2] = 0x00;
+        uint8_t *const frames[] = {payload, clearIrq};
+        const uint8_t sizes[] = {(uint8_t)(size + 3), sizeof(clearIrq)};
+        hal.TransferBatch(frames, sizes, 2);
+
+        for (uint8_t i = 0; i < size; i++)
+            radio->RXdataBuffer[i] = payload[i + 3];
+    }
+    else
+    {
+        uint8_t *const frames[] = {clearIrq};
+        const uint8_t sizes[] = {sizeof(clearIrq)};
+        hal.TransferBatch(frames, sizes, 1);
+    }
+
+    if (irq & SX1280_IRQ_TX_DONE)
+        radio->TXnbISR();
+    if (rxDone)
+        radio->RXnbISR(packetStatus + 2);
 }
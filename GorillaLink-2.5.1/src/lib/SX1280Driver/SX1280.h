@@ -17,7 +17,7 @@ public:
     static void (*RXtimeout)(); //function pointer for callback
 
     ///////////Radio Variables////////
-    #define TXRXBuffSize 16
+    #define TXRXBuffSize 20
     volatile uint8_t TXdataBuffer[TXRXBuffSize];
     volatile uint8_t RXdataBuffer[TXRXBuffSize];
 
@@ -30,6 +30,7 @@ public:
     SX1280_RadioLoRaCodingRates_t currCR = SX1280_LORA_CR_4_7;
     uint32_t currFreq = 2400000000;
     SX1280_RadioOperatingModes_t currOpmode = SX1280_MODE_SLEEP;
+    SX1280_RadioPacketTypes_t currPacketType = SX1280_PACKET_TYPE_LORA;
     bool IQinverted = false;
     uint16_t timeout = 0xFFFF;
 
@@ -41,6 +42,7 @@ public:
     /////////////Packet Stats//////////
     int8_t LastPacketRSSI = 0;
     int8_t LastPacketSNR = 0;
+    uint32_t LastPacketIsrMicros = 0; // micros() at the RX done edge
     volatile uint8_t NonceTX = 0;
     volatile uint8_t NonceRX = 0;
     static uint32_t TotalTime;
@@ -63,11 +65,26 @@ public:
     void End();
     void SetMode(SX1280_RadioOperatingModes_t OPmode);
     void SetTxIdleMode() { SetMode(SX1280_MODE_FS); }; // set Idle mode used when switching from RX to TX
-    void Config(SX1280_RadioLoRaBandwidths_t bw, SX1280_RadioLoRaSpreadingFactors_t sf, SX1280_RadioLoRaCodingRates_t cr, uint32_t freq, uint8_t PreambleLength, bool InvertIQ, uint8_t PayloadLength, uint32_t interval);
+    // LoRa takes bw/sf/cr, FLRC takes the bitrate in bw, the BT in sf and its own cr. InvertIQ only applies to LoRa, the sync word only to FLRC
+    void Config(uint8_t bw, uint8_t sf, uint8_t cr, uint32_t freq, uint8_t PreambleLength, bool InvertIQ, uint8_t PayloadLength, uint32_t interval,
+                SX1280_RadioPacketTypes_t packetType = SX1280_PACKET_TYPE_LORA, uint32_t syncWord = 0);
     void ConfigLoRaModParams(SX1280_RadioLoRaBandwidths_t bw, SX1280_RadioLoRaSpreadingFactors_t sf, SX1280_RadioLoRaCodingRates_t cr);
     void SetPacketParams(uint8_t PreambleLength, SX1280_RadioLoRaPacketLengthsModes_t HeaderType, uint8_t PayloadLength, SX1280_RadioLoRaCrcModes_t crc, SX1280_RadioLoRaIQModes_t InvertIQ);
+    void ConfigFLRCModParams(SX1280_RadioFLRCBandwidths_t bw, SX1280_RadioFLRCCodingRates_t cr, SX1280_RadioFLRCBandwidthTimes_t bt);
+    // PreambleLength in bits, a multiple of 4 from 8 to 32
+    void SetPacketParamsFLRC(uint8_t PreambleLength, uint8_t PayloadLength, uint32_t syncWord);
     void ICACHE_RAM_ATTR SetFrequencyHz(uint32_t freq);
     void ICACHE_RAM_ATTR SetFrequencyReg(uint32_t freq);
+    // The whole SPI command that tunes to freq (register units), so FHSS can build it ahead of the hop
+    #define FREQ_CMD_SIZE 4
+    static void BuildFrequencyCmd(uint32_t freq, uint8_t *cmd)
+    {
+        cmd[0] = (uint8_t)SX1280_RADIO_SET_RFFREQUENCY;
+        cmd[1] = (uint8_t)((freq >> 16) & 0xFF);
+        cmd[2] = (uint8_t)((freq >> 8) & 0xFF);
+        cmd[3] = (uint8_t)(freq & 0xFF);
+    }
+    void ICACHE_RAM_ATTR SetFrequencyCmd(uint32_t freq, const uint8_t *cmd);
     void ICACHE_RAM_ATTR SetFIFOaddr(uint8_t txBaseAddr, uint8_t rxBaseAddr);
     void SetRxTimeoutUs(uint32_t interval);
     void SetOutputPower(int8_t power);
@@ -91,6 +108,7 @@ public:
 
 private:
     static void ICACHE_RAM_ATTR IsrCallback();
-    void RXnbISR(); // ISR for non-blocking RX routine
+    void RXnbISR(const uint8_t *packetStatus); // ISR for non-blocking RX routine
+    void DecodePacketStats(const uint8_t *status);
     void TXnbISR(); // ISR for non-blocking TX routine
 };
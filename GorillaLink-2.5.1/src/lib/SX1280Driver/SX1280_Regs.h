@@ -3,6 +3,7 @@
 #define REG_LR_FIRMWARE_VERSION_MSB 0x0153 //The address of the register holding the firmware version MSB
 #define SX1280_REG_LR_ESTIMATED_FREQUENCY_ERROR_MSB 0x0954
 #define SX1280_REG_LR_ESTIMATED_FREQUENCY_ERROR_MASK 0x0FFFFF
+#define SX1280_REG_FLRC_SYNC_WORD_1 0x09CF // 4 bytes, MSB first
 
 #define SX1280_XTAL_FREQ 52000000
 #define FREQ_STEP ((double)(SX1280_XTAL_FREQ / pow(2.0, 18.0)))
@@ -72,18 +73,18 @@ typedef enum
     SX1280_PACKET_TYPE_NONE = 0x0F,
 } SX1280_RadioPacketTypes_t;
 
-//only for GFSK
-// typedef enum
-// {
-//     SX1280_PREAMBLE_LENGTH_04_BITS = 0x00, //!< Preamble length: 04 bits
-//     SX1280_PREAMBLE_LENGTH_08_BITS = 0x10, //!< Preamble length: 08 bits
-//     SX1280_PREAMBLE_LENGTH_12_BITS = 0x20, //!< Preamble length: 12 bits
-//     SX1280_PREAMBLE_LENGTH_16_BITS = 0x30, //!< Preamble length: 16 bits
-//     SX1280_PREAMBLE_LENGTH_20_BITS = 0x40, //!< Preamble length: 20 bits
-//     SX1280_PREAMBLE_LENGTH_24_BITS = 0x50, //!< Preamble length: 24 bits
-//     SX1280_PREAMBLE_LENGTH_28_BITS = 0x60, //!< Preamble length: 28 bits
-//     SX1280_PREAMBLE_LENGTH_32_BITS = 0x70, //!< Preamble length: 32 bits
-// } SX1280_RadioPreambleLengths_t;
+// GFSK and FLRC
+typedef enum
+{
+    SX1280_PREAMBLE_LENGTH_04_BITS = 0x00, //!< Preamble length: 04 bits
+    SX1280_PREAMBLE_LENGTH_08_BITS = 0x10, //!< Preamble length: 08 bits
+    SX1280_PREAMBLE_LENGTH_12_BITS = 0x20, //!< Preamble length: 12 bits
+    SX1280_PREAMBLE_LENGTH_16_BITS = 0x30, //!< Preamble length: 16 bits
+    SX1280_PREAMBLE_LENGTH_20_BITS = 0x40, //!< Preamble length: 20 bits
+    SX1280_PREAMBLE_LENGTH_24_BITS = 0x50, //!< Preamble length: 24 bits
+    SX1280_PREAMBLE_LENGTH_28_BITS = 0x60, //!< Preamble length: 28 bits
+    SX1280_PREAMBLE_LENGTH_32_BITS = 0x70, //!< Preamble length: 32 bits
+} SX1280_RadioPreambleLengths_t;
 
 typedef enum
 {
@@ -180,6 +181,71 @@ typedef enum
     SX1280_LORA_CRC_OFF = 0x00, //!< CRC not used
 } SX1280_RadioLoRaCrcModes_t;
 
+/*!
+ * \brief Represents the bitrate and bandwidth values for FLRC packet type
+ */
+typedef enum
+{
+    SX1280_FLRC_BR_1_300_BW_1_2 = 0x45, //!< 1.3Mbps, 1.2MHz
+    SX1280_FLRC_BR_1_000_BW_1_2 = 0x69, //!< 1.04Mbps, 1.2MHz
+    SX1280_FLRC_BR_0_650_BW_0_6 = 0x86, //!< 650kbps, 600kHz
+    SX1280_FLRC_BR_0_520_BW_0_6 = 0xAA, //!< 520kbps, 600kHz
+    SX1280_FLRC_BR_0_325_BW_0_3 = 0xC7, //!< 325kbps, 300kHz
+    SX1280_FLRC_BR_0_260_BW_0_3 = 0xEB, //!< 260kbps, 300kHz
+} SX1280_RadioFLRCBandwidths_t;
+
+typedef enum
+{
+    SX1280_FLRC_CR_1_2 = 0x00,
+    SX1280_FLRC_CR_3_4 = 0x02,
+    SX1280_FLRC_CR_1_0 = 0x04,
+} SX1280_RadioFLRCCodingRates_t;
+
+/*!
+ * \brief Represents the gaussian filter BT product for FLRC packet type
+ */
+typedef enum
+{
+    SX1280_FLRC_BT_DIS = 0x00,
+    SX1280_FLRC_BT_1 = 0x10,
+    SX1280_FLRC_BT_0_5 = 0x20,
+} SX1280_RadioFLRCBandwidthTimes_t;
+
+typedef enum
+{
+    SX1280_FLRC_SYNC_NOSYNC = 0x00,
+    SX1280_FLRC_SYNC_WORD_LEN_P32S = 0x04,
+} SX1280_RadioFLRCSyncWordLen_t;
+
+typedef enum
+{
+    SX1280_FLRC_RX_DISABLE_SYNC_WORD = 0x00,
+    SX1280_FLRC_RX_MATCH_SYNC_WORD_1 = 0x10,
+    SX1280_FLRC_RX_MATCH_SYNC_WORD_2 = 0x20,
+    SX1280_FLRC_RX_MATCH_SYNC_WORD_1_2 = 0x30,
+    SX1280_FLRC_RX_MATCH_SYNC_WORD_3 = 0x40,
+    SX1280_FLRC_RX_MATCH_SYNC_WORD_1_3 = 0x50,
+    SX1280_FLRC_RX_MATCH_SYNC_WORD_2_3 = 0x60,
+    SX1280_FLRC_RX_MATCH_SYNC_WORD_1_2_3 = 0x70,
+} SX1280_RadioFLRCSyncWordMatch_t;
+
+typedef enum
+{
+    SX1280_FLRC_PACKET_FIXED_LENGTH = 0x00,
+    SX1280_FLRC_PACKET_VARIABLE_LENGTH = 0x20,
+} SX1280_RadioFLRCPacketLengthsModes_t;
+
+typedef enum
+{
+    SX1280_FLRC_CRC_OFF = 0x00,
+    SX1280_FLRC_CRC_2_BYTE = 0x10,
+    SX1280_FLRC_CRC_3_BYTE = 0x20,
+    SX1280_FLRC_CRC_4_BYTE = 0x30,
+} SX1280_RadioFLRCCrcModes_t;
+
+// FLRC has no whitening, the packet params must say so
+#define SX1280_FLRC_WHITENING_DISABLE 0x08
+
 typedef enum RadioCommands_u
 {
     SX1280_RADIO_GET_STATUS = 0xC0,
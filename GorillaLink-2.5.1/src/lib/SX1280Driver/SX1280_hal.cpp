@@ -170,6 +170,23 @@ void ICACHE_RAM_ATTR SX1280Hal::WriteCommand(SX1280_RadioCommands_t command, uin
     BusyDelay(12);
 }
 
+void ICACHE_RAM_ATTR SX1280Hal::WriteRaw(const uint8_t *buffer, uint8_t size)
+{
+    WaitOnBusy();
+    digitalWrite(GPIO_PIN_NSS, LOW);
+#if defined(PLATFORM_ESP32) || defined(PLATFORM_ESP8266)
+    SPI.writeBytes(buffer, size);
+#else
+    // transfer() reads back into the buffer, keep the caller's intact
+    WORD_ALIGNED_ATTR uint8_t OutBuffer[size];
+    memcpy(OutBuffer, buffer, size);
+    SPI.transfer(OutBuffer, size);
+#endif
+    digitalWrite(GPIO_PIN_NSS, HIGH);
+
+    BusyDelay(12);
+}
+
 void ICACHE_RAM_ATTR SX1280Hal::ReadCommand(SX1280_RadioCommands_t command, uint8_t *buffer, uint8_t size)
 {
     WORD_ALIGNED_ATTR uint8_t OutBuffer[size + 2];
@@ -293,6 +310,22 @@ void ICACHE_RAM_ATTR SX1280Hal::ReadBuffer(uint8_t offset, volatile uint8_t *buf
     }
 }
 
+void ICACHE_RAM_ATTR SX1280Hal::TransferBatch(uint8_t *const frames[], const uint8_t sizes[], uint8_t count)
+{
+    // The frames are a few bytes each, a blocking transfer is over before a
+    // DMA transfer would have been set up
+    for (uint8_t i = 0; i < count; i++)
+    {
+        WaitOnBusy();
+        digitalWrite(GPIO_PIN_NSS, LOW);
+        SPI.transfer(frames[i], sizes[i]);
+        digitalWrite(GPIO_PIN_NSS, HIGH);
+
+        if (!IsReadCommand(frames[i][0]))
+            BusyDelay(12);
+    }
+}
+
 bool ICACHE_RAM_ATTR SX1280Hal::WaitOnBusy()
 {
 #if defined(GPIO_PIN_BUSY) && (GPIO_PIN_BUSY != UNDEF_PIN)
@@ -339,6 +372,7 @@ bool ICACHE_RAM_ATTR SX1280Hal::WaitOnBusy()
 
 void ICACHE_RAM_ATTR SX1280Hal::dioISR()
 {
+    instance->IsrMicros = micros();
     if (instance->IsrCallback)
         instance->IsrCallback();
 }
@@ -40,6 +40,8 @@ public:
 
     void ICACHE_RAM_ATTR WriteCommand(SX1280_RadioCommands_t opcode, uint8_t *buffer, uint8_t size);
     void ICACHE_RAM_ATTR WriteCommand(SX1280_RadioCommands_t command, uint8_t val);
+    // A complete command that already starts with its opcode
+    void ICACHE_RAM_ATTR WriteRaw(const uint8_t *buffer, uint8_t size);
     void ICACHE_RAM_ATTR WriteRegister(uint16_t address, uint8_t *buffer, uint8_t size);
     void ICACHE_RAM_ATTR WriteRegister(uint16_t address, uint8_t value);
 
@@ -50,6 +52,31 @@ public:
     void ICACHE_RAM_ATTR WriteBuffer(uint8_t offset, volatile uint8_t *buffer, uint8_t size); // Writes and Reads to FIFO
     void ICACHE_RAM_ATTR ReadBuffer(uint8_t offset, volatile uint8_t *buffer, uint8_t size);
 
+    // Complete commands (opcode first) clocked out back to back, the MISO bytes
+    // replace each frame like SPI.transfer(). The SX1280 latches one command per
+    // NSS cycle so every frame gets its own, and BUSY is checked before each one
+    // as the datasheet asks for every command. A read leaves no BusyDelay()
+    // window, so with BUSY low that check is one pin read.
+    void ICACHE_RAM_ATTR TransferBatch(uint8_t *const frames[], const uint8_t sizes[], uint8_t count);
+    // Reads don't leave the SX1280 BUSY, writes do
+    static bool IsReadCommand(uint8_t opcode)
+    {
+        switch (opcode)
+        {
+        case SX1280_RADIO_GET_STATUS:
+        case SX1280_RADIO_READ_REGISTER:
+        case SX1280_RADIO_READ_BUFFER:
+        case SX1280_RADIO_GET_PACKETTYPE:
+        case SX1280_RADIO_GET_RXBUFFERSTATUS:
+        case SX1280_RADIO_GET_PACKETSTATUS:
+        case SX1280_RADIO_GET_RSSIINST:
+        case SX1280_RADIO_GET_IRQSTATUS:
+            return true;
+        default:
+            return false;
+        }
+    }
+
     bool ICACHE_RAM_ATTR WaitOnBusy();
     
     void ICACHE_RAM_ATTR TXenable();
@@ -58,6 +85,7 @@ public:
 
     static ICACHE_RAM_ATTR void dioISR();
     void (*IsrCallback)(); //function pointer for callback
+    volatile uint32_t IsrMicros; // micros() at the DIO edge, taken before any SPI
 
 #if defined(GPIO_PIN_BUSY) && (GPIO_PIN_BUSY != UNDEF_PIN)
     void BusyDelay(uint32_t duration) const { (void)duration; };
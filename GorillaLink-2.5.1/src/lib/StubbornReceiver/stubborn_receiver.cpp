@@ -1,9 +1,10 @@
 #include <cstdint>
 #include "stubborn_receiver.h"
 
-StubbornReceiver::StubbornReceiver(uint8_t maxPackageIndex)
+StubbornReceiver::StubbornReceiver(uint8_t maxPackageIndex, uint8_t fecGroup)
 {
     this->maxPackageIndex = maxPackageIndex;
+    this->fecGroup = fecGroup > 1 ? fecGroup : 0;
     this->ResetState();
 }
 
@@ -11,42 +12,57 @@ void StubbornReceiver::ResetState()
 {
     data = 0;
     bytesPerCall = 1;
-    currentOffset = 0;
-    currentPackage = 0;
+    currentPackage = 1;
+    receivedMap = 0;
+    startSeq = 0;
     length = 0;
-    telemetryConfirm = false;
+    finishedData = false;
+    parityLast = 0;
+}
+
+uint8_t StubbornReceiver::GetCurrentAck()
+{
+    const uint8_t seq = startSeq + currentPackage - 1;
+    return (seq & ELRS_STUBBORN_ACK_SEQ_MASK) | ((receivedMap >> 1) << ELRS_STUBBORN_ACK_MAP_SHIFT);
 }
 
 bool StubbornReceiver::GetCurrentConfirm()
 {
-    return telemetryConfirm;
+    return GetCurrentAck() & 1;
 }
 
 void StubbornReceiver::SetDataToReceive(uint8_t maxLength, uint8_t* dataToReceive, uint8_t bytesPerCall)
 {
     length = maxLength;
     data = dataToReceive;
+    startSeq += currentPackage - 1;
     currentPackage = 1;
-    currentOffset = 0;
+    receivedMap = 0;
     finishedData = false;
+    parityLast = 0;
     this->bytesPerCall = bytesPerCall;
+    ClearData();
 }
 
-void StubbornReceiver::ReceiveData(uint8_t packageIndex, volatile uint8_t* receiveData)
+void StubbornReceiver::ClearData()
 {
-    if  (packageIndex == 0 && currentPackage > 1)
+    for (uint8_t i = 0; data && i < length; i++)
     {
-        finishedData = true;
-        telemetryConfirm = !telemetryConfirm;
-        return;
+        data[i] = 0;
     }
+}
 
+void StubbornReceiver::ReceiveData(uint8_t packageIndex, volatile uint8_t* receiveData)
+{
     if (packageIndex == maxPackageIndex)
     {
-        telemetryConfirm = !telemetryConfirm;
+        // Count on from the sender's number, the message it gave up on is gone
+        startSeq = *receiveData;
         currentPackage = 1;
-        currentOffset = 0;
+        receivedMap = 0;
         finishedData = false;
+        parityLast = 0;
+        ClearData();
         return;
     }
 
@@ -55,19 +71,104 @@ void StubbornReceiver::ReceiveData(uint8_t packageIndex, volatile uint8_t* recei
         return;
     }
 
-    if (packageIndex == currentPackage)
+    // The end of the message, only sent once all of it is acked
+    if (packageIndex == 0)
+    {
+        if (currentPackage > 1 && receivedMap == 0)
+        {
+            finishedData = true;
+            currentPackage++;
+        }
+        return;
+    }
+
+    if (packageIndex > maxPackageIndex)
     {
-        for (uint8_t i = 0; i < bytesPerCall; i++)
+        if (fecGroup && bytesPerCall <= ELRS_STUBBORN_MAX_FEC_BYTES)
         {
-            data[currentOffset++] = *(receiveData + i);
+            parityLast = packageIndex - maxPackageIndex;
+            for (uint8_t i = 0; i < bytesPerCall; i++)
+            {
+                parity[i] = *(receiveData + i);
+            }
+            Rebuild();
         }
+        return;
+    }
+
+    StorePackage(packageIndex, receiveData);
+    if (parityLast)
+    {
+        Rebuild();
+    }
+}
+
+void StubbornReceiver::StorePackage(uint8_t packageIndex, volatile uint8_t *receiveData)
+{
+    const uint8_t ahead = packageIndex - currentPackage;
+    if (ahead >= ELRS_STUBBORN_MAX_WINDOW || (receivedMap & (1 << ahead)))
+    {
+        return;
+    }
+
+    const uint8_t offset = (packageIndex - 1) * bytesPerCall;
+    for (uint8_t i = 0; i < bytesPerCall && offset + i < length; i++)
+    {
+        data[offset + i] = *(receiveData + i);
+    }
 
+    receivedMap |= 1 << ahead;
+    while (receivedMap & 1)
+    {
+        receivedMap >>= 1;
         currentPackage++;
-        telemetryConfirm = !telemetryConfirm;
+    }
+}
+
+/**
+ * If one package of the parity's group is missing, XOR it back together
+ * from the parity and the rest of the group
+ **/
+void StubbornReceiver::Rebuild()
+{
+    const uint8_t first = (parityLast - 1) / fecGroup * fecGroup + 1;
+    if (parityLast < currentPackage || parityLast - currentPackage >= ELRS_STUBBORN_MAX_WINDOW)
+    {
+        // All of the group is in, or it is too far ahead to have been sent yet
+        if (parityLast < currentPackage)
+            parityLast = 0;
         return;
     }
 
-    return;
+    uint8_t missing = 0;
+    uint8_t missingCount = 0;
+    for (uint8_t package = first; package <= parityLast; package++)
+    {
+        if (package >= currentPackage && !(receivedMap & (1 << (package - currentPackage))))
+        {
+            missing = package;
+            missingCount++;
+        }
+    }
+    if (missingCount != 1)
+        return;
+
+    // The other packages are already in data[], padded with zeros past the end as the sender does
+    uint8_t rebuilt[ELRS_STUBBORN_MAX_FEC_BYTES];
+    for (uint8_t i = 0; i < bytesPerCall; i++)
+    {
+        rebuilt[i] = parity[i];
+    }
+    for (uint8_t package = first; package <= parityLast; package++)
+    {
+        const uint8_t offset = (package - 1) * bytesPerCall;
+        for (uint8_t i = 0; package != missing && i < bytesPerCall && offset + i < length; i++)
+        {
+            rebuilt[i] ^= data[offset + i];
+        }
+    }
+    parityLast = 0;
+    StorePackage(missing, rebuilt);
 }
 
 bool StubbornReceiver::HasFinishedData()
@@ -79,8 +180,10 @@ void StubbornReceiver::Unlock()
 {
     if (finishedData)
     {
+        startSeq += currentPackage - 1;
         currentPackage = 1;
-        currentOffset = 0;
         finishedData = false;
+        parityLast = 0;
+        ClearData();
     }
 }
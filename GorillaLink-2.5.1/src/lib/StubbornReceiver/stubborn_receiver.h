@@ -1,24 +1,42 @@
 #pragma once
 
 #include <cstdint>
+#include "telemetry_protocol.h"
 
+/**
+ * Puts together the chunks of a StubbornSender message, which can arrive
+ * out of order up to ELRS_STUBBORN_MAX_WINDOW chunks ahead of the first
+ * one missing. GetCurrentAck() is what to send back, GetCurrentConfirm()
+ * its bit 0 for links that only have room for one bit. With the fecGroup of
+ * the sender, a package missing from a group is rebuilt from its parity.
+ * Each message starts on a zeroed buffer, so past its end is zeros as the
+ * sender pads it, never what was left of the one before.
+ **/
 class StubbornReceiver
 {
 public:
-    StubbornReceiver(uint8_t maxPackageIndex);
+    StubbornReceiver(uint8_t maxPackageIndex, uint8_t fecGroup = 0);
     void ResetState();
     void SetDataToReceive(uint8_t maxLength, uint8_t* dataToReceive, uint8_t bytesPerCall);
     void ReceiveData(uint8_t packageIndex, volatile uint8_t* data);
     bool HasFinishedData();
     void Unlock();
     bool GetCurrentConfirm();
+    uint8_t GetCurrentAck();
 private:
     uint8_t *data;
     volatile bool finishedData;
     volatile uint8_t length;
     volatile uint8_t bytesPerCall;
-    volatile uint8_t currentOffset;
-    volatile uint8_t currentPackage;
-    volatile bool telemetryConfirm;
+    volatile uint8_t currentPackage;    // first package missing
+    volatile uint8_t receivedMap;       // bit n for package currentPackage + n
+    volatile uint8_t startSeq;          // sequence number of package 1
     volatile uint8_t maxPackageIndex;
+    uint8_t fecGroup;
+    uint8_t parity[ELRS_STUBBORN_MAX_FEC_BYTES];
+    uint8_t parityLast;                 // last package of the group parity is for, 0 for none
+
+    void ClearData();
+    void StorePackage(uint8_t packageIndex, volatile uint8_t *receiveData);
+    void Rebuild();
 };
@@ -1,9 +1,18 @@
 #include <cstdint>
 #include "stubborn_sender.h"
 
-StubbornSender::StubbornSender(uint8_t maxPackageIndex)
+StubbornSender::StubbornSender(uint8_t maxPackageIndex, uint8_t windowSize, uint8_t fecGroup)
 {
     this->maxPackageIndex = maxPackageIndex;
+    if (windowSize < 1)
+        windowSize = 1;
+    if (windowSize > ELRS_STUBBORN_MAX_WINDOW)
+        windowSize = ELRS_STUBBORN_MAX_WINDOW;
+    this->windowSize = windowSize;
+    // A window of 1 only needs to know if the receiver moved on, which fits the one bit links
+    ackMask = (windowSize > 1) ? ELRS_STUBBORN_ACK_SEQ_MASK : 1;
+    // The parity is only sent once the whole group is out, so the group has to fit the window
+    this->fecGroup = (fecGroup > 1 && fecGroup <= windowSize) ? fecGroup : 0;
     this->ResetState();
 }
 
@@ -11,16 +20,28 @@ void StubbornSender::ResetState()
 {
     data = nullptr;
     bytesPerCall = 1;
-    currentOffset = 0;
-    currentPackage = 0;
     length = 0;
-    waitUntilTelemetryConfirm = true;
-    waitCount = 0;
+    packageCount = 0;
+    startSeq = 0;
+    lastAck = 0;
+    resyncSeq = 0;
+    abandoned = false;
+    StartMessage();
     // 80 corresponds to UpdateTelemetryRate(ANY, 2, 1), which is what the TX uses in boost mode
     maxWaitCount = 80;
     senderState = SENDER_IDLE;
 }
 
+void StubbornSender::StartMessage()
+{
+    windowBase = 1;
+    nextNew = 1;
+    // Outside the window, so the first time round starts with the parity
+    nextResend = 0;
+    ackedMap = 0;
+    waitCount = 0;
+}
+
 /***
  * Queues a message to send, will abort the current message if one is currently being transmitted
  ***/
@@ -33,11 +54,20 @@ void StubbornSender::SetDataToTransmit(uint8_t lengthToTransmit, uint8_t* dataTo
 
     length = lengthToTransmit;
     data = dataToTransmit;
-    currentOffset = 0;
-    currentPackage = 1;
-    waitCount = 0;
     this->bytesPerCall = bytesPerCall;
-    senderState = (senderState == SENDER_IDLE) ? SENDING : RESYNC_THEN_SEND;
+    packageCount = (lengthToTransmit + bytesPerCall - 1) / bytesPerCall;
+    abandoned = false;
+    StartMessage();
+    if (senderState == SENDER_IDLE)
+    {
+        senderState = SENDING;
+    }
+    else
+    {
+        // The receiver may have some of the old message, start again from a number it is not at
+        resyncSeq = (lastAck + 1) & ackMask;
+        senderState = RESYNC_THEN_SEND;
+    }
 }
 
 bool StubbornSender::IsActive()
@@ -51,29 +81,42 @@ void StubbornSender::GetCurrentPayload(uint8_t *packageIndex, uint8_t *count, ui
     {
     case RESYNC:
     case RESYNC_THEN_SEND:
+        // The receiver starts counting again from resyncSeq
         *packageIndex = maxPackageIndex;
-        *count = 0;
-        *currentData = 0;
+        *count = 1;
+        *currentData = &resyncSeq;
         break;
     case SENDING:
-        *currentData = data + currentOffset;
-        *packageIndex = currentPackage;
-        if (bytesPerCall > 1)
+    {
+        const uint8_t windowEnd = (windowBase + windowSize <= packageCount) ? windowBase + windowSize : packageCount + 1;
+        uint8_t package;
+        if (nextNew < windowEnd)
         {
-            if (currentOffset + bytesPerCall <= length)
+            package = nextNew++;
+        }
+        else
+        {
+            // Everything in the window went out once, go round the ones not acked
+            if (nextResend < windowBase || nextResend >= windowEnd)
             {
-                *count = bytesPerCall;
+                nextResend = windowBase;
+                if (GetParity(packageIndex, count, currentData))
+                    break;
             }
-            else
+            while (ackedMap & (1 << (nextResend - windowBase)))
             {
-                *count = length-currentOffset;
+                if (++nextResend >= windowEnd)
+                    nextResend = windowBase;
             }
+            package = nextResend++;
         }
-        else
-        {
-            *count = 1;
-        }
+
+        const uint8_t offset = (package - 1) * bytesPerCall;
+        *currentData = data + offset;
+        *packageIndex = package;
+        *count = (offset + bytesPerCall <= length) ? bytesPerCall : length - offset;
         break;
+    }
     default:
         *count = 0;
         *currentData = 0;
@@ -81,60 +124,119 @@ void StubbornSender::GetCurrentPayload(uint8_t *packageIndex, uint8_t *count, ui
     }
 }
 
-void StubbornSender::ConfirmCurrentPayload(bool telemetryConfirmValue)
+/**
+ * The XOR of the group holding windowBase, false if there is no parity to
+ * send because FEC is off or not all of the group has gone out yet
+ **/
+bool StubbornSender::GetParity(uint8_t *packageIndex, uint8_t *count, uint8_t **currentData)
+{
+    if (fecGroup == 0 || bytesPerCall > ELRS_STUBBORN_MAX_FEC_BYTES)
+        return false;
+
+    const uint8_t first = (windowBase - 1) / fecGroup * fecGroup + 1;
+    const uint8_t last = (first + fecGroup - 1 <= packageCount) ? first + fecGroup - 1 : packageCount;
+    if (last >= nextNew || first == last)
+        return false;
+
+    // The short package at the end counts as padded with zeros
+    for (uint8_t i = 0; i < bytesPerCall; i++)
+        parity[i] = 0;
+    for (uint8_t package = first; package <= last; package++)
+    {
+        const uint8_t offset = (package - 1) * bytesPerCall;
+        for (uint8_t i = 0; i < bytesPerCall && offset + i < length; i++)
+            parity[i] ^= data[offset + i];
+    }
+
+    *packageIndex = maxPackageIndex + last;
+    *count = bytesPerCall;
+    *currentData = parity;
+    return true;
+}
+
+/**
+ * Move the window up to the ack, true if it acked anything new
+ **/
+bool StubbornSender::AckWindow(uint8_t ack)
 {
-    stubborn_sender_state_s nextSenderState = senderState;
+    const uint8_t baseSeq = startSeq + windowBase - 1;
+    const uint8_t advance = (ack - baseSeq) & ackMask;
+    // Anything past what has been sent is from before a resync
+    if (advance > nextNew - windowBase)
+        return false;
+
+    windowBase += advance;
+    ackedMap >>= advance;
+    uint8_t acked = ackedMap;
+    if (windowSize > 1)
+    {
+        // The first package is the one the receiver is missing
+        const uint8_t sentMap = (1 << (nextNew - windowBase)) - 1;
+        acked = ((ack >> ELRS_STUBBORN_ACK_MAP_SHIFT) << 1) & sentMap;
+    }
+    const bool progress = advance || (acked & ~ackedMap);
+    ackedMap = acked;
+    return progress;
+}
+
+void StubbornSender::Resync(uint8_t ack)
+{
+    resyncSeq = (ack + 1) & ackMask;
+    abandoned = true;
+    senderState = RESYNC;
+}
+
+void StubbornSender::ConfirmCurrentPayload(uint8_t ack)
+{
+    lastAck = ack;
 
     switch (senderState)
     {
     case SENDING:
-        if (telemetryConfirmValue != waitUntilTelemetryConfirm)
+        if (!AckWindow(ack))
         {
             waitCount++;
             if (waitCount > maxWaitCount)
             {
-                waitUntilTelemetryConfirm = !telemetryConfirmValue;
-                nextSenderState = RESYNC;
+                Resync(ack);
             }
             break;
         }
 
-        currentOffset += bytesPerCall;
-        currentPackage++;
-        waitUntilTelemetryConfirm = !waitUntilTelemetryConfirm;
         waitCount = 0;
-
-        if (currentOffset >= length)
+        if (windowBase > packageCount)
         {
-            nextSenderState = WAIT_UNTIL_NEXT_CONFIRM;
+            senderState = WAIT_UNTIL_NEXT_CONFIRM;
         }
         break;
 
-    case RESYNC:
-    case RESYNC_THEN_SEND:
     case WAIT_UNTIL_NEXT_CONFIRM:
-        if (telemetryConfirmValue == waitUntilTelemetryConfirm)
+        // The end of the message takes a sequence number too
+        if (((ack - startSeq - packageCount) & ackMask) == 1)
         {
-            nextSenderState = (senderState == RESYNC_THEN_SEND) ? SENDING : SENDER_IDLE;
-            waitUntilTelemetryConfirm = !telemetryConfirmValue;
+            startSeq += packageCount + 1;
+            senderState = SENDER_IDLE;
         }
         // switch to resync if tx does not confirm value fast enough
-        else if (senderState == WAIT_UNTIL_NEXT_CONFIRM)
+        else if (++waitCount > maxWaitCount)
         {
-            waitCount++;
-            if (waitCount > maxWaitCount)
-            {
-                waitUntilTelemetryConfirm = !telemetryConfirmValue;
-                nextSenderState = RESYNC;
-            }
+            Resync(ack);
+        }
+        break;
+
+    case RESYNC:
+    case RESYNC_THEN_SEND:
+        if (((ack - resyncSeq) & ackMask) == 0)
+        {
+            startSeq = resyncSeq;
+            StartMessage();
+            senderState = (senderState == RESYNC_THEN_SEND) ? SENDING : SENDER_IDLE;
         }
         break;
 
     case SENDER_IDLE:
         break;
     }
-
-    senderState = nextSenderState;
 }
 
 /*
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include "telemetry_protocol.h"
 
 // The number of times to resend the same package index before going to RESYNC
 #define SSENDER_MAX_MISSED_PACKETS 20
@@ -13,27 +14,59 @@ typedef enum {
     RESYNC_THEN_SEND, // perform a RESYNC then go to SENDING
 } stubborn_sender_state_s;
 
+/**
+ * Sends a message in chunks of bytesPerCall, with selective repeat over a
+ * window of up to ELRS_STUBBORN_MAX_WINDOW chunks. Each chunk also has a
+ * sequence number that carries on from message to message, and the
+ * receiver's ack (see ELRS_STUBBORN_ACK_SEQ_MASK) is the number of the
+ * first chunk it is missing plus a bitmap of the ones after it. With a
+ * window of 1 only bit 0 of the ack is used, which is the confirm toggle of
+ * the plain stop-and-wait sender.
+ *
+ * With a fecGroup the packages are also taken in groups of that many. Each
+ * time round the window, ahead of the resends, the XOR of the group holding
+ * the first package not acked goes out as package maxPackageIndex + the
+ * last package of the group, so the receiver can rebuild one lost package
+ * of it.
+ **/
 class StubbornSender
 {
 public:
-    StubbornSender(uint8_t maxPackageIndex);
+    StubbornSender(uint8_t maxPackageIndex, uint8_t windowSize = 1, uint8_t fecGroup = 0);
     void ResetState();
     void UpdateTelemetryRate(uint16_t airRate, uint8_t tlmRatio, uint8_t tlmBurst);
     void SetDataToTransmit(uint8_t lengthToTransmit, uint8_t* dataToTransmit, uint8_t bytesPerCall);
+    // The chunk to send now, every call is one transmission
     void GetCurrentPayload(uint8_t *packageIndex, uint8_t *count, uint8_t **currentData);
-    void ConfirmCurrentPayload(bool telemetryConfirmValue);
+    void ConfirmCurrentPayload(uint8_t ack);
     bool IsActive();
+    // True if the last message was given up on in a RESYNC, so the receiver may not have all of it
+    bool LastMessageAbandoned() const { return abandoned; }
     uint16_t GetMaxPacketsBeforeResync() const { return maxWaitCount; }
 private:
     uint8_t *data;
     uint8_t length;
     uint8_t bytesPerCall;
-    uint8_t currentOffset;
-    uint8_t currentPackage;
-    bool waitUntilTelemetryConfirm;
-    bool resetState;
+    uint8_t packageCount;
+    uint8_t windowBase;     // first package not acked
+    uint8_t nextNew;        // first package not sent yet
+    uint8_t nextResend;
+    uint8_t ackedMap;       // bit n for package windowBase + n
+    uint8_t startSeq;       // sequence number of package 1
+    uint8_t lastAck;
+    uint8_t resyncSeq;
+    uint8_t ackMask;
+    uint8_t windowSize;
+    uint8_t fecGroup;
+    uint8_t parity[ELRS_STUBBORN_MAX_FEC_BYTES];
     uint16_t waitCount;
     uint16_t maxWaitCount;
     uint8_t maxPackageIndex;
+    bool abandoned;
     volatile stubborn_sender_state_s senderState;
+
+    void StartMessage();
+    void Resync(uint8_t ack);
+    bool AckWindow(uint8_t ack);
+    bool GetParity(uint8_t *packageIndex, uint8_t *count, uint8_t **currentData);
 };
@@ -142,7 +142,8 @@ device_t Thermal_device = {
     .initialize = initialize,
     .start = NULL,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = EVENT_CONFIG_CHANGED
 };
 
 #endif // HAS_THERMAL || HAS_FAN
\ No newline at end of file
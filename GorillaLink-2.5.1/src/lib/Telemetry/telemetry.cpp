@@ -45,12 +45,29 @@ bool Telemetry::ShouldSendDeviceFrame()
 }
 
 
-PAYLOAD_DATA(GPS, BATTERY_SENSOR, ATTITUDE, DEVICE_INFO, FLIGHT_MODE, VARIO, BARO_ALTITUDE);
+PAYLOAD_DATA();
+
+/**
+ * How far behind its interval the slot is, weighted by priority and in
+ * 1/256ths of an interval. Under load each type ends up sent at a rate in
+ * proportion to priority / interval, so none of them starves.
+ **/
+uint32_t Telemetry::Urgency(uint8_t index, uint32_t now)
+{
+    const crsf_telemetry_package_t &payload = payloadTypes[index];
+    uint32_t elapsed = now - payload.sentAt;
+    if (elapsed > UINT16_MAX)
+    {
+        elapsed = UINT16_MAX;
+    }
+    return payload.priority * elapsed * 256 / (payload.interval ? payload.interval : 1);
+}
 
-bool Telemetry::GetNextPayload(uint8_t* nextPayloadSize, uint8_t **payloadData)
+bool Telemetry::GetNextPayload(uint8_t* nextPayloadSize, uint8_t **payloadData, uint8_t maxLength)
 {
-    uint8_t checks = 0;
-    uint8_t oldPayloadIndex = currentPayloadIndex;
+    const uint32_t now = millis();
+    int8_t next = -1;
+    uint32_t nextUrgency = 0;
     uint8_t realLength = 0;
 
     if (payloadTypes[currentPayloadIndex].locked)
@@ -59,34 +76,67 @@ bool Telemetry::GetNextPayload(uint8_t* nextPayloadSize, uint8_t **payloadData)
         payloadTypes[currentPayloadIndex].updated = false;
     }
 
-    do
+    for (int8_t i = 0; i < payloadTypesCount; i++)
     {
-        currentPayloadIndex = (currentPayloadIndex + 1) % payloadTypesCount;
-        checks++;
-    } while(!payloadTypes[currentPayloadIndex].updated && checks < payloadTypesCount);
+        if (!payloadTypes[i].updated)
+        {
+            continue;
+        }
+        // too old to be worth the air time, wait for a fresh one
+        if (payloadTypes[i].maxAge && now - payloadTypes[i].updatedAt > payloadTypes[i].maxAge)
+        {
+            payloadTypes[i].updated = false;
+            continue;
+        }
+        // an MSP response in two chunks has to go in order, the later slot waits for the earlier one
+        if (i >= payloadTypesCount - 2)
+        {
+            const crsf_telemetry_package_t &other = payloadTypes[i == payloadTypesCount - 1 ? i - 1 : i + 1];
+            if (other.updated && (int16_t)(other.pendingSeq - payloadTypes[i].pendingSeq) < 0)
+            {
+                continue;
+            }
+        }
+        // does not fit in what is left of the message, it goes in the next one
+        if (CRSF_FRAME_SIZE(payloadTypes[i].data[CRSF_TELEMETRY_LENGTH_INDEX]) > maxLength)
+        {
+            continue;
+        }
+        // the one waiting the longest of equally urgent slots
+        const uint32_t urgency = Urgency(i, now);
+        if (next < 0 || urgency > nextUrgency ||
+            (urgency == nextUrgency && (int16_t)(payloadTypes[i].pendingSeq - payloadTypes[next].pendingSeq) < 0))
+        {
+            next = i;
+            nextUrgency = urgency;
+        }
+    }
 
-    if (payloadTypes[currentPayloadIndex].updated)
+    if (next >= 0)
     {
-        payloadTypes[currentPayloadIndex].locked = true;
+        crsf_telemetry_package_t &payload = payloadTypes[next];
 
-        realLength = CRSF_FRAME_SIZE(payloadTypes[currentPayloadIndex].data[CRSF_TELEMETRY_LENGTH_INDEX]);
+        realLength = CRSF_FRAME_SIZE(payload.data[CRSF_TELEMETRY_LENGTH_INDEX]);
         // search for non zero data from the end
-        while (realLength > 0 && payloadTypes[currentPayloadIndex].data[realLength - 1] == 0)
+        while (realLength > 0 && payload.data[realLength - 1] == 0)
         {
             realLength--;
         }
 
         if (realLength > 0)
         {
+            currentPayloadIndex = next;
+            payload.locked = true;
+            payload.sentAt = now;
             // store real length in frame
-            payloadTypes[currentPayloadIndex].data[CRSF_TELEMETRY_LENGTH_INDEX] = realLength - CRSF_FRAME_NOT_COUNTED_BYTES;
+            payload.data[CRSF_TELEMETRY_LENGTH_INDEX] = realLength - CRSF_FRAME_NOT_COUNTED_BYTES;
             *nextPayloadSize = realLength;
-            *payloadData = payloadTypes[currentPayloadIndex].data;
+            *payloadData = payload.data;
             return true;
         }
+        payload.updated = false;
     }
 
-    currentPayloadIndex = oldPayloadIndex;
     *nextPayloadSize = 0;
     *payloadData = 0;
     return false;
@@ -117,6 +167,7 @@ void Telemetry::ResetState()
     currentTelemetryByte = 0;
     currentPayloadIndex = 0;
     receivedPackages = 0;
+    pendingSeq = 0;
 
     uint8_t offset = 0;
 
@@ -124,6 +175,7 @@ void Telemetry::ResetState()
     {
         payloadTypes[i].locked = false;
         payloadTypes[i].updated = false;
+        payloadTypes[i].sentAt = 0;
         payloadTypes[i].data = PayloadData + offset;
         offset += payloadTypes[i].size;
 
@@ -294,6 +346,11 @@ bool Telemetry::AppendTelemetryPackage(uint8_t *package)
     if (targetFound)
     {
         memcpy(payloadTypes[targetIndex].data, package, CRSF_FRAME_SIZE(package[CRSF_TELEMETRY_LENGTH_INDEX]));
+        if (!payloadTypes[targetIndex].updated)
+        {
+            payloadTypes[targetIndex].pendingSeq = pendingSeq++;
+        }
+        payloadTypes[targetIndex].updatedAt = millis();
         payloadTypes[targetIndex].updated = true;
     }
 
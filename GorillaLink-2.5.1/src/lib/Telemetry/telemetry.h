@@ -18,32 +18,57 @@ typedef enum {
 typedef struct crsf_telemetry_package_t {
     const uint8_t type;
     const uint8_t size;
+    const uint8_t priority;
+    const uint16_t interval;
+    const uint16_t maxAge;
     volatile bool locked;
     volatile bool updated;
     uint8_t *data;
+    uint32_t updatedAt;     // millis() the frame in data came in
+    uint32_t sentAt;        // millis() the last frame was picked to send
+    uint16_t pendingSeq;    // order the slots were updated in since they were last sent
 } crsf_telemetry_package_t;
 
-#define PAYLOAD_DATA(type0, type1, type2, type3, type4, type5, type6)\
+/**
+ * The frame types the RX keeps a slot for and how they are scheduled, as
+ * X(type, priority, interval, maxAge):
+ *   priority   weight of the type when the link can not keep up
+ *   interval   ms the scheduler aims for between frames of the type
+ *   maxAge     ms after which a frame not sent yet is dropped, 0 to keep it until sent
+ * Of the slots updated, the one the most intervals behind times its priority
+ * goes next.
+ * A target can use its own table by defining TELEMETRY_PAYLOAD_TYPES, and
+ * TELEMETRY_RESPONSE_SCHEDULE for the two slots after them, which take MSP
+ * responses and the other extended frames.
+ **/
+#if !defined(TELEMETRY_PAYLOAD_TYPES)
+#define TELEMETRY_PAYLOAD_TYPES(X) \
+    X(GPS,            3, 200,  1000) \
+    X(BATTERY_SENSOR, 3, 250,  2000) \
+    X(ATTITUDE,       1, 200,  300)  \
+    X(DEVICE_INFO,    4, 0,    0)    \
+    X(FLIGHT_MODE,    2, 500,  0)    \
+    X(VARIO,          1, 200,  500)  \
+    X(BARO_ALTITUDE,  2, 500,  1000)
+#endif
+#if !defined(TELEMETRY_RESPONSE_SCHEDULE)
+#define TELEMETRY_RESPONSE_SCHEDULE 4, 0, 0
+#endif
+
+#define PAYLOAD_DATA_SIZE(type, priority, interval, maxAge) \
+    CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type##_PAYLOAD_SIZE) +
+#define PAYLOAD_DATA_SLOT(type, priority, interval, maxAge) \
+    {CRSF_FRAMETYPE_##type, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type##_PAYLOAD_SIZE), priority, interval, maxAge, false, false, 0, 0, 0, 0},
+
+#define PAYLOAD_DATA()\
     uint8_t PayloadData[\
-        CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type0##_PAYLOAD_SIZE) + \
-        CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type1##_PAYLOAD_SIZE) + \
-        CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type2##_PAYLOAD_SIZE) + \
-        CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type3##_PAYLOAD_SIZE) + \
-        CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type4##_PAYLOAD_SIZE) + \
-        CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type5##_PAYLOAD_SIZE) + \
-        CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type6##_PAYLOAD_SIZE) + \
+        TELEMETRY_PAYLOAD_TYPES(PAYLOAD_DATA_SIZE) \
         CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_GENERAL_RESP_PAYLOAD_SIZE) + \
         CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_GENERAL_RESP_PAYLOAD_SIZE)]; \
     crsf_telemetry_package_t payloadTypes[] = {\
-    {CRSF_FRAMETYPE_##type0, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type0##_PAYLOAD_SIZE), false, false, 0},\
-    {CRSF_FRAMETYPE_##type1, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type1##_PAYLOAD_SIZE), false, false, 0},\
-    {CRSF_FRAMETYPE_##type2, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type2##_PAYLOAD_SIZE), false, false, 0},\
-    {CRSF_FRAMETYPE_##type3, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type3##_PAYLOAD_SIZE), false, false, 0},\
-    {CRSF_FRAMETYPE_##type4, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type4##_PAYLOAD_SIZE), false, false, 0},\
-    {CRSF_FRAMETYPE_##type5, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type5##_PAYLOAD_SIZE), false, false, 0},\
-    {CRSF_FRAMETYPE_##type6, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_##type6##_PAYLOAD_SIZE), false, false, 0},\
-    {0, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_GENERAL_RESP_PAYLOAD_SIZE), false, false, 0},\
-    {0, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_GENERAL_RESP_PAYLOAD_SIZE), false, false, 0}};\
+    TELEMETRY_PAYLOAD_TYPES(PAYLOAD_DATA_SLOT) \
+    {0, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_GENERAL_RESP_PAYLOAD_SIZE), TELEMETRY_RESPONSE_SCHEDULE, false, false, 0, 0, 0, 0},\
+    {0, CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_GENERAL_RESP_PAYLOAD_SIZE), TELEMETRY_RESPONSE_SCHEDULE, false, false, 0, 0, 0, 0}};\
     const uint8_t payloadTypesCount = (sizeof(payloadTypes)/sizeof(crsf_telemetry_package_t))
 
 class Telemetry
@@ -57,18 +82,20 @@ public:
     bool ShouldCallUpdateModelMatch();
     bool ShouldSendDeviceFrame();
     uint8_t GetUpdatedModelMatch() { return modelMatchId; }
-    bool GetNextPayload(uint8_t* nextPayloadSize, uint8_t **payloadData);
+    bool GetNextPayload(uint8_t* nextPayloadSize, uint8_t **payloadData, uint8_t maxLength = CRSF_MAX_PACKET_LEN);
     uint8_t UpdatedPayloadCount();
     uint8_t ReceivedPackagesCount();
     bool AppendTelemetryPackage(uint8_t *package);
 private:
     void AppendToPackage(volatile crsf_telemetry_package_t *current);
+    uint32_t Urgency(uint8_t index, uint32_t now);
     uint8_t CRSFinBuffer[CRSF_MAX_PACKET_LEN];
     telemetry_state_s telemetry_state;
     uint8_t currentTelemetryByte;
     uint8_t currentPayloadIndex;
     volatile crsf_telemetry_package_t *telemetryPackageHead;
     uint8_t receivedPackages;
+    uint16_t pendingSeq;
     bool callBootloader;
     bool callEnterBind;
     bool callUpdateModelMatch;
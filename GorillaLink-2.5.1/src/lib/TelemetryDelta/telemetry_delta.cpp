@@ -0,0 +1,286 @@
+#include <cstring>
+#include "telemetry_delta.h"
+#include "../CRC/crc.h"
+
+#define TELEMETRY_DELTA_MAX_LAYOUT 6
+#define TELEMETRY_DELTA_PAYLOAD_INDEX (CRSF_TELEMETRY_TYPE_INDEX + 1)
+// The longest varint, of a 4 byte field
+#define TELEMETRY_DELTA_MAX_VARINT 5
+
+typedef struct {
+    uint8_t type;
+    uint8_t sizes[TELEMETRY_DELTA_MAX_LAYOUT];  // of the fields in bytes, 0 past the last one
+} telemetry_delta_layout_t;
+
+// With no layout all of the payload is one byte fields, however long it is
+static const telemetry_delta_layout_t layouts[TELEMETRY_DELTA_TYPES] = {
+    {CRSF_FRAMETYPE_GPS, {4, 4, 2, 2, 2, 1}},       // lat, lon, speed, heading, altitude, satellites
+    {CRSF_FRAMETYPE_BATTERY_SENSOR, {2, 2, 3, 1}},  // voltage, current, capacity, remaining
+    {CRSF_FRAMETYPE_ATTITUDE, {2, 2, 2}},           // pitch, roll, yaw
+    {CRSF_FRAMETYPE_VARIO, {2}},
+    {CRSF_FRAMETYPE_BARO_ALTITUDE, {2, 2}},         // altitude, vertical speed
+    {CRSF_FRAMETYPE_FLIGHT_MODE, {}},
+};
+
+static const GENERIC_CRC8<CRSF_CRC_POLY> crc;
+
+static uint32_t readField(const uint8_t *data, uint8_t size)
+{
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < size; i++)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+static void writeField(uint8_t *data, uint8_t size, uint32_t value)
+{
+    for (uint8_t i = size; i > 0; i--)
+    {
+        data[i - 1] = value;
+        value >>= 8;
+    }
+}
+
+void TelemetryDelta::ResetState()
+{
+    for (uint8_t i = 0; i < TELEMETRY_DELTA_TYPES; i++)
+    {
+        references[i].valid = false;
+        references[i].seq = 0;
+        references[i].deltas = 0;
+        references[i].frame[CRSF_TELEMETRY_LENGTH_INDEX] = 0;
+    }
+}
+
+int8_t TelemetryDelta::IndexOf(uint8_t type)
+{
+    for (uint8_t i = 0; i < TELEMETRY_DELTA_TYPES; i++)
+    {
+        if (layouts[i].type == type)
+            return i;
+    }
+    return -1;
+}
+
+bool TelemetryDelta::IsVariable(uint8_t index)
+{
+    return layouts[index].sizes[0] == 0;
+}
+
+uint8_t TelemetryDelta::LayoutPayloadSize(uint8_t index)
+{
+    uint8_t size = 0;
+    for (uint8_t i = 0; i < TELEMETRY_DELTA_MAX_LAYOUT; i++)
+        size += layouts[index].sizes[i];
+    return size;
+}
+
+/**
+ * Splits a payload of the type into fields, returns how many
+ **/
+uint8_t TelemetryDelta::FieldSizes(uint8_t index, uint8_t payloadSize, uint8_t *sizes)
+{
+    if (IsVariable(index))
+    {
+        memset(sizes, 1, payloadSize);
+        return payloadSize;
+    }
+
+    uint8_t count = 0;
+    while (count < TELEMETRY_DELTA_MAX_LAYOUT && layouts[index].sizes[count])
+    {
+        sizes[count] = layouts[index].sizes[count];
+        count++;
+    }
+    return count;
+}
+
+void TelemetryDelta::SetKeyframe(reference_t *reference, const uint8_t *frame)
+{
+    const uint8_t length = CRSF_FRAME_SIZE(frame[CRSF_TELEMETRY_LENGTH_INDEX]);
+    reference->valid = frame[CRSF_TELEMETRY_LENGTH_INDEX] >= 2 && length <= TELEMETRY_DELTA_MAX_FRAME;
+    reference->deltas = 0;
+    if (reference->valid)
+        memcpy(reference->frame, frame, length);
+}
+
+uint8_t TelemetryDelta::Encode(const uint8_t *frame, uint8_t *message)
+{
+    const uint8_t length = CRSF_FRAME_SIZE(frame[CRSF_TELEMETRY_LENGTH_INDEX]);
+    const int8_t index = IndexOf(frame[CRSF_TELEMETRY_TYPE_INDEX]);
+    if (index < 0)
+    {
+        memcpy(message, frame, length);
+        // The TX replaces the address anyway, make sure it is not taken for a delta
+        if (!(message[0] & ELRS_TELEMETRY_DELTA_FLAG))
+            message[0] = CRSF_SYNC_BYTE;
+        return length;
+    }
+
+    reference_t *reference = &references[index];
+    const uint8_t payloadSize = frame[CRSF_TELEMETRY_LENGTH_INDEX] - 2;
+    reference->seq = (reference->seq + 1) & ELRS_TELEMETRY_DELTA_SEQ_MASK;
+
+    if (reference->valid && reference->deltas < ELRS_TELEMETRY_DELTA_KEYFRAMES - 1 &&
+        reference->frame[CRSF_TELEMETRY_LENGTH_INDEX] == frame[CRSF_TELEMETRY_LENGTH_INDEX] &&
+        (IsVariable(index) || payloadSize == LayoutPayloadSize(index)))
+    {
+        // Made to the side, it only goes if it comes out shorter than the frame
+        uint8_t delta[TELEMETRY_DELTA_MAX_FRAME + TELEMETRY_DELTA_MAX_VARINT];
+        uint8_t sizes[TELEMETRY_DELTA_MAX_FRAME];
+        const uint8_t fields = FieldSizes(index, payloadSize, sizes);
+        const uint8_t maskBytes = (fields + 7) / 8;
+        uint8_t *mask = delta + 1;
+        if (IsVariable(index))
+            *mask++ = fields;
+        uint8_t *out = mask + maskBytes;
+        const uint8_t *oldField = reference->frame + TELEMETRY_DELTA_PAYLOAD_INDEX;
+        const uint8_t *newField = frame + TELEMETRY_DELTA_PAYLOAD_INDEX;
+
+        memset(mask, 0, maskBytes);
+        for (uint8_t field = 0; field < fields && out - delta < length; field++)
+        {
+            const uint8_t size = sizes[field];
+            const uint32_t oldValue = readField(oldField, size);
+            const uint32_t newValue = readField(newField, size);
+            oldField += size;
+            newField += size;
+            if (newValue == oldValue)
+                continue;
+
+            mask[field / 8] |= 1 << (field % 8);
+            if (size == 1)
+            {
+                *out++ = newValue;
+                continue;
+            }
+            // The difference sign extended from the width of the field, then zigzag
+            const uint8_t shift = 32 - size * 8;
+            const int32_t difference = (int32_t)((newValue - oldValue) << shift) >> shift;
+            uint32_t zigzag = ((uint32_t)difference << 1) ^ (uint32_t)(difference >> 31);
+            while (zigzag >= 0x80)
+            {
+                *out++ = (zigzag & 0x7F) | 0x80;
+                zigzag >>= 7;
+            }
+            *out++ = zigzag;
+        }
+
+        if (out - delta < length)
+        {
+            delta[0] = (index << ELRS_TELEMETRY_DELTA_TYPE_SHIFT) | reference->seq;
+            reference->deltas++;
+            memcpy(reference->frame, frame, length);
+            memcpy(message, delta, out - delta);
+            return out - delta;
+        }
+    }
+
+    SetKeyframe(reference, frame);
+    memcpy(message, frame, length);
+    message[0] = ELRS_TELEMETRY_DELTA_FLAG | reference->seq;
+    return length;
+}
+
+bool TelemetryDelta::Decode(const uint8_t *message, uint8_t length, uint8_t *used, uint8_t *frame)
+{
+    *used = 0;
+    if (length == 0)
+        return false;
+
+    if (message[0] & ELRS_TELEMETRY_DELTA_FLAG)
+    {
+        if (length < CRSF_FRAME_NOT_COUNTED_BYTES)
+            return false;
+        const uint8_t frameLength = CRSF_FRAME_SIZE(message[CRSF_TELEMETRY_LENGTH_INDEX]);
+        if (frameLength > length || frameLength > CRSF_MAX_PACKET_LEN)
+            return false;
+
+        *used = frameLength;
+        memcpy(frame, message, frameLength);
+        const int8_t index = IndexOf(message[CRSF_TELEMETRY_TYPE_INDEX]);
+        if (index >= 0)
+        {
+            SetKeyframe(&references[index], message);
+            references[index].seq = message[0] & ELRS_TELEMETRY_DELTA_SEQ_MASK;
+        }
+        return true;
+    }
+
+    const uint8_t index = message[0] >> ELRS_TELEMETRY_DELTA_TYPE_SHIFT;
+    const uint8_t seq = message[0] & ELRS_TELEMETRY_DELTA_SEQ_MASK;
+    if (index >= TELEMETRY_DELTA_TYPES)
+        return false;
+
+    const uint8_t *in = message + 1;
+    const uint8_t *end = message + length;
+    uint8_t payloadSize = LayoutPayloadSize(index);
+    if (IsVariable(index))
+    {
+        if (in >= end)
+            return false;
+        payloadSize = *in++;
+    }
+    if (CRSF_TELEMETRY_TOTAL_SIZE(payloadSize) > TELEMETRY_DELTA_MAX_FRAME)
+        return false;
+
+    uint8_t sizes[TELEMETRY_DELTA_MAX_FRAME];
+    const uint8_t fields = FieldSizes(index, payloadSize, sizes);
+    const uint8_t *mask = in;
+    in += (fields + 7) / 8;
+
+    // Only on top of the frame it was made from, with the one before it in
+    reference_t *reference = &references[index];
+    const bool follows = reference->valid && ((reference->seq + 1) & ELRS_TELEMETRY_DELTA_SEQ_MASK) == seq &&
+        reference->frame[CRSF_TELEMETRY_LENGTH_INDEX] == payloadSize + 2;
+    uint8_t updated[TELEMETRY_DELTA_MAX_FRAME];
+    if (follows)
+        memcpy(updated, reference->frame, CRSF_FRAME_SIZE(payloadSize + 2));
+    uint8_t *field = updated + TELEMETRY_DELTA_PAYLOAD_INDEX;
+
+    for (uint8_t i = 0; i < fields; field += sizes[i++])
+    {
+        if (in > end)
+            return false;
+        if (!(mask[i / 8] & (1 << (i % 8))))
+            continue;
+
+        const uint8_t size = sizes[i];
+        if (size == 1)
+        {
+            if (in >= end)
+                return false;
+            *field = *in++;
+            continue;
+        }
+        uint32_t zigzag = 0;
+        for (uint8_t shift = 0; ; shift += 7)
+        {
+            if (in >= end || shift >= TELEMETRY_DELTA_MAX_VARINT * 7)
+                return false;
+            zigzag |= (uint32_t)(*in & 0x7F) << shift;
+            if (!(*in++ & 0x80))
+                break;
+        }
+        const int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+        if (follows)
+            writeField(field, size, readField(field, size) + delta);
+    }
+    if (in > end)
+        return false;
+    *used = in - message;
+
+    if (!follows)
+    {
+        // A message of the type went missing, none of its deltas apply until the next keyframe
+        reference->valid = false;
+        return false;
+    }
+
+    const uint8_t frameLength = CRSF_FRAME_SIZE(payloadSize + 2);
+    updated[frameLength - 1] = crc.calc(updated + CRSF_TELEMETRY_TYPE_INDEX, frameLength - CRSF_TELEMETRY_TYPE_INDEX - CRSF_TELEMETRY_CRC_LENGTH);
+    memcpy(reference->frame, updated, frameLength);
+    reference->seq = seq;
+    memcpy(frame, updated, frameLength);
+    return true;
+}
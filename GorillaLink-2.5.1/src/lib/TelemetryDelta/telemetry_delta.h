@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include "crsf_protocol.h"
+#include "telemetry_protocol.h"
+
+// Frame types with a field layout, that go as deltas
+#define TELEMETRY_DELTA_TYPES 6
+#define TELEMETRY_DELTA_MAX_FRAME CRSF_TELEMETRY_TOTAL_SIZE(CRSF_FRAME_FLIGHT_MODE_PAYLOAD_SIZE)
+
+/**
+ * Delta compression of the CRSF telemetry frames the RX sends to the TX.
+ * GPS, battery, attitude, vario, baro altitude and flight mode frames go as
+ * the fields that changed since the last frame of the type:
+ *
+ *   [type index << ELRS_TELEMETRY_DELTA_TYPE_SHIFT | seq] ([field count]) [changed field mask] [fields]
+ *
+ * Only the flight mode, which is as long as its string, has the field count,
+ * the other types only go as deltas with the payload of their layout. The
+ * mask has a bit per field, LSB first, in (fields + 7) / 8 bytes. A one byte
+ * field is sent as its new value, a wider one as the zigzag varint of the
+ * difference, and the TX works out the CRC again. So a message can be taken
+ * apart without the frame it applies to, and several go one after another
+ * in a telemetry message.
+ *
+ * Any other frame goes as is, with the address made one that has
+ * ELRS_TELEMETRY_DELTA_FLAG set. A whole frame of a delta type is the
+ * keyframe of it, with ELRS_TELEMETRY_DELTA_FLAG | seq in place of the
+ * address. Every message of a type, keyframes included, takes the next seq,
+ * and the TX only applies a delta with the seq after the one it has. One
+ * that does not follow on means a message went missing, and the TX drops
+ * the deltas of the type until the next keyframe. There is one every
+ * ELRS_TELEMETRY_DELTA_KEYFRAMES messages of a type, or sooner when the
+ * length changes or the delta would be no shorter.
+ *
+ * The RX calls Encode() for each frame it sends and the TX Decode() for each
+ * message it gets. The StubbornSender only moves on once a message is in,
+ * or when it gives up on it, after which the RX calls ResetState() so every
+ * type starts again from a keyframe.
+ **/
+class TelemetryDelta
+{
+public:
+    TelemetryDelta() { ResetState(); }
+    // The next frame of each type is a keyframe
+    void ResetState();
+    // Writes the message for frame, returns its length which is at most the frame's
+    uint8_t Encode(const uint8_t *frame, uint8_t *message);
+    // Turns the message at the start of length bytes back into the CRSF frame, false if there is
+    // nothing to forward. used is how much of the bytes it took, 0 if they are not a message.
+    bool Decode(const uint8_t *message, uint8_t length, uint8_t *used, uint8_t *frame);
+
+private:
+    typedef struct {
+        bool valid;
+        uint8_t seq;
+        uint8_t deltas;     // since the keyframe
+        uint8_t frame[TELEMETRY_DELTA_MAX_FRAME];
+    } reference_t;
+
+    reference_t references[TELEMETRY_DELTA_TYPES];
+
+    static int8_t IndexOf(uint8_t type);
+    static bool IsVariable(uint8_t index);
+    static uint8_t LayoutPayloadSize(uint8_t index);
+    static uint8_t FieldSizes(uint8_t index, uint8_t payloadSize, uint8_t *sizes);
+    void SetKeyframe(reference_t *reference, const uint8_t *frame);
+};
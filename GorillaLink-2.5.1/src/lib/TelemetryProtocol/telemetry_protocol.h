@@ -2,11 +2,43 @@
 
 #define ELRS_TELEMETRY_TYPE_LINK 0x01
 #define ELRS_TELEMETRY_TYPE_DATA 0x02
+#define ELRS_TELEMETRY_TYPE_FHSS 0x03
 #define ELRS_TELEMETRY_TYPE_MASK 0x03
 #define ELRS_TELEMETRY_SHIFT 2
 #define ELRS_TELEMETRY_BYTES_PER_CALL 5
 #define ELRS_TELEMETRY_MAX_PACKAGES (255 >> ELRS_TELEMETRY_SHIFT)
 
 #define ELRS_MSP_BYTES_PER_CALL 5
-#define ELRS_MSP_BUFFER 65
+// The TX sends as many of the queued CRSF frames as fit in one message, the
+// RX splits them up again at the frame lengths, stopping at a zero one
+#define ELRS_MSP_BUFFER 250
 #define ELRS_MSP_MAX_PACKAGES ((ELRS_MSP_BUFFER/ELRS_MSP_BYTES_PER_CALL)+1)
+
+// The acks of the StubbornSender chunks: the sequence number of the next chunk
+// the StubbornReceiver is missing in the low bits, and which of the chunks
+// after it have arrived above that. Where there is only one bit for the ack
+// (TelemetryStatus in the RC packets) it is bit 0 and the window is 1.
+#define ELRS_STUBBORN_ACK_SEQ_MASK 0x0F
+#define ELRS_STUBBORN_ACK_MAP_SHIFT 4
+#define ELRS_STUBBORN_MAX_WINDOW 4
+// MSP chunks are acked with the whole byte in the LINK telemetry
+#define ELRS_MSP_WINDOW 4
+// With ENABLE_MSP_FEC, when the window has all gone out, the XOR of each group
+// of ELRS_MSP_FEC_GROUP MSP chunks is sent first so one lost chunk of it is
+// rebuilt without a resend. Off by default, test_stubborn shows it gains
+// little over the window alone. 0 turns it off, both ends need the same.
+#define ELRS_STUBBORN_MAX_FEC_BYTES 5
+#if defined(ENABLE_MSP_FEC)
+#define ELRS_MSP_FEC_GROUP ELRS_MSP_WINDOW
+#else
+#define ELRS_MSP_FEC_GROUP 0
+#endif
+// A DATA telemetry message is a count of the frames in it, then the frames
+// as TelemetryDelta messages. Those sent as the fields changed since the last
+// of their type have the top bit of the first byte clear where the CRSF
+// address has it set, then the type in the next 3 bits and the seq in the
+// low 4. The keyframes have the flag and the seq.
+#define ELRS_TELEMETRY_DELTA_FLAG 0x80
+#define ELRS_TELEMETRY_DELTA_TYPE_SHIFT 4
+#define ELRS_TELEMETRY_DELTA_SEQ_MASK 0x0F
+#define ELRS_TELEMETRY_DELTA_KEYFRAMES 16
@@ -2,6 +2,8 @@
 #include "common.h"
 #include "device.h"
 
+#if defined(TARGET_TX)
+
 #include "config.h"
 #include "CRSF.h"
 #include "msp.h"
@@ -22,7 +24,7 @@ static enum VtxSendState_e
 void VtxTriggerSend()
 {
     VtxSendState = VTXSS_MODIFIED;
-    devicesTriggerEvent();
+    devicesTriggerEvent(EVENT_CONFIG_CHANGED);
 }
 
 static void eepromWriteToMSPOut()
@@ -106,5 +108,8 @@ device_t VTX_device = {
     .initialize = NULL,
     .start = NULL,
     .event = event,
-    .timeout = timeout
+    .timeout = timeout,
+    .eventMask = EVENT_CONNECTION_CHANGED | EVENT_CONFIG_CHANGED
 };
+
+#endif
@@ -750,7 +750,8 @@ device_t WIFI_device = {
   .initialize = wifiOff,
   .start = start,
   .event = event,
-  .timeout = timeout
+  .timeout = timeout,
+  .eventMask = EVENT_CONNECTION_CHANGED
 };
 
 #endif
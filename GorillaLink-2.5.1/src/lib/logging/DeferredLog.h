@@ -0,0 +1,263 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include "targets.h"
+#include "crc.h"
+
+/**
+ * Ring of binary log records for DEBUG_LOG_DEFERRED. Logging only copies the
+ * address of the format string (its ID) and the raw argument words into an
+ * entry, with the time, so an ISR pays a few dozen cycles instead of
+ * formatting and pushing characters out of the UART. The main loop drains the
+ * ring later and either formats the entries itself or sends them as frames
+ * for python/decode_log.py to expand with the strings of the firmware ELF.
+ *
+ * Any context may log (loop and ISRs, or both ESP32 cores): a producer first
+ * claims the next entry by moving tail, fills it and then marks it ready.
+ * Only the loop consumes, in order, and it stops at an entry still being
+ * filled by a producer that was preempted. A full ring drops the record and
+ * counts it, so a burst never blocks an ISR.
+ *
+ * The arguments are read back as the format asks (%d %u %x %s). A char
+ * pointer argument is taken as a string for %s and copied into the entry,
+ * cut to what is left of its DEFERRED_LOG_TEXT bytes, as it is often a
+ * temporary (String::c_str()). Its word is then the offset in the text.
+ **/
+
+#define DEFERRED_LOG_MAX_ARGS 8
+// Bytes of an entry for the strings of its %s, each with its terminator
+#ifndef DEFERRED_LOG_TEXT
+#define DEFERRED_LOG_TEXT 24
+#endif
+
+// Entry flags
+#define DEFERRED_LOG_NEWLINE    0x01    // end the line after the record
+#define DEFERRED_LOG_ERROR      0x02    // prefix "ERROR: "
+#define DEFERRED_LOG_WRITE      0x04    // no format, write the first argument as a byte
+
+/**
+ * Frame of one record as the binary drain sends it, little endian:
+ * [DEFERRED_LOG_SYNC][argc | flags << 4][us: 4][fmt: 4][args: 4 each][text length][text][crc8]
+ * The CRC (CRSF polynomial) covers everything after the sync byte. A frame
+ * with fmt 0 and the NEWLINE flag reports the records dropped so far.
+ **/
+#define DEFERRED_LOG_SYNC 0xA5
+#define DEFERRED_LOG_CRC8_POLY 0xD5
+#define DEFERRED_LOG_MAX_FRAME (1 + 1 + 4 + 4 + 4 * DEFERRED_LOG_MAX_ARGS + 1 + DEFERRED_LOG_TEXT + 1)
+
+typedef struct
+{
+    const char *fmt;
+    uint32_t us;            // micros() when it was logged
+    uint8_t flags;
+    uint8_t argc;
+    uintptr_t args[DEFERRED_LOG_MAX_ARGS];
+    uint8_t textLen;
+    char text[DEFERRED_LOG_TEXT];
+    std::atomic<bool> ready;
+} deferredLogEntry_t;
+
+// An argument as the raw word it is stored as: integers, enums and pointers
+template <typename T>
+inline uintptr_t deferredLogWord(deferredLogEntry_t *, T value)
+{
+    return (uintptr_t)value;
+}
+
+// A string, copied into the entry's text as far as it fits
+inline uintptr_t ICACHE_RAM_ATTR deferredLogWord(deferredLogEntry_t *entry, const char *value)
+{
+    if (entry->textLen == DEFERRED_LOG_TEXT)
+    {
+        // Full, the terminator of the last one
+        return DEFERRED_LOG_TEXT - 1;
+    }
+    const uint8_t offset = entry->textLen;
+    uint8_t len = offset;
+    while (value != nullptr && *value && len < DEFERRED_LOG_TEXT - 1)
+    {
+        entry->text[len++] = *value++;
+    }
+    entry->text[len++] = 0;
+    entry->textLen = len;
+    return offset;
+}
+
+inline uintptr_t ICACHE_RAM_ATTR deferredLogWord(deferredLogEntry_t *entry, char *value)
+{
+    return deferredLogWord(entry, (const char *)value);
+}
+
+// The string of a %s argument of the entry
+inline const char *deferredLogText(const deferredLogEntry_t &entry, uintptr_t word)
+{
+    return word < entry.textLen ? &entry.text[word] : "";
+}
+
+template <uint16_t capacity>
+class DeferredLogRing
+{
+    static_assert(capacity >= 4 && capacity <= 32768 && (capacity & (capacity - 1)) == 0,
+                  "DeferredLogRing capacity must be a power of two from 4 to 32768");
+
+    static constexpr uint16_t mask = capacity - 1;
+
+public:
+    DeferredLogRing() : head(0), tail(0), dropped(0), droppedReported(0)
+    {
+        for (uint16_t i = 0; i < capacity; ++i)
+            entries[i].ready.store(false, std::memory_order_relaxed);
+    }
+
+    ///// Producer side, any context /////
+
+    // Record fmt with its arguments, false if the ring was full
+    template <typename... Args>
+    bool ICACHE_RAM_ATTR log(uint8_t flags, const char *fmt, Args... args)
+    {
+        static_assert(sizeof...(args) <= DEFERRED_LOG_MAX_ARGS, "Too many arguments to log deferred");
+        deferredLogEntry_t *entry = reserve();
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        entry->textLen = 0;
+        // In argument order, the trailing word keeps the array from being empty
+        const uintptr_t words[] = {deferredLogWord(entry, args)..., 0};
+        entry->fmt = fmt;
+        entry->us = micros();
+        entry->flags = flags;
+        entry->argc = sizeof...(args);
+        memcpy(entry->args, words, sizeof...(args) * sizeof(uintptr_t));
+        commit(entry);
+        return true;
+    }
+
+    // Claim the next entry, nullptr if the ring is full
+    deferredLogEntry_t *ICACHE_RAM_ATTR reserve()
+    {
+#if defined(PLATFORM_ESP8266)
+        // The LX106 has no compare-and-swap, but it has a single core, so
+        // masking the interrupts for the few instructions of the claim does
+        const uint32_t savedPS = xt_rsil(15);
+        const uint16_t t = tail.load(std::memory_order_relaxed);
+        const bool full = (uint16_t)(t - head.load(std::memory_order_acquire)) >= capacity;
+        if (full)
+        {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            tail.store(t + 1, std::memory_order_relaxed);
+        }
+        xt_wsr_ps(savedPS);
+        return full ? nullptr : &entries[t & mask];
+#else
+        uint16_t t = tail.load(std::memory_order_relaxed);
+        do
+        {
+            if ((uint16_t)(t - head.load(std::memory_order_acquire)) >= capacity)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+        } while (!tail.compare_exchange_weak(t, t + 1, std::memory_order_relaxed, std::memory_order_relaxed));
+        return &entries[t & mask];
+#endif
+    }
+
+    // Hand the entry from reserve() over to the consumer
+    void ICACHE_RAM_ATTR commit(deferredLogEntry_t *entry)
+    {
+        entry->ready.store(true, std::memory_order_release);
+    }
+
+    ///// Consumer side, the main loop /////
+
+    // The oldest entry once it is complete, left in the ring until consume()
+    const deferredLogEntry_t *peek()
+    {
+        const uint16_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        const deferredLogEntry_t *entry = &entries[h & mask];
+        return entry->ready.load(std::memory_order_acquire) ? entry : nullptr;
+    }
+
+    // Drop the entry returned by peek()
+    void consume()
+    {
+        const uint16_t h = head.load(std::memory_order_relaxed);
+        entries[h & mask].ready.store(false, std::memory_order_relaxed);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Records dropped since the last call
+    uint32_t takeDropped()
+    {
+        const uint32_t total = dropped.load(std::memory_order_relaxed);
+        const uint32_t count = total - droppedReported;
+        droppedReported = total;
+        return count;
+    }
+
+    // Entries claimed and not consumed yet
+    uint16_t size() const
+    {
+        const uint16_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+
+    // Frame of entry as the binary drain sends it, returns its length
+    static uint8_t encode(const deferredLogEntry_t &entry, uint8_t *frame)
+    {
+        return encode(entry.fmt, entry.us, entry.flags, entry.argc, entry.args, entry.textLen, entry.text, frame);
+    }
+
+    // Frame reporting count dropped records
+    static uint8_t encodeDropped(uint32_t count, uint32_t us, uint8_t *frame)
+    {
+        const uintptr_t word = count;
+        return encode(nullptr, us, DEFERRED_LOG_NEWLINE, 1, &word, 0, nullptr, frame);
+    }
+
+private:
+    std::atomic<uint16_t> head;
+    std::atomic<uint16_t> tail;
+    std::atomic<uint32_t> dropped;
+    uint32_t droppedReported;
+    deferredLogEntry_t entries[capacity];
+
+    static uint8_t *put32(uint8_t *p, uint32_t value)
+    {
+        for (uint8_t i = 0; i < 4; ++i)
+        {
+            *p++ = value >> (8 * i);
+        }
+        return p;
+    }
+
+    static uint8_t encode(const char *fmt, uint32_t us, uint8_t flags, uint8_t argc, const uintptr_t *args,
+                          uint8_t textLen, const char *text, uint8_t *frame)
+    {
+        static const GENERIC_CRC8<DEFERRED_LOG_CRC8_POLY> crc;
+        uint8_t *p = frame;
+        *p++ = DEFERRED_LOG_SYNC;
+        *p++ = argc | (flags << 4);
+        p = put32(p, us);
+        p = put32(p, (uint32_t)(uintptr_t)fmt);
+        for (uint8_t i = 0; i < argc; ++i)
+        {
+            p = put32(p, (uint32_t)args[i]);
+        }
+        *p++ = textLen;
+        memcpy(p, text, textLen);
+        p += textLen;
+        *p = crc.calc(frame + 1, p - frame - 1);
+        return p - frame + 1;
+    }
+};
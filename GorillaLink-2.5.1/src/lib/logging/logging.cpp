@@ -8,11 +8,30 @@
   #define GETCHAR *fmt
 #endif
 
-void debugPrintf(const char* fmt, ...)
+// Print one %s %d %u or %x conversion of value
+static void printConversion(char c, uintptr_t value)
+{
+  switch (c) {
+    case 's':
+      LOGGING_UART.print((const char *)value);
+      break;
+    case 'd':
+      LOGGING_UART.print((int32_t)value, DEC);
+      break;
+    case 'u':
+      LOGGING_UART.print((uint32_t)value, DEC);
+      break;
+    case 'x':
+      LOGGING_UART.print((uint32_t)value, HEX);
+      break;
+    default:
+      break;
+  }
+}
+
+static void debugVPrintf(const char* fmt, va_list vlist)
 {
   char c;
-  va_list  vlist;
-  va_start(vlist,fmt);
 
   c = GETCHAR;
   while(c) {
@@ -21,16 +40,12 @@ void debugPrintf(const char* fmt, ...)
       c = GETCHAR;
       switch (c) {
         case 's':
-          LOGGING_UART.print(va_arg(vlist,const char *));
+          printConversion(c, (uintptr_t)va_arg(vlist,const char *));
           break;
         case 'd':
-          LOGGING_UART.print(va_arg(vlist,int32_t), DEC);
-          break;
         case 'u':
-          LOGGING_UART.print(va_arg(vlist,uint32_t), DEC);
-          break;
         case 'x':
-          LOGGING_UART.print(va_arg(vlist,uint32_t), HEX);
+          printConversion(c, va_arg(vlist,uint32_t));
           break;
         default:
           break;
@@ -41,5 +56,89 @@ void debugPrintf(const char* fmt, ...)
     fmt++;
     c = GETCHAR;
   }
+}
+
+void debugPrintf(const char* fmt, ...)
+{
+  va_list  vlist;
+  va_start(vlist,fmt);
+  debugVPrintf(fmt, vlist);
   va_end(vlist);
-}
\ No newline at end of file
+}
+
+#if defined(DEBUG_LOG_DEFERRED)
+
+DeferredLogRing<DEFERRED_LOG_ENTRIES> deferredLog;
+
+#if defined(DEBUG_LOG_BINARY)
+static void sendFrame(const uint8_t *frame, uint8_t len)
+{
+  for (uint8_t i = 0; i < len; ++i)
+    LOGGING_UART.write(frame[i]);
+}
+#else
+// debugPrintf() of a record, the arguments taken from its words in turn
+static void printEntry(const deferredLogEntry_t &entry)
+{
+  if (entry.flags & DEFERRED_LOG_ERROR)
+    LOGGING_UART.print("ERROR: ");
+  if (entry.flags & DEFERRED_LOG_WRITE) {
+    LOGGING_UART.write((uint8_t)entry.args[0]);
+  } else {
+    uint8_t arg = 0;
+    for (const char *p = entry.fmt; *p; ++p) {
+      if (*p != '%') {
+        LOGGING_UART.write(*p);
+        continue;
+      }
+      const char c = *++p;
+      if (c == 0)
+        break;
+      if (c == 's' && arg < entry.argc)
+        printConversion(c, (uintptr_t)deferredLogText(entry, entry.args[arg++]));
+      else if ((c == 'd' || c == 'u' || c == 'x') && arg < entry.argc)
+        printConversion(c, entry.args[arg++]);
+    }
+  }
+  if (entry.flags & DEFERRED_LOG_NEWLINE)
+    LOGGING_UART.println();
+}
+#endif
+
+static void reportDropped()
+{
+  const uint32_t dropped = deferredLog.takeDropped();
+  if (dropped == 0)
+    return;
+#if defined(DEBUG_LOG_BINARY)
+  uint8_t frame[DEFERRED_LOG_MAX_FRAME];
+  sendFrame(frame, deferredLog.encodeDropped(dropped, micros(), frame));
+#else
+  debugPrintf("[%u log records dropped]", dropped);
+  LOGGING_UART.println();
+#endif
+}
+
+static bool drainOne()
+{
+  const deferredLogEntry_t *entry = deferredLog.peek();
+  if (entry == nullptr)
+    return false;
+#if defined(DEBUG_LOG_BINARY)
+  uint8_t frame[DEFERRED_LOG_MAX_FRAME];
+  sendFrame(frame, deferredLog.encode(*entry, frame));
+#else
+  printEntry(*entry);
+#endif
+  deferredLog.consume();
+  return true;
+}
+
+void deferredLogDrain()
+{
+  for (uint8_t i = 0; i < DEFERRED_LOG_DRAIN_BATCH && drainOne(); ++i)
+    ;
+  reportDropped();
+}
+
+#endif
@@ -12,11 +12,24 @@
  * DBGW / DBGVW - Write a single byte to logging (Serial.write(x))
  *
  * Set LOGGING_UART define to Serial instance to use if not Serial
+ *
+ * DEBUG_LOG_DEFERRED keeps the formatting out of the caller: the macros only
+ * record the format string and raw arguments in a ring (DeferredLog.h) and
+ * DBGDRAIN() prints a few records per call from the main loop. So logging
+ * from an ISR no longer shifts the timing it is logging. The strings of %s
+ * are copied into the record, cut to DEFERRED_LOG_TEXT bytes. DEBUG_LOG_BINARY
+ * sends the records as binary frames instead, for python/decode_log.py to
+ * expand with the format strings of the firmware ELF.
  **/
 
-// DEBUG_LOG_VERBOSE and DEBUG_RX_SCOREBOARD implies DEBUG_LOG
+// DEBUG_LOG_BINARY implies DEBUG_LOG_DEFERRED
+#if defined(DEBUG_LOG_BINARY) && !defined(DEBUG_LOG_DEFERRED)
+  #define DEBUG_LOG_DEFERRED
+#endif
+
+// DEBUG_LOG_VERBOSE, DEBUG_RX_SCOREBOARD, DEBUG_ISR_TIMING and DEBUG_LOG_DEFERRED implies DEBUG_LOG
 #if !defined(DEBUG_LOG)
-  #if defined(DEBUG_LOG_VERBOSE) || defined(DEBUG_RX_SCOREBOARD)
+  #if defined(DEBUG_LOG_VERBOSE) || defined(DEBUG_RX_SCOREBOARD) || defined(DEBUG_ISR_TIMING) || defined(DEBUG_LOG_DEFERRED)
     #define DEBUG_LOG
   #endif
 #endif
@@ -32,7 +45,30 @@ extern Stream *TxBackpack;
 
 extern void debugPrintf(const char* fmt, ...);
 
-#if defined(CRSF_RCVR_NO_SERIAL) && !defined(DEBUG_LOG)
+#if defined(DEBUG_LOG_DEFERRED)
+#include "DeferredLog.h"
+
+// Records the ring holds, a burst beyond that is dropped and counted
+#ifndef DEFERRED_LOG_ENTRIES
+#define DEFERRED_LOG_ENTRIES 32
+#endif
+// Records DBGDRAIN() prints per call
+#ifndef DEFERRED_LOG_DRAIN_BATCH
+#define DEFERRED_LOG_DRAIN_BATCH 4
+#endif
+
+extern DeferredLogRing<DEFERRED_LOG_ENTRIES> deferredLog;
+// Print DEFERRED_LOG_DRAIN_BATCH records, only ever from the main loop
+extern void deferredLogDrain();
+
+#define DEFERRED_LOG(flags, msg, ...) (void)deferredLog.log(flags, msg, ##__VA_ARGS__)
+#endif
+
+#if defined(DEBUG_LOG_DEFERRED)
+  // Through the ring too, so they come out in order with the rest
+  #define INFOLN(msg, ...) DEFERRED_LOG(DEFERRED_LOG_NEWLINE, msg, ##__VA_ARGS__)
+  #define ERRLN(msg, ...)  DEFERRED_LOG(DEFERRED_LOG_NEWLINE | DEFERRED_LOG_ERROR, msg, ##__VA_ARGS__)
+#elif defined(CRSF_RCVR_NO_SERIAL) && !defined(DEBUG_LOG)
   #define INFOLN(msg, ...)
   #define ERRLN(msg)
 #else
@@ -48,7 +84,13 @@ extern void debugPrintf(const char* fmt, ...);
   })(LOGGING_UART.println("ERROR: " msg))
 #endif
 
-#if defined(DEBUG_LOG)
+#if defined(DEBUG_LOG_DEFERRED)
+  #define DBGCR   deferredLog.log(DEFERRED_LOG_NEWLINE, "")
+  #define DBGW(c) deferredLog.log(DEFERRED_LOG_WRITE, nullptr, c)
+  #define DBG(msg, ...)   DEFERRED_LOG(0, msg, ##__VA_ARGS__)
+  #define DBGLN(msg, ...) DEFERRED_LOG(DEFERRED_LOG_NEWLINE, msg, ##__VA_ARGS__)
+  #define DBGDRAIN() deferredLogDrain()
+#elif defined(DEBUG_LOG)
   #define DBGCR   LOGGING_UART.println()
   #define DBGW(c) LOGGING_UART.write(c)
   #ifndef LOG_USE_PROGMEM
@@ -64,6 +106,12 @@ extern void debugPrintf(const char* fmt, ...);
       LOGGING_UART.println(); \
     }
   #endif
+#endif
+
+#if defined(DEBUG_LOG)
+  #if !defined(DEBUG_LOG_DEFERRED)
+    #define DBGDRAIN()
+  #endif
 
   // Verbose logging is for spammy stuff
   #if defined(DEBUG_LOG_VERBOSE)
@@ -82,6 +130,7 @@ extern void debugPrintf(const char* fmt, ...);
   #define DBGW(c)
   #define DBG(...)
   #define DBGLN(...)
+  #define DBGDRAIN()
   #define DBGVCR
   #define DBGV(...)
   #define DBGVLN(...)
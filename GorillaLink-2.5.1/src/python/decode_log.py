@@ -0,0 +1,247 @@
+#!/usr/bin/env python3
+"""
+Expands the binary log of a DEBUG_LOG_BINARY build.
+
+The firmware only sends the address of each format string (its ID) and the
+raw argument words, see lib/logging/DeferredLog.h for the frame. The strings
+are looked up in the ELF of the same build, e.g.
+.pio/build/<env>/firmware.elf, so the two have to match.
+
+    decode_log.py firmware.elf capture.bin
+    decode_log.py firmware.elf --port /dev/ttyUSB0 --baud 420000
+    decode_log.py firmware.elf --id 0x0800f1a4
+
+The strings of %s come in the frame itself. Anything between the frames
+(output from before the log started) is passed through as it is.
+"""
+
+import argparse
+import struct
+import sys
+
+SYNC = 0xA5
+CRC8_POLY = 0xD5
+MAX_ARGS = 8
+MAX_TEXT = 24
+
+FLAG_NEWLINE = 0x01
+FLAG_ERROR = 0x02
+FLAG_WRITE = 0x04
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+def _crc8_table(poly):
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = ((crc << 1) ^ (poly if crc & 0x80 else 0)) & 0xFF
+        table.append(crc)
+    return table
+
+
+CRC8_TABLE = _crc8_table(CRC8_POLY)
+
+
+def crc8(data):
+    crc = 0
+    for b in data:
+        crc = CRC8_TABLE[crc ^ b]
+    return crc
+
+
+class ElfStrings:
+    """ The contents of the loaded sections of a little endian ELF """
+
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        if self.data[:4] != b'\x7fELF' or self.data[4] not in (1, 2) or self.data[5] != 1:
+            raise ValueError("%s is not a little endian ELF" % path)
+        if self.data[4] == 1:
+            shoff, = struct.unpack_from('<I', self.data, 0x20)
+            shentsize, shnum = struct.unpack_from('<HH', self.data, 0x2E)
+            section = '<IIIIII'
+        else:
+            # 64 bit, only for native builds
+            shoff, = struct.unpack_from('<Q', self.data, 0x28)
+            shentsize, shnum = struct.unpack_from('<HH', self.data, 0x3A)
+            section = '<IIQQQQ'
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = struct.unpack_from(section, self.data, shoff + i * shentsize)
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+                self.sections.append((addr, offset, size))
+
+    def string(self, address):
+        """ The C string at address, None if no section holds it """
+        for addr, offset, size in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.data.find(b'\0', start, offset + size)
+                if end < 0:
+                    end = offset + size
+                return self.data[start:end].decode('utf-8', 'replace')
+        return None
+
+
+def _text_at(text, offset):
+    """ The string of a %s, at offset in the text of the frame """
+    if offset >= len(text):
+        return ''
+    end = text.find(b'\0', offset)
+    return text[offset:end if end >= 0 else len(text)].decode('utf-8', 'replace')
+
+
+def format_record(elf, fmt_id, args, text=b''):
+    """ The record as debugPrintf() would have printed it """
+    fmt = elf.string(fmt_id)
+    if fmt is None:
+        return "<unknown format 0x%08x %s>" % (fmt_id, ' '.join('0x%x' % a for a in args))
+    out = []
+    args = list(args)
+    i = 0
+    while i < len(fmt):
+        c = fmt[i]
+        i += 1
+        if c != '%':
+            out.append(c)
+            continue
+        if i >= len(fmt):
+            break
+        conv = fmt[i]
+        i += 1
+        if conv not in 'sdux' or not args:
+            continue
+        value = args.pop(0)
+        if conv == 'd':
+            out.append(str(value - (1 << 32) if value & 0x80000000 else value))
+        elif conv == 'u':
+            out.append(str(value))
+        elif conv == 'x':
+            out.append('%X' % value)
+        else:
+            out.append(_text_at(text, value))
+    return ''.join(out)
+
+
+class Decoder:
+    """ Splits the byte stream into frames and text, and prints both """
+
+    def __init__(self, elf, out=sys.stdout):
+        self.elf = elf
+        self.out = out
+        self.buf = bytearray()
+        self.line_start = True
+
+    def _write(self, text, us=None):
+        if self.line_start and us is not None:
+            self.out.write("[%6u.%06u] " % (us // 1000000, us % 1000000))
+        self.out.write(text)
+        self.line_start = False
+
+    def _newline(self):
+        self.out.write('\n')
+        self.line_start = True
+
+    def _record(self, flags, us, fmt_id, args, text):
+        if fmt_id == 0 and flags & FLAG_NEWLINE and args:
+            text = "[%u log records dropped]" % args[0]
+        elif flags & FLAG_WRITE:
+            text = chr(args[0] & 0xFF) if args else ''
+        else:
+            text = format_record(self.elf, fmt_id, args, text)
+        if flags & FLAG_ERROR:
+            text = "ERROR: " + text
+        self._write(text, us)
+        if flags & FLAG_NEWLINE:
+            self._newline()
+
+    def _text(self, data):
+        for line in data.decode('utf-8', 'replace').splitlines(True):
+            if line.endswith('\n'):
+                self._write(line.rstrip('\r\n'))
+                self._newline()
+            else:
+                self._write(line.rstrip('\r'))
+
+    def feed(self, data):
+        self.buf += data
+        while self.buf:
+            sync = self.buf.find(SYNC)
+            if sync < 0:
+                self._text(bytes(self.buf))
+                self.buf.clear()
+                break
+            if sync:
+                self._text(bytes(self.buf[:sync]))
+                del self.buf[:sync]
+            if len(self.buf) < 2:
+                break
+            argc = self.buf[1] & 0x0F
+            if argc > MAX_ARGS:
+                del self.buf[:1]
+                continue
+            text_at = 10 + 4 * argc
+            if len(self.buf) <= text_at:
+                break
+            text_len = self.buf[text_at]
+            if text_len > MAX_TEXT:
+                del self.buf[:1]
+                continue
+            length = text_at + 1 + text_len + 1
+            if len(self.buf) < length:
+                break
+            frame = bytes(self.buf[:length])
+            if crc8(frame[1:-1]) != frame[-1]:
+                # Not a frame after all, drop the sync byte and look again
+                del self.buf[:1]
+                continue
+            flags = frame[1] >> 4
+            us, fmt_id = struct.unpack_from('<II', frame, 2)
+            args = struct.unpack_from('<%dI' % argc, frame, 10)
+            self._record(flags, us, fmt_id, args, frame[text_at + 1:text_at + 1 + text_len])
+            del self.buf[:length]
+        self.out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Expand the binary log of a DEBUG_LOG_BINARY build")
+    parser.add_argument('elf', help="firmware.elf of the build that is logging")
+    parser.add_argument('capture', nargs='?', help="file of captured log bytes, - for stdin")
+    parser.add_argument('--port', help="serial port to read the log from")
+    parser.add_argument('--baud', type=int, default=420000, help="baud rate of the serial port")
+    parser.add_argument('--id', action='append', default=[], help="print the format string of an ID")
+    args = parser.parse_args()
+
+    elf = ElfStrings(args.elf)
+    for fmt_id in args.id:
+        s = elf.string(int(fmt_id, 0))
+        print("%s: %s" % (fmt_id, repr(s) if s is not None else "<unknown>"))
+    if args.id and not args.capture and not args.port:
+        return
+
+    decoder = Decoder(elf)
+    if args.port:
+        import serial
+        with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+            try:
+                while True:
+                    decoder.feed(port.read(256))
+            except KeyboardInterrupt:
+                pass
+    elif args.capture:
+        f = sys.stdin.buffer if args.capture == '-' else open(args.capture, 'rb')
+        while True:
+            data = f.read(4096)
+            if not data:
+                break
+            decoder.feed(data)
+    else:
+        parser.error("give a capture file or --port")
+
+
+if __name__ == '__main__':
+    main()
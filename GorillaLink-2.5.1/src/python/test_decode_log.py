@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+Tests for decode_log.py, run from this directory with
+
+    python3 -m unittest test_decode_log
+
+The frames are built the way DeferredLogRing::encode() does, against a
+minimal ELF holding the format strings.
+"""
+
+import io
+import os
+import struct
+import tempfile
+import unittest
+
+import decode_log
+
+RODATA = 0x08001000
+FORMATS = [b"lost conn fc=%d ppm=%d", b"Set Lua [%s]=%u", b"ISR %s n=%u %x"]
+
+
+def make_elf(strings):
+    """ A little endian ELF32 with one loaded section of the strings, and their addresses """
+    rodata = b''
+    addresses = []
+    for s in strings:
+        addresses.append(RODATA + len(rodata))
+        rodata += s + b'\0'
+    shoff = 52 + len(rodata)
+    header = b'\x7fELF' + bytes([1, 1, 1]) + bytes(9)
+    header += struct.pack('<HHIIIIIHHHHHH', 2, 40, 1, 0, 0, shoff, 0, 52, 0, 0, 40, 2, 0)
+    null = bytes(40)
+    section = struct.pack('<IIIIIIIIII', 0, 1, decode_log.SHF_ALLOC, RODATA, 52, len(rodata), 0, 0, 4, 0)
+    return header + rodata + null + section, addresses
+
+
+def frame(fmt_id, args=(), text=b'', flags=0, us=0):
+    """ The frame of a record, see DeferredLog.h """
+    body = bytes([len(args) | flags << 4]) + struct.pack('<II', us, fmt_id)
+    body += struct.pack('<%dI' % len(args), *args) + bytes([len(text)]) + text
+    return bytes([decode_log.SYNC]) + body + bytes([decode_log.crc8(body)])
+
+
+class DecodeLogTest(unittest.TestCase):
+
+    def setUp(self):
+        data, self.ids = make_elf(FORMATS)
+        fd, self.path = tempfile.mkstemp(suffix='.elf')
+        with os.fdopen(fd, 'wb') as f:
+            f.write(data)
+        self.elf = decode_log.ElfStrings(self.path)
+
+    def tearDown(self):
+        os.remove(self.path)
+
+    def decode(self, *chunks):
+        out = io.StringIO()
+        decoder = decode_log.Decoder(self.elf, out)
+        for chunk in chunks:
+            decoder.feed(chunk)
+        return out.getvalue()
+
+    def test_crc8(self):
+        # The CRSF CRC8 check value
+        self.assertEqual(0xBC, decode_log.crc8(b'123456789'))
+
+    def test_elf_strings(self):
+        self.assertEqual("Set Lua [%s]=%u", self.elf.string(self.ids[1]))
+        self.assertEqual("[%s]=%u", self.elf.string(self.ids[1] + 8))
+        self.assertIsNone(self.elf.string(RODATA - 1))
+
+    def test_records(self):
+        data = frame(self.ids[0], (0xFFFFFFFB, 0xFFFFFFB0), flags=decode_log.FLAG_NEWLINE, us=1234)
+        data += frame(self.ids[1], (0, 1), b'Bind\0', flags=decode_log.FLAG_NEWLINE | decode_log.FLAG_ERROR)
+        data += frame(self.ids[2], (0, 42, 0xBEEF, 0), b'hop\0', flags=decode_log.FLAG_NEWLINE, us=2000001)
+        self.assertEqual("[     0.001234] lost conn fc=-5 ppm=-80\n"
+                         "[     0.000000] ERROR: Set Lua [Bind]=1\n"
+                         "[     2.000001] ISR hop n=42 BEEF\n", self.decode(data))
+
+    def test_writes_and_dropped(self):
+        data = frame(0, (ord('.'),), flags=decode_log.FLAG_WRITE)
+        data += frame(0, (ord('_'),), flags=decode_log.FLAG_WRITE)
+        data += frame(0, (9,), flags=decode_log.FLAG_NEWLINE)
+        self.assertEqual("[     0.000000] ._[9 log records dropped]\n", self.decode(data))
+
+    def test_split_and_noise(self):
+        # Text around the frames passes through, a frame may come in pieces
+        data = frame(self.ids[1], (0, 7), b'Rate\0', flags=decode_log.FLAG_NEWLINE)
+        self.assertEqual("boot\n[     0.000000] Set Lua [Rate]=7\n",
+                         self.decode(b'boot\n', data[:3], data[3:15], data[15:]))
+
+    def test_bad_frames(self):
+        good = frame(self.ids[1], (0, 2), b'Bind\0', flags=decode_log.FLAG_NEWLINE)
+        corrupt = bytearray(good)
+        corrupt[8] ^= 0xFF
+        # A failed CRC is not taken for a frame and the next one is still found
+        self.assertIn("Set Lua [Bind]=2\n", self.decode(bytes(corrupt) + good))
+        # Nor is too much text
+        self.assertIn("Set Lua [Bind]=2\n", self.decode(bytes([decode_log.SYNC, 0]) + bytes(8) + b'\xff' + good))
+
+    def test_unknown_format(self):
+        self.assertEqual("[     0.000000] <unknown format 0x00000010 0x5>\n",
+                         self.decode(frame(0x10, (5,), flags=decode_log.FLAG_NEWLINE)))
+
+
+if __name__ == '__main__':
+    unittest.main()
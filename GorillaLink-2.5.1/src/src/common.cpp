@@ -11,11 +11,26 @@ expresslrs_mod_settings_s ExpressLRS_AirRateConfig[RATE_MAX] = {
     {2, RATE_50HZ, SX127x_BW_500_00_KHZ, SX127x_SF_8, SX127x_CR_4_7, 20000, TLM_RATIO_NO_TLM, 4, 10, 8},
     {3, RATE_25HZ, SX127x_BW_500_00_KHZ, SX127x_SF_9, SX127x_CR_4_7, 40000, TLM_RATIO_NO_TLM, 2, 10, 8}};
 
+// smFullRes packets take longer on air, each rate index drops to the next rate that fits them.
+// 19 bytes on SF9 do not fit in 25Hz, so the last index stays on SF8 and trades the rest of
+// the slot for the stronger coding rate.
+expresslrs_mod_settings_s ExpressLRS_AirRateConfigFullRes[RATE_MAX] = {
+    {0, RATE_100HZ, SX127x_BW_500_00_KHZ, SX127x_SF_6, SX127x_CR_4_7, 10000, TLM_RATIO_1_64, 4, 8, 19},
+    {1, RATE_50HZ, SX127x_BW_500_00_KHZ, SX127x_SF_7, SX127x_CR_4_7, 20000, TLM_RATIO_NO_TLM, 4, 8, 19},
+    {2, RATE_25HZ, SX127x_BW_500_00_KHZ, SX127x_SF_8, SX127x_CR_4_7, 40000, TLM_RATIO_NO_TLM, 4, 10, 19},
+    {3, RATE_25HZ, SX127x_BW_500_00_KHZ, SX127x_SF_8, SX127x_CR_4_8, 40000, TLM_RATIO_NO_TLM, 2, 10, 19}};
+
 expresslrs_rf_pref_params_s ExpressLRS_AirRateRFperf[RATE_MAX] = {
     {0, RATE_200HZ, -112, 4380, 3000, 2500, 600, 5000},
     {1, RATE_100HZ, -117, 8770, 3500, 2500, 600, 5000},
     {2, RATE_50HZ, -120, 18560, 4000, 2500, 600, 5000},
     {3, RATE_25HZ, -123, 29950, 6000, 4000, 0, 5000}};
+
+expresslrs_rf_pref_params_s ExpressLRS_AirRateRFperfFullRes[RATE_MAX] = {
+    {0, RATE_100HZ, -112, 7968, 3500, 2500, 600, 5000},
+    {1, RATE_50HZ, -117, 14144, 4000, 2500, 600, 5000},
+    {2, RATE_25HZ, -120, 25728, 6000, 4000, 0, 5000},
+    {3, RATE_25HZ, -120, 27776, 6000, 4000, 0, 5000}};
 #endif
 
 #if defined(Regulatory_Domain_ISM_2400)
@@ -24,16 +39,35 @@ expresslrs_rf_pref_params_s ExpressLRS_AirRateRFperf[RATE_MAX] = {
 extern SX1280Driver Radio;
 
 expresslrs_mod_settings_s ExpressLRS_AirRateConfig[RATE_MAX] = {
-    {0, RATE_500HZ, SX1280_LORA_BW_0800, SX1280_LORA_SF5, SX1280_LORA_CR_LI_4_6, 2000, TLM_RATIO_1_128, 4, 12, 8},
-    {1, RATE_250HZ, SX1280_LORA_BW_0800, SX1280_LORA_SF6, SX1280_LORA_CR_LI_4_7, 4000, TLM_RATIO_1_64, 4, 14, 8},
-    {2, RATE_150HZ, SX1280_LORA_BW_0800, SX1280_LORA_SF7, SX1280_LORA_CR_LI_4_7, 6666, TLM_RATIO_1_32, 4, 12, 8},
-    {3, RATE_50HZ, SX1280_LORA_BW_0800, SX1280_LORA_SF9, SX1280_LORA_CR_LI_4_6, 20000, TLM_RATIO_NO_TLM, 2, 12, 8}};
+    {0, RATE_500HZ, SX1280_PACKET_TYPE_LORA, SX1280_LORA_BW_0800, SX1280_LORA_SF5, SX1280_LORA_CR_LI_4_6, 2000, TLM_RATIO_1_128, 4, 12, 8},
+    {1, RATE_250HZ, SX1280_PACKET_TYPE_LORA, SX1280_LORA_BW_0800, SX1280_LORA_SF6, SX1280_LORA_CR_LI_4_7, 4000, TLM_RATIO_1_64, 4, 14, 8},
+    {2, RATE_150HZ, SX1280_PACKET_TYPE_LORA, SX1280_LORA_BW_0800, SX1280_LORA_SF7, SX1280_LORA_CR_LI_4_7, 6666, TLM_RATIO_1_32, 4, 12, 8},
+    {3, RATE_50HZ, SX1280_PACKET_TYPE_LORA, SX1280_LORA_BW_0800, SX1280_LORA_SF9, SX1280_LORA_CR_LI_4_6, 20000, TLM_RATIO_NO_TLM, 2, 12, 8},
+    // FLRC, the preamble is in bits
+    {4, RATE_1000HZ, SX1280_PACKET_TYPE_FLRC, SX1280_FLRC_BR_0_650_BW_0_6, SX1280_FLRC_BT_1, SX1280_FLRC_CR_1_2, 1000, TLM_RATIO_1_128, 4, 32, 8}};
+
+// smFullRes packets take longer on air, each rate index drops to the next rate that fits them.
+// FLRC still fits 19 bytes in 1000Hz.
+expresslrs_mod_settings_s ExpressLRS_AirRateConfigFullRes[RATE_MAX] = {
+    {0, RATE_250HZ, SX1280_PACKET_TYPE_LORA, SX1280_LORA_BW_0800, SX1280_LORA_SF5, SX1280_LORA_CR_LI_4_6, 4000, TLM_RATIO_1_64, 4, 12, 19},
+    {1, RATE_150HZ, SX1280_PACKET_TYPE_LORA, SX1280_LORA_BW_0800, SX1280_LORA_SF6, SX1280_LORA_CR_LI_4_7, 6666, TLM_RATIO_1_32, 4, 14, 19},
+    {2, RATE_50HZ, SX1280_PACKET_TYPE_LORA, SX1280_LORA_BW_0800, SX1280_LORA_SF7, SX1280_LORA_CR_LI_4_7, 20000, TLM_RATIO_NO_TLM, 4, 12, 19},
+    {3, RATE_25HZ, SX1280_PACKET_TYPE_LORA, SX1280_LORA_BW_0800, SX1280_LORA_SF9, SX1280_LORA_CR_LI_4_6, 40000, TLM_RATIO_NO_TLM, 2, 12, 19},
+    {4, RATE_1000HZ, SX1280_PACKET_TYPE_FLRC, SX1280_FLRC_BR_0_650_BW_0_6, SX1280_FLRC_BT_1, SX1280_FLRC_CR_1_2, 1000, TLM_RATIO_1_128, 4, 32, 19}};
 
 expresslrs_rf_pref_params_s ExpressLRS_AirRateRFperf[RATE_MAX] = {
     {0, RATE_500HZ, -105, 1665, 2500, 2500, 3, 5000},
     {1, RATE_250HZ, -108, 3300, 3000, 2500, 6, 5000},
     {2, RATE_150HZ, -112, 5871, 3500, 2500, 10, 5000},
-    {3, RATE_50HZ, -117, 18443, 4000, 2500, 0, 5000}};
+    {3, RATE_50HZ, -117, 18443, 4000, 2500, 0, 5000},
+    {4, RATE_1000HZ, -104, 314, 2500, 2500, 3, 5000}};
+
+expresslrs_rf_pref_params_s ExpressLRS_AirRateRFperfFullRes[RATE_MAX] = {
+    {0, RATE_250HZ, -105, 2568, 3000, 2500, 6, 5000},
+    {1, RATE_150HZ, -108, 5488, 3500, 2500, 10, 5000},
+    {2, RATE_50HZ, -112, 9094, 4000, 2500, 0, 5000},
+    {3, RATE_25HZ, -117, 29418, 6000, 4000, 0, 5000},
+    {4, RATE_1000HZ, -104, 585, 2500, 2500, 3, 5000}};
 #endif
 
 expresslrs_mod_settings_s *get_elrs_airRateConfig(int8_t index);
@@ -54,6 +88,20 @@ expresslrs_mod_settings_s *get_elrs_airRateConfig(int8_t index)
     return &ExpressLRS_AirRateConfig[index];
 }
 
+expresslrs_mod_settings_s *get_elrs_airRateConfigFullRes(int8_t index)
+{
+    // Same index as get_elrs_airRateConfig(), with get_elrs_RFperfParamsFullRes() for its RF perf params
+    if (index < 0)
+    {
+        return &ExpressLRS_AirRateConfigFullRes[0];
+    }
+    else if (index > (RATE_MAX - 1))
+    {
+        return &ExpressLRS_AirRateConfigFullRes[RATE_MAX - 1];
+    }
+    return &ExpressLRS_AirRateConfigFullRes[index];
+}
+
 expresslrs_rf_pref_params_s *get_elrs_RFperfParams(int8_t index)
 {
     // Protect against out of bounds rate
@@ -70,6 +118,19 @@ expresslrs_rf_pref_params_s *get_elrs_RFperfParams(int8_t index)
     return &ExpressLRS_AirRateRFperf[index];
 }
 
+expresslrs_rf_pref_params_s *get_elrs_RFperfParamsFullRes(int8_t index)
+{
+    if (index < 0)
+    {
+        return &ExpressLRS_AirRateRFperfFullRes[0];
+    }
+    else if (index > (RATE_MAX - 1))
+    {
+        return &ExpressLRS_AirRateRFperfFullRes[RATE_MAX - 1];
+    }
+    return &ExpressLRS_AirRateRFperfFullRes[index];
+}
+
 ICACHE_RAM_ATTR uint8_t enumRatetoIndex(expresslrs_RFrates_e rate)
 { // convert enum_rate to index
     for (int i = 0; i < RATE_MAX; i++)
@@ -153,6 +214,7 @@ uint16_t RateEnumToHz(expresslrs_RFrates_e eRate)
 {
     switch(eRate)
     {
+    case RATE_1000HZ: return 1000;
     case RATE_500HZ: return 500;
     case RATE_250HZ: return 250;
     case RATE_200HZ: return 200;
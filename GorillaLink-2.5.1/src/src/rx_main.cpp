@@ -18,6 +18,7 @@ SX1280Driver Radio;
 #include "telemetry.h"
 #include "stubborn_sender.h"
 #include "stubborn_receiver.h"
+#include "telemetry_delta.h"
 
 #include "FHSS.h"
 #include "logging.h"
@@ -26,6 +27,8 @@ SX1280Driver Radio;
 #include "msptypes.h"
 #include "hwTimer.h"
 #include "PFD.h"
+#include "PLL.h"
+#include "ISRTIMING.h"
 #include "LQCALC.h"
 #include "elrs_eeprom.h"
 #include "config.h"
@@ -42,7 +45,13 @@ SX1280Driver Radio;
 #define SEND_LINK_STATS_TO_FC_INTERVAL 100
 #define DIVERSITY_ANTENNA_INTERVAL 5
 #define DIVERSITY_ANTENNA_RSSI_TRIGGER 5
-#define PACKET_TO_TOCK_SLACK 200 // Desired buffer time between Packet ISR and Tock ISR
+// Desired buffer time between the RX done DIO edge and the Tock ISR. The
+// edge is up to ~50us ahead of ProcessRFPacket: the SX127x reads the IRQ
+// flags, FIFO, RSSI and SNR in 5 SPI transactions (~30us at 10MHz on the
+// ESP8266), the SX1280 the status, payload and IRQ clear in 5 (~50us with
+// the BusyDelay() of a board without BUSY). 200us after that, as when the
+// time was taken in ProcessRFPacket, leaves it room to finish first.
+#define PACKET_TO_TOCK_SLACK 250
 ///////////////////
 
 device_affinity_t ui_devices[] = {
@@ -65,7 +74,8 @@ uint8_t antenna = 0;    // which antenna is currently in use
 hwTimer hwTimer;
 POWERMGNT POWERMGNT;
 PFD PFDloop;
-GENERIC_CRC14 ota_crc(ELRS_CRC14_POLY);
+PLL PLLloop;
+GENERIC_CRC14<ELRS_CRC14_POLY> ota_crc;
 ELRS_EEPROM eeprom;
 RxConfig config;
 Telemetry telemetry;
@@ -105,20 +115,20 @@ CRSF crsf(CRSF_TX_SERIAL);
 #endif
 
 StubbornSender TelemetrySender(ELRS_TELEMETRY_MAX_PACKAGES);
+TelemetryDelta TelemetryCompressor;
+// The count of frames in it, then the frames as TelemetryDelta messages
+static uint8_t TelemetryMessage[CRSF_MAX_PACKET_LEN + 1];
 static uint8_t telemetryBurstCount;
 static uint8_t telemetryBurstMax;
 // Maximum ms between LINK_STATISTICS packets for determining burst max
 #define TELEM_MIN_LINK_INTERVAL 512U
 
-StubbornReceiver MspReceiver(ELRS_MSP_MAX_PACKAGES);
+StubbornReceiver MspReceiver(ELRS_MSP_MAX_PACKAGES, ELRS_MSP_FEC_GROUP);
 uint8_t MspData[ELRS_MSP_BUFFER];
 
 static uint8_t NextTelemetryType = ELRS_TELEMETRY_TYPE_LINK;
 static bool telemBurstValid;
 /// Filters ////////////////
-LPF LPF_Offset(2);
-LPF LPF_OffsetDx(4);
-
 // LPF LPF_UplinkRSSI(5);
 LPF LPF_UplinkRSSI0(5);  // track rssi per antenna
 LPF LPF_UplinkRSSI1(5);
@@ -127,18 +137,38 @@ LPF LPF_UplinkRSSI1(5);
 /// LQ Calculation //////////
 LQCALC<100> LQCalc;
 uint8_t uplinkLQ;
+// Channel the radio was tuned to for the current LQ period
+static uint8_t LQperiodChannel;
+
+/// FHSS channel blacklisting ///
+// How often the per channel LQ is checked for a better blacklist
+#define BLACKLIST_CHECK_INTERVAL 1000U
+static uint32_t BlacklistLastChecked;
+// The TX is on a list this end doesn't have, propose one even if nothing changed
+static bool BlacklistResync;
+// Alternate blacklist proposals with the link statistics
+static bool BlacklistSendNext;
 
 uint8_t scanIndex = RATE_DEFAULT;
+#if defined(ENABLE_FULL_RES_SCAN)
+// The RX scans every rate in both packet lengths, the smFullRes ones after the standard ones
+#define RF_MODE_SCAN_COUNT (RATE_MAX * 2)
+#else
+#define RF_MODE_SCAN_COUNT RATE_MAX
+#endif
+// An smFullRes TX on the bandwidth and spreading factor of a standard rate
+// shows up there as CRC errors, its longer packets are cut short, so then the
+// smFullRes rates on that modulation are tried before the scan goes on.
+static volatile bool scanCrcError;
+static uint8_t scanCrcRateIndex;
+static uint8_t scanFullResIndex = RATE_MAX;
+// smFullRes changes the packet length, so a SYNC that switches to or from it
+// is applied with the air rate change in loop()
+static bool nextAirRateFullRes;
 
 int32_t RawOffset;
-int32_t prevRawOffset;
-int32_t Offset;
-int32_t OffsetDx;
-int32_t prevOffset;
 RXtimerState_e RXtimerState;
-uint32_t GotConnectionMillis = 0;
 bool connectionHasModelMatch;
-const uint32_t ConsiderConnGoodMillis = 1000; // minimum time before we can consider a connection to be 'good'
 
 ///////////////////////////////////////////////
 
@@ -147,7 +177,6 @@ volatile uint8_t NonceRX = 0; // nonce that we THINK we are up to.
 bool alreadyFHSS = false;
 bool alreadyTLMresp = false;
 
-uint32_t beginProcessing;
 uint32_t doneProcessing;
 
 //////////////////////////////////////////////////////////////
@@ -247,14 +276,19 @@ void ICACHE_RAM_ATTR getRFlinkInfo()
     #endif
 }
 
-void SetRFLinkRate(uint8_t index) // Set speed of RF link
+void SetRFLinkRate(uint8_t index, bool fullRes) // Set speed of RF link
 {
-    expresslrs_mod_settings_s *const ModParams = get_elrs_airRateConfig(index);
-    expresslrs_rf_pref_params_s *const RFperf = get_elrs_RFperfParams(index);
+    expresslrs_mod_settings_s *const ModParams = fullRes ? get_elrs_airRateConfigFullRes(index) : get_elrs_airRateConfig(index);
+    expresslrs_rf_pref_params_s *const RFperf = fullRes ? get_elrs_RFperfParamsFullRes(index) : get_elrs_RFperfParams(index);
     bool invertIQ = UID[5] & 0x01;
 
     hwTimer.updateInterval(ModParams->interval);
-    Radio.Config(ModParams->bw, ModParams->sf, ModParams->cr, GetInitialFreq(), ModParams->PreambleLen, invertIQ, ModParams->PayloadLength, 0);
+    PLLloop.init(ModParams->interval);
+    Radio.Config(ModParams->bw, ModParams->sf, ModParams->cr, GetInitialFreq(), ModParams->PreambleLen, invertIQ, ModParams->PayloadLength, 0
+#if defined(Regulatory_Domain_ISM_2400)
+                 , ModParams->packetType, uidMacSeedGet()
+#endif
+                 );
 
     // Wait for (11/10) 110% of time it takes to cycle through all freqs in FHSS table (in ms)
     cycleInterval = ((uint32_t)11U * FHSSgetChannelCount() * ModParams->FHSShopInterval * ModParams->interval) / (10U * 1000U);
@@ -262,6 +296,12 @@ void SetRFLinkRate(uint8_t index) // Set speed of RF link
     ExpressLRS_currAirRate_Modparams = ModParams;
     ExpressLRS_currAirRate_RFperfParams = RFperf;
     ExpressLRS_nextAirRateIndex = index; // presumably we just handled this
+    nextAirRateFullRes = fullRes;
+    // The unpacker has to match the packet length, the next SYNC sets the exact mode
+    if (fullRes)
+        OtaSetSwitchMode(smFullRes);
+    else if (OtaSwitchModeCurrent == smFullRes)
+        OtaSetSwitchMode(smHybrid);
     telemBurstValid = false;
 }
 
@@ -275,7 +315,8 @@ bool ICACHE_RAM_ATTR HandleFHSS()
     }
 
     alreadyFHSS = true;
-    Radio.SetFrequencyReg(FHSSgetNextFreq());
+    const fhss_channel_t &channel = FHSSgetNextChannel();
+    Radio.SetFrequencyCmd(channel.freq, channel.cmd);
 
     uint8_t modresultTLM = (NonceRX + 1) % (TLMratioEnumToValue(ExpressLRS_currAirRate_Modparams->TLMinterval));
 
@@ -301,7 +342,24 @@ bool ICACHE_RAM_ATTR HandleSendTelemetryResponse()
     alreadyTLMresp = true;
     Radio.TXdataBuffer[0] = TLM_PACKET;
 
-    if (NextTelemetryType == ELRS_TELEMETRY_TYPE_LINK || !TelemetrySender.IsActive())
+    const bool linkSlot = NextTelemetryType == ELRS_TELEMETRY_TYPE_LINK || !TelemetrySender.IsActive();
+    if (linkSlot)
+    {
+        BlacklistSendNext = !BlacklistSendNext;
+    }
+
+    fhss_blacklist_t blacklist;
+    if (linkSlot && BlacklistSendNext && FHSSgetPendingBlacklist(blacklist))
+    {
+        // Propose the blacklist in every other link statistics slot until the TX announces it
+        Radio.TXdataBuffer[1] = ELRS_TELEMETRY_TYPE_FHSS + (blacklist.epoch << ELRS_TELEMETRY_SHIFT) + (blacklist.count << (ELRS_TELEMETRY_SHIFT + 1));
+        for (uint8_t i = 0; i < FHSS_BLACKLIST_MAX; i++)
+        {
+            Radio.TXdataBuffer[2 + i] = blacklist.channels[i];
+        }
+        Radio.TXdataBuffer[6] = MspReceiver.GetCurrentAck();
+    }
+    else if (linkSlot)
     {
         Radio.TXdataBuffer[1] = ELRS_TELEMETRY_TYPE_LINK;
         // The value in linkstatistics is "positivized" (inverted polarity)
@@ -311,7 +369,7 @@ bool ICACHE_RAM_ATTR HandleSendTelemetryResponse()
         Radio.TXdataBuffer[3] = crsf.LinkStatistics.uplink_RSSI_2 | (connectionHasModelMatch << 7);
         Radio.TXdataBuffer[4] = crsf.LinkStatistics.uplink_SNR;
         Radio.TXdataBuffer[5] = crsf.LinkStatistics.uplink_Link_quality;
-        Radio.TXdataBuffer[6] = MspReceiver.GetCurrentConfirm() ? 1 : 0;
+        Radio.TXdataBuffer[6] = MspReceiver.GetCurrentAck();
 
         NextTelemetryType = ELRS_TELEMETRY_TYPE_DATA;
         // Start the count at 1 because the next will be DATA and doing +1 before checking
@@ -338,9 +396,10 @@ bool ICACHE_RAM_ATTR HandleSendTelemetryResponse()
         Radio.TXdataBuffer[6] = maxLength >= 4 ? *(data + 4): 0;
     }
 
-    uint16_t crc = ota_crc.calc(Radio.TXdataBuffer, 7, CRCInitializer);
+    const uint8_t crcPos = ExpressLRS_currAirRate_Modparams->PayloadLength - 1;
+    uint16_t crc = ota_crc.calc(Radio.TXdataBuffer, crcPos, CRCInitializer);
     Radio.TXdataBuffer[0] |= (crc >> 6) & 0b11111100;
-    Radio.TXdataBuffer[7] = crc & 0xFF;
+    Radio.TXdataBuffer[crcPos] = crc & 0xFF;
 
     Radio.TXnb();
     return true;
@@ -353,12 +412,11 @@ void ICACHE_RAM_ATTR HandleFreqCorr(bool value)
     {
         if (FreqCorrection < FreqCorrectionMax)
         {
-            FreqCorrection += 1; //min freq step is ~ 61hz but don't forget we use FREQ_HZ_TO_REG_VAL so the units here are not hz!
+            FHSSsetFreqCorrection(FreqCorrection + 1); //min freq step is ~ 61hz but don't forget we use FREQ_HZ_TO_REG_VAL so the units here are not hz!
         }
         else
         {
-            FreqCorrection = FreqCorrectionMax;
-            FreqCorrection = 0; //reset because something went wrong
+            FHSSsetFreqCorrection(0); //reset because something went wrong
             DBGLN("Max +FreqCorrection reached!");
         }
     }
@@ -366,12 +424,11 @@ void ICACHE_RAM_ATTR HandleFreqCorr(bool value)
     {
         if (FreqCorrection > FreqCorrectionMin)
         {
-            FreqCorrection -= 1; //min freq step is ~ 61hz
+            FHSSsetFreqCorrection(FreqCorrection - 1); //min freq step is ~ 61hz
         }
         else
         {
-            FreqCorrection = FreqCorrectionMin;
-            FreqCorrection = 0; //reset because something went wrong
+            FHSSsetFreqCorrection(0); //reset because something went wrong
             DBGLN("Max -FreqCorrection reached!");
         }
     }
@@ -381,45 +438,28 @@ void ICACHE_RAM_ATTR updatePhaseLock()
 {
     if (connectionState != disconnected)
     {
-        PFDloop.calcResult();
+        const bool gotPacket = PFDloop.calcResult();
         PFDloop.reset();
         RawOffset = PFDloop.getResult();
-        Offset = LPF_Offset.update(RawOffset);
-        OffsetDx = LPF_OffsetDx.update(RawOffset - prevRawOffset);
 
-        if (RXtimerState == tim_locked && LQCalc.currentIsSet())
+        // Without a packet there is no phase error to go on, the loop just
+        // keeps correcting the frequency it has learnt
+        if (gotPacket)
         {
-            if (NonceRX % 8 == 0) //limit rate of freq offset adjustment slightly
-            {
-                if (Offset > 0)
-                {
-                    hwTimer.incFreqOffset();
-                }
-                else if (Offset < 0)
-                {
-                    hwTimer.decFreqOffset();
-                }
-            }
-        }
-
-        if (connectionState != connected)
-        {
-            hwTimer.phaseShift(RawOffset >> 1);
+            hwTimer.phaseShift(PLLloop.update(RawOffset, connectionState == connected));
         }
         else
         {
-            hwTimer.phaseShift(Offset >> 2);
+            hwTimer.phaseShift(PLLloop.coast());
         }
-
-        prevOffset = Offset;
-        prevRawOffset = RawOffset;
     }
 
-    DBGVLN("%d:%d:%d:%d:%d", Offset, RawOffset, OffsetDx, hwTimer.FreqOffset, uplinkLQ);
+    DBGVLN("%d:%d:%u:%d", RawOffset, PLLloop.getError(), PLLloop.getLockError(), uplinkLQ);
 }
 
 void ICACHE_RAM_ATTR HWtimerCallbackTick() // this is 180 out of phase with the other callback, occurs mid-packet reception
 {
+    ISR_TIMING_SCOPE(isrTimerTick);
     updatePhaseLock();
     NonceRX++;
 
@@ -433,7 +473,12 @@ void ICACHE_RAM_ATTR HWtimerCallbackTick() // this is 180 out of phase with the
     crsf.LinkStatistics.uplink_Link_quality = uplinkLQ;
     // Only advance the LQI period counter if we didn't send Telemetry this period
     if (!alreadyTLMresp)
+    {
+        if (connectionState == connected)
+            FHSSrecordPacket(LQperiodChannel, LQCalc.currentIsSet());
         LQCalc.inc();
+        LQperiodChannel = FHSSgetCurrChannel();
+    }
 
     alreadyTLMresp = false;
     alreadyFHSS = false;
@@ -507,6 +552,7 @@ static void ICACHE_RAM_ATTR updateDiversity()
 
 void ICACHE_RAM_ATTR HWtimerCallbackTock()
 {
+    ISR_TIMING_SCOPE(isrTimerTock);
     PFDloop.intEvent(micros()); // our internal osc just fired
 
     updateDiversity();
@@ -535,26 +581,23 @@ void ICACHE_RAM_ATTR HWtimerCallbackTock()
 
 void LostConnection()
 {
-    DBGLN("lost conn fc=%d fo=%d", FreqCorrection, hwTimer.FreqOffset);
+    DBGLN("lost conn fc=%d ppm=%d", FreqCorrection, PLLloop.getFreqPpm());
 
     RFmodeCycleMultiplier = 1;
     connectionStatePrev = connectionState;
     connectionState = disconnected; //set lost connection
     RXtimerState = tim_disconnected;
     hwTimer.resetFreqOffset();
-    FreqCorrection = 0;
+    FHSSsetFreqCorrection(0);
+    FHSSresetBlacklist();
+    BlacklistResync = false;
     #if !defined(Regulatory_Domain_ISM_2400)
     Radio.SetPPMoffsetReg(0);
     #endif
-    Offset = 0;
-    OffsetDx = 0;
     RawOffset = 0;
-    prevOffset = 0;
-    GotConnectionMillis = 0;
+    PLLloop.reset();
     uplinkLQ = 0;
     LQCalc.reset();
-    LPF_Offset.init(0);
-    LPF_OffsetDx.init(0);
     alreadyTLMresp = false;
     alreadyFHSS = false;
 
@@ -562,7 +605,7 @@ void LostConnection()
     {
         while(micros() - PFDloop.getIntEventTime() > 250); // time it just after the tock()
         hwTimer.stop();
-        SetRFLinkRate(ExpressLRS_nextAirRateIndex); // also sets to initialFreq
+        SetRFLinkRate(ExpressLRS_nextAirRateIndex, nextAirRateFullRes); // also sets to initialFreq
         Radio.RXnb();
     }
 }
@@ -575,10 +618,8 @@ void ICACHE_RAM_ATTR TentativeConnection(unsigned long now)
     connectionHasModelMatch = false;
     RXtimerState = tim_disconnected;
     DBGLN("tentative conn");
-    FreqCorrection = 0;
-    Offset = 0;
-    prevOffset = 0;
-    LPF_Offset.init(0);
+    FHSSsetFreqCorrection(0);
+    PLLloop.reset();
     RFmodeLastCycled = now; // give another 3 sec for lock to occur
 
     // The caller MUST call hwTimer.resume(). It is not done here because
@@ -599,7 +640,6 @@ void GotConnection(unsigned long now)
     connectionStatePrev = connectionState;
     connectionState = connected; //we got a packet, therefore no lost connection
     RXtimerState = tim_tentative;
-    GotConnectionMillis = now;
     #if defined(PLATFORM_ESP32) || defined(PLATFORM_ESP8266)
     webserverPreventAutoStart = true;
     #endif
@@ -629,16 +669,44 @@ static void ICACHE_RAM_ATTR ProcessRfPacket_RC()
     }
 }
 
-/**
- * Process the assembled MSP packet in MspData[]
- **/
-static void ICACHE_RAM_ATTR MspReceiveComplete()
+static void MspReceiveFrame(uint8_t *frame, uint16_t frameSize)
 {
-    if (MspData[7] == MSP_SET_RX_CONFIG && MspData[8] == MSP_ELRS_MODEL_ID)
+    // Only the start of an MSP v1 packet, not a frame carrying on a longer one
+    if (frameSize > 9 && frame[5] == (ENCAPSULATED_MSP_STATUS_VERSION_1 | ENCAPSULATED_MSP_STATUS_START) &&
+        frame[7] == MSP_SET_RX_CONFIG && frame[8] == MSP_ELRS_MODEL_ID)
     {
-        UpdateModelMatch(MspData[9]);
+        UpdateModelMatch(frame[9]);
     }
-    else if (MspData[0] == MSP_ELRS_SET_RX_WIFI_MODE)
+    // No MSP data to the FC if no model match
+    else if (connectionHasModelMatch)
+    {
+        crsf_ext_header_t *receivedHeader = (crsf_ext_header_t *) frame;
+        if ((receivedHeader->dest_addr == CRSF_ADDRESS_BROADCAST || receivedHeader->dest_addr == CRSF_ADDRESS_FLIGHT_CONTROLLER))
+        {
+            crsf.sendMSPFrameToFC(frame);
+        }
+
+        if ((receivedHeader->dest_addr == CRSF_ADDRESS_BROADCAST || receivedHeader->dest_addr == CRSF_ADDRESS_CRSF_RECEIVER))
+        {
+            if (frame[CRSF_TELEMETRY_TYPE_INDEX] == CRSF_FRAMETYPE_DEVICE_PING)
+            {
+                uint8_t deviceInformation[DEVICE_INFORMATION_LENGTH];
+                crsf.GetDeviceInformation(deviceInformation, 0);
+                crsf.SetExtendedHeaderAndCrc(deviceInformation, CRSF_FRAMETYPE_DEVICE_INFO, DEVICE_INFORMATION_FRAME_SIZE, CRSF_ADDRESS_CRSF_RECEIVER, CRSF_ADDRESS_CRSF_TRANSMITTER);
+                telemetry.AppendTelemetryPackage(deviceInformation);
+            }
+        }
+    }
+}
+
+/**
+ * Process the assembled MSP packet in MspData[], either an ELRS command
+ * or a batch of CRSF frames ended by a zero length or the end of the buffer.
+ * From the loop, since the frames are written out to the FC as they are.
+ **/
+static void MspReceiveComplete()
+{
+    if (MspData[0] == MSP_ELRS_SET_RX_WIFI_MODE)
     {
 #if defined(PLATFORM_ESP32) || defined(PLATFORM_ESP8266)
         connectionState = wifiUpdate;
@@ -646,25 +714,16 @@ static void ICACHE_RAM_ATTR MspReceiveComplete()
     }
     else
     {
-        // No MSP data to the FC if no model match
-        if (connectionHasModelMatch)
+        uint16_t offset = 0;
+        while (offset + CRSF_FRAME_NOT_COUNTED_BYTES <= ELRS_MSP_BUFFER && MspData[offset + CRSF_TELEMETRY_LENGTH_INDEX] != 0)
         {
-            crsf_ext_header_t *receivedHeader = (crsf_ext_header_t *) MspData;
-            if ((receivedHeader->dest_addr == CRSF_ADDRESS_BROADCAST || receivedHeader->dest_addr == CRSF_ADDRESS_FLIGHT_CONTROLLER))
-            {
-                crsf.sendMSPFrameToFC(MspData);
-            }
-
-            if ((receivedHeader->dest_addr == CRSF_ADDRESS_BROADCAST || receivedHeader->dest_addr == CRSF_ADDRESS_CRSF_RECEIVER))
+            const uint16_t frameSize = CRSF_FRAME_SIZE(MspData[offset + CRSF_TELEMETRY_LENGTH_INDEX]);
+            if (frameSize > ELRS_MSP_BUFFER - offset)
             {
-                if (MspData[CRSF_TELEMETRY_TYPE_INDEX] == CRSF_FRAMETYPE_DEVICE_PING)
-                {
-                    uint8_t deviceInformation[DEVICE_INFORMATION_LENGTH];
-                    crsf.GetDeviceInformation(deviceInformation, 0);
-                    crsf.SetExtendedHeaderAndCrc(deviceInformation, CRSF_FRAMETYPE_DEVICE_INFO, DEVICE_INFORMATION_FRAME_SIZE, CRSF_ADDRESS_CRSF_RECEIVER, CRSF_ADDRESS_CRSF_TRANSMITTER);
-                    telemetry.AppendTelemetryPackage(deviceInformation);
-                }
+                break;
             }
+            MspReceiveFrame(&MspData[offset], frameSize);
+            offset += frameSize;
         }
     }
 
@@ -686,22 +745,24 @@ static void ICACHE_RAM_ATTR ProcessRfPacket_MSP()
     if (connectionState != connected)
         return;
 
-    bool currentMspConfirmValue = MspReceiver.GetCurrentConfirm();
+    uint8_t currentMspAck = MspReceiver.GetCurrentAck();
     MspReceiver.ReceiveData(Radio.RXdataBuffer[1], Radio.RXdataBuffer + 2);
-    if (currentMspConfirmValue != MspReceiver.GetCurrentConfirm())
+    if (currentMspAck != MspReceiver.GetCurrentAck())
     {
         NextTelemetryType = ELRS_TELEMETRY_TYPE_LINK;
     }
-    if (MspReceiver.HasFinishedData())
-    {
-        MspReceiveComplete();
-    }
 }
 
 static bool ICACHE_RAM_ATTR ProcessRfPacket_SYNC(uint32_t now)
 {
-    // Verify the first two of three bytes of the binding ID, which should always match
-    if (Radio.RXdataBuffer[4] != UID[3] || Radio.RXdataBuffer[5] != UID[4])
+    // Verify the first two of three bytes of the binding ID, which should always match.
+    // The top bit of the second one is flipped for rate index 4 and up.
+    const uint8_t uidFlipped = Radio.RXdataBuffer[5] ^ UID[4];
+    if (Radio.RXdataBuffer[4] != UID[3] || (uidFlipped & 0b01111111) != 0)
+        return false;
+    // A flip to a rate that doesn't exist is a UID that doesn't match
+    const uint8_t rateIndex = ((Radio.RXdataBuffer[3] & 0b11000000) >> 6) | ((uidFlipped & 0b10000000) >> 5);
+    if (rateIndex >= RATE_MAX)
         return false;
 
     // The third byte will be XORed with inverse of the ModelId if ModelMatch is on
@@ -716,9 +777,12 @@ static bool ICACHE_RAM_ATTR ProcessRfPacket_SYNC(uint32_t now)
 #endif
 
     // Will change the packet air rate in loop() if this changes
-    ExpressLRS_nextAirRateIndex = (Radio.RXdataBuffer[3] & 0b11000000) >> 6;
-    // Update switch mode encoding immediately
-    OtaSetSwitchMode((OtaSwitchMode_e)((Radio.RXdataBuffer[3] & 0b00000110) >> 1));
+    ExpressLRS_nextAirRateIndex = rateIndex;
+    // Update switch mode encoding immediately, unless the packet length changes with it
+    OtaSwitchMode_e switchMode = (OtaSwitchMode_e)((Radio.RXdataBuffer[3] & 0b00000110) >> 1);
+    nextAirRateFullRes = switchMode == smFullRes;
+    if (nextAirRateFullRes == (OtaSwitchModeCurrent == smFullRes))
+        OtaSetSwitchMode(switchMode);
     // Update TLM ratio
     expresslrs_tlm_ratio_e TLMrateIn = (expresslrs_tlm_ratio_e)((Radio.RXdataBuffer[3] & 0b00111000) >> 3);
     if (ExpressLRS_currAirRate_Modparams->TLMinterval != TLMrateIn)
@@ -727,6 +791,11 @@ static bool ICACHE_RAM_ATTR ProcessRfPacket_SYNC(uint32_t now)
         ExpressLRS_currAirRate_Modparams->TLMinterval = TLMrateIn;
         telemBurstValid = false;
     }
+    // Follow the blacklist the TX is on or about to switch to
+    if (connectionState != disconnected && !FHSSfollowBlacklist(Radio.RXdataBuffer[3] & 0b1))
+    {
+        BlacklistResync = true;
+    }
 
     // modelId = 0xff indicates modelMatch is disabled, the XOR does nothing in that case
     uint8_t modelXor = (~config.GetModelId()) & MODELMATCH_MASK;
@@ -752,10 +821,12 @@ static bool ICACHE_RAM_ATTR ProcessRfPacket_SYNC(uint32_t now)
 
 void ICACHE_RAM_ATTR ProcessRFPacket()
 {
-    beginProcessing = micros();
+    ISR_TIMING_SCOPE(isrProcessRFPacket);
 
     uint8_t type = Radio.RXdataBuffer[0] & 0b11;
-    uint16_t inCRC = (((uint16_t)(Radio.RXdataBuffer[0] & 0b11111100)) << 6) | Radio.RXdataBuffer[7];
+    // The last byte of the payload holds the low bits of the CRC over everything before it
+    const uint8_t crcPos = ExpressLRS_currAirRate_Modparams->PayloadLength - 1;
+    uint16_t inCRC = (((uint16_t)(Radio.RXdataBuffer[0] & 0b11111100)) << 6) | Radio.RXdataBuffer[crcPos];
 
     // For smHybrid the CRC only has the packet type in byte 0
     // For smHybridWide the FHSS slot is added to the CRC in byte 0 on RC_DATA_PACKETs
@@ -768,12 +839,12 @@ void ICACHE_RAM_ATTR ProcessRFPacket()
         uint8_t NonceFHSSresult = NonceRX % ExpressLRS_currAirRate_Modparams->FHSShopInterval;
         Radio.RXdataBuffer[0] = type | (NonceFHSSresult << 2);
     }
-    uint16_t calculatedCRC = ota_crc.calc(Radio.RXdataBuffer, 7, CRCInitializer);
+    uint16_t calculatedCRC = ota_crc.calc(Radio.RXdataBuffer, crcPos, CRCInitializer);
 
     if (inCRC != calculatedCRC)
     {
         DBGV("CRC error: ");
-        for (int i = 0; i < 8; i++)
+        for (int i = 0; i <= crcPos; i++)
         {
             DBGV("%x,", Radio.RXdataBuffer[i]);
         }
@@ -781,9 +852,12 @@ void ICACHE_RAM_ATTR ProcessRFPacket()
         #if defined(DEBUG_RX_SCOREBOARD)
             lastPacketCrcError = true;
         #endif
+        if (connectionState == disconnected)
+            scanCrcError = true;
         return;
     }
-    PFDloop.extEvent(beginProcessing + PACKET_TO_TOCK_SLACK);
+    // Timed from the DIO edge, the ISR latency and the SPI reads since vary
+    PFDloop.extEvent(Radio.LastPacketIsrMicros + PACKET_TO_TOCK_SLACK);
 
     bool doStartTimer = false;
     unsigned long now = millis();
@@ -995,10 +1069,34 @@ static void setupRadio()
     Radio.RXdoneCallback = &RXdoneISR;
     Radio.TXdoneCallback = &TXdoneISR;
 
-    SetRFLinkRate(RATE_DEFAULT);
+    SetRFLinkRate(RATE_DEFAULT, false);
     RFmodeCycleMultiplier = 1;
 }
 
+static void updateBlacklist(uint32_t now)
+{
+    // Proposals go to the TX with the telemetry, one at a time
+    if (connectionState != connected || ExpressLRS_currAirRate_Modparams->TLMinterval == TLM_RATIO_NO_TLM
+        || FHSSblacklistPending() || (now - BlacklistLastChecked) < BLACKLIST_CHECK_INTERVAL)
+    {
+        return;
+    }
+    BlacklistLastChecked = now;
+
+    fhss_blacklist_t active;
+    fhss_blacklist_t list;
+    FHSSgetBlacklist(active);
+    FHSSpickBlacklist(list);
+    if (!BlacklistResync && list.count == active.count && memcmp(list.channels, active.channels, list.count) == 0)
+    {
+        return;
+    }
+    BlacklistResync = false;
+    list.epoch = !active.epoch;
+    FHSSprepareBlacklist(list);
+    DBGLN("Blacklist %u channels", list.count);
+}
+
 static void updateTelemetryBurst()
 {
     if (telemBurstValid)
@@ -1023,6 +1121,25 @@ static void updateTelemetryBurst()
     TelemetrySender.UpdateTelemetryRate(hz, ratiodiv, telemetryBurstMax);
 }
 
+/* The next smFullRes rate from index on that a TX would be heard on at the
+ * standard rate that had the CRC error, RATE_MAX for none
+ */
+static uint8_t nextFullResScanIndex(uint8_t index)
+{
+    const expresslrs_mod_settings_s *const heard = get_elrs_airRateConfig(scanCrcRateIndex);
+    for (; index < RATE_MAX; index++)
+    {
+        const expresslrs_mod_settings_s *const fullRes = get_elrs_airRateConfigFullRes(index);
+        if (fullRes->bw == heard->bw && fullRes->sf == heard->sf
+#if defined(Regulatory_Domain_ISM_2400)
+            && fullRes->packetType == heard->packetType
+#endif
+            )
+            break;
+    }
+    return index;
+}
+
 /* If not connected will rotate through the RF modes looking for sync
  * and blink LED
  */
@@ -1037,10 +1154,25 @@ static void cycleRfMode(unsigned long now)
         RFmodeLastCycled = now;
         LastSyncPacket = now;           // reset this variable
         SendLinkStatstoFCForcedSends = 2;
-        SetRFLinkRate(scanIndex % RATE_MAX); // switch between rates
+        if (scanCrcError && OtaSwitchModeCurrent != smFullRes)
+        {
+            scanCrcRateIndex = ExpressLRS_currAirRate_Modparams->index;
+            scanFullResIndex = 0;
+        }
+        scanCrcError = false;
+        if (scanFullResIndex < RATE_MAX)
+            scanFullResIndex = nextFullResScanIndex(scanFullResIndex);
+        if (scanFullResIndex < RATE_MAX)
+        {
+            SetRFLinkRate(scanFullResIndex++, true);
+        }
+        else
+        {
+            SetRFLinkRate(scanIndex % RATE_MAX, (scanIndex % RF_MODE_SCAN_COUNT) >= RATE_MAX); // switch between rates
+            scanIndex++;
+        }
         LQCalc.reset();
         // Display the current air rate to the user as an indicator something is happening
-        scanIndex++;
         Radio.RXnb();
         INFOLN("%u", ExpressLRS_currAirRate_Modparams->interval);
 
@@ -1178,6 +1310,7 @@ void setup()
     setupSerial();
     // Init EEPROM and load config, checking powerup count
     setupConfigAndPocCheck();
+    ISR_TIMING_INIT();
 
     INFOLN("ExpressLRS Module Booting...");
 
@@ -1217,6 +1350,8 @@ void loop()
     }
 
     devicesUpdate(now);
+    ISR_TIMING_UPDATE(now);
+    DBGDRAIN();
 
     #if defined(PLATFORM_ESP8266)
     // If the reboot time is set and the current time is past the reboot time then reboot.
@@ -1230,7 +1365,8 @@ void loop()
         return;
     }
 
-    if ((connectionState != disconnected) && (ExpressLRS_currAirRate_Modparams->index != ExpressLRS_nextAirRateIndex)){ // forced change
+    if ((connectionState != disconnected) && (ExpressLRS_currAirRate_Modparams->index != ExpressLRS_nextAirRateIndex
+        || (OtaSwitchModeCurrent == smFullRes) != nextAirRateFullRes)){ // forced change
         DBGLN("Req air rate change %u->%u", ExpressLRS_currAirRate_Modparams->index, ExpressLRS_nextAirRateIndex);
         LostConnection();
         LastSyncPacket = now;           // reset this variable to stop rf mode switching and add extra time
@@ -1257,26 +1393,47 @@ void loop()
         LostConnection();
     }
 
-    if ((connectionState == tentative) && (abs(OffsetDx) <= 10) && (Offset < 100) && (LQCalc.getLQRaw() > minLqForChaos())) //detects when we are connected
+    if ((connectionState == tentative) && (PLLloop.getLockError() <= PLL_ACQUIRE_ERROR_US) && (LQCalc.getLQRaw() > minLqForChaos())) //detects when we are connected
     {
         GotConnection(now);
     }
 
     checkSendLinkStatsToFc(now);
 
-    if ((RXtimerState == tim_tentative) && ((now - GotConnectionMillis) > ConsiderConnGoodMillis) && (abs(OffsetDx) <= 5))
+    if ((RXtimerState == tim_tentative) && PLLloop.isLocked())
     {
         RXtimerState = tim_locked;
         DBGLN("Timer locked");
     }
 
-    uint8_t *nextPayload = 0;
-    uint8_t nextPlayloadSize = 0;
-    if (!TelemetrySender.IsActive() && telemetry.GetNextPayload(&nextPlayloadSize, &nextPayload))
+    if (!TelemetrySender.IsActive())
     {
-        TelemetrySender.SetDataToTransmit(nextPlayloadSize, nextPayload, ELRS_TELEMETRY_BYTES_PER_CALL);
+        // The TX may not have all of the last message, start every type again from a keyframe
+        if (TelemetrySender.LastMessageAbandoned())
+        {
+            TelemetryCompressor.ResetState();
+        }
+        uint8_t *nextPayload = 0;
+        uint8_t nextPlayloadSize = 0;
+        uint8_t messageLength = 1;
+        TelemetryMessage[0] = 0;
+        while (telemetry.GetNextPayload(&nextPlayloadSize, &nextPayload, sizeof(TelemetryMessage) - messageLength))
+        {
+            messageLength += TelemetryCompressor.Encode(nextPayload, &TelemetryMessage[messageLength]);
+            TelemetryMessage[0]++;
+        }
+        if (TelemetryMessage[0] > 0)
+        {
+            TelemetrySender.SetDataToTransmit(messageLength, TelemetryMessage, ELRS_TELEMETRY_BYTES_PER_CALL);
+        }
+    }
+    // The receiver holds the message until it is unlocked
+    if (MspReceiver.HasFinishedData())
+    {
+        MspReceiveComplete();
     }
     updateTelemetryBurst();
+    updateBlacklist(now);
     updateBindingMode();
 }
 
@@ -1336,13 +1493,13 @@ void EnterBindingMode()
 
     // Start attempting to bind
     // Lock the RF rate and freq while binding
-    SetRFLinkRate(RATE_BINDING);
+    SetRFLinkRate(RATE_BINDING, false);
     Radio.SetFrequencyReg(GetInitialFreq());
     // If the Radio Params (including InvertIQ) parameter changed, need to restart RX to take effect
     Radio.RXnb();
 
     DBGLN("Entered binding mode at freq = %d", Radio.currFreq);
-    devicesTriggerEvent();
+    devicesTriggerEvent(EVENT_CONFIG_CHANGED);
 }
 
 void ExitBindingMode()
@@ -1368,14 +1525,15 @@ void ExitBindingMode()
     #endif
 
     // Force RF cycling to start at the beginning immediately
-    scanIndex = RATE_MAX;
+    scanIndex = RF_MODE_SCAN_COUNT;
+    scanFullResIndex = RATE_MAX;
     RFmodeLastCycled = 0;
 
     // Do this last as LostConnection() will wait for a tock that never comes
     // if we're in binding mode
     InBindingMode = false;
     DBGLN("Exiting binding mode");
-    devicesTriggerEvent();
+    devicesTriggerEvent(EVENT_CONFIG_CHANGED);
 }
 
 void ICACHE_RAM_ATTR OnELRSBindMSP(uint8_t* packet)
@@ -19,10 +19,12 @@ SX1280Driver Radio;
 #include <OTA.h>
 #include "config.h"
 #include "hwTimer.h"
+#include "ISRTIMING.h"
 #include "LQCALC.h"
 #include "telemetry_protocol.h"
 #include "stubborn_receiver.h"
 #include "stubborn_sender.h"
+#include "telemetry_delta.h"
 
 #include "helpers.h"
 #include "devCRSF.h"
@@ -48,7 +50,7 @@ SX1280Driver Radio;
 
 /// define some libs to use ///
 hwTimer hwTimer;
-GENERIC_CRC14 ota_crc(ELRS_CRC14_POLY);
+GENERIC_CRC14<ELRS_CRC14_POLY> ota_crc;
 CRSF crsf;
 POWERMGNT POWERMGNT;
 MSP msp;
@@ -81,6 +83,9 @@ LQCALC<10> LQCalc;
 
 volatile bool busyTransmitting;
 static volatile bool ModelUpdatePending;
+// Channel blacklist proposed by the RX, prepared in loop() as building the map takes a while
+static fhss_blacklist_t BlacklistProposal;
+static volatile bool BlacklistProposalReceived;
 volatile bool connectionHasModelMatch = true;
 
 bool InBindingMode = false;
@@ -90,8 +95,10 @@ bool RxWiFiReadyToSend = false;
 
 static TxTlmRcvPhase_e TelemetryRcvPhase = ttrpTransmitting;
 StubbornReceiver TelemetryReceiver(ELRS_TELEMETRY_MAX_PACKAGES);
-StubbornSender MspSender(ELRS_MSP_MAX_PACKAGES);
+TelemetryDelta TelemetryDecompressor;
+StubbornSender MspSender(ELRS_MSP_MAX_PACKAGES, ELRS_MSP_WINDOW, ELRS_MSP_FEC_GROUP);
 uint8_t CRSFinBuffer[CRSF_MAX_PACKET_LEN+1];
+static uint8_t TelemetryFrame[CRSF_MAX_PACKET_LEN];
 
 device_affinity_t ui_devices[] = {
   {&CRSF_device, 0},
@@ -253,10 +260,12 @@ void DynamicPower_Update()
 
 void ICACHE_RAM_ATTR ProcessTLMpacket()
 {
-  uint16_t inCRC = (((uint16_t)Radio.RXdataBuffer[0] & 0b11111100) << 6) | Radio.RXdataBuffer[7];
+  // The last byte of the payload holds the low bits of the CRC over everything before it
+  const uint8_t crcPos = ExpressLRS_currAirRate_Modparams->PayloadLength - 1;
+  uint16_t inCRC = (((uint16_t)Radio.RXdataBuffer[0] & 0b11111100) << 6) | Radio.RXdataBuffer[crcPos];
 
   Radio.RXdataBuffer[0] &= 0b11;
-  uint16_t calculatedCRC = ota_crc.calc(Radio.RXdataBuffer, 7, CRCInitializer);
+  uint16_t calculatedCRC = ota_crc.calc(Radio.RXdataBuffer, crcPos, CRCInitializer);
 
   uint8_t type = Radio.RXdataBuffer[0] & TLM_PACKET;
   uint8_t TLMheader = Radio.RXdataBuffer[1];
@@ -293,7 +302,7 @@ void ICACHE_RAM_ATTR ProcessTLMpacket()
             // -- uplink_TX_Power is updated when sending to the handset, so it updates when missing telemetry
             // -- rf_mode is updated when we change rates
             // -- downlink_Link_quality is updated before the LQ period is incremented
-            MspSender.ConfirmCurrentPayload(Radio.RXdataBuffer[6] == 1);
+            MspSender.ConfirmCurrentPayload(Radio.RXdataBuffer[6]);
 
             dynamic_power_updated = true;
             break;
@@ -301,6 +310,18 @@ void ICACHE_RAM_ATTR ProcessTLMpacket()
         case ELRS_TELEMETRY_TYPE_DATA:
             TelemetryReceiver.ReceiveData(TLMheader >> ELRS_TELEMETRY_SHIFT, Radio.RXdataBuffer + 2);
             break;
+
+        case ELRS_TELEMETRY_TYPE_FHSS:
+            if (!BlacklistProposalReceived)
+            {
+                const uint8_t count = TLMheader >> (ELRS_TELEMETRY_SHIFT + 1);
+                BlacklistProposal.epoch = (TLMheader >> ELRS_TELEMETRY_SHIFT) & 0b1;
+                BlacklistProposal.count = count < FHSS_BLACKLIST_MAX ? count : FHSS_BLACKLIST_MAX;
+                memcpy(BlacklistProposal.channels, (const uint8_t *)Radio.RXdataBuffer + 2, FHSS_BLACKLIST_MAX);
+                BlacklistProposalReceived = true;
+            }
+            MspSender.ConfirmCurrentPayload(Radio.RXdataBuffer[6]);
+            break;
     }
 }
 
@@ -310,11 +331,11 @@ void ICACHE_RAM_ATTR GenerateSyncPacketData()
   uint8_t Index;
   if (syncSpamCounter)
   {
-    Index = (config.GetRate() & 0b11);
+    Index = (config.GetRate() & 0b111);
   }
   else
   {
-    Index = (ExpressLRS_currAirRate_Modparams->index & 0b11);
+    Index = (ExpressLRS_currAirRate_Modparams->index & 0b111);
   }
 
   if (syncSpamCounter)
@@ -331,9 +352,11 @@ void ICACHE_RAM_ATTR GenerateSyncPacketData()
   Radio.TXdataBuffer[0] = SYNC_PACKET & 0b11;
   Radio.TXdataBuffer[1] = FHSSgetCurrIndex();
   Radio.TXdataBuffer[2] = NonceTX;
-  Radio.TXdataBuffer[3] = (Index << 6) + (newRatio << 3) + (SwitchEncMode << 1);
+  Radio.TXdataBuffer[3] = ((Index & 0b11) << 6) + (newRatio << 3) + (SwitchEncMode << 1) + FHSSannounceBlacklist();
   Radio.TXdataBuffer[4] = UID[3];
-  Radio.TXdataBuffer[5] = UID[4];
+  // The top bit of the second UID byte is flipped for rate index 4 and up, so
+  // RXs from before there were more than 4 rates still match it for the others
+  Radio.TXdataBuffer[5] = UID[4] ^ ((Index & 0b100) << 5);
   Radio.TXdataBuffer[6] = UID[5];
   // For model match, the last byte of the binding ID is XORed with the inverse of the modelId
   if (!InBindingMode && config.GetModelMatch())
@@ -346,14 +369,9 @@ uint8_t adjustPacketRateForBaud(uint8_t rate)
 {
   #if defined(Regulatory_Domain_ISM_2400)
     // Packet rate limited to 250Hz if we are on 115k baud
-    if (crsf.GetCurrentBaudRate() == 115200) {
-      while(rate < RATE_MAX) {
-        expresslrs_mod_settings_s *const ModParams = get_elrs_airRateConfig(rate);
-        if (ModParams->enum_rate >= RATE_250HZ) {
-          break;
-        }
-        rate++;
-      }
+    // The rates are not in speed order, FLRC is last
+    if (crsf.GetCurrentBaudRate() == 115200 && get_elrs_airRateConfig(rate)->enum_rate < RATE_250HZ) {
+      rate = enumRatetoIndex(RATE_250HZ);
     }
   #endif
   return rate;
@@ -362,8 +380,10 @@ uint8_t adjustPacketRateForBaud(uint8_t rate)
 void ICACHE_RAM_ATTR SetRFLinkRate(uint8_t index) // Set speed of RF link (hz)
 {
   index = adjustPacketRateForBaud(index);
-  expresslrs_mod_settings_s *const ModParams = get_elrs_airRateConfig(index);
-  expresslrs_rf_pref_params_s *const RFperf = get_elrs_RFperfParams(index);
+  // smFullRes packets are longer and have their own air rates, binding always uses the standard ones
+  const bool fullRes = !InBindingMode && config.GetSwitchMode() == smFullRes;
+  expresslrs_mod_settings_s *const ModParams = fullRes ? get_elrs_airRateConfigFullRes(index) : get_elrs_airRateConfig(index);
+  expresslrs_rf_pref_params_s *const RFperf = fullRes ? get_elrs_RFperfParamsFullRes(index) : get_elrs_RFperfParams(index);
   bool invertIQ = UID[5] & 0x01;
   if ((ModParams == ExpressLRS_currAirRate_Modparams)
     && (RFperf == ExpressLRS_currAirRate_RFperfParams)
@@ -372,7 +392,16 @@ void ICACHE_RAM_ATTR SetRFLinkRate(uint8_t index) // Set speed of RF link (hz)
 
   DBGLN("set rate %u", index);
   hwTimer.updateInterval(ModParams->interval);
-  Radio.Config(ModParams->bw, ModParams->sf, ModParams->cr, GetInitialFreq(), ModParams->PreambleLen, invertIQ, ModParams->PayloadLength, ModParams->interval);
+  Radio.Config(ModParams->bw, ModParams->sf, ModParams->cr, GetInitialFreq(), ModParams->PreambleLen, invertIQ, ModParams->PayloadLength, ModParams->interval
+#if defined(Regulatory_Domain_ISM_2400)
+               , ModParams->packetType, uidMacSeedGet()
+#endif
+               );
+  // The packer has to match the packet length
+  if (fullRes)
+    OtaSetSwitchMode(smFullRes);
+  else if (OtaSwitchModeCurrent == smFullRes)
+    OtaSetSwitchMode(smHybrid);
 
   ExpressLRS_currAirRate_Modparams = ModParams;
   ExpressLRS_currAirRate_RFperfParams = RFperf;
@@ -380,6 +409,7 @@ void ICACHE_RAM_ATTR SetRFLinkRate(uint8_t index) // Set speed of RF link (hz)
 
   crsf.setSyncParams(ModParams->interval);
   connectionState = disconnected;
+  FHSSresetBlacklist();
   rfModeLastChangedMS = millis();
 }
 
@@ -389,7 +419,8 @@ void ICACHE_RAM_ATTR HandleFHSS()
   // If the next packet should be on the next FHSS frequency, do the hop
   if (!InBindingMode && modresult == 0)
   {
-    Radio.SetFrequencyReg(FHSSgetNextFreq());
+    const fhss_channel_t &channel = FHSSgetNextChannel();
+    Radio.SetFrequencyCmd(channel.freq, channel.cmd);
   }
 }
 
@@ -406,6 +437,7 @@ void ICACHE_RAM_ATTR HandlePrepareForTLM()
 
 void ICACHE_RAM_ATTR SendRCdataToRF()
 {
+  ISR_TIMING_SCOPE(isrSendRCdata);
   uint32_t now = millis();
   static uint8_t syncSlot;
 #if defined(NO_SYNC_ON_ARM)
@@ -415,6 +447,9 @@ void ICACHE_RAM_ATTR SendRCdataToRF()
   uint32_t SyncInterval = (connectionState == connected) ? ExpressLRS_currAirRate_RFperfParams->SyncPktIntervalConnected : ExpressLRS_currAirRate_RFperfParams->SyncPktIntervalDisconnected;
   bool skipSync = InBindingMode;
 #endif
+  // Announce a new blacklist on every visit to the sync channel until it takes over
+  if (FHSSblacklistPending())
+    SyncInterval = ExpressLRS_currAirRate_Modparams->FHSShopInterval * ExpressLRS_currAirRate_Modparams->interval / 1000;
 
   uint8_t NonceFHSSresult = NonceTX % ExpressLRS_currAirRate_Modparams->FHSShopInterval;
   bool WithinSyncSpamResidualWindow = now - rfModeLastChangedMS < syncSpamAResidualTimeMS;
@@ -442,11 +477,12 @@ void ICACHE_RAM_ATTR SendRCdataToRF()
       MspSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
       Radio.TXdataBuffer[0] = MSP_DATA_PACKET & 0b11;
       Radio.TXdataBuffer[1] = packageIndex;
+      // Zeros past the end, the RX takes the first zero frame length as the end of a batch
       Radio.TXdataBuffer[2] = maxLength > 0 ? *data : 0;
-      Radio.TXdataBuffer[3] = maxLength >= 1 ? *(data + 1) : 0;
-      Radio.TXdataBuffer[4] = maxLength >= 2 ? *(data + 2) : 0;
-      Radio.TXdataBuffer[5] = maxLength >= 3 ? *(data + 3): 0;
-      Radio.TXdataBuffer[6] = maxLength >= 4 ? *(data + 4): 0;
+      Radio.TXdataBuffer[3] = maxLength > 1 ? *(data + 1) : 0;
+      Radio.TXdataBuffer[4] = maxLength > 2 ? *(data + 2) : 0;
+      Radio.TXdataBuffer[5] = maxLength > 3 ? *(data + 3): 0;
+      Radio.TXdataBuffer[6] = maxLength > 4 ? *(data + 4): 0;
       // send channel data next so the channel messages also get sent during msp transmissions
       NextPacketIsMspData = false;
       // counter can be increased even for normal msp messages since it's reset if a real bind message should be sent
@@ -470,9 +506,10 @@ void ICACHE_RAM_ATTR SendRCdataToRF()
     Radio.TXdataBuffer[0] |= NonceFHSSresult << 2;
 
   ///// Next, Calculate the CRC and put it into the buffer /////
-  uint16_t crc = ota_crc.calc(Radio.TXdataBuffer, 7, CRCInitializer);
+  const uint8_t crcPos = ExpressLRS_currAirRate_Modparams->PayloadLength - 1;
+  uint16_t crc = ota_crc.calc(Radio.TXdataBuffer, crcPos, CRCInitializer);
   Radio.TXdataBuffer[0] = (Radio.TXdataBuffer[0] & 0b11) | ((crc >> 6) & 0b11111100);
-  Radio.TXdataBuffer[7] = crc & 0xFF;
+  Radio.TXdataBuffer[crcPos] = crc & 0xFF;
 
   Radio.TXnb();
 }
@@ -482,6 +519,8 @@ void ICACHE_RAM_ATTR SendRCdataToRF()
  */
 void ICACHE_RAM_ATTR timerCallbackNormal()
 {
+  ISR_TIMING_SCOPE(isrTxTimerTock);
+
   #ifdef FEATURE_OPENTX_SYNC
   // Sync OpenTX to this point
   crsf.JustSentRFpacket();
@@ -513,7 +552,7 @@ void ICACHE_RAM_ATTR timerCallbackNormal()
 }
 
 /*
- * Called as the timer ISR while waiting for eeprom flush
+ * Called as the timer ISR while the radio params change or the eeprom flushes
  */
 void ICACHE_RAM_ATTR timerCallbackIdle()
 {
@@ -567,13 +606,12 @@ void ICACHE_RAM_ATTR ModelUpdateReq()
 
 static void ConfigChangeCommit()
 {
-  // Write the uncommitted eeprom values (may block for a while)
+  // Stage the uncommitted eeprom values, CommitConfigSlice() writes them out
   config.Commit();
-  // Change params after the blocking finishes as a rate change will change the radio freq
   ChangeRadioParams();
   // Resume the timer, will take one hop for the radio to be on the right frequency if we missed a hop
   hwTimer.callbackTock = &timerCallbackNormal;
-  devicesTriggerEvent();
+  devicesTriggerEvent(EVENT_CONFIG_CHANGED);
 }
 
 
@@ -585,13 +623,36 @@ static void CheckConfigChangePending()
     if (syncSpamCounter > 0)
       return;
 
-#if !defined(PLATFORM_STM32) || defined(TARGET_USE_EEPROM)
     while (busyTransmitting); // wait until no longer transmitting
-#else
-    // The code expects to enter here shortly after the tock ISR has started sending the last
-    // sync packet, before the tick ISR. Because the EEPROM write takes so long and disables
-    // interrupts, FastForward the timer
-    const uint32_t EEPROM_WRITE_DURATION = 30000; // us, a page write on F103C8 takes ~29.3ms
+    hwTimer.callbackTock = &timerCallbackIdle;
+    // If telemetry expected in the next interval, the radio is in RX mode
+    // and will skip sending the next packet when the tiemr resumes.
+    // Return to normal send mode because if the skipped packet happened
+    // to be on the last slot of the FHSS the skip will prevent FHSS
+    if (TelemetryRcvPhase == ttrpInReceiveMode)
+    {
+      TelemetryRcvPhase = ttrpTransmitting;
+    }
+    ConfigChangeCommit();
+  }
+}
+
+/*
+ * Write the staged config a slice at a time, after the packet of this
+ * interval has gone out so writing it never holds up the radio
+ */
+static void CommitConfigSlice()
+{
+  if (!config.IsCommitPending() || busyTransmitting)
+    return;
+
+#if (defined(PLATFORM_STM32) || defined(TARGET_NATIVE)) && !defined(TARGET_USE_EEPROM)
+  // Erasing the flash stops the CPU, when the last slice has to compact
+  // the flash log it is done with the timer paused over it
+  if (config.IsLastCommitSlice() && eeprom.CommitWillErase() && hwTimer.running)
+  {
+    hwTimer.callbackTock = &timerCallbackIdle;
+    const uint32_t EEPROM_WRITE_DURATION = 65000; // us, erasing the 2KB bank and writing the log back on F103C8 takes ~60ms
     const uint32_t cycleInterval = ExpressLRS_currAirRate_Modparams->interval;
     // Total time needs to be at least DURATION, rounded up to next cycle
     // adding one cycle that will be eaten by busywaiting for the transmit to end
@@ -604,18 +665,16 @@ static void CheckConfigChangePending()
     --pauseCycles; // the last cycle will actually be a transmit
     while (pauseCycles--)
       timerCallbackIdle();
-#endif
-    hwTimer.callbackTock = &timerCallbackIdle;
-    // If telemetry expected in the next interval, the radio is in RX mode
-    // and will skip sending the next packet when the tiemr resumes.
-    // Return to normal send mode because if the skipped packet happened
-    // to be on the last slot of the FHSS the skip will prevent FHSS
     if (TelemetryRcvPhase == ttrpInReceiveMode)
     {
       TelemetryRcvPhase = ttrpTransmitting;
     }
-    ConfigChangeCommit();
+    config.CommitSlice();
+    hwTimer.callbackTock = &timerCallbackNormal;
+    return;
   }
+#endif
+  config.CommitSlice();
 }
 
 void ICACHE_RAM_ATTR RXdoneISR()
@@ -652,12 +711,31 @@ static void UpdateConnectDisconnectStatus()
   }
   else
   {
+    // The RX forgets its blacklist when it loses the connection
+    if (connectionState == connected)
+      FHSSresetBlacklist();
     connectionState = disconnected;
     connectionHasModelMatch = true;
     crsf.ForwardDevicePings = false;
   }
 }
 
+static void CheckBlacklistProposal()
+{
+  if (!BlacklistProposalReceived)
+    return;
+
+  fhss_blacklist_t active;
+  FHSSgetBlacklist(active);
+  // Once prepared the RX sticks to a proposal until it has been announced
+  if (connectionState == connected && BlacklistProposal.epoch != active.epoch && !FHSSblacklistPending())
+  {
+    DBGLN("Blacklist %u channels", BlacklistProposal.count);
+    FHSSprepareBlacklist(BlacklistProposal);
+  }
+  BlacklistProposalReceived = false;
+}
+
 void SetSyncSpam()
 {
   // Send sync spam if a UI device has requested to and the config has changed
@@ -946,6 +1024,7 @@ static void setupTarget()
 void setup()
 {
   setupTarget();
+  ISR_TIMING_INIT();
   // Register the devices with the framework
   devicesRegister(ui_devices, ARRAY_SIZE(ui_devices));
   // Initialise the devices
@@ -1010,10 +1089,19 @@ void loop()
   if (connectionState < MODE_STATES)
   {
     UpdateConnectDisconnectStatus();
+    CheckBlacklistProposal();
   }
 
   // Update UI devices
+  static bool lastArmed = false;
+  if (IsArmed() != lastArmed)
+  {
+    lastArmed = !lastArmed;
+    devicesTriggerEvent(EVENT_ARM_CHANGED);
+  }
   devicesUpdate(now);
+  ISR_TIMING_UPDATE(now);
+  DBGDRAIN();
 
   #if defined(PLATFORM_ESP8266) || defined(PLATFORM_ESP32)
     // If the reboot time is set and the current time is past the reboot time then reboot.
@@ -1022,6 +1110,8 @@ void loop()
     }
   #endif
 
+  CommitConfigSlice();
+
   if (connectionState > MODE_STATES)
   {
     return;
@@ -1052,7 +1142,21 @@ void loop()
 
   if (TelemetryReceiver.HasFinishedData())
   {
-      crsf.sendTelemetryToTX(CRSFinBuffer);
+      // The count of frames in it, then the frames as TelemetryDelta messages
+      uint8_t offset = 1;
+      for (uint8_t i = 0; i < CRSFinBuffer[0] && offset < sizeof(CRSFinBuffer); i++)
+      {
+          uint8_t used;
+          if (TelemetryDecompressor.Decode(&CRSFinBuffer[offset], sizeof(CRSFinBuffer) - offset, &used, TelemetryFrame))
+          {
+              crsf.sendTelemetryToTX(TelemetryFrame);
+          }
+          if (used == 0)
+          {
+              break;
+          }
+          offset += used;
+      }
       TelemetryReceiver.Unlock();
   }
 
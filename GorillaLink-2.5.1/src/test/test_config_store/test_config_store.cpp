@@ -0,0 +1,364 @@
+#include <cstdint>
+#include <string.h>
+#include <unity.h>
+#include "ConfigStore.h"
+
+#define STORAGE_SIZE 1024
+
+/**
+ * EEPROM that loses power after a number of writes. Written bytes are
+ * durable at once like an I2C EEPROM, or only once committed like the flash
+ * emulations. Their Commit() erases every erase unit that changed and then
+ * programs it a byte at a time, each erase and byte counting as a write, so
+ * the power can go with a unit erased.
+ **/
+class TestStorage
+{
+public:
+    uint8_t durable[STORAGE_SIZE];
+    uint8_t buffer[STORAGE_SIZE];
+    uint32_t eraseUnit;     // 0 for bytes that are durable once written
+    uint32_t writesLeft;
+    bool off;
+    uint32_t writes;        // WriteByte()s
+    uint32_t programs;      // erases and bytes programmed by Commit()
+    uint32_t commits;
+
+    void begin(uint32_t unit, uint8_t fill)
+    {
+        memset(durable, fill, sizeof(durable));
+        memset(buffer, fill, sizeof(buffer));
+        eraseUnit = unit;
+        writesLeft = UINT32_MAX;
+        off = false;
+        writes = 0;
+        programs = 0;
+        commits = 0;
+    }
+
+    // Back on, with only what made it to the EEPROM
+    void powerCycle()
+    {
+        memcpy(buffer, durable, sizeof(buffer));
+        writesLeft = UINT32_MAX;
+        off = false;
+    }
+
+    uint8_t ReadByte(const uint32_t address) { return buffer[address]; }
+
+    void WriteByte(const uint32_t address, const uint8_t value)
+    {
+        if (!powered())
+            return;
+        ++writes;
+        buffer[address] = value;
+        if (!eraseUnit)
+            durable[address] = value;
+    }
+
+    void Commit()
+    {
+        if (off)
+            return;
+        ++commits;
+        for (uint32_t unit = 0; eraseUnit && unit < STORAGE_SIZE; unit += eraseUnit)
+        {
+            if (memcmp(&durable[unit], &buffer[unit], eraseUnit) == 0)
+                continue;
+            if (!powered())
+                return;
+            ++programs;
+            memset(&durable[unit], 0xFF, eraseUnit);
+            for (uint32_t i = unit; i < unit + eraseUnit; ++i)
+            {
+                if (!powered())
+                    return;
+                ++programs;
+                durable[i] = buffer[i];
+            }
+        }
+    }
+
+private:
+    // Takes one of the writes left, false once the power is gone
+    bool powered()
+    {
+        off = off || writesLeft == 0;
+        if (!off)
+            --writesLeft;
+        return !off;
+    }
+};
+
+typedef StagedConfigStore<TestStorage, STORAGE_SIZE / 2> TestStore;
+typedef ConfigStore<TestStorage, STORAGE_SIZE / 2> TestUnstagedStore;
+
+typedef struct {
+    uint32_t version;
+    char name[33];
+    uint8_t values[200];
+} test_config_t;
+
+static TestStorage storage;
+
+static void makeConfig(test_config_t &config, uint8_t seed)
+{
+    config.version = 0x1000 + seed;
+    snprintf(config.name, sizeof(config.name), "config %u", seed);
+    for (uint8_t i = 0; i < sizeof(config.values); ++i)
+        config.values[i] = seed * 31 + i;
+}
+
+static void commit(TestStore &store, const test_config_t &config)
+{
+    store.Stage(&config, sizeof(config));
+    store.Flush();
+}
+
+// What a freshly booted store finds, false if nothing
+static bool load(test_config_t &config)
+{
+    TestStore store;
+    store.SetStorageProvider(&storage);
+    return store.Load(&config, sizeof(config));
+}
+
+void test_config_store_round_trip(void)
+{
+    storage.begin(0, 0xFF);
+    TestStore store;
+    store.SetStorageProvider(&storage);
+    test_config_t config, loaded;
+    TEST_ASSERT_FALSE(store.Load(&loaded, sizeof(loaded)));
+
+    for (uint8_t seed = 1; seed <= 5; ++seed)
+    {
+        makeConfig(config, seed);
+        commit(store, config);
+        TEST_ASSERT_TRUE(load(loaded));
+        TEST_ASSERT_EQUAL_MEMORY(&config, &loaded, sizeof(config));
+    }
+
+    // A different length is someone else's config
+    uint8_t other[sizeof(config) - 1];
+    TEST_ASSERT_FALSE(store.Load(other, sizeof(other)));
+    // and more than a slot holds is never staged
+    static uint8_t huge[TestStore::maxLength + 1];
+    TEST_ASSERT_FALSE(store.Stage(huge, sizeof(huge)));
+    TEST_ASSERT_FALSE(store.IsPending());
+}
+
+void test_config_store_write(void)
+{
+    // TEST CASE:
+    // GIVEN a ConfigStore without the shadow buffer, as on the RX
+    // WHEN the config is written with Write()
+    // THEN all of it is written straight from the config before it returns
+    // AND a config bigger than a slot is refused
+
+    storage.begin(STORAGE_SIZE / 2, 0xFF);
+    TestUnstagedStore store;
+    store.SetStorageProvider(&storage);
+    TEST_ASSERT_TRUE(sizeof(store) + TestStore::maxLength <= sizeof(TestStore));
+
+    test_config_t config, loaded;
+    for (uint8_t seed = 1; seed <= 3; ++seed)
+    {
+        makeConfig(config, seed);
+        TEST_ASSERT_TRUE(store.Write(&config, sizeof(config)));
+        TEST_ASSERT_FALSE(store.IsPending());
+        TEST_ASSERT_EQUAL(seed, storage.commits);
+        TEST_ASSERT_TRUE(load(loaded));
+        TEST_ASSERT_EQUAL_MEMORY(&config, &loaded, sizeof(config));
+    }
+
+    static uint8_t huge[TestUnstagedStore::maxLength + 1];
+    TEST_ASSERT_FALSE(store.Write(huge, sizeof(huge)));
+    TEST_ASSERT_EQUAL(3, storage.commits);
+    TEST_ASSERT_TRUE(load(loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&config, &loaded, sizeof(config));
+}
+
+void test_config_store_slices(void)
+{
+    storage.begin(STORAGE_SIZE / 2, 0xFF);
+    TestStore store;
+    store.SetStorageProvider(&storage);
+    test_config_t config;
+    makeConfig(config, 1);
+    store.Stage(&config, sizeof(config));
+
+    // A slice of bytes per poll, then the footer and the one page program
+    uint16_t polls = 0;
+    while (store.IsPending())
+    {
+        const bool last = store.IsLastSlice();
+        const uint32_t writes = storage.writes;
+        const bool more = store.Poll();
+        ++polls;
+        TEST_ASSERT_EQUAL(!last, more);
+        TEST_ASSERT_TRUE(storage.writes - writes <= CONFIG_STORE_SLICE_SIZE);
+        TEST_ASSERT_EQUAL(last ? 1 : 0, storage.commits);
+    }
+    TEST_ASSERT_EQUAL((sizeof(config) + CONFIG_STORE_SLICE_SIZE - 1) / CONFIG_STORE_SLICE_SIZE + 2, polls);
+    TEST_ASSERT_FALSE(store.Poll());
+}
+
+// Both slots hold a copy of the old config, as after a few commits
+static void commitTwice(TestStore &store, uint32_t eraseUnit, const test_config_t &config)
+{
+    storage.begin(eraseUnit, 0xFF);
+    store.SetStorageProvider(&storage);
+    commit(store, config);
+    commit(store, config);
+}
+
+/**
+ * Power lost after every single byte written of a commit, at every slice
+ * boundary, and every erase and byte programmed by the Commit() included:
+ * what boots is always the old config or the new one.
+ **/
+static void checkPowerLoss(uint32_t eraseUnit)
+{
+    test_config_t oldConfig, newConfig, loaded;
+    makeConfig(oldConfig, 1);
+    makeConfig(newConfig, 2);
+
+    // How many writes a commit takes
+    TestStore store;
+    commitTwice(store, eraseUnit, oldConfig);
+    const uint32_t before = storage.writes + storage.programs;
+    commit(store, newConfig);
+    const uint32_t commitWrites = storage.writes + storage.programs - before;
+    // An erase and a program of each unit in the slot
+    const uint32_t programs = eraseUnit ? STORAGE_SIZE / 2 / eraseUnit * (1 + eraseUnit) : 0;
+    TEST_ASSERT_EQUAL(sizeof(newConfig) + sizeof(TestStore::footer_t) + programs, commitWrites);
+
+    for (uint32_t cut = 0; cut <= commitWrites; ++cut)
+    {
+        TestStore store;
+        commitTwice(store, eraseUnit, oldConfig);
+
+        storage.writesLeft = cut;
+        store.Stage(&newConfig, sizeof(newConfig));
+        while (store.Poll())
+            ;
+        storage.powerCycle();
+
+        TEST_ASSERT_TRUE(load(loaded));
+        const bool isNew = memcmp(&loaded, &newConfig, sizeof(loaded)) == 0;
+        TEST_ASSERT_TRUE(isNew || memcmp(&loaded, &oldConfig, sizeof(loaded)) == 0);
+        TEST_ASSERT_EQUAL(cut == commitWrites, isNew);
+
+        // and the next commit after the reboot goes through
+        TestStore rebooted;
+        rebooted.SetStorageProvider(&storage);
+        rebooted.Load(&loaded, sizeof(loaded));
+        commit(rebooted, newConfig);
+        TEST_ASSERT_TRUE(load(loaded));
+        TEST_ASSERT_EQUAL_MEMORY(&newConfig, &loaded, sizeof(loaded));
+    }
+}
+
+void test_config_store_power_loss(void)
+{
+    checkPowerLoss(0);
+    // A slot to each erase unit
+    checkPowerLoss(STORAGE_SIZE / 2);
+    checkPowerLoss(STORAGE_SIZE / 4);
+}
+
+void test_config_store_shared_erase_unit(void)
+{
+    // Both slots in the one unit Commit() erases, as in the ESP8266 EEPROM sector
+    test_config_t oldConfig, newConfig, loaded;
+    makeConfig(oldConfig, 1);
+    makeConfig(newConfig, 2);
+    TestStore store;
+    commitTwice(store, STORAGE_SIZE, oldConfig);
+
+    // Power lost right after the erase takes both copies
+    storage.writesLeft = sizeof(newConfig) + sizeof(TestStore::footer_t) + 1;
+    commit(store, newConfig);
+    storage.powerCycle();
+    TEST_ASSERT_FALSE(load(loaded));
+
+    // Up to the erase the old one is still there
+    commitTwice(store, STORAGE_SIZE, oldConfig);
+    storage.writesLeft = sizeof(newConfig) + sizeof(TestStore::footer_t);
+    commit(store, newConfig);
+    storage.powerCycle();
+    TEST_ASSERT_TRUE(load(loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&oldConfig, &loaded, sizeof(loaded));
+}
+
+void test_config_store_legacy(void)
+{
+    // A config from before ConfigStore sits at 0 with nothing at the footers
+    storage.begin(0, 0x00);
+    test_config_t legacy, config, loaded;
+    makeConfig(legacy, 7);
+    memcpy(storage.durable, &legacy, sizeof(legacy));
+    storage.powerCycle();
+
+    TestStore store;
+    store.SetStorageProvider(&storage);
+    TEST_ASSERT_FALSE(store.Load(&loaded, sizeof(loaded)));
+
+    // The first copy goes in the other slot, until it is complete the legacy one is there
+    makeConfig(config, 8);
+    store.Stage(&config, sizeof(config));
+    while (store.Poll())
+        TEST_ASSERT_EQUAL_MEMORY(&legacy, storage.durable, sizeof(legacy));
+    TEST_ASSERT_TRUE(load(loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&config, &loaded, sizeof(loaded));
+}
+
+void test_config_store_restage(void)
+{
+    storage.begin(0, 0xFF);
+    TestStore store;
+    store.SetStorageProvider(&storage);
+    test_config_t first, second, loaded;
+    makeConfig(first, 1);
+    makeConfig(second, 2);
+    commit(store, first);
+
+    // Changed again half way through writing it, the latest wins
+    store.Stage(&second, sizeof(second));
+    store.Poll();
+    store.Poll();
+    second.values[0] = 99;
+    store.Stage(&second, sizeof(second));
+    store.Flush();
+    TEST_ASSERT_TRUE(load(loaded));
+    TEST_ASSERT_EQUAL_MEMORY(&second, &loaded, sizeof(loaded));
+
+    // and it carries on from there
+    for (uint8_t i = 0; i < 4; ++i)
+    {
+        makeConfig(first, 10 + i);
+        commit(store, first);
+        TEST_ASSERT_TRUE(load(loaded));
+        TEST_ASSERT_EQUAL_MEMORY(&first, &loaded, sizeof(loaded));
+    }
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_config_store_round_trip);
+    RUN_TEST(test_config_store_write);
+    RUN_TEST(test_config_store_slices);
+    RUN_TEST(test_config_store_power_loss);
+    RUN_TEST(test_config_store_shared_erase_unit);
+    RUN_TEST(test_config_store_legacy);
+    RUN_TEST(test_config_store_restage);
+    UNITY_END();
+
+    return 0;
+}
@@ -2,7 +2,10 @@
 #include <unity.h>
 #include "ucrc_t.h"
 #include <crc.h>
+#include <STM32_crc.h>
+#include "crsf_protocol.h"
 #include "common.h"
+#include <time.h>
 
 #ifdef BIG_TEST
 #define NUM_ITERATIONS 1000000
@@ -32,7 +35,7 @@ void test_crc14_implementation_compatibility(void)
     uCRC_t ccrc = uCRC_t("CRC14", 14, ELRS_CRC14_POLY, 0, false, false, 0);
     uint64_t crc = ccrc.get_raw_crc(bytes, 7, 0);
 
-    GENERIC_CRC14 ecrc = GENERIC_CRC14(ELRS_CRC14_POLY);
+    GENERIC_CRC14<ELRS_CRC14_POLY> ecrc;
     uint16_t c = ecrc.calc(bytes, 7, 0);
 
     TEST_ASSERT_EQUAL_MESSAGE((int)(crc & 0x3FFF), c, genMsg(bytes, sizeof(bytes)));
@@ -41,7 +44,7 @@ void test_crc14_implementation_compatibility(void)
 void test_crc14_flip_random(int flip)
 {
     int false_positive = 0;
-    GENERIC_CRC14 ccrc = GENERIC_CRC14(ELRS_CRC14_POLY);
+    GENERIC_CRC14<ELRS_CRC14_POLY> ccrc;
 
     for (int x = 0; x < NUM_ITERATIONS; x++)
     {
@@ -78,7 +81,7 @@ void test_crc14_flip_random(int flip)
 void test_crc14_flip_sequential(int flip)
 {
     int false_positive = 0;
-    GENERIC_CRC14 ccrc = GENERIC_CRC14(ELRS_CRC14_POLY);
+    GENERIC_CRC14<ELRS_CRC14_POLY> ccrc;
 
     for (int x=0 ; x<NUM_ITERATIONS ; x++) {
         uint8_t bytes[7];
@@ -115,7 +118,7 @@ void test_crc14_flip_sequential(int flip)
 void test_crc14_flip_within(int flip)
 {
     int false_positive = 0;
-    GENERIC_CRC14 ccrc = GENERIC_CRC14(ELRS_CRC14_POLY);
+    GENERIC_CRC14<ELRS_CRC14_POLY> ccrc;
 
     for (int x = 0; x < NUM_ITERATIONS; x++)
     {
@@ -154,7 +157,7 @@ void test_crc14_flip_within(int flip)
 
 void test_crc14_flip5(void)
 {
-    GENERIC_CRC14 ccrc = GENERIC_CRC14(ELRS_CRC14_POLY);
+    GENERIC_CRC14<ELRS_CRC14_POLY> ccrc;
 
     for (int x = 0; x < NUM_ITERATIONS; x++)
     {
@@ -203,6 +206,119 @@ void test_crc14_flip5(void)
     }
 }
 
+void test_crc14_slicing_compatibility(void)
+{
+    uCRC_t ccrc = uCRC_t("CRC14", 14, ELRS_CRC14_POLY, 0, false, false, 0);
+    GENERIC_CRC14<ELRS_CRC14_POLY, 2> crc2;
+    GENERIC_CRC14<ELRS_CRC14_POLY, 4> crc4;
+    GENERIC_CRC14<ELRS_CRC14_POLY, 7> crc7;
+    GENERIC_CRC14<ELRS_CRC14_POLY, 8> crc8;
+
+    uint8_t bytes[32];
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        bytes[i] = random() % 255;
+
+    // Every length, so each slicing width ends with every possible tail
+    for (uint8_t len = 0; len <= sizeof(bytes); len++)
+    {
+        uint16_t init = random() & 0x3FFF;
+        uint16_t expected = ccrc.get_raw_crc(bytes, len, init) & 0x3FFF;
+        TEST_ASSERT_EQUAL_MESSAGE(expected, crc2.calc(bytes, len, init), genMsg(bytes, len < 20 ? len : 20));
+        TEST_ASSERT_EQUAL_MESSAGE(expected, crc4.calc(bytes, len, init), genMsg(bytes, len < 20 ? len : 20));
+        TEST_ASSERT_EQUAL_MESSAGE(expected, crc7.calc(bytes, len, init), genMsg(bytes, len < 20 ? len : 20));
+        TEST_ASSERT_EQUAL_MESSAGE(expected, crc8.calc(bytes, len, init), genMsg(bytes, len < 20 ? len : 20));
+    }
+
+    volatile uint8_t *vbytes = bytes;
+    uint16_t expected = ccrc.get_raw_crc(bytes, 7, 0x1234) & 0x3FFF;
+    TEST_ASSERT_EQUAL(expected, crc4.calc(vbytes, 7, 0x1234));
+    TEST_ASSERT_EQUAL(expected, crc7.calc(vbytes, 7, 0x1234));
+}
+
+// The previous implementation, one byte at a time through a table built at runtime
+class RUNTIME_CRC14
+{
+public:
+    RUNTIME_CRC14(uint16_t poly)
+    {
+        for (uint16_t i = 0; i < 256; i++)
+        {
+            uint16_t crc = i << (14 - 8);
+            for (uint8_t j = 0; j < 8; j++)
+                crc = (crc << 1) ^ ((crc & 0x2000) ? poly : 0);
+            crc14tab[i] = crc;
+        }
+    }
+    uint16_t calc(volatile uint8_t *data, uint8_t len, uint16_t crc)
+    {
+        while (len--)
+            crc = (crc << 8) ^ crc14tab[((crc >> 6) ^ (uint16_t) *data++) & 0x00FF];
+        return crc & 0x3FFF;
+    }
+
+private:
+    uint16_t crc14tab[256];
+};
+
+#define BENCH_PACKETS 256
+#define BENCH_ROUNDS 4000
+
+static uint8_t benchPackets[BENCH_PACKETS][7];
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t nowCycles() { return __rdtsc(); }
+#else
+static uint64_t nowCycles() { return 0; }
+#endif
+
+// Chain each result into the next initialiser so the calls cannot be overlapped or dropped
+#define BENCH_CRC14(name, expr) \
+    do { \
+        uint16_t crc = 0; \
+        const uint64_t startNs = nowNs(); \
+        const uint64_t startCycles = nowCycles(); \
+        for (int r = 0; r < BENCH_ROUNDS; r++) \
+            for (int p = 0; p < BENCH_PACKETS; p++) \
+            { \
+                volatile uint8_t *data = benchPackets[p]; \
+                crc = expr; \
+            } \
+        const double packets = (double)BENCH_ROUNDS * BENCH_PACKETS; \
+        printf("%-24s %6.2f ns/packet %7.1f cycles/packet (crc %04x)\n", name, \
+            (nowNs() - startNs) / packets, (nowCycles() - startCycles) / packets, crc); \
+        results[n++] = crc; \
+    } while (0)
+
+void test_crc14_benchmark(void)
+{
+    for (int p = 0; p < BENCH_PACKETS; p++)
+        for (int i = 0; i < 7; i++)
+            benchPackets[p][i] = random() % 255;
+
+    RUNTIME_CRC14 runtime(ELRS_CRC14_POLY);
+    GENERIC_CRC14<ELRS_CRC14_POLY, 2> crc2;
+    GENERIC_CRC14<ELRS_CRC14_POLY, 4> crc4;
+    GENERIC_CRC14<ELRS_CRC14_POLY, 7> crc7;
+
+    uint16_t results[8];
+    int n = 0;
+    BENCH_CRC14("runtime table bytewise", runtime.calc(data, 7, crc));
+    BENCH_CRC14("slicing-by-2", crc2.calc(data, 7, crc));
+    BENCH_CRC14("slicing-by-4", crc4.calc(data, 7, crc));
+    BENCH_CRC14("slicing-by-7", crc7.calc(data, 7, crc));
+
+    for (int i = 1; i < n; i++)
+        TEST_ASSERT_EQUAL(results[0], results[i]);
+}
+
 void test_crc8(void)
 {
     // Size of a CRSF packet
@@ -213,12 +329,79 @@ void test_crc8(void)
     uCRC_t ccrc = uCRC_t("CRC8", 8, ELRS_CRC_POLY, 0, false, false, 0);
     uint64_t crc = ccrc.get_raw_crc(bytes, 7, 0);
 
-    GENERIC_CRC8 ecrc = GENERIC_CRC8(ELRS_CRC_POLY);
+    GENERIC_CRC8<ELRS_CRC_POLY> ecrc;
     uint16_t c = ecrc.calc(bytes, 7);
 
     TEST_ASSERT_EQUAL_MESSAGE((int)(crc & 0xFF), c, genMsg(bytes, sizeof(bytes)));
 }
 
+/**
+ * Register level model of the STM32 CRC unit as described in the reference
+ * manuals: POLYSIZE 8, no bit reversal, CR.RESET loads INIT, each byte
+ * written to DR is shifted through MSB first.
+ **/
+struct ModelCrcUnit
+{
+    static uint8_t pol;
+    static uint8_t dr;
+    static int locked;
+
+    static uint32_t lock() { return locked++; }
+    static void unlock(uint32_t state) { locked = state; }
+    static void reset(uint8_t poly, uint8_t init)
+    {
+        pol = poly;
+        dr = init;
+    }
+    static void write(uint8_t data)
+    {
+        TEST_ASSERT_EQUAL(1, locked);
+        dr ^= data;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            dr = (dr & 0x80) ? (dr << 1) ^ pol : dr << 1;
+    }
+    static uint8_t read() { return dr; }
+};
+uint8_t ModelCrcUnit::pol;
+uint8_t ModelCrcUnit::dr;
+int ModelCrcUnit::locked;
+
+template <uint8_t poly>
+static void test_crc8_backends_poly(void)
+{
+    uCRC_t ccrc = uCRC_t("CRC8", 8, poly, 0, false, false, 0);
+    GENERIC_CRC8<poly> table;
+    HW_CRC8<poly, ModelCrcUnit> hardware;
+
+    // Every length up to the longest CRSF frame, chained from a random CRC
+    uint8_t bytes[CRSF_MAX_PACKET_LEN];
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        bytes[i] = random() % 255;
+    for (uint8_t len = 0; len <= sizeof(bytes); len++)
+    {
+        uint8_t init = random() % 256;
+        uint8_t expected = ccrc.get_raw_crc(bytes, len, init) & 0xFF;
+        TEST_ASSERT_EQUAL_MESSAGE(expected, table.calc(bytes, len, init), genMsg(bytes, len < 20 ? len : 20));
+        TEST_ASSERT_EQUAL_MESSAGE(expected, hardware.calc(bytes, len, init), genMsg(bytes, len < 20 ? len : 20));
+    }
+
+    // The single byte form is the CRC of that byte alone
+    for (uint16_t b = 0; b < 256; b++)
+    {
+        uint8_t byte = b;
+        uint8_t expected = ccrc.get_raw_crc(&byte, 1, 0) & 0xFF;
+        TEST_ASSERT_EQUAL(expected, table.calc(byte));
+        TEST_ASSERT_EQUAL(expected, hardware.calc(byte));
+    }
+    TEST_ASSERT_EQUAL(0, ModelCrcUnit::locked);
+}
+
+void test_crc8_backends(void)
+{
+    test_crc8_backends_poly<CRSF_CRC_POLY>();
+    test_crc8_backends_poly<ELRS_CRC_POLY>();
+}
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -230,7 +413,10 @@ int main(int argc, char **argv)
     UNITY_BEGIN();
     RUN_TEST(test_crc14_implementation_compatibility);
     RUN_TEST(test_crc14_flip5);
+    RUN_TEST(test_crc14_slicing_compatibility);
+    RUN_TEST(test_crc14_benchmark);
     RUN_TEST(test_crc8);
+    RUN_TEST(test_crc8_backends);
     UNITY_END();
 #endif
 #ifdef BIG_TEST
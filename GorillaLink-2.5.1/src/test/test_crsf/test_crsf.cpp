@@ -14,7 +14,7 @@ StringStream ss(buf);
 // using the StringStream as a mock UART
 CRSF crsf(&ss);
 
-GENERIC_CRC8 test_crc(CRSF_CRC_POLY);
+GENERIC_CRC8<CRSF_CRC_POLY> test_crc;
 
 void test_device_info(void)
 {
@@ -46,6 +46,140 @@ void test_device_info(void)
     TEST_ASSERT_EQUAL(test_crc.calc(&deviceInformation[2], DEVICE_INFORMATION_LENGTH-3), deviceInformation[DEVICE_INFORMATION_LENGTH - 1]);
 }
 
+// The DMA side of the ring: bytes land at the write position, the idle line marks the end of a burst
+static CRSFRxRing<256> ring;
+static uint16_t dmaPos;
+
+static void dmaReceive(const uint8_t *data, uint8_t len)
+{
+    while (len--)
+    {
+        ring.buffer[dmaPos++ % sizeof(ring.buffer)] = *data++;
+    }
+}
+
+static void dmaIdle(uint32_t time)
+{
+    ring.markIdle(dmaPos % sizeof(ring.buffer), time);
+}
+
+static uint8_t makeFrame(uint8_t *frame, uint8_t type, uint8_t payloadLen, uint8_t seed)
+{
+    frame[0] = CRSF_SYNC_BYTE;
+    frame[1] = payloadLen + 2;
+    frame[2] = type;
+    for (uint8_t i = 0; i < payloadLen; i++)
+    {
+        frame[3 + i] = seed + i * 7;
+    }
+    frame[3 + payloadLen] = test_crc.calc(&frame[2], payloadLen + 1);
+    return payloadLen + 4;
+}
+
+static void resetRing(uint16_t startPos)
+{
+    ring.reset();
+    dmaPos = 0;
+    // Move the DMA to startPos as if earlier frames had been consumed
+    ring.flush(startPos);
+    dmaPos = startPos;
+}
+
+void test_rx_ring_in_place(void)
+{
+    uint8_t frame[CRSF_MAX_PACKET_LEN];
+    uint32_t bad = 0;
+    const uint8_t len = makeFrame(frame, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, 22, 1);
+    resetRing(10);
+
+    // Nothing until the idle line says the frame is complete
+    dmaReceive(frame, len);
+    TEST_ASSERT_NULL(ring.nextFrame(test_crc, bad));
+
+    dmaIdle(1234);
+    const volatile uint8_t *rx = ring.nextFrame(test_crc, bad);
+    TEST_ASSERT_NOT_NULL(rx);
+    // Not copied, the frame is validated where the DMA wrote it
+    TEST_ASSERT_TRUE(rx == &ring.buffer[10]);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, (const uint8_t *)rx, len);
+    TEST_ASSERT_EQUAL(1234, ring.frameTime());
+    TEST_ASSERT_NULL(ring.nextFrame(test_crc, bad));
+    TEST_ASSERT_EQUAL(0, bad);
+}
+
+void test_rx_ring_wrap(void)
+{
+    uint8_t frame[CRSF_MAX_PACKET_LEN];
+    uint32_t bad = 0;
+    // Every split of a full size frame across the end of the buffer
+    for (uint8_t split = 1; split < CRSF_MAX_PACKET_LEN; split++)
+    {
+        const uint8_t len = makeFrame(frame, CRSF_FRAMETYPE_MSP_REQ, CRSF_MAX_PACKET_LEN - 4, split);
+        resetRing(sizeof(ring.buffer) - split);
+        dmaReceive(frame, len);
+        dmaIdle(split);
+
+        const volatile uint8_t *rx = ring.nextFrame(test_crc, bad);
+        TEST_ASSERT_NOT_NULL(rx);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, (const uint8_t *)rx, len);
+        TEST_ASSERT_NULL(ring.nextFrame(test_crc, bad));
+    }
+    TEST_ASSERT_EQUAL(0, bad);
+}
+
+void test_rx_ring_bursts(void)
+{
+    uint8_t frame[CRSF_MAX_PACKET_LEN];
+    uint32_t bad = 0;
+    resetRing(200);
+
+    // Line noise before a frame is skipped, two frames in one burst are both returned
+    const uint8_t noise[] = {0x00, 0x55, 0xAA};
+    dmaReceive(noise, sizeof(noise));
+    uint8_t len = makeFrame(frame, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, 22, 2);
+    dmaReceive(frame, len);
+    len = makeFrame(frame, CRSF_FRAMETYPE_DEVICE_PING, 2, 3);
+    dmaReceive(frame, len);
+    dmaIdle(100);
+    TEST_ASSERT_NOT_NULL(ring.nextFrame(test_crc, bad));
+    const volatile uint8_t *rx = ring.nextFrame(test_crc, bad);
+    TEST_ASSERT_NOT_NULL(rx);
+    TEST_ASSERT_EQUAL(CRSF_FRAMETYPE_DEVICE_PING, rx[2]);
+    TEST_ASSERT_NULL(ring.nextFrame(test_crc, bad));
+    TEST_ASSERT_EQUAL(0, bad);
+
+    // A corrupt frame drops its burst
+    len = makeFrame(frame, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, 22, 4);
+    frame[5] ^= 0x10;
+    dmaReceive(frame, len);
+    dmaIdle(200);
+    TEST_ASSERT_NULL(ring.nextFrame(test_crc, bad));
+    TEST_ASSERT_EQUAL(1, bad);
+
+    // So does a burst that ends mid frame
+    len = makeFrame(frame, CRSF_FRAMETYPE_RC_CHANNELS_PACKED, 22, 5);
+    dmaReceive(frame, len - 5);
+    dmaIdle(300);
+    TEST_ASSERT_NULL(ring.nextFrame(test_crc, bad));
+    TEST_ASSERT_EQUAL(2, bad);
+
+    // And the next burst is received normally
+    dmaReceive(frame, len);
+    dmaIdle(400);
+    rx = ring.nextFrame(test_crc, bad);
+    TEST_ASSERT_NOT_NULL(rx);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, (const uint8_t *)rx, len);
+    TEST_ASSERT_EQUAL(400, ring.frameTime());
+
+    // Flushing discards what has been received, marked or not
+    dmaReceive(frame, len);
+    dmaIdle(500);
+    dmaReceive(frame, len);
+    ring.flush(dmaPos % sizeof(ring.buffer));
+    TEST_ASSERT_NULL(ring.nextFrame(test_crc, bad));
+    TEST_ASSERT_EQUAL(2, bad);
+}
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -54,6 +188,9 @@ int main(int argc, char **argv)
 {
     UNITY_BEGIN();
     RUN_TEST(test_device_info);
+    RUN_TEST(test_rx_ring_in_place);
+    RUN_TEST(test_rx_ring_wrap);
+    RUN_TEST(test_rx_ring_bursts);
     UNITY_END();
 
     return 0;
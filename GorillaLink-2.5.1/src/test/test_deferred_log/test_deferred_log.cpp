@@ -0,0 +1,240 @@
+#include <cstdint>
+#include <unity.h>
+#include "DeferredLog.h"
+
+#define ENTRIES 8
+
+typedef DeferredLogRing<ENTRIES> TestRing;
+
+static TestRing ring;
+
+typedef enum { stateA, stateB, stateC } testState_e;
+
+static void drainAll()
+{
+    while (ring.peek())
+        ring.consume();
+    ring.takeDropped();
+}
+
+void test_deferred_log_records(void)
+{
+    NativeClock::reset();
+    drainAll();
+
+    static const char *const fmtA = "lost conn fc=%d ppm=%d";
+    static const char *const fmtB = "MM %u=%u %d";
+    NativeClock::advance(1234);
+    TEST_ASSERT_TRUE(ring.log(DEFERRED_LOG_NEWLINE, fmtA, (int8_t)-5, (int32_t)-80));
+    NativeClock::advance(10);
+    TEST_ASSERT_TRUE(ring.log(0, fmtB, (uint8_t)200, 0xDEADBEEFU, stateC));
+    TEST_ASSERT_TRUE(ring.log(DEFERRED_LOG_NEWLINE, ""));
+    TEST_ASSERT_EQUAL(3, ring.size());
+
+    // The format string itself is the ID, the arguments raw words
+    const deferredLogEntry_t *entry = ring.peek();
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_TRUE(fmtA == entry->fmt);
+    TEST_ASSERT_EQUAL(1234, entry->us);
+    TEST_ASSERT_EQUAL(DEFERRED_LOG_NEWLINE, entry->flags);
+    TEST_ASSERT_EQUAL(2, entry->argc);
+    TEST_ASSERT_EQUAL(-5, (int32_t)entry->args[0]);
+    TEST_ASSERT_EQUAL(-80, (int32_t)entry->args[1]);
+    ring.consume();
+
+    entry = ring.peek();
+    TEST_ASSERT_TRUE(fmtB == entry->fmt);
+    TEST_ASSERT_EQUAL(1244, entry->us);
+    TEST_ASSERT_EQUAL(3, entry->argc);
+    TEST_ASSERT_EQUAL(200, (uint32_t)entry->args[0]);
+    TEST_ASSERT_EQUAL_HEX32(0xDEADBEEF, (uint32_t)entry->args[1]);
+    TEST_ASSERT_EQUAL(stateC, (int32_t)entry->args[2]);
+    ring.consume();
+
+    entry = ring.peek();
+    TEST_ASSERT_EQUAL(0, entry->argc);
+    ring.consume();
+    TEST_ASSERT_NULL(ring.peek());
+    TEST_ASSERT_EQUAL(0, ring.size());
+}
+
+static void radioIsr()
+{
+    ring.log(DEFERRED_LOG_NEWLINE, "TLM crc error");
+}
+
+void test_deferred_log_preempted(void)
+{
+    NativeClock::reset();
+    drainAll();
+    NativeClock::attachInterrupt(0, &radioIsr);
+
+    // The loop has claimed an entry when the radio ISR logs
+    static const char *const fmtLoop = "Req air rate change %u->%u";
+    deferredLogEntry_t *claimed = ring.reserve();
+    TEST_ASSERT_NOT_NULL(claimed);
+    NativeClock::trigger(0, 100);
+    NativeClock::advance(200);
+    TEST_ASSERT_EQUAL(2, ring.size());
+
+    // Nothing comes out past the loop's record until it is complete
+    TEST_ASSERT_NULL(ring.peek());
+    claimed->fmt = fmtLoop;
+    claimed->us = 50;
+    claimed->flags = DEFERRED_LOG_NEWLINE;
+    claimed->argc = 2;
+    claimed->args[0] = 1;
+    claimed->args[1] = 3;
+    ring.commit(claimed);
+
+    const deferredLogEntry_t *entry = ring.peek();
+    TEST_ASSERT_TRUE(fmtLoop == entry->fmt);
+    ring.consume();
+    entry = ring.peek();
+    TEST_ASSERT_EQUAL_STRING("TLM crc error", entry->fmt);
+    TEST_ASSERT_EQUAL(100, entry->us);
+    ring.consume();
+    TEST_ASSERT_NULL(ring.peek());
+    NativeClock::detachInterrupt(0);
+}
+
+void test_deferred_log_overflow(void)
+{
+    NativeClock::reset();
+    drainAll();
+
+    // A full ring drops and counts, it never blocks
+    for (uint8_t i = 0; i < ENTRIES + 5; ++i)
+        TEST_ASSERT_EQUAL(i < ENTRIES, ring.log(0, "%u", i));
+    TEST_ASSERT_EQUAL(ENTRIES, ring.size());
+    TEST_ASSERT_EQUAL(5, ring.takeDropped());
+    TEST_ASSERT_EQUAL(0, ring.takeDropped());
+
+    // The oldest are kept, and the space comes back as they are drained
+    TEST_ASSERT_EQUAL(0, ring.peek()->args[0]);
+    ring.consume();
+    TEST_ASSERT_TRUE(ring.log(0, "%u", 100));
+    TEST_ASSERT_FALSE(ring.log(0, "%u", 101));
+    TEST_ASSERT_EQUAL(1, ring.takeDropped());
+    for (uint8_t i = 1; i < ENTRIES; ++i)
+    {
+        TEST_ASSERT_EQUAL(i, ring.peek()->args[0]);
+        ring.consume();
+    }
+    TEST_ASSERT_EQUAL(100, ring.peek()->args[0]);
+    ring.consume();
+    TEST_ASSERT_NULL(ring.peek());
+
+    // and the indexes wrap around
+    for (uint32_t i = 0; i < 70000; ++i)
+    {
+        TEST_ASSERT_TRUE(ring.log(0, "%u", i));
+        TEST_ASSERT_EQUAL(i, ring.peek()->args[0]);
+        ring.consume();
+    }
+    TEST_ASSERT_EQUAL(0, ring.takeDropped());
+}
+
+void test_deferred_log_strings(void)
+{
+    NativeClock::reset();
+    drainAll();
+
+    // The string is copied, it may be gone by the time the ring is drained
+    char ssid[] = "home";
+    ring.log(DEFERRED_LOG_NEWLINE, "Setting home network %s", ssid);
+    strcpy(ssid, "away");
+    const deferredLogEntry_t *entry = ring.peek();
+    TEST_ASSERT_EQUAL(1, entry->argc);
+    TEST_ASSERT_EQUAL_STRING("home", deferredLogText(*entry, entry->args[0]));
+    ring.consume();
+
+    // Several share the text, cut to what is left of it
+    ring.log(0, "%s %u %s %s", "ISR hop", 7U, "0123456789abcdefghij", "gone");
+    entry = ring.peek();
+    TEST_ASSERT_EQUAL(7, entry->args[1]);
+    TEST_ASSERT_EQUAL_STRING("ISR hop", deferredLogText(*entry, entry->args[0]));
+    TEST_ASSERT_EQUAL_STRING("0123456789abcde", deferredLogText(*entry, entry->args[2]));
+    TEST_ASSERT_EQUAL_STRING("", deferredLogText(*entry, entry->args[3]));
+    TEST_ASSERT_EQUAL(DEFERRED_LOG_TEXT, entry->textLen);
+    ring.consume();
+
+    // A null string is empty, and a word past the text never reads outside it
+    ring.log(0, "%s", (const char *)nullptr);
+    entry = ring.peek();
+    TEST_ASSERT_EQUAL_STRING("", deferredLogText(*entry, entry->args[0]));
+    TEST_ASSERT_EQUAL_STRING("", deferredLogText(*entry, 200));
+    ring.consume();
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void test_deferred_log_frames(void)
+{
+    NativeClock::reset();
+    drainAll();
+    const GENERIC_CRC8<DEFERRED_LOG_CRC8_POLY> crc;
+
+    // Decoded as python/decode_log.py does
+    static const char *const fmt = "%d:%d:%u:%d";
+    NativeClock::advance(0x12345678);
+    ring.log(DEFERRED_LOG_NEWLINE, fmt, -7, 12, 300U, 100);
+    uint8_t frame[DEFERRED_LOG_MAX_FRAME];
+    const uint8_t len = TestRing::encode(*ring.peek(), frame);
+    ring.consume();
+
+    TEST_ASSERT_EQUAL(1 + 1 + 4 + 4 + 4 * 4 + 1 + 1, len);
+    TEST_ASSERT_EQUAL_HEX8(DEFERRED_LOG_SYNC, frame[0]);
+    TEST_ASSERT_EQUAL(4, frame[1] & 0x0F);
+    TEST_ASSERT_EQUAL(DEFERRED_LOG_NEWLINE, frame[1] >> 4);
+    TEST_ASSERT_EQUAL_HEX32(0x12345678, get32(&frame[2]));
+    TEST_ASSERT_EQUAL_HEX32((uint32_t)(uintptr_t)fmt, get32(&frame[6]));
+    TEST_ASSERT_EQUAL(-7, (int32_t)get32(&frame[10]));
+    TEST_ASSERT_EQUAL(12, get32(&frame[14]));
+    TEST_ASSERT_EQUAL(300, get32(&frame[18]));
+    TEST_ASSERT_EQUAL(100, get32(&frame[22]));
+    TEST_ASSERT_EQUAL(0, frame[26]);
+    TEST_ASSERT_EQUAL_HEX8(crc.calc(&frame[1], len - 2), frame[len - 1]);
+
+    // The text of a %s follows the arguments
+    ring.log(0, "Set Lua [%s]=%u", "Bind", 1);
+    const uint8_t textLen = TestRing::encode(*ring.peek(), frame);
+    ring.consume();
+    TEST_ASSERT_EQUAL(1 + 1 + 4 + 4 + 4 * 2 + 1 + 5 + 1, textLen);
+    TEST_ASSERT_EQUAL(0, get32(&frame[10]));
+    TEST_ASSERT_EQUAL(5, frame[18]);
+    TEST_ASSERT_EQUAL_STRING("Bind", (const char *)&frame[19]);
+    TEST_ASSERT_EQUAL_HEX8(crc.calc(&frame[1], textLen - 2), frame[textLen - 1]);
+
+    // A record with the most arguments and text fits the largest frame
+    ring.log(0, "  hist %u %u %u %u %u %u %u %s", 1, 2, 3, 4, 5, 6, 7, "a string longer than the text");
+    TEST_ASSERT_EQUAL(DEFERRED_LOG_MAX_FRAME, TestRing::encode(*ring.peek(), frame));
+    ring.consume();
+
+    // Drops are reported with no format
+    const uint8_t droppedLen = TestRing::encodeDropped(9, 1000, frame);
+    TEST_ASSERT_EQUAL(1 + 1 + 4 + 4 + 4 + 1 + 1, droppedLen);
+    TEST_ASSERT_EQUAL(0, get32(&frame[6]));
+    TEST_ASSERT_EQUAL(9, get32(&frame[10]));
+    TEST_ASSERT_EQUAL_HEX8(crc.calc(&frame[1], droppedLen - 2), frame[droppedLen - 1]);
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_deferred_log_records);
+    RUN_TEST(test_deferred_log_preempted);
+    RUN_TEST(test_deferred_log_overflow);
+    RUN_TEST(test_deferred_log_strings);
+    RUN_TEST(test_deferred_log_frames);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,401 @@
+#include <cstdint>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include <unity.h>
+#include "targets.h"
+#include "common.h"
+#include "device.h"
+#include "DeviceScheduler.h"
+
+connectionState_e connectionState = disconnected;
+
+static uint32_t seed;
+static uint32_t rnd()
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+void test_scheduler_heap(void)
+{
+    // Against a plain array of deadlines
+    DeviceScheduler<DEVICE_MAX_COUNT> s;
+    bool scheduled[DEVICE_MAX_COUNT] = {false};
+    uint32_t deadline[DEVICE_MAX_COUNT];
+    seed = 1;
+    uint32_t now = 1000;
+    for (uint32_t step = 0; step < 20000; ++step)
+    {
+        const uint8_t device = rnd() % DEVICE_MAX_COUNT;
+        switch (rnd() % 4)
+        {
+        case 0:
+            s.cancel(device);
+            scheduled[device] = false;
+            break;
+        case 1:
+            now += rnd() % 50;
+            break;
+        default:
+            deadline[device] = now + rnd() % 500;
+            scheduled[device] = true;
+            s.schedule(device, deadline[device]);
+            break;
+        }
+
+        uint8_t count = 0;
+        uint32_t first = UINT32_MAX;
+        for (uint8_t i = 0; i < DEVICE_MAX_COUNT; ++i)
+        {
+            TEST_ASSERT_EQUAL(scheduled[i], s.isScheduled(i));
+            if (scheduled[i])
+            {
+                ++count;
+                const uint32_t wait = deadline[i] > now ? deadline[i] - now : 0;
+                if (wait < first)
+                    first = wait;
+            }
+        }
+        TEST_ASSERT_EQUAL(count, s.size());
+        TEST_ASSERT_EQUAL(first, s.timeToNext(now));
+
+        if (step % 16 == 0)
+        {
+            uint8_t due[DEVICE_MAX_COUNT];
+            const uint8_t n = s.takeDue(now, due);
+            uint8_t expected = 0;
+            for (uint8_t i = 0; i < DEVICE_MAX_COUNT; ++i)
+            {
+                if (scheduled[i] && deadline[i] <= now)
+                {
+                    TEST_ASSERT_TRUE(expected < n);
+                    TEST_ASSERT_EQUAL(i, due[expected++]);
+                    scheduled[i] = false;
+                }
+            }
+            TEST_ASSERT_EQUAL(expected, n);
+        }
+    }
+}
+
+void test_scheduler_wrap(void)
+{
+    // millis() wraps after 49 days, the order must not
+    DeviceScheduler<4> s;
+    const uint32_t now = 0xFFFFFF00;
+    s.schedule(0, now + 0x200);
+    s.schedule(1, now + 0x10);
+    s.schedule(2, now + 0x100);
+    TEST_ASSERT_EQUAL(0x10, s.timeToNext(now));
+    uint8_t due[4];
+    TEST_ASSERT_EQUAL(1, s.takeDue(now + 0x10, due));
+    TEST_ASSERT_EQUAL(1, due[0]);
+    TEST_ASSERT_EQUAL(0, s.takeDue(now + 0xFF, due));
+    TEST_ASSERT_EQUAL(2, s.takeDue(now + 0x200, due));
+    TEST_ASSERT_EQUAL(0, due[0]);
+    TEST_ASSERT_EQUAL(2, due[1]);
+    TEST_ASSERT_EQUAL(UINT32_MAX, s.timeToNext(now));
+}
+
+/**
+ * Synthetic devices with the mix of the real ones: LEDs and screens every
+ * few hundred ms, some polled every loop like LUA and CRSF, some that only
+ * run after an event like VTX, and each wanting its own events.
+ **/
+typedef struct
+{
+    uint8_t device;
+    uint8_t call;   // 0 start, 1 event, 2 timeout
+    uint32_t now;
+} deviceCall_t;
+
+static std::vector<deviceCall_t> calls;
+static bool recording;
+static uint32_t simNow;
+
+static int period(uint8_t n)
+{
+    if (n % 8 == 0)
+        return DURATION_IMMEDIATELY;
+    if (n % 8 == 3)
+        return DURATION_NEVER;
+    return 20 + (n * 37) % 480;
+}
+
+static void record(uint8_t n, uint8_t call)
+{
+    if (recording)
+        calls.push_back({n, call, simNow});
+}
+
+template <uint8_t n>
+static int synthStart()
+{
+    record(n, 0);
+    return n % 5 == 0 ? DURATION_NEVER : period(n);
+}
+
+template <uint8_t n>
+static int synthEvent()
+{
+    record(n, 1);
+    switch (n % 3)
+    {
+    case 0:
+        return DURATION_IGNORE;
+    case 1:
+        return DURATION_IMMEDIATELY;
+    default:
+        return n % 8 == 3 ? 50 : period(n);
+    }
+}
+
+template <uint8_t n>
+static int synthTimeout()
+{
+    record(n, 2);
+    return period(n);
+}
+
+static const uint8_t masks[] = {0, EVENT_CONNECTION_CHANGED, EVENT_CONFIG_CHANGED, EVENT_CONNECTION_CHANGED | EVENT_ARM_CHANGED};
+
+#define SYNTH(n) {nullptr, synthStart<n>, n % 7 == 6 ? nullptr : synthEvent<n>, n % 11 == 10 ? nullptr : synthTimeout<n>, masks[n % 4]}
+#define SYNTH4(n) SYNTH(n), SYNTH((n + 1)), SYNTH((n + 2)), SYNTH((n + 3))
+static device_t synthDevices[DEVICE_MAX_COUNT] = {
+    SYNTH4(0), SYNTH4(4), SYNTH4(8), SYNTH4(12), SYNTH4(16), SYNTH4(20), SYNTH4(24), SYNTH4(28)
+};
+static device_affinity_t synthAffinity[DEVICE_MAX_COUNT];
+
+/**
+ * devicesUpdate() as it was before the scheduler: every device is looked at
+ * on every update, for its events and against its timeout
+ **/
+class LinearDevices
+{
+public:
+    void start(uint8_t count, uint32_t now)
+    {
+        deviceCount = count;
+        events = 0;
+        lastConnectionState = connectionState;
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            timeout[i] = 0xFFFFFFFF;
+            const int delay = synthDevices[i].start();
+            timeout[i] = delay == DURATION_NEVER ? 0xFFFFFFFF : now + delay;
+        }
+    }
+
+    void trigger(uint8_t fired) { events |= fired; }
+
+    void update(uint32_t now)
+    {
+        uint8_t fired = events;
+        events = 0;
+        if (lastConnectionState != connectionState)
+            fired |= EVENT_CONNECTION_CHANGED;
+        lastConnectionState = connectionState;
+        for (uint8_t i = 0; i < deviceCount; ++i)
+        {
+            const uint8_t mask = synthDevices[i].eventMask ? synthDevices[i].eventMask : EVENT_ALL;
+            if ((fired & mask) && synthDevices[i].event)
+            {
+                const int delay = synthDevices[i].event();
+                if (delay != DURATION_IGNORE)
+                    timeout[i] = delay == DURATION_NEVER ? 0xFFFFFFFF : now + delay;
+            }
+        }
+        for (uint8_t i = 0; i < deviceCount; ++i)
+        {
+            if (synthDevices[i].timeout && now >= timeout[i])
+            {
+                const int delay = synthDevices[i].timeout();
+                timeout[i] = delay == DURATION_NEVER ? 0xFFFFFFFF : now + delay;
+            }
+        }
+    }
+
+private:
+    uint8_t deviceCount;
+    uint8_t events;
+    connectionState_e lastConnectionState;
+    uint32_t timeout[DEVICE_MAX_COUNT];
+};
+
+static LinearDevices linear;
+
+static void startDevices(uint8_t count, bool scheduled)
+{
+    // Let devicesUpdate() see the connection state the run starts in
+    connectionState = disconnected;
+    recording = false;
+    devicesRegister(synthAffinity, 0);
+    devicesUpdate(millis());
+
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        synthAffinity[i].device = &synthDevices[i];
+        synthAffinity[i].core = -1;
+    }
+    simNow = NativeClock::now() / 1000;
+    recording = true;
+    if (scheduled)
+    {
+        devicesRegister(synthAffinity, count);
+        devicesStart();
+    }
+    else
+    {
+        linear.start(count, simNow);
+    }
+}
+
+// 20s of main loop, updated 3 times a ms with events and connection changes on the way
+static void runLoop(bool scheduled, uint32_t ms)
+{
+    seed = 7;
+    for (uint32_t t = 0; t < ms; ++t)
+    {
+        NativeClock::advance(1000);
+        simNow = NativeClock::now() / 1000;
+        const uint32_t r = rnd() % 1000;
+        uint8_t fired = 0;
+        if (r < 2)
+            fired = EVENT_CONFIG_CHANGED;
+        else if (r < 3)
+            fired = EVENT_ARM_CHANGED;
+        else if (r < 4)
+            connectionState = connectionState == connected ? disconnected : connected;
+        if (fired)
+        {
+            if (scheduled)
+                devicesTriggerEvent(fired);
+            else
+                linear.trigger(fired);
+        }
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            if (scheduled)
+                devicesUpdate(simNow);
+            else
+                linear.update(simNow);
+        }
+    }
+}
+
+void test_devices_same_calls(void)
+{
+    // Every start(), event() and timeout() at the same time as before
+    const uint8_t counts[] = {4, 16, DEVICE_MAX_COUNT};
+    for (uint8_t c = 0; c < sizeof(counts); ++c)
+    {
+        NativeClock::reset();
+        calls.clear();
+        startDevices(counts[c], false);
+        runLoop(false, 20000);
+        const std::vector<deviceCall_t> expected = calls;
+
+        NativeClock::reset();
+        calls.clear();
+        startDevices(counts[c], true);
+        runLoop(true, 20000);
+
+        TEST_ASSERT_EQUAL(expected.size(), calls.size());
+        for (size_t i = 0; i < calls.size(); ++i)
+        {
+            TEST_ASSERT_EQUAL(expected[i].device, calls[i].device);
+            TEST_ASSERT_EQUAL(expected[i].call, calls[i].call);
+            TEST_ASSERT_EQUAL(expected[i].now, calls[i].now);
+        }
+    }
+}
+
+void test_devices_events(void)
+{
+    NativeClock::reset();
+    calls.clear();
+    startDevices(8, true);
+    TEST_ASSERT_EQUAL(8, calls.size());
+
+    // Only the devices that want the event, in order
+    calls.clear();
+    devicesTriggerEvent(EVENT_CONFIG_CHANGED);
+    devicesUpdate(simNow);
+    const uint8_t configDevices[] = {0, 2, 4};
+    uint8_t events = 0;
+    for (size_t i = 0; i < calls.size(); ++i)
+    {
+        if (calls[i].call != 1)
+            continue;
+        TEST_ASSERT_TRUE(events < sizeof(configDevices));
+        TEST_ASSERT_EQUAL(configDevices[events], calls[i].device);
+        ++events;
+    }
+    TEST_ASSERT_EQUAL(sizeof(configDevices), events);
+
+    // Device 4 asked for its timeout straight away
+    uint8_t timeouts = 0;
+    for (size_t i = 0; i < calls.size(); ++i)
+    {
+        if (calls[i].call != 2)
+            continue;
+        TEST_ASSERT_EQUAL(4, calls[i].device);
+        ++timeouts;
+    }
+    TEST_ASSERT_EQUAL(1, timeouts);
+
+    // The wait is to the first deadline, device 1 from its start()
+    TEST_ASSERT_EQUAL(period(1), devicesTimeToNext(simNow));
+    TEST_ASSERT_EQUAL(period(1) - 5, devicesTimeToNext(simNow + 5));
+
+    // and none with a device polled every update
+    devicesRegister(synthAffinity + 8, 1);
+    devicesStart();
+    TEST_ASSERT_EQUAL(DURATION_IMMEDIATELY, period(8));
+    TEST_ASSERT_EQUAL(0, devicesTimeToNext(simNow));
+}
+
+static uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void test_devices_benchmark(void)
+{
+    const uint8_t counts[] = {16, 24, DEVICE_MAX_COUNT};
+    for (uint8_t c = 0; c < sizeof(counts); ++c)
+    {
+        uint64_t ns[2];
+        for (uint8_t scheduled = 0; scheduled < 2; ++scheduled)
+        {
+            NativeClock::reset();
+            startDevices(counts[c], scheduled);
+            recording = false;
+            const uint64_t start = nowNs();
+            runLoop(scheduled, 20000);
+            ns[scheduled] = nowNs() - start;
+        }
+        printf("devices %2u: %4u ns per loop scanning every device, %4u ns with the timeout heap\n",
+               counts[c], (uint32_t)(ns[0] / 60000), (uint32_t)(ns[1] / 60000));
+    }
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_scheduler_heap);
+    RUN_TEST(test_scheduler_wrap);
+    RUN_TEST(test_devices_same_calls);
+    RUN_TEST(test_devices_events);
+    RUN_TEST(test_devices_benchmark);
+    UNITY_END();
+
+    return 0;
+}
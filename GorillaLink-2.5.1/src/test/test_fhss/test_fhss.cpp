@@ -68,6 +68,132 @@ void test_fhss_same(void)
     }
 }
 
+static void checkHopCommands(const int32_t correction)
+{
+    FHSSsetFreqCorrection(correction);
+    FHSSsetCurrIndex(0);
+
+    for (unsigned int i = 0; i < FHSSgetSequenceCount(); i++) {
+        const fhss_channel_t &channel = FHSSgetNextChannel();
+        const uint32_t expected = FHSSfreqs[FHSSsequence[FHSSgetCurrIndex()]] - correction;
+        TEST_ASSERT_EQUAL_UINT32(expected, channel.freq);
+
+        uint8_t cmd[FREQ_CMD_SIZE];
+        FHSSradio_t::BuildFrequencyCmd(expected, cmd);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(cmd, channel.cmd, FREQ_CMD_SIZE);
+        TEST_ASSERT_EQUAL_UINT32(expected, ((uint32_t)channel.cmd[1] << 16) | ((uint32_t)channel.cmd[2] << 8) | channel.cmd[3]);
+    }
+}
+
+void test_fhss_hop_commands(void)
+{
+    FHSSrandomiseFHSSsequence(0x01020304L);
+
+    // The prebuilt commands follow every change of FreqCorrection
+    checkHopCommands(0);
+    checkHopCommands(5);
+    checkHopCommands(-3);
+    checkHopCommands(FreqCorrectionMax);
+    checkHopCommands(0);
+
+    // and a new sequence
+    FHSSrandomiseFHSSsequence(0x05060708L);
+    checkHopCommands(0);
+}
+
+void test_fhss_blacklist(void)
+{
+    FHSSrandomiseFHSSsequence(0x01020304L);
+    const uint32_t numFhss = FHSSgetChannelCount();
+
+    // Two channels lose most packets, the others a few
+    for (unsigned int i = 0; i < 64 * numFhss; i++) {
+        const uint8_t channel = i % numFhss;
+        const unsigned int round = i / numFhss;
+        const bool bad = channel == 3 || channel == 4;
+        FHSSrecordPacket(channel, bad ? (round % 5 == 0) : (round % 20 != 0));
+    }
+    fhss_blacklist_t list;
+    FHSSpickBlacklist(list);
+    TEST_ASSERT_EQUAL(2, list.count);
+    TEST_ASSERT_EQUAL(3, list.channels[0]);
+    TEST_ASSERT_EQUAL(4, list.channels[1]);
+
+    // The sync channel is never blacklisted
+    list.count = 3;
+    list.channels[2] = sync_channel;
+    list.epoch = 1;
+    FHSSprepareBlacklist(list);
+    TEST_ASSERT_TRUE(FHSSblacklistPending());
+    TEST_ASSERT_EQUAL(1, FHSSannounceBlacklist());
+
+    // Nothing changes until the start of the sequence
+    FHSSsetCurrIndex(1);
+    for (unsigned int i = 2; i < FHSSgetSequenceCount(); i++) {
+        TEST_ASSERT_EQUAL_UINT32(FHSSfreqs[FHSSsequence[i]], FHSSgetNextFreq());
+    }
+    uint32_t prev = FHSSfreqs[FHSSsequence[FHSSgetSequenceCount() - 1]];
+    for (unsigned int i = 0; i < FHSSgetSequenceCount(); i++) {
+        const uint32_t freq = FHSSgetNextFreq();
+        TEST_ASSERT_NOT_EQUAL(FHSSfreqs[3], freq);
+        TEST_ASSERT_NOT_EQUAL(FHSSfreqs[4], freq);
+        TEST_ASSERT_NOT_EQUAL(prev, freq);
+        if (FHSSsequence[i] == sync_channel) {
+            TEST_ASSERT_EQUAL_UINT32(GetInitialFreq(), freq);
+        }
+        prev = freq;
+    }
+    TEST_ASSERT_FALSE(FHSSblacklistPending());
+
+    // The RX follows an announced list it has prepared, and drops one it doesn't know
+    fhss_blacklist_t active;
+    FHSSgetBlacklist(active);
+    TEST_ASSERT_EQUAL(1, active.epoch);
+    TEST_ASSERT_TRUE(FHSSfollowBlacklist(1));
+    TEST_ASSERT_FALSE(FHSSfollowBlacklist(0));
+    FHSSgetBlacklist(active);
+    TEST_ASSERT_EQUAL(0, active.count);
+    const uint32_t expected = FHSSfreqs[FHSSsequence[(FHSSgetCurrIndex() + 1) % FHSSgetSequenceCount()]];
+    TEST_ASSERT_EQUAL_UINT32(expected, FHSSgetNextFreq());
+}
+
+void test_fhss_blacklist_reset(void)
+{
+    FHSSrandomiseFHSSsequence(0x01020304L);
+    fhss_blacklist_t list = {1, 1, {3}};
+    FHSSprepareBlacklist(list);
+    FHSSannounceBlacklist();
+    FHSSsetCurrIndex(FHSSgetSequenceCount() - 1);
+    FHSSgetNextFreq();
+    TEST_ASSERT_NOT_EQUAL(3, FHSSchannelMap[3]);
+
+    // loop() only flags the reset, the map stays as it is until the ISR hops
+    FHSSresetBlacklist();
+    TEST_ASSERT_TRUE(FHSSblacklistPending());
+    fhss_blacklist_t pending;
+    TEST_ASSERT_FALSE(FHSSgetPendingBlacklist(pending));
+    TEST_ASSERT_NOT_EQUAL(3, FHSSchannelMap[3]);
+
+    FHSSgetNextFreq();
+    TEST_ASSERT_FALSE(FHSSblacklistPending());
+    fhss_blacklist_t active;
+    FHSSgetBlacklist(active);
+    TEST_ASSERT_EQUAL(0, active.epoch);
+    TEST_ASSERT_EQUAL(0, active.count);
+    for (unsigned int i = 0; i < FHSSgetChannelCount(); i++) {
+        TEST_ASSERT_EQUAL(i, FHSSchannelMap[i]);
+    }
+
+    // A SYNC does it too, before it compares the epoch
+    FHSSprepareBlacklist(list);
+    FHSSannounceBlacklist();
+    FHSSsetCurrIndex(FHSSgetSequenceCount() - 1);
+    FHSSgetNextFreq();
+    FHSSresetBlacklist();
+    TEST_ASSERT_TRUE(FHSSfollowBlacklist(0));
+    TEST_ASSERT_EQUAL(3, FHSSchannelMap[3]);
+}
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -79,6 +205,9 @@ int main(int argc, char **argv)
     RUN_TEST(test_fhss_assignment);
     RUN_TEST(test_fhss_unique);
     RUN_TEST(test_fhss_same);
+    RUN_TEST(test_fhss_hop_commands);
+    RUN_TEST(test_fhss_blacklist);
+    RUN_TEST(test_fhss_blacklist_reset);
     UNITY_END();
 
     return 0;
@@ -1,59 +1,212 @@
 #include <cstdint>
-#include <FIFO.h>
+#include <PacketFIFO.h>
 #include <unity.h>
-#include <set>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
-FIFO f;
-void init()
+PacketFIFO<256> f;
+
+static void fillPacket(uint8_t *data, uint8_t len, uint32_t seq)
+{
+    for (uint8_t i = 0; i < len; i++)
+        data[i] = (uint8_t)(seq * 31 + i * 7);
+}
+
+static void checkPacket(const uint8_t *data, uint8_t len, uint32_t seq)
+{
+    uint8_t expected[255];
+    fillPacket(expected, len, seq);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, data, len);
+}
+
+void test_fifo_pop_wrap(void)
 {
     f.flush();
-    for(int i=0;i<FIFO_SIZE/2;i++) {
-        f.push(i);
-        TEST_ASSERT_EQUAL(i, f.pop());
+    // Lengths that don't divide the capacity so packets keep landing across the end
+    uint8_t buf[64];
+    for (uint32_t seq = 0; seq < 1000; seq++)
+    {
+        const uint8_t len = 1 + seq % 37;
+        fillPacket(buf, len, seq);
+        TEST_ASSERT_TRUE(f.push(buf, len));
+        if (seq % 3 == 0)
+            continue;
+        // Keep a couple of packets queued across the wrap
+        while (f.size() > 100)
+        {
+            uint8_t len;
+            const uint8_t *data = f.peek(len);
+            TEST_ASSERT_NOT_NULL(data);
+            f.consume();
+        }
     }
-    for(int i=0;i<FIFO_SIZE-1;i++) {
-        f.push(i);
+    f.flush();
+    TEST_ASSERT_TRUE(f.empty());
+
+    for (uint32_t seq = 0; seq < 1000; seq++)
+    {
+        const uint8_t len = 1 + seq % 37;
+        fillPacket(buf, len, seq);
+        TEST_ASSERT_TRUE(f.push(buf, len));
+        uint8_t out[64];
+        TEST_ASSERT_EQUAL(len, f.pop(out, sizeof(out)));
+        checkPacket(out, len, seq);
     }
+    TEST_ASSERT_TRUE(f.empty());
+    TEST_ASSERT_EQUAL(0, f.pop(buf, sizeof(buf)));
 }
 
-void test_fifo_pop_wrap(void)
+void test_fifo_reserve_commit(void)
+{
+    f.flush();
+    uint8_t *data = f.reserve(10);
+    TEST_ASSERT_NOT_NULL(data);
+    fillPacket(data, 10, 1);
+    // Not visible until it is committed
+    uint8_t len;
+    TEST_ASSERT_NULL(f.peek(len));
+    TEST_ASSERT_TRUE(f.empty());
+
+    f.commit();
+    const uint8_t *out = f.peek(len);
+    TEST_ASSERT_NOT_NULL(out);
+    TEST_ASSERT_EQUAL(10, len);
+    checkPacket(out, len, 1);
+    // peek() leaves it queued
+    TEST_ASSERT_TRUE(out == f.peek(len));
+    f.consume();
+    TEST_ASSERT_TRUE(f.empty());
+    TEST_ASSERT_NULL(f.reserve(0));
+}
+
+void test_fifo_full()
 {
-    init();
-    for(int i=0;i<FIFO_SIZE-1;i++) {
-        TEST_ASSERT_EQUAL(i, f.pop());
+    // Fresh queue so the packets start at the beginning of the buffer
+    PacketFIFO<256> f;
+    // Push 25 9-byte packets, each takes 10 bytes with the length prefix
+    uint8_t buf[100];
+    for (int i = 0; i < 25; i++)
+    {
+        fillPacket(buf, 9, i);
+        TEST_ASSERT_TRUE(f.push(buf, 9));
     }
+    TEST_ASSERT_EQUAL(250, f.size());
+
+    // A packet that doesn't fit is refused, the queued ones are left alone
+    TEST_ASSERT_FALSE(f.push(buf, 99));
+    TEST_ASSERT_NULL(f.reserve(6));
+    TEST_ASSERT_EQUAL(250, f.size());
+
+    for (int i = 0; i < 10; i++)
+        TEST_ASSERT_EQUAL(9, f.pop(buf, sizeof(buf)));
+    // The 99 byte packet does not fit in the 6 bytes before the end of the
+    // buffer, so it wraps around to the space freed at the beginning
+    fillPacket(buf, 99, 99);
+    TEST_ASSERT_TRUE(f.push(buf, 99));
+    TEST_ASSERT_EQUAL(256, f.size());
+    for (int i = 10; i < 25; i++)
+    {
+        TEST_ASSERT_EQUAL(9, f.pop(buf, sizeof(buf)));
+        checkPacket(buf, 9, i);
+    }
+    TEST_ASSERT_EQUAL(99, f.pop(buf, sizeof(buf)));
+    checkPacket(buf, 99, 99);
+    TEST_ASSERT_TRUE(f.empty());
+
+    // A packet too long for the reader is dropped
+    TEST_ASSERT_TRUE(f.push(buf, 99));
+    TEST_ASSERT_EQUAL(0, f.pop(buf, 50));
+    TEST_ASSERT_TRUE(f.empty());
 }
 
-void test_fifo_popBytes_wrap(void)
+/**
+ * A producer thread standing in for an ISR pushes numbered packets of every
+ * length while the main thread consumes them. Without any locking, every
+ * packet must arrive once, in order and intact.
+ **/
+#define STRESS_PACKETS 200000
+
+static PacketFIFO<256> stressFifo;
+static atomic<bool> stressDone;
+static atomic<bool> stressAbort;
+
+static void isrProducer(bool dropWhenFull, uint32_t *dropped)
 {
-    init();
-    uint8_t buf[FIFO_SIZE] = {0};
-    f.popBytes(buf, FIFO_SIZE-1);
-    for(int i=0;i<FIFO_SIZE-1;i++) {
-        TEST_ASSERT_EQUAL(i, buf[i]);
+    for (uint32_t seq = 0; seq < STRESS_PACKETS; seq++)
+    {
+        const uint8_t len = 4 + seq % 60;
+        uint8_t *data;
+        while ((data = stressFifo.reserve(len)) == nullptr)
+        {
+            if (dropWhenFull || stressAbort)
+                break;
+            this_thread::yield();
+        }
+        if (data == nullptr)
+        {
+            ++*dropped;
+            continue;
+        }
+        // Sequence number first, then the pattern
+        fillPacket(data, len, seq);
+        memcpy(data, &seq, sizeof(seq));
+        stressFifo.commit();
     }
+    stressDone = true;
 }
 
-void test_fifo_ensure()
+static void runStress(bool dropWhenFull)
 {
-    f.flush();
-    // Push 25 9-byte packets with a 1 byte length header
-    for (int i = 0; i < 25; i++)
+    stressFifo.flush();
+    stressDone = false;
+    stressAbort = false;
+    uint32_t dropped = 0;
+    thread producer(isrProducer, dropWhenFull, &dropped);
+
+    uint32_t received = 0;
+    uint32_t nextSeq = 0;
+    bool ok = true;
+    while (ok)
     {
-        f.push(9); // 9 bytes;
-        for(int x = 0 ; x<9 ; x++)
-            f.push(i);
+        uint8_t len;
+        const uint8_t *data = stressFifo.peek(len);
+        if (data == nullptr)
+        {
+            if (stressDone && stressFifo.empty())
+                break;
+            this_thread::yield();
+            continue;
+        }
+        uint32_t seq;
+        memcpy(&seq, data, sizeof(seq));
+        uint8_t expected[64];
+        fillPacket(expected, len, seq);
+        ok = (dropWhenFull ? seq >= nextSeq : seq == nextSeq) &&
+             len == 4 + seq % 60 &&
+             memcmp(expected + 4, data + 4, len - 4) == 0;
+        stressFifo.consume();
+        nextSeq = seq + 1;
+        ++received;
     }
-    TEST_ASSERT_EQUAL(250, f.size());
+    stressAbort = true;
+    producer.join();
+
+    TEST_ASSERT_TRUE_MESSAGE(ok, "packet lost, reordered or torn");
+    TEST_ASSERT_EQUAL(STRESS_PACKETS, received + dropped);
+    if (!dropWhenFull)
+        TEST_ASSERT_EQUAL(0, dropped);
+}
 
-    // Ensure we can push a 99 byte packet with a prefix (i.e. 100 bytes)
-    f.ensure(100);
-    TEST_ASSERT_EQUAL(150, f.size());   // make sure that we've popped the right amount to fit our jumbo packet
-    TEST_ASSERT_EQUAL(9, f.pop());      // check that we have a header len
-    for (int x = 0; x < 9; x++)
-        TEST_ASSERT_EQUAL(10, f.pop()); // and that all the bytes in the head packet are what we expect
+void test_fifo_spsc_stress(void)
+{
+    runStress(false);
+}
+
+void test_fifo_spsc_stress_drop(void)
+{
+    runStress(true);
 }
 
 // Unity setup/teardown
@@ -64,8 +217,10 @@ int main(int argc, char **argv)
 {
     UNITY_BEGIN();
     RUN_TEST(test_fifo_pop_wrap);
-    RUN_TEST(test_fifo_popBytes_wrap);
-    RUN_TEST(test_fifo_ensure);
+    RUN_TEST(test_fifo_reserve_commit);
+    RUN_TEST(test_fifo_full);
+    RUN_TEST(test_fifo_spsc_stress);
+    RUN_TEST(test_fifo_spsc_stress_drop);
     UNITY_END();
 
     return 0;
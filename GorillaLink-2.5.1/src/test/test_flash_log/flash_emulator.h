@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Two banks of STM32F1 like internal flash for FlashLog: erased to 0xFF,
+ * programmed a half word at a time only where still erased, and power that
+ * can be cut after a number of half words. It counts what the log costs the
+ * flash: half words programmed, bank erases and bytes read, and the time
+ * programming and erasing would take on an F103.
+ **/
+#define FLASH_EMU_PROGRAM_US 53     // per half word
+#define FLASH_EMU_ERASE_US 40000    // per bank, two 1KB pages
+
+class FlashEmulator
+{
+public:
+    static constexpr uint32_t BankSize = 2048;
+    static constexpr uint8_t ProgramUnit = 2;
+
+    uint8_t mem[2][BankSize];
+    uint32_t programmed;        // bytes
+    uint32_t erases[2];
+    uint32_t bytesRead;
+    uint32_t busyUs;
+    uint32_t programErrors;     // programming what wasn't erased
+    uint32_t unitsLeft;         // before the power goes
+    bool off;
+
+    FlashEmulator() { begin(); }
+
+    void begin()
+    {
+        memset(mem, 0xFF, sizeof(mem));
+        resetCounts();
+        powerCycle();
+    }
+
+    void resetCounts()
+    {
+        programmed = 0;
+        erases[0] = erases[1] = 0;
+        bytesRead = 0;
+        busyUs = 0;
+        programErrors = 0;
+    }
+
+    void powerCycle()
+    {
+        unitsLeft = UINT32_MAX;
+        off = false;
+    }
+
+    void Read(uint8_t bank, uint32_t offset, void *data, uint32_t len)
+    {
+        memcpy(data, &mem[bank][offset], len);
+        bytesRead += len;
+    }
+
+    void Program(uint8_t bank, uint32_t offset, const void *data, uint32_t len)
+    {
+        const uint8_t *p = (const uint8_t *)data;
+        for (uint32_t i = 0; i < len; i += ProgramUnit)
+        {
+            if (!use())
+                return;
+            uint8_t *unit = &mem[bank][offset + i];
+            if (unit[0] != 0xFF || unit[1] != 0xFF)
+                ++programErrors;
+            unit[0] &= p[i];
+            unit[1] &= p[i + 1];
+            programmed += ProgramUnit;
+            busyUs += FLASH_EMU_PROGRAM_US;
+        }
+    }
+
+    void Erase(uint8_t bank)
+    {
+        if (!use())
+            return;
+        memset(mem[bank], 0xFF, BankSize);
+        ++erases[bank];
+        busyUs += FLASH_EMU_ERASE_US;
+    }
+
+private:
+    bool use()
+    {
+        off = off || unitsLeft == 0;
+        if (off)
+            return false;
+        --unitsLeft;
+        return true;
+    }
+};
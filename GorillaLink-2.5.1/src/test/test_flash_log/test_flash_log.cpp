@@ -0,0 +1,233 @@
+#include <cstdint>
+#include <stdio.h>
+#include <unity.h>
+#include "FlashLog.h"
+#include "ConfigStore.h"
+#include "flash_emulator.h"
+
+#define EEPROM_SIZE 1024
+
+typedef FlashLog<FlashEmulator> TestLog;
+typedef FlashEeprom<FlashEmulator, EEPROM_SIZE> TestEeprom;
+typedef StagedConfigStore<TestEeprom, EEPROM_SIZE / 2> TestStore;
+
+static FlashEmulator flash;
+
+// The latest value of keys 0..15 as Load() rebuilds them
+static uint32_t values[16];
+static uint32_t applied;
+
+static void applyValue(void *ctx, uint16_t key, const uint8_t *value, uint8_t length)
+{
+    (void)ctx;
+    TEST_ASSERT_EQUAL(sizeof(uint32_t), length);
+    TEST_ASSERT_TRUE(key < 16);
+    memcpy(&values[key], value, length);
+    ++applied;
+}
+
+static bool load(TestLog &log)
+{
+    memset(values, 0, sizeof(values));
+    applied = 0;
+    return log.Load(&applyValue, nullptr);
+}
+
+// Compaction of the log written by writeValue(): every key's latest value
+static uint32_t latest[16];
+
+static void fillValues(void *ctx)
+{
+    TestLog *log = (TestLog *)ctx;
+    for (uint16_t key = 0; key < 16; ++key)
+        log->CompactAppend(key, &latest[key], sizeof(latest[key]));
+}
+
+static void writeValue(TestLog &log, uint16_t key, uint32_t value)
+{
+    latest[key] = value;
+    if (!log.Append(key, &value, sizeof(value)))
+        TEST_ASSERT_TRUE(log.Compact(&fillValues, &log));
+}
+
+void test_flash_log_records(void)
+{
+    flash.begin();
+    TestLog log(flash);
+    TEST_ASSERT_FALSE(load(log));
+    TEST_ASSERT_EQUAL(0, log.Free());
+    memset(latest, 0, sizeof(latest));
+
+    // The first write formats the log
+    writeValue(log, 3, 0x1234);
+    TEST_ASSERT_TRUE(log.IsFormatted());
+    TEST_ASSERT_EQUAL(1, flash.erases[0]);
+    TEST_ASSERT_EQUAL(0, flash.erases[1]);
+
+    // Each change after that is one record, the last of a key wins
+    const uint32_t programmed = flash.programmed;
+    writeValue(log, 3, 0x5678);
+    writeValue(log, 7, 0x9ABC);
+    TEST_ASSERT_EQUAL(2 * TestLog::RecordSize(sizeof(uint32_t)), flash.programmed - programmed);
+    TestLog reloaded(flash);
+    TEST_ASSERT_TRUE(load(reloaded));
+    TEST_ASSERT_EQUAL(0x5678, values[3]);
+    TEST_ASSERT_EQUAL(0x9ABC, values[7]);
+    TEST_ASSERT_EQUAL(log.Free(), reloaded.Free());
+
+    // Filling the log up compacts it into the other bank, they take turns
+    for (uint32_t i = 0; i < 2000; ++i)
+        writeValue(reloaded, i % 16, i);
+    TEST_ASSERT_UINT_WITHIN(1, flash.erases[0], flash.erases[1]);
+    TEST_ASSERT_TRUE(load(log));
+    for (uint16_t key = 0; key < 16; ++key)
+        TEST_ASSERT_EQUAL(latest[key], values[key]);
+    TEST_ASSERT_EQUAL(0, flash.programErrors);
+}
+
+void test_flash_log_power_loss(void)
+{
+    // Cut the power at every half word of an append, and of a compaction
+    for (uint8_t compacting = 0; compacting < 2; ++compacting)
+    {
+        uint32_t units = 0;
+        for (uint32_t cut = 0;; ++cut)
+        {
+            flash.begin();
+            TestLog log(flash);
+            memset(latest, 0, sizeof(latest));
+            for (uint16_t key = 0; key < 16; ++key)
+                writeValue(log, key, 100 + key);
+            if (compacting)
+            {
+                while (log.Free() >= TestLog::RecordSize(sizeof(uint32_t)))
+                    writeValue(log, 5, 200);
+            }
+            const uint32_t before[2] = {flash.erases[0], flash.erases[1]};
+
+            flash.unitsLeft = cut;
+            latest[5] = 300;
+            const uint32_t value = 300;
+            if (!log.Append(5, &value, sizeof(value)))
+                log.Compact(&fillValues, &log);
+            const bool complete = !flash.off;
+            flash.powerCycle();
+
+            TestLog reloaded(flash);
+            TEST_ASSERT_TRUE(load(reloaded));
+            TEST_ASSERT_TRUE(values[5] == 300 || values[5] == (compacting ? 200U : 105U));
+            if (complete)
+                TEST_ASSERT_EQUAL(300, values[5]);
+            for (uint16_t key = 0; key < 16; ++key)
+                if (key != 5)
+                    TEST_ASSERT_EQUAL(100 + key, values[key]);
+
+            // and it carries on after the reboot
+            latest[5] = values[5];
+            writeValue(reloaded, 5, 400);
+            TEST_ASSERT_TRUE(load(log));
+            TEST_ASSERT_EQUAL(400, values[5]);
+            TEST_ASSERT_EQUAL(0, flash.programErrors);
+
+            if (complete)
+            {
+                units = cut;
+                TEST_ASSERT_EQUAL(compacting, flash.erases[0] + flash.erases[1] > before[0] + before[1]);
+                break;
+            }
+        }
+        TEST_ASSERT_TRUE(units > 0);
+    }
+}
+
+/**
+ * A TX config the shape of tx_config_t stored as TxConfig does it on STM32:
+ * ConfigStore's two copies in ELRS_EEPROM, kept in the FlashLog.
+ **/
+typedef struct {
+    uint32_t version;
+    char ssid[33];
+    char password[33];
+    uint8_t vtx[5];
+    uint8_t model_config[64][3];
+    uint8_t misc[4];
+} test_config_t;
+
+static void commit(TestStore &store, const test_config_t &config)
+{
+    store.Stage(&config, sizeof(config));
+    store.Flush();
+}
+
+void test_flash_log_config_changes(void)
+{
+    flash.begin();
+    TestEeprom eeprom(flash);
+    TEST_ASSERT_FALSE(eeprom.Begin());
+    TestStore store;
+    store.SetStorageProvider(&eeprom);
+
+    test_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.version = 6;
+    commit(store, config);
+    commit(store, config);
+
+    // A model setting changed at a time, as from the Lua menu
+    const uint16_t changes = 1000;
+    flash.resetCounts();
+    uint32_t erasingCommits = 0;
+    for (uint16_t i = 0; i < changes; ++i)
+    {
+        config.model_config[(i * 7) % 64][i % 3] = i;
+        store.Stage(&config, sizeof(config));
+        while (!store.IsLastSlice())
+            store.Poll();
+        const bool willErase = eeprom.CommitWillErase();
+        const uint32_t erases = flash.erases[0] + flash.erases[1];
+        store.Poll();
+        TEST_ASSERT_EQUAL(willErase, flash.erases[0] + flash.erases[1] > erases);
+        erasingCommits += willErase;
+    }
+    TEST_ASSERT_EQUAL(0, flash.programErrors);
+    TEST_ASSERT_EQUAL(erasingCommits, flash.erases[0] + flash.erases[1]);
+
+    // Rewriting the page took an erase and 1KB of programming every time.
+    // Now it is the blocks of the two models changed since the slot was
+    // last written and its footer, plus the compactions shared out.
+    const uint32_t bytesPerChange = flash.programmed / changes;
+    const uint32_t usPerChange = flash.busyUs / changes;
+    TEST_ASSERT_TRUE(bytesPerChange <= EEPROM_SIZE / 8);
+    TEST_ASSERT_TRUE(erasingCommits <= changes / 10);
+    TEST_ASSERT_UINT_WITHIN(1, flash.erases[0], flash.erases[1]);
+
+    // Booting rebuilds it from no more than the headers and a bank
+    flash.resetCounts();
+    TestEeprom rebooted(flash);
+    TEST_ASSERT_TRUE(rebooted.Begin());
+    const uint32_t bytesRead = flash.bytesRead;
+    TEST_ASSERT_TRUE(bytesRead <= FlashEmulator::BankSize + 2 * sizeof(TestLog::bankHeader_t));
+    TestStore loaded;
+    loaded.SetStorageProvider(&rebooted);
+    test_config_t check;
+    TEST_ASSERT_TRUE(loaded.Load(&check, sizeof(check)));
+    TEST_ASSERT_EQUAL_MEMORY(&config, &check, sizeof(config));
+
+    printf("flash log  %u bytes programmed and %uus busy per change, %u erases in %u changes, %u bytes read to load\n",
+           bytesPerChange, usPerChange, erasingCommits, changes, bytesRead);
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_flash_log_records);
+    RUN_TEST(test_flash_log_power_loss);
+    RUN_TEST(test_flash_log_config_changes);
+    UNITY_END();
+
+    return 0;
+}
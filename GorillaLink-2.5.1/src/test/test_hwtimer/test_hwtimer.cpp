@@ -0,0 +1,353 @@
+#include <cstdint>
+#include <unity.h>
+#include "hwTimer.h"
+#include "PFD.h"
+#include "PLL.h"
+
+#define INTERVAL 2000
+// An interrupt that can preempt the timer and one that can't
+#define RADIO_IRQ 0
+#define UART_IRQ 2
+
+hwTimer timer;
+
+static uint32_t tickCount;
+static uint32_t tockCount;
+static uint64_t lastTick;
+static uint64_t lastTock;
+
+static void countTick()
+{
+    ++tickCount;
+    lastTick = NativeClock::now();
+}
+
+static void countTock()
+{
+    ++tockCount;
+    lastTock = NativeClock::now();
+}
+
+static void start(uint32_t interval)
+{
+    NativeClock::reset();
+    tickCount = 0;
+    tockCount = 0;
+    timer.callbackTick = &countTick;
+    timer.callbackTock = &countTock;
+    timer.init();
+    timer.updateInterval(interval);
+    timer.resetFreqOffset();
+    timer.phaseShift(0);
+    timer.resume();
+}
+
+// Index of the next event of the given type from index on, eventCount() if none
+static uint32_t findEvent(uint32_t index, uint8_t event)
+{
+    while (index < NativeClock::eventCount() && NativeClock::event(index).event != event)
+        ++index;
+    return index;
+}
+
+void test_hwtimer_tick_tock(void)
+{
+    start(INTERVAL);
+    // Resuming fires the tock straight away
+    NativeClock::advance(0);
+    TEST_ASSERT_EQUAL(1, tockCount);
+    TEST_ASSERT_EQUAL(0, tickCount);
+
+    NativeClock::advance(INTERVAL / 2);
+    TEST_ASSERT_EQUAL(1, tickCount);
+    TEST_ASSERT_EQUAL(INTERVAL / 2, lastTick);
+
+    NativeClock::advance(100 * INTERVAL - INTERVAL / 2);
+    TEST_ASSERT_EQUAL(101, tockCount);
+    TEST_ASSERT_EQUAL(100, tickCount);
+    TEST_ASSERT_EQUAL(100 * INTERVAL, lastTock);
+    TEST_ASSERT_EQUAL(100 * INTERVAL - INTERVAL / 2, lastTick);
+
+    timer.stop();
+    NativeClock::advance(10 * INTERVAL);
+    TEST_ASSERT_EQUAL(101, tockCount);
+    TEST_ASSERT_EQUAL(nativeTimerStop, NativeClock::event(NativeClock::eventCount() - 1).event);
+}
+
+void test_hwtimer_clock(void)
+{
+    NativeClock::reset();
+    TEST_ASSERT_EQUAL(0, micros());
+    delayMicroseconds(1500);
+    TEST_ASSERT_EQUAL(1500, micros());
+    TEST_ASSERT_EQUAL(1, millis());
+    delay(10);
+    TEST_ASSERT_EQUAL(11500, micros());
+    TEST_ASSERT_EQUAL(11, millis());
+
+    // micros() wraps at 32 bits like on the MCUs, the clock underneath doesn't
+    NativeClock::advance(0x100000000ULL - 11500 + 7);
+    TEST_ASSERT_EQUAL(7, micros());
+    TEST_ASSERT_EQUAL(0x100000007ULL, NativeClock::now());
+}
+
+void test_hwtimer_phase_shift(void)
+{
+    start(INTERVAL);
+    NativeClock::advance(INTERVAL / 2);
+    // A shift asked for at the tick moves the tock after the next one
+    timer.phaseShift(100);
+    NativeClock::advance(INTERVAL / 2);
+    TEST_ASSERT_EQUAL(INTERVAL, lastTock);
+    NativeClock::advance(INTERVAL + 100);
+    TEST_ASSERT_EQUAL(2 * INTERVAL + 100, lastTock);
+    // and only that one, the grid moves with it
+    NativeClock::advance(INTERVAL);
+    TEST_ASSERT_EQUAL(3 * INTERVAL + 100, lastTock);
+    TEST_ASSERT_EQUAL(3 * INTERVAL + 100 - INTERVAL / 2, lastTick);
+
+    // It is logged on the tock that applied it
+    const uint32_t shifted = findEvent(findEvent(0, nativeTimerTock) + 1, nativeTimerTock);
+    TEST_ASSERT_EQUAL(100, NativeClock::event(shifted).value);
+    TEST_ASSERT_EQUAL(INTERVAL, NativeClock::event(shifted).us);
+
+    // No more than a quarter interval at a time
+    timer.phaseShift(-INTERVAL);
+    TEST_ASSERT_EQUAL(-INTERVAL / 4, timer.PhaseShift);
+    timer.phaseShift(INTERVAL);
+    TEST_ASSERT_EQUAL(INTERVAL / 4, timer.PhaseShift);
+}
+
+void test_hwtimer_freq_offset(void)
+{
+    start(INTERVAL);
+    timer.incFreqOffset();
+    timer.incFreqOffset();
+    timer.decFreqOffset();
+    timer.incFreqOffset();
+    NativeClock::advance(10 * INTERVAL);
+    // 2us longer every half interval from the first tock on
+    TEST_ASSERT_EQUAL(9 * (INTERVAL + 4), lastTock);
+    TEST_ASSERT_EQUAL(10, tockCount);
+
+    // The half interval already running keeps it
+    timer.resetFreqOffset();
+    NativeClock::advance(2 * INTERVAL + 100);
+    TEST_ASSERT_EQUAL(10 * (INTERVAL + 4) + 2 * INTERVAL, lastTock);
+}
+
+static uint32_t radioIsrs;
+static uint64_t radioIsrAt;
+static uint32_t uartIsrs;
+static uint64_t uartIsrAt;
+
+static void radioIsr()
+{
+    ++radioIsrs;
+    radioIsrAt = NativeClock::now();
+}
+
+static void uartIsr()
+{
+    ++uartIsrs;
+    uartIsrAt = NativeClock::now();
+}
+
+// A tock that busy waits for 300us, with two interrupts coming due 100us in
+static void busyTock()
+{
+    const uint64_t now = NativeClock::now();
+    NativeClock::trigger(RADIO_IRQ, now + 100);
+    NativeClock::trigger(UART_IRQ, now + 100);
+    delayMicroseconds(300);
+    countTock();
+}
+
+void test_hwtimer_preemption(void)
+{
+    start(INTERVAL);
+    radioIsrs = 0;
+    uartIsrs = 0;
+    NativeClock::attachInterrupt(RADIO_IRQ, radioIsr);
+    NativeClock::attachInterrupt(UART_IRQ, uartIsr);
+    timer.callbackTock = &busyTock;
+    NativeClock::advance(0);
+
+    // The radio preempts the timer at its time, the UART waits for the timer to return
+    TEST_ASSERT_EQUAL(1, radioIsrs);
+    TEST_ASSERT_EQUAL(100, radioIsrAt);
+    TEST_ASSERT_EQUAL(1, uartIsrs);
+    TEST_ASSERT_EQUAL(300, uartIsrAt);
+    TEST_ASSERT_EQUAL(1, tockCount);
+
+    // resume, timer in, its tock, radio in and out, timer out, UART in and out
+    const uint8_t expected[][3] = {
+        // event, irq running, value
+        {nativeTimerResume, 0xFF, 0},
+        {nativeIsrEnter, 0xFF, 0xFF},
+        {nativeTimerTock, HWTIMER_IRQ, 0},
+        {nativeIsrEnter, HWTIMER_IRQ, HWTIMER_IRQ},
+        {nativeIsrExit, HWTIMER_IRQ, RADIO_IRQ},
+        {nativeIsrExit, 0xFF, HWTIMER_IRQ},
+        {nativeIsrEnter, 0xFF, 0xFF},
+        {nativeIsrExit, 0xFF, UART_IRQ},
+    };
+    TEST_ASSERT_EQUAL(sizeof(expected) / sizeof(expected[0]), NativeClock::eventCount());
+    for (uint8_t i = 0; i < sizeof(expected) / sizeof(expected[0]); ++i)
+    {
+        const nativeEvent_t &e = NativeClock::event(i);
+        TEST_ASSERT_EQUAL(expected[i][0], e.event);
+        TEST_ASSERT_EQUAL((int8_t)expected[i][1], e.irq);
+        TEST_ASSERT_EQUAL((int8_t)expected[i][2], e.value);
+    }
+    TEST_ASSERT_EQUAL(100, NativeClock::event(3).us);
+    TEST_ASSERT_EQUAL(300, NativeClock::event(5).us);
+
+    // The timer kept to its own time through it
+    timer.callbackTock = &countTock;
+    NativeClock::advance(INTERVAL);
+    TEST_ASSERT_EQUAL(INTERVAL, lastTock);
+    NativeClock::detachInterrupt(RADIO_IRQ);
+    NativeClock::detachInterrupt(UART_IRQ);
+}
+
+void test_hwtimer_pause(void)
+{
+    // Paused from the main loop just after the tock for a whole number of
+    // intervals, as CommitConfigSlice() in tx_main.cpp does (the link sim
+    // runs it for real)
+    const uint32_t intervals[] = {1000, 2000, 4000, 6666, 20000};
+    const uint32_t cycles = 4;
+    for (uint8_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); ++i)
+    {
+        const uint32_t interval = intervals[i];
+        start(interval);
+        NativeClock::advance(5 * interval + 10);
+        const uint64_t lastSent = lastTock;
+        TEST_ASSERT_EQUAL(5 * interval, lastSent);
+        const uint32_t ticksBefore = tickCount;
+
+        timer.pause(cycles * interval);
+        // pause() returns as the tick that took it has passed, without calling back
+        TEST_ASSERT_EQUAL(lastSent + interval / 2, NativeClock::now());
+        TEST_ASSERT_EQUAL(ticksBefore, tickCount);
+        const uint32_t pause = findEvent(0, nativeTimerPause);
+        const uint32_t tick = findEvent(pause, nativeTimerTick);
+        TEST_ASSERT_EQUAL(cycles * interval, NativeClock::event(pause).value);
+        TEST_ASSERT_EQUAL(cycles * interval - interval / 2, NativeClock::event(tick).value);
+
+        // The next tock is back on the grid, the paused cycles later
+        NativeClock::advance(cycles * interval - interval / 2 - 1);
+        TEST_ASSERT_EQUAL(lastSent, lastTock);
+        NativeClock::advance(interval + 1);
+        TEST_ASSERT_EQUAL(lastSent + (cycles + 1) * interval, lastTock);
+        TEST_ASSERT_EQUAL(ticksBefore + 1, tickCount);
+        TEST_ASSERT_EQUAL(lastTock - interval / 2, lastTick);
+        timer.stop();
+    }
+}
+
+/**
+ * The RX timer correction of rx_main.cpp on the native timer: the radio
+ * interrupt of every packet from a TX whose crystal is off by ppm gives the
+ * PFD its external event, the tock the internal one and the tick hands the
+ * phase error to the PLL, connected once the error is acquired.
+ **/
+#define PACKET_TO_TOCK_SLACK 200
+
+static PFD pfd;
+static PLL pll;
+static double txPacketAt;
+static double txInterval;
+static uint32_t lossEvery;
+static uint32_t packets;
+static bool tracking;
+static int32_t lastError;
+
+static void rxPacketIsr()
+{
+    if (!lossEvery || (++packets % lossEvery) != 0)
+        pfd.extEvent(micros() + PACKET_TO_TOCK_SLACK);
+    txPacketAt += txInterval;
+    NativeClock::trigger(RADIO_IRQ, (uint64_t)txPacketAt);
+}
+
+static void rxTock()
+{
+    pfd.intEvent(micros());
+    countTock();
+}
+
+static void rxTick()
+{
+    const bool gotPacket = pfd.calcResult();
+    pfd.reset();
+    if (gotPacket)
+    {
+        tracking = tracking || pll.getLockError() <= PLL_ACQUIRE_ERROR_US;
+        lastError = pfd.getResult();
+        timer.phaseShift(pll.update(lastError, tracking));
+    }
+    else
+    {
+        timer.phaseShift(pll.coast());
+    }
+    countTick();
+}
+
+void test_hwtimer_rx_phase_lock(void)
+{
+    const int32_t ppms[] = {0, 60, -60};
+    for (uint8_t i = 0; i < sizeof(ppms) / sizeof(ppms[0]); ++i)
+    {
+        start(INTERVAL);
+        timer.callbackTick = &rxTick;
+        timer.callbackTock = &rxTock;
+        pll.init(INTERVAL);
+        pfd.reset();
+        tracking = false;
+        packets = 0;
+        lossEvery = i == 2 ? 3 : 0;
+        // The first packet lands anywhere in the RX interval
+        txInterval = INTERVAL * (1 + ppms[i] * 1e-6);
+        txPacketAt = 737;
+        NativeClock::attachInterrupt(RADIO_IRQ, rxPacketIsr);
+        NativeClock::trigger(RADIO_IRQ, (uint64_t)txPacketAt);
+
+        NativeClock::advance(2000 * INTERVAL);
+        TEST_ASSERT_TRUE(tracking);
+        TEST_ASSERT_TRUE(pll.isLocked());
+        TEST_ASSERT_INT_WITHIN(3, ppms[i], pll.getFreqPpm());
+
+        // and the tocks now come PACKET_TO_TOCK_SLACK after the packets
+        int32_t worst = 0;
+        for (uint16_t k = 0; k < 200; ++k)
+        {
+            NativeClock::advance(INTERVAL);
+            if (abs(lastError) > worst)
+                worst = abs(lastError);
+        }
+        TEST_ASSERT_TRUE(worst <= 2);
+        timer.stop();
+        NativeClock::detachInterrupt(RADIO_IRQ);
+    }
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_hwtimer_tick_tock);
+    RUN_TEST(test_hwtimer_clock);
+    RUN_TEST(test_hwtimer_phase_shift);
+    RUN_TEST(test_hwtimer_freq_offset);
+    RUN_TEST(test_hwtimer_preemption);
+    RUN_TEST(test_hwtimer_pause);
+    RUN_TEST(test_hwtimer_rx_phase_lock);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+// The timing is only compiled in on request, build it here on the host clock
+#define DEBUG_ISR_TIMING
+#include <cstdint>
+#include <unity.h>
+#include "ISRTIMING.h"
+#include "../../lib/ISRTIMING/ISRTIMING.cpp"
+
+void test_isr_timing_stats(void)
+{
+    ISRTiming::init();
+    const uint32_t perUs = ISRTiming::cyclesPerUs();
+    ISRTiming::record(isrRadio, 3 * perUs);
+    ISRTiming::record(isrRadio, 10 * perUs);
+    ISRTiming::record(isrRadio, 5 * perUs);
+
+    isrTimingStats_t stats;
+    ISRTiming::get(isrRadio, stats);
+    TEST_ASSERT_EQUAL(3, stats.count);
+    TEST_ASSERT_EQUAL(3, ISRTiming::toMicros(stats.min));
+    TEST_ASSERT_EQUAL(10, ISRTiming::toMicros(stats.max));
+    TEST_ASSERT_EQUAL(6, ISRTiming::toMicros((uint32_t)(stats.total / stats.count)));
+
+    // The other points are untouched
+    ISRTiming::get(isrTimerTick, stats);
+    TEST_ASSERT_EQUAL(0, stats.count);
+
+    ISRTiming::reset();
+    ISRTiming::get(isrRadio, stats);
+    TEST_ASSERT_EQUAL(0, stats.count);
+    TEST_ASSERT_EQUAL(0, stats.total);
+}
+
+void test_isr_timing_histogram(void)
+{
+    ISRTiming::reset();
+    const uint32_t perUs = ISRTiming::cyclesPerUs();
+    // <1, <2, <4, <4, <8 ... <64, and two past the end
+    const uint32_t us[] = {0, 1, 2, 3, 4, 8, 16, 32, 64, 1000};
+    for (uint32_t i = 0; i < sizeof(us) / sizeof(us[0]); ++i)
+        ISRTiming::record(isrCRSFin, us[i] * perUs);
+
+    isrTimingStats_t stats;
+    ISRTiming::get(isrCRSFin, stats);
+    const uint32_t expected[ISR_TIMING_BUCKETS] = {1, 1, 2, 1, 1, 1, 1, 2};
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, stats.histogram, ISR_TIMING_BUCKETS);
+}
+
+static void busyWait(uint32_t us)
+{
+    const uint32_t start = ISRTiming::cycles();
+    while (ISRTiming::cycles() - start < us * ISRTiming::cyclesPerUs())
+        ;
+}
+
+static void instrumented(uint32_t us)
+{
+    ISR_TIMING_SCOPE(isrTimerTock);
+    busyWait(us);
+}
+
+void test_isr_timing_scope(void)
+{
+    ISRTiming::reset();
+    instrumented(100);
+    instrumented(200);
+
+    isrTimingStats_t stats;
+    ISRTiming::get(isrTimerTock, stats);
+    TEST_ASSERT_EQUAL(2, stats.count);
+    TEST_ASSERT_GREATER_OR_EQUAL(100, ISRTiming::toMicros(stats.min));
+    TEST_ASSERT_GREATER_OR_EQUAL(200, ISRTiming::toMicros(stats.max));
+    // Both land in the >=64us bucket
+    TEST_ASSERT_EQUAL(2, stats.histogram[ISR_TIMING_BUCKETS - 1]);
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_isr_timing_stats);
+    RUN_TEST(test_isr_timing_histogram);
+    RUN_TEST(test_isr_timing_scope);
+    UNITY_END();
+
+    return 0;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// The LQCALC library is ignored by the native build, the header-only class is still used
+#include "../../lib/LQCALC/LQCALC.h"
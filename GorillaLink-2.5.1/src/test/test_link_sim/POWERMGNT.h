@@ -0,0 +1,60 @@
+#pragma once
+
+/**
+ * Stand-in for the POWERMGNT library, which needs the DAC and PA hardware.
+ * The output power only matters to the firmware as a value reported over
+ * CRSF and Lua, so the simulated nodes just remember it.
+ **/
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum
+{
+    PWR_10mW = 0,
+    PWR_25mW = 1,
+    PWR_50mW = 2,
+    PWR_100mW = 3,
+    PWR_250mW = 4,
+    PWR_500mW = 5,
+    PWR_1000mW = 6,
+    PWR_2000mW = 7,
+    PWR_COUNT = 8
+} PowerLevels_e;
+
+#define MinPower PWR_10mW
+#define MaxPower PWR_250mW
+#define DefaultPower PWR_50mW
+
+class POWERMGNT
+{
+public:
+    static void setPower(PowerLevels_e Power) { current() = (Power > MaxPower) ? MaxPower : Power; }
+    static PowerLevels_e incPower()
+    {
+        if (current() < MaxPower)
+            current() = (PowerLevels_e)(current() + 1);
+        return current();
+    }
+    static PowerLevels_e decPower()
+    {
+        if (current() > MinPower)
+            current() = (PowerLevels_e)(current() - 1);
+        return current();
+    }
+    static PowerLevels_e currPower() { return current(); }
+    static uint8_t powerToCrsfPower(PowerLevels_e Power) { return Power; }
+    static PowerLevels_e getDefaultPower() { return DefaultPower; }
+    static uint8_t getPowerIndBm() { return 10 + 3 * current(); }
+    static void setDefaultPower() { setPower(DefaultPower); }
+    static void init() { setDefaultPower(); }
+    static void SetPowerCaliValues(int8_t *values, size_t size) { (void)values; (void)size; }
+    static void GetPowerCaliValues(int8_t *values, size_t size) { (void)values; (void)size; }
+
+private:
+    static PowerLevels_e &current()
+    {
+        static PowerLevels_e power = DefaultPower;
+        return power;
+    }
+};
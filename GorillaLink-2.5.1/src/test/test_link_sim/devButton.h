@@ -0,0 +1,4 @@
+#pragma once
+
+// The BUTTON library is ignored by the native build, no button is defined for the simulated targets
+#include "../../lib/BUTTON/devButton.h"
@@ -0,0 +1,4 @@
+#pragma once
+
+// The EEPROM library is ignored by the native build, its header is still needed by config.h
+#include "../../lib/EEPROM/elrs_eeprom.h"
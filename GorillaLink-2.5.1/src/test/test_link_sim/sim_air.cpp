@@ -0,0 +1,171 @@
+#include "sim_air.h"
+#include "sim_clock.h"
+
+#include <string.h>
+
+#define SIM_AIR_MAX_PORTS 4
+#define SIM_AIR_MAX_PAYLOAD 32
+
+typedef struct {
+    uint32_t id;
+    SimRadioPort *to;
+    int64_t carrierHz;
+    uint32_t modemKey;
+    uint32_t payloadKey;
+    uint8_t len;
+    uint8_t data[SIM_AIR_MAX_PAYLOAD];
+} SimAirPacket;
+
+// Packets in flight, a slot is reused once the packet has been delivered
+#define SIM_AIR_MAX_INFLIGHT 32
+static SimAirPacket inflight[SIM_AIR_MAX_INFLIGHT];
+
+static SimRadioPort *ports[SIM_AIR_MAX_PORTS];
+static uint8_t portCount;
+static uint32_t nextPacketId;
+
+double (*SimAir::carrierLossPercent)(int64_t carrierHz);
+
+SimRadioPort::SimRadioPort()
+    : listening(false), listenSinceNs(0), listenUntilNs(UINT64_MAX), transmitting(false),
+      carrierHz(0), crystalPpm(0.0), bandwidthHz(0), modemKey(0), payloadKey(0),
+      txPackets(0), rxDelivered(0), rxCorrupted(0), rxLost(0), rxMissed(0), lockedPacket(0),
+      spiTransfers(0), busyWaitUs(0), isrCount(0), isrSpiTransfers(0), isrBusyWaitUs(0)
+{
+    memset(&channel, 0, sizeof(channel));
+}
+
+static bool carrierMatches(const SimRadioPort *port, int64_t carrierHz)
+{
+    // LoRa tolerates roughly +/-25% of the bandwidth of carrier offset
+    int64_t diff = port->carrierHz - carrierHz;
+    if (diff < 0)
+        diff = -diff;
+    return diff <= (int64_t)(port->bandwidthHz / 4);
+}
+
+static void packetStart(void *ctx, uint32_t id)
+{
+    SimAirPacket *pkt = (SimAirPacket *)ctx;
+    if (pkt->id != id)
+        return;
+
+    SimRadioPort *port = pkt->to;
+    const uint64_t now = SimClock::nowNs();
+    if (port->listening && !port->transmitting && port->lockedPacket == 0
+        && port->listenSinceNs <= now && now <= port->listenUntilNs
+        && port->modemKey == pkt->modemKey && carrierMatches(port, pkt->carrierHz))
+    {
+        port->lockedPacket = pkt->id;
+    }
+    else
+    {
+        ++port->rxMissed;
+        pkt->id = 0;
+    }
+}
+
+static void packetEnd(void *ctx, uint32_t id)
+{
+    SimAirPacket *pkt = (SimAirPacket *)ctx;
+    if (pkt->id != id)
+        return;
+    pkt->id = 0;
+
+    SimRadioPort *port = pkt->to;
+    if (port->lockedPacket != id)
+    {
+        // Receiver hopped, transmitted or changed mode during the packet
+        ++port->rxMissed;
+        return;
+    }
+    port->lockedPacket = 0;
+
+    double loss = port->channel.lossPercent;
+    if (SimAir::carrierLossPercent)
+        loss += SimAir::carrierLossPercent(pkt->carrierHz);
+    if (SimClock::chance(loss / 100.0))
+    {
+        ++port->rxLost;
+        return;
+    }
+
+    uint8_t data[SIM_AIR_MAX_PAYLOAD];
+    memcpy(data, pkt->data, pkt->len);
+    if (port->payloadKey != pkt->payloadKey)
+    {
+        // The preamble and sync word were found, the payload is decoded wrong
+        for (uint8_t i = 0; i < pkt->len; ++i)
+            data[i] = SimClock::random();
+        ++port->rxCorrupted;
+    }
+    else if (SimClock::chance(port->channel.corruptPercent / 100.0))
+    {
+        uint32_t bit = SimClock::random() % (pkt->len * 8);
+        data[bit / 8] ^= 1 << (bit % 8);
+        ++port->rxCorrupted;
+    }
+    else
+    {
+        ++port->rxDelivered;
+    }
+    port->airReceive(data, pkt->len, port->channel.rssi, port->channel.snr,
+                     (int32_t)(pkt->carrierHz - port->carrierHz));
+}
+
+void SimAir::reset()
+{
+    memset(inflight, 0, sizeof(inflight));
+    portCount = 0;
+    nextPacketId = 1;
+    carrierLossPercent = nullptr;
+}
+
+void SimAir::attach(SimRadioPort *port)
+{
+    if (portCount < SIM_AIR_MAX_PORTS)
+        ports[portCount++] = port;
+}
+
+void SimAir::transmit(SimRadioPort *from, const uint8_t *data, uint8_t len, uint32_t timeOnAirNs)
+{
+    ++from->txPackets;
+    if (len > SIM_AIR_MAX_PAYLOAD)
+        len = SIM_AIR_MAX_PAYLOAD;
+
+    for (uint8_t i = 0; i < portCount; ++i)
+    {
+        SimRadioPort *to = ports[i];
+        if (to == from)
+            continue;
+
+        SimAirPacket *pkt = nullptr;
+        for (uint8_t slot = 0; slot < SIM_AIR_MAX_INFLIGHT; ++slot)
+        {
+            if (inflight[slot].id == 0)
+            {
+                pkt = &inflight[slot];
+                break;
+            }
+        }
+        if (pkt == nullptr)
+            continue;
+
+        pkt->id = nextPacketId++;
+        pkt->to = to;
+        pkt->carrierHz = from->carrierHz;
+        pkt->modemKey = from->modemKey;
+        pkt->payloadKey = from->payloadKey;
+        pkt->len = len;
+        memcpy(pkt->data, data, len);
+
+        const uint64_t startNs = SimClock::nowNs() + to->channel.delayUs * 1000ULL;
+        SimClock::schedule(startNs, &packetStart, pkt, pkt->id);
+        SimClock::schedule(startNs + timeOnAirNs, &packetEnd, pkt, pkt->id);
+    }
+}
+
+void SimAir::portChanged(SimRadioPort *port)
+{
+    port->lockedPacket = 0;
+}
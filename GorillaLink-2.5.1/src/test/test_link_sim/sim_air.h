@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * The simulated RF medium. Radio chip models attach a SimRadioPort and
+ * hand finished transmissions to SimAir, which delivers them to every other
+ * port that was listening on a compatible carrier and modulation for the
+ * whole packet, subject to that port's SimChannelParams.
+ **/
+
+typedef struct {
+    double lossPercent;     // packets that are never detected by the receiver
+    double corruptPercent;  // packets that arrive with a flipped bit (exercises the OTA CRC)
+    uint32_t delayUs;       // added between the transmitter and this receiver
+    int8_t rssi;            // dBm reported by the receiver
+    int8_t snr;             // dB reported by the receiver
+} SimChannelParams;
+
+class SimRadioPort
+{
+public:
+    SimRadioPort();
+    virtual ~SimRadioPort() {}
+
+    // Called by SimAir at the end of a packet this port has been receiving
+    virtual void airReceive(const uint8_t *data, uint8_t len, int8_t rssi, int8_t snr, int32_t freqErrorHz) = 0;
+
+    // Receiver state, maintained by the chip model
+    bool listening;
+    uint64_t listenSinceNs;
+    uint64_t listenUntilNs;   // UINT64_MAX for continuous receive
+    bool transmitting;
+    int64_t carrierHz;        // actual carrier, including crystal error
+    double crystalPpm;        // radio crystal error applied to carrierHz, positive runs fast
+    uint32_t bandwidthHz;
+    uint32_t modemKey;        // modulation signature, both ends must match
+    uint32_t payloadKey;      // coding rate and fixed payload length, a packet that only
+                              // differs in these is received but garbled
+
+    SimChannelParams channel; // applied to packets received by this port
+
+    // Ground truth counters
+    uint32_t txPackets;
+    uint32_t rxDelivered;
+    uint32_t rxCorrupted;
+    uint32_t rxLost;          // dropped by the channel model
+    uint32_t rxMissed;        // not listening on the right carrier when the packet started
+
+    uint32_t lockedPacket;    // id of the packet currently being received, 0 if none
+
+    // SPI cost, counted by the chip model's hal: NSS cycles and the time the
+    // firmware would have spun waiting on BUSY, in total and inside DIO ISRs
+    uint32_t spiTransfers;
+    uint32_t busyWaitUs;
+    uint32_t isrCount;
+    uint32_t isrSpiTransfers;
+    uint32_t isrBusyWaitUs;
+};
+
+class SimAir
+{
+public:
+    static void reset();
+    static void attach(SimRadioPort *port);
+    static void transmit(SimRadioPort *from, const uint8_t *data, uint8_t len, uint32_t timeOnAirNs);
+    // The port changed carrier, modulation or mode, abandon any packet in progress
+    static void portChanged(SimRadioPort *port);
+
+    // Optional extra loss applied per carrier frequency, e.g. a jammer on some channels
+    static double (*carrierLossPercent)(int64_t carrierHz);
+};
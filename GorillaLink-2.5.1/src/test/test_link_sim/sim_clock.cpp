@@ -0,0 +1,81 @@
+#include "sim_clock.h"
+
+#include <queue>
+#include <vector>
+
+uint64_t SimClock::currentNs;
+uint64_t SimClock::rngState;
+
+typedef struct {
+    uint64_t atNs;
+    uint64_t seq;  // FIFO order for events due at the same time
+    SimEventCallback callback;
+    void *ctx;
+    uint32_t arg;
+} SimEvent;
+
+struct SimEventLater
+{
+    bool operator()(const SimEvent &a, const SimEvent &b) const
+    {
+        return (a.atNs != b.atNs) ? (a.atNs > b.atNs) : (a.seq > b.seq);
+    }
+};
+
+static std::priority_queue<SimEvent, std::vector<SimEvent>, SimEventLater> events;
+static uint64_t eventSeq;
+
+void SimClock::reset(uint64_t seed)
+{
+    currentNs = 0;
+    eventSeq = 0;
+    rngState = seed ? seed : 0x9E3779B97F4A7C15ULL;
+    while (!events.empty())
+        events.pop();
+}
+
+void SimClock::schedule(uint64_t atNs, SimEventCallback callback, void *ctx, uint32_t arg)
+{
+    SimEvent ev = {atNs < currentNs ? currentNs : atNs, eventSeq++, callback, ctx, arg};
+    events.push(ev);
+}
+
+uint64_t SimClock::nextEventNs()
+{
+    return events.empty() ? UINT64_MAX : events.top().atNs;
+}
+
+bool SimClock::runNext(uint64_t limitNs)
+{
+    if (events.empty() || events.top().atNs > limitNs)
+        return false;
+
+    SimEvent ev = events.top();
+    events.pop();
+    currentNs = ev.atNs;
+    ev.callback(ev.ctx, ev.arg);
+    return true;
+}
+
+void SimClock::runUntil(uint64_t limitNs)
+{
+    while (runNext(limitNs))
+        ;
+    if (currentNs < limitNs)
+        currentNs = limitNs;
+}
+
+uint32_t SimClock::random()
+{
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (uint32_t)((rngState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+bool SimClock::chance(double probability)
+{
+    if (probability <= 0.0)
+        return false;
+    return random() < (uint32_t)(probability * 4294967295.0);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Virtual time base shared by every simulated node and the air between them.
+ * Time only moves when an event is dispatched, so a run is fully
+ * deterministic and as fast as the host can execute the firmware code.
+ **/
+
+typedef void (*SimEventCallback)(void *ctx, uint32_t arg);
+
+class SimClock
+{
+public:
+    static void reset(uint64_t seed);
+
+    static uint64_t nowNs() { return currentNs; }
+
+    // Queue callback(ctx, arg) to run at the given absolute time (never in the past)
+    static void schedule(uint64_t atNs, SimEventCallback callback, void *ctx, uint32_t arg = 0);
+    // Dispatch the next event if it is due at or before limitNs, returns false if none was
+    static bool runNext(uint64_t limitNs);
+    // Dispatch all events up to and including limitNs, then leave the clock at limitNs
+    static void runUntil(uint64_t limitNs);
+    static uint64_t nextEventNs();
+
+    // Deterministic PRNG for the channel model (xorshift64*)
+    static uint32_t random();
+    // True with the given probability, 0.0 - 1.0
+    static bool chance(double probability);
+
+private:
+    static uint64_t currentNs;
+    static uint64_t rngState;
+};
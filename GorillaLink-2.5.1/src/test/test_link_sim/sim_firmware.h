@@ -0,0 +1,32 @@
+#pragma once
+
+/**
+ * Common prologue for the node translation units (sim_tx*.cpp, sim_rx*.cpp).
+ * The firmware sources are included inside a namespace per node, so every
+ * system header they use must already have been included at global scope,
+ * otherwise its include guard would put the standard library inside the
+ * namespace.
+ **/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+
+#include "targets.h"
+
+#include "sim_clock.h"
+#include "sim_node.h"
@@ -0,0 +1,89 @@
+#include "sim_node.h"
+#include "sim_clock.h"
+
+// micros() calls from loop() without time moving before it is treated as a busy-wait
+#define SIM_SPIN_LIMIT 200
+
+SimNode::SimNode()
+    : clockPpm(0.0), bootOffsetNs(0), loopIntervalUs(100), isrLatencyMaxUs(0), spiJitterMaxUs(0),
+      isrDepth(0), spinCount(0), isrDelayNs(0)
+{
+}
+
+void SimNode::isrExit()
+{
+    if (--isrDepth == 0)
+        isrDelayNs = 0;
+}
+
+void SimNode::radioIsrEnter()
+{
+    isrEnter();
+    // Only draw when asked to, so the channel model sees the same random numbers otherwise
+    if (isrLatencyMaxUs)
+        isrDelayNs += SimClock::random() % (isrLatencyMaxUs * 1000 + 1);
+}
+
+void SimNode::spiTransaction()
+{
+    if (inIsr() && spiJitterMaxUs)
+        isrDelayNs += SimClock::random() % (spiJitterMaxUs * 1000 + 1);
+}
+
+void SimNode::start()
+{
+    SimClock::schedule(SimClock::nowNs(), &setupEvent, this);
+}
+
+void SimNode::setupEvent(void *ctx, uint32_t arg)
+{
+    SimNode *node = (SimNode *)ctx;
+    node->setup();
+    SimClock::schedule(SimClock::nowNs() + node->loopIntervalUs * 1000ULL, &loopEvent, node);
+}
+
+void SimNode::loopEvent(void *ctx, uint32_t arg)
+{
+    SimNode *node = (SimNode *)ctx;
+    node->spinCount = 0;
+    node->loop();
+    SimClock::schedule(SimClock::nowNs() + node->loopIntervalUs * 1000ULL, &loopEvent, node);
+}
+
+uint64_t SimNode::localNs() const
+{
+    const double now = (double)SimClock::nowNs();
+    return bootOffsetNs + (uint64_t)(now + now * clockPpm * 1e-6);
+}
+
+uint64_t SimNode::globalNs(uint64_t local) const
+{
+    if (local <= bootOffsetNs)
+        return 0;
+    const double elapsed = (double)(local - bootOffsetNs);
+    // Round up so the event never fires before the local clock has reached the deadline
+    return (uint64_t)(elapsed / (1.0 + clockPpm * 1e-6)) + 1;
+}
+
+uint32_t SimNode::micros()
+{
+    // Firmware code takes no simulated time, so a loop polling micros() would
+    // never exit. Once it has polled enough, let the rest of the world run.
+    if (!inIsr() && ++spinCount > SIM_SPIN_LIMIT)
+    {
+        spinCount = 0;
+        if (!SimClock::runNext(UINT64_MAX))
+            SimClock::runUntil(SimClock::nowNs() + 1000);
+    }
+    return (uint32_t)((localNs() + isrDelayNs) / 1000);
+}
+
+uint32_t SimNode::millis()
+{
+    return (uint32_t)(localNs() / 1000000);
+}
+
+void SimNode::delayUs(uint32_t us)
+{
+    SimClock::runUntil(globalNs(localNs() + us * 1000ULL));
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sim_air.h"
+
+/**
+ * One simulated MCU running a full copy of the TX or RX firmware. Each
+ * node's firmware is compiled into its own namespace (sim_tx*.cpp and
+ * sim_rx*.cpp) and only reaches the rest of the simulation through this
+ * class: the node's local clock behind micros()/millis(), busy-wait
+ * handling, ISR context and the setup()/loop() schedule.
+ **/
+class SimNode
+{
+public:
+    SimNode();
+    virtual ~SimNode() {}
+
+    // Configuration, set before start()
+    double clockPpm;            // MCU crystal error, positive runs fast
+    uint64_t bootOffsetNs;      // local clock reading at simulation time zero
+    uint32_t loopIntervalUs;    // idle time between loop() calls
+    // Radio ISR timing, 0 for an ideal MCU. The DIO ISR starts up to
+    // isrLatencyMaxUs after the edge and each SPI transaction in it takes up
+    // to spiJitterMaxUs as other interrupts get in the way. The ISR still runs
+    // at the edge in simulation time, only the clock it reads runs late.
+    uint32_t isrLatencyMaxUs;
+    uint32_t spiJitterMaxUs;
+
+    // Run setup() now and loop() every loopIntervalUs after that
+    void start();
+
+    uint64_t localNs() const;
+    // Simulation time at which the local clock will read localNs
+    uint64_t globalNs(uint64_t localNs) const;
+
+    uint32_t micros();
+    uint32_t millis();
+    // Blocking delay, other nodes and this node's ISRs keep running
+    void delayUs(uint32_t us);
+
+    void isrEnter() { ++isrDepth; }
+    void isrExit();
+    bool inIsr() const { return isrDepth != 0; }
+    // The same for the radio DIO ISR and for an SPI transaction, for the timing above
+    void radioIsrEnter();
+    void spiTransaction();
+
+    virtual SimRadioPort *radio() = 0;
+
+protected:
+    virtual void setup() = 0;
+    virtual void loop() = 0;
+
+private:
+    static void setupEvent(void *ctx, uint32_t arg);
+    static void loopEvent(void *ctx, uint32_t arg);
+
+    uint32_t isrDepth;
+    uint32_t spinCount;
+    uint64_t isrDelayNs;        // how late the clock reads in the current radio ISR
+};
+
+class SimTxNode : public SimNode
+{
+public:
+    // Number of entries in this build's ExpressLRS_AirRateConfig
+    virtual uint8_t rateCount() = 0;
+    // Select the packet rate index (ExpressLRS_AirRateConfig) and commit it to the config
+    virtual void setRate(uint8_t index) = 0;
+    // Select the OtaSwitchMode_e and commit it to the config, 0 keeps the default
+    virtual void setSwitchMode(uint8_t mode) = 0;
+    // A CRSF RC_CHANNELS_PACKED frame from the handset arrives on the CRSF UART
+    virtual void handsetChannels(const uint16_t channels[16]) = 0;
+    // Whether writing the config out has to erase the flash (ELRS_EEPROM::CommitWillErase)
+    virtual void setCommitErases(bool erases) = 0;
+    // Change a config value that leaves the link alone and stage it to be written out
+    virtual void changeConfig() = 0;
+    // Duration of the last hwTimer.pause() still in the timer's event log, us, 0 if none
+    virtual uint32_t timerPauseUs() = 0;
+    // The last OpenTX sync the TX sent the handset: the packet interval and how long before
+    // the packet the handset's frame came less the safety margin, in 0.1us. false if none yet
+    virtual bool opentxSync(uint32_t *rate, int32_t *offset) = 0;
+
+    virtual bool connected() = 0;
+    virtual uint8_t downlinkLQ() = 0;
+    virtual uint8_t uplinkLQReported() = 0;  // uplink LQ as reported by the RX over telemetry
+};
+
+class SimRxNode : public SimNode
+{
+public:
+    SimRxNode() : rcFrameCallback(nullptr), rcFrameCtx(nullptr) {}
+
+    virtual bool connected() = 0;
+    virtual uint8_t uplinkLQ() = 0;
+    virtual uint8_t rateIndex() = 0;
+    // Last phase error of the packet against the timer, us
+    virtual int32_t phaseOffset() = 0;
+    // The timer's phase lock has settled (tim_locked)
+    virtual bool timerLocked() = 0;
+    // Clock error against the TX the phase lock has learnt, ppm
+    virtual int32_t timerFreqPpm() = 0;
+
+    // Called for every RC channels frame written to the flight controller UART
+    void (*rcFrameCallback)(void *ctx, const uint16_t channels[16]);
+    void *rcFrameCtx;
+};
+
+// Firmware builds linked into the simulator, one instance each per process
+SimTxNode &simTx900();
+SimTxNode &simTx900Dma();   // CRSF input through the DMA ring (USE_CRSF_RX_DMA)
+SimRxNode &simRx900();
+SimTxNode &simTx2400();     // SX1280, LoRa and FLRC
+SimRxNode &simRx2400();
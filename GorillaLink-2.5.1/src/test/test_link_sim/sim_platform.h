@@ -0,0 +1,172 @@
+/**
+ * MCU platform for one simulated node. This file is included INSIDE the
+ * node's namespace ahead of the firmware sources (see sim_tx900.cpp) so that
+ * every micros(), Serial and NativeClock reference in the firmware resolves to
+ * the node's own instance instead of the global native.h stubs.
+ **/
+
+static SimNode *simNode;
+
+inline unsigned long micros() { return simNode->micros(); }
+inline unsigned long millis() { return simNode->millis(); }
+inline void delay(uint32_t ms) { simNode->delayUs(ms * 1000U); }
+inline void delayMicroseconds(uint32_t us) { simNode->delayUs(us); }
+
+// Logging goes nowhere, on the RX it would otherwise be mixed into the CRSF output
+inline void debugPrintf(const char *fmt, ...) { (void)fmt; }
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+using std::min;
+using std::max;
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+/**
+ * UART with a receive queue fed by the simulation and a transmit sink that
+ * the node adapter parses (handset side on the TX, flight controller on the RX)
+ **/
+class HardwareSerial : public ::Stream
+{
+public:
+    HardwareSerial() : sink(nullptr), sinkCtx(nullptr), rxHead(0), rxTail(0) {}
+
+    int available() { return (uint16_t)(rxTail - rxHead); }
+    int read() { return available() ? rxBuf[rxHead++ % sizeof(rxBuf)] : -1; }
+    int peek() { return available() ? rxBuf[rxHead % sizeof(rxBuf)] : -1; }
+    void flush() {}
+    void end() {}
+    void begin(int baud) { (void)baud; }
+    void enableHalfDuplexRx() {}
+    int availableForWrite() { return 256; }
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(uint8_t *s, int l) { return write((const uint8_t *)s, (size_t)l); }
+    size_t write(const uint8_t *s, size_t l)
+    {
+        if (sink)
+            sink(sinkCtx, s, l);
+        return l;
+    }
+
+    int print(const char *s) { (void)s; return 0; }
+    int print(int32_t v, int radix = DEC) { (void)v; (void)radix; return 0; }
+    int println() { return 0; }
+    int println(const char *s) { (void)s; return 0; }
+    int println(int32_t v, int radix = DEC) { (void)v; (void)radix; return 0; }
+
+    // Bytes arriving on the UART RX pin, dropped if the buffer is full
+    void simReceive(const uint8_t *data, size_t len)
+    {
+        while (len-- && (uint16_t)(rxTail - rxHead) < sizeof(rxBuf))
+            rxBuf[rxTail++ % sizeof(rxBuf)] = *data++;
+    }
+
+    void (*sink)(void *ctx, const uint8_t *data, size_t len);
+    void *sinkCtx;
+
+private:
+    uint8_t rxBuf[1024];
+    uint16_t rxHead;
+    uint16_t rxTail;
+};
+
+static HardwareSerial Serial;
+
+/**
+ * The node's own NativeClock, found ahead of the global one in native.h so
+ * the native hwTimer (NATIVE_hwTimer.cpp, built into the node's namespace)
+ * runs on this node's local clock. Interrupts are SimClock events at the
+ * simulation time the local clock reaches them, so MCU clock drift moves
+ * the timer against the other node, and advance() lets the rest of the
+ * simulation run like delayMicroseconds() does.
+ **/
+class NativeClock
+{
+public:
+    static uint64_t now() { return simNode->localNs() / 1000; }
+
+    static void attachInterrupt(uint8_t irq, void (*isr)()) { isrs[irq] = isr; }
+    static void detachInterrupt(uint8_t irq)
+    {
+        isrs[irq] = nullptr;
+        cancel(irq);
+    }
+    static void trigger(uint8_t irq, uint64_t us)
+    {
+        uint64_t at = simNode->globalNs(us * 1000);
+        if (at < SimClock::nowNs())
+            at = SimClock::nowNs();
+        SimClock::schedule(at, &irqEvent, (void *)(uintptr_t)irq, ++generation[irq]);
+    }
+    // The event already scheduled is ignored when it comes due
+    static void cancel(uint8_t irq) { ++generation[irq]; }
+    static void advance(uint64_t us) { simNode->delayUs(us); }
+
+    static void log(uint8_t event, int32_t value)
+    {
+        nativeEvent_t &e = events[count++ % NATIVE_EVENT_LOG_SIZE];
+        e.us = now();
+        e.irq = active;
+        e.event = event;
+        e.value = value;
+    }
+    static uint32_t eventCount() { return count; }
+    static const nativeEvent_t &event(uint32_t index) { return events[index % NATIVE_EVENT_LOG_SIZE]; }
+
+private:
+    static int8_t active;
+    static uint32_t count;
+    static nativeEvent_t events[NATIVE_EVENT_LOG_SIZE];
+    static void (*isrs[NATIVE_IRQ_COUNT])();
+    static uint32_t generation[NATIVE_IRQ_COUNT];
+
+    static void irqEvent(void *ctx, uint32_t gen)
+    {
+        const uint8_t irq = (uintptr_t)ctx;
+        if (gen != generation[irq] || !isrs[irq])
+            return;
+        const int8_t preempted = active;
+        simNode->isrEnter();
+        active = irq;
+        isrs[irq]();
+        active = preempted;
+        simNode->isrExit();
+    }
+};
+
+int8_t NativeClock::active = -1;
+uint32_t NativeClock::count = 0;
+nativeEvent_t NativeClock::events[NATIVE_EVENT_LOG_SIZE];
+void (*NativeClock::isrs[NATIVE_IRQ_COUNT])();
+uint32_t NativeClock::generation[NATIVE_IRQ_COUNT];
+
+/**
+ * EEPROM kept in RAM, starts erased on every simulation run. Whether a
+ * commit has to erase the flash first is up to the scenario.
+ **/
+#include "elrs_eeprom.h"
+
+static uint8_t simEeprom[RESERVED_EEPROM_SIZE];
+static bool simEepromErases;
+
+void ELRS_EEPROM::Begin() {}
+
+uint8_t ELRS_EEPROM::ReadByte(const uint32_t address)
+{
+    return (address < RESERVED_EEPROM_SIZE) ? simEeprom[address] : 0;
+}
+
+void ELRS_EEPROM::WriteByte(const uint32_t address, const uint8_t value)
+{
+    if (address < RESERVED_EEPROM_SIZE)
+        simEeprom[address] = value;
+}
+
+void ELRS_EEPROM::Commit() {}
+bool ELRS_EEPROM::CommitWillErase() { return simEepromErases; }
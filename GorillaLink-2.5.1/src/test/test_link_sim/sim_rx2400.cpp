@@ -0,0 +1,9 @@
+/**
+ * The same RX firmware as sim_rx900.cpp for a 2.4GHz SX1280 receiver.
+ **/
+
+#define SIM_RX_NODE SimRx2400
+#define SIM_RX_FACTORY simRx2400
+#define Regulatory_Domain_ISM_2400 1
+
+#include "sim_rx900.cpp"
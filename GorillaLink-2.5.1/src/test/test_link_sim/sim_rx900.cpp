@@ -0,0 +1,154 @@
+/**
+ * The RX firmware (src/rx_main.cpp) for a 900MHz SX127x receiver, built into
+ * namespace SimRx900 as one node of the link simulation. The CRSF output to
+ * the flight controller is parsed back into channel frames. sim_rx2400.cpp
+ * builds it again for a 2.4GHz SX1280 receiver.
+ **/
+
+#include "sim_firmware.h"
+#if defined(Regulatory_Domain_ISM_2400)
+#include "sim_sx1280.h"
+#else
+#include "sim_sx127x.h"
+#endif
+
+#ifndef SIM_RX_NODE
+#define SIM_RX_NODE SimRx900
+#define SIM_RX_FACTORY simRx900
+#endif
+
+#define TARGET_RX 1
+#undef CRSF_TX_MODULE
+#ifndef LATEST_COMMIT
+#define LATEST_COMMIT 0
+#endif
+#ifndef LATEST_VERSION
+#define LATEST_VERSION 0
+#endif
+
+namespace SIM_RX_NODE {
+
+#include "sim_platform.h"
+
+#if defined(Regulatory_Domain_ISM_2400)
+#include "SX1280Driver.h"
+#else
+#include "SX127xDriver.h"
+#endif
+// The mod settings in common.h are only declared outside of unit tests
+#undef UNIT_TEST
+#include "common.h"
+#define UNIT_TEST 1
+#if defined(Regulatory_Domain_ISM_2400)
+#include "sim_sx1280_hal.h"
+#else
+#include "sim_sx127x_hal.h"
+#endif
+
+#include "../../src/rx_main.cpp"
+#include "../../src/common.cpp"
+#include "../../src/options.cpp"
+#if defined(Regulatory_Domain_ISM_2400)
+#include "../../lib/SX1280Driver/SX1280.cpp"
+#else
+#include "../../lib/SX127xDriver/SX127x.cpp"
+#endif
+#include "../../lib/CRSF/CRSF.cpp"
+#include "../../lib/DEVICE/device.cpp"
+#include "../../lib/FHSS/FHSS.cpp"
+#include "../../lib/FHSS/random.cpp"
+#include "../../lib/CRC/crc.cpp"
+#include "../../lib/HWTIMER/NATIVE_hwTimer.cpp"
+// Only the packers for this side of the link, as in the firmware build
+#undef UNIT_TEST
+#include "../../lib/OTA/OTA.cpp"
+#define UNIT_TEST 1
+#include "../../lib/CONFIG/config.cpp"
+#include "../../lib/MSP/msp.cpp"
+#include "../../lib/Telemetry/telemetry.cpp"
+#include "../../lib/StubbornSender/stubborn_sender.cpp"
+#include "../../lib/StubbornReceiver/stubborn_receiver.cpp"
+#include "../../lib/TelemetryDelta/telemetry_delta.cpp"
+
+class Node : public SimRxNode
+{
+public:
+    Node() : fcFrameLen(0)
+    {
+        simNode = this;
+#if defined(Regulatory_Domain_ISM_2400)
+        simSX1280 = &chip;
+        chip.dio1 = &simSX1280Dio1;
+#else
+        simSX127x = &chip;
+        chip.dio0 = &simSX127xDio0;
+#endif
+        Serial.sink = &fcReceive;
+        Serial.sinkCtx = this;
+    }
+
+    SimRadioPort *radio() { return &chip; }
+
+    bool connected() { return connectionState == SIM_RX_NODE::connected; }
+    uint8_t uplinkLQ() { return SIM_RX_NODE::uplinkLQ; }
+    uint8_t rateIndex() { return ExpressLRS_currAirRate_Modparams->index; }
+    int32_t phaseOffset() { return RawOffset; }
+    bool timerLocked() { return RXtimerState == tim_locked; }
+    int32_t timerFreqPpm() { return PLLloop.getFreqPpm(); }
+
+protected:
+    void setup() { SIM_RX_NODE::setup(); }
+    void loop() { SIM_RX_NODE::loop(); }
+
+private:
+#if defined(Regulatory_Domain_ISM_2400)
+    SimSX1280 chip;
+#else
+    SimSX127x chip;
+#endif
+    uint8_t fcFrame[CRSF_MAX_PACKET_LEN];
+    uint8_t fcFrameLen;
+
+    // Flight controller side of the CRSF UART, reassembles frames from the written bytes
+    static void fcReceive(void *ctx, const uint8_t *data, size_t len)
+    {
+        Node *node = (Node *)ctx;
+        while (len--)
+            node->fcByte(*data++);
+    }
+
+    void fcByte(uint8_t c)
+    {
+        if (fcFrameLen == 0 && c != CRSF_ADDRESS_FLIGHT_CONTROLLER && c != CRSF_SYNC_BYTE)
+            return;
+        if (fcFrameLen == 1 && (c < 2 || c > CRSF_MAX_PACKET_LEN - 2))
+        {
+            fcFrameLen = 0;
+            return;
+        }
+        fcFrame[fcFrameLen++] = c;
+        if (fcFrameLen < 2 || fcFrameLen < fcFrame[1] + 2)
+            return;
+
+        fcFrameLen = 0;
+        const uint8_t crc = crsf_crc.calc(&fcFrame[2], fcFrame[1] - 1);
+        if (crc != fcFrame[fcFrame[1] + 1] || fcFrame[2] != CRSF_FRAMETYPE_RC_CHANNELS_PACKED || !rcFrameCallback)
+            return;
+
+        const crsf_channels_t *packed = (const crsf_channels_t *)&fcFrame[3];
+        const uint16_t channels[16] = {
+            (uint16_t)packed->ch0, (uint16_t)packed->ch1, (uint16_t)packed->ch2, (uint16_t)packed->ch3,
+            (uint16_t)packed->ch4, (uint16_t)packed->ch5, (uint16_t)packed->ch6, (uint16_t)packed->ch7,
+            (uint16_t)packed->ch8, (uint16_t)packed->ch9, (uint16_t)packed->ch10, (uint16_t)packed->ch11,
+            (uint16_t)packed->ch12, (uint16_t)packed->ch13, (uint16_t)packed->ch14, (uint16_t)packed->ch15};
+        rcFrameCallback(rcFrameCtx, channels);
+    }
+};
+
+} // namespace SIM_RX_NODE
+
+SimRxNode &SIM_RX_FACTORY()
+{
+    static SIM_RX_NODE::Node node;
+    return node;
+}
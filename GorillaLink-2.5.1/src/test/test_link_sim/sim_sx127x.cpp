@@ -0,0 +1,271 @@
+#include "sim_sx127x.h"
+#include "sim_clock.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "SX127xRegs.h"
+
+#define SIM_SX127X_MODE_MASK 0b00000111
+#define SIM_SX127X_FREQ_STEP 61.03515625
+// Coding rate bits of REG_MODEM_CONFIG_1
+#define SIM_SX127X_CR_MASK 0b00001110
+
+static const uint32_t bandwidths[] = {
+    7800, 10400, 15600, 20800, 31250, 41700, 62500, 125000, 250000, 500000};
+
+// FEI scaling used by SX127xDriver::GetFrequencyError(), 32MHz crystal
+static const uint32_t bandwidthNormalisedShifted[] = {
+    1026, 769, 513, 385, 256, 192, 128, 64, 32, 16};
+
+SimSX127x::SimSX127x()
+    : dio0(nullptr), dio0Ctx(nullptr)
+{
+    reset();
+}
+
+void SimSX127x::reset()
+{
+    memset(regs, 0, sizeof(regs));
+    memset(fifo, 0, sizeof(fifo));
+    regs[SX127X_REG_OP_MODE] = SX127x_OPMODE_STANDBY;
+    regs[SX127X_REG_MODEM_CONFIG_1] = SX127x_BW_125_00_KHZ | SX127x_CR_4_5;
+    regs[SX127X_REG_MODEM_CONFIG_2] = SX127x_SF_7;
+    regs[SX127X_REG_PREAMBLE_LSB] = 8;
+    regs[SX127X_REG_PAYLOAD_LENGTH] = 1;
+    regs[SX127X_REG_SYNC_WORD] = 0x12;
+    regs[SX127X_REG_VERSION] = 0x12;
+    rxWritePtr = 0;
+    modeGeneration = 0;
+    listening = false;
+    transmitting = false;
+    updateModem();
+    updateCarrier();
+}
+
+uint8_t SimSX127x::mode() const
+{
+    return regs[SX127X_REG_OP_MODE] & SIM_SX127X_MODE_MASK;
+}
+
+uint8_t SimSX127x::readRegister(uint8_t reg)
+{
+    reg &= 0x7f;
+    if (reg == SX127X_REG_FIFO)
+        return fifo[regs[SX127X_REG_FIFO_ADDR_PTR]++];
+    return regs[reg];
+}
+
+void SimSX127x::writeRegister(uint8_t reg, uint8_t value)
+{
+    reg &= 0x7f;
+    switch (reg)
+    {
+    case SX127X_REG_FIFO:
+        fifo[regs[SX127X_REG_FIFO_ADDR_PTR]++] = value;
+        break;
+    case SX127X_REG_OP_MODE:
+        // LongRangeMode can only change in sleep, the driver writes the mode without it
+        regs[reg] = (regs[reg] & ~SIM_SX127X_MODE_MASK) | (value & SIM_SX127X_MODE_MASK);
+        if ((value & SIM_SX127X_MODE_MASK) == SX127x_OPMODE_SLEEP)
+            regs[reg] = value;
+        setMode(value & SIM_SX127X_MODE_MASK);
+        break;
+    case SX127X_REG_IRQ_FLAGS:
+        regs[reg] &= ~value;
+        break;
+    case SX127X_REG_VERSION:
+    case SX127X_REG_RX_NB_BYTES:
+    case SX127X_REG_FIFO_RX_CURRENT_ADDR:
+    case SX127X_REG_PKT_SNR_VALUE:
+    case SX127X_REG_PKT_RSSI_VALUE:
+    case SX127X_REG_FEI_MSB:
+    case SX127X_REG_FEI_MID:
+    case SX127X_REG_FEI_LSB:
+        break; // read only
+    case SX127X_REG_FRF_MSB:
+    case SX127X_REG_FRF_MID:
+    case SX127X_REG_FRF_LSB:
+        regs[reg] = value;
+        updateCarrier();
+        break;
+    case SX127X_REG_MODEM_CONFIG_1:
+    case SX127X_REG_MODEM_CONFIG_2:
+    case SX127X_REG_PAYLOAD_LENGTH:
+    case SX127X_REG_INVERT_IQ:
+    case SX127X_REG_SYNC_WORD:
+        regs[reg] = value;
+        updateModem();
+        break;
+    default:
+        regs[reg] = value;
+        break;
+    }
+}
+
+void SimSX127x::updateCarrier()
+{
+    const uint32_t frf = ((uint32_t)regs[SX127X_REG_FRF_MSB] << 16)
+        | ((uint32_t)regs[SX127X_REG_FRF_MID] << 8) | regs[SX127X_REG_FRF_LSB];
+    const int64_t carrier = (int64_t)(frf * SIM_SX127X_FREQ_STEP * (1.0 + crystalPpm * 1e-6));
+    if (carrier != carrierHz)
+    {
+        carrierHz = carrier;
+        SimAir::portChanged(this);
+    }
+}
+
+void SimSX127x::updateModem()
+{
+    const uint8_t bwIdx = regs[SX127X_REG_MODEM_CONFIG_1] >> 4;
+    bandwidthHz = (bwIdx < sizeof(bandwidths) / sizeof(bandwidths[0])) ? bandwidths[bwIdx] : 0;
+    // Bandwidth, header mode, spreading factor, IQ and sync word have to
+    // match to find the packet at all
+    const uint32_t key = (regs[SX127X_REG_MODEM_CONFIG_1] & ~SIM_SX127X_CR_MASK)
+        | ((uint32_t)(regs[SX127X_REG_MODEM_CONFIG_2] & 0xf4) << 8)
+        | ((uint32_t)(regs[SX127X_REG_INVERT_IQ] & 0x40) << 10)
+        | ((uint32_t)regs[SX127X_REG_SYNC_WORD] << 24);
+    // In implicit header mode the coding rate and payload length are not sent,
+    // a packet with others is decoded wrong
+    const bool implicitHeader = regs[SX127X_REG_MODEM_CONFIG_1] & SX1278_HEADER_IMPL_MODE;
+    const uint32_t payload = implicitHeader
+        ? (regs[SX127X_REG_MODEM_CONFIG_1] & SIM_SX127X_CR_MASK) | ((uint32_t)regs[SX127X_REG_PAYLOAD_LENGTH] << 8) : 0;
+    if (key != modemKey || payload != payloadKey)
+    {
+        modemKey = key;
+        payloadKey = payload;
+        SimAir::portChanged(this);
+    }
+}
+
+uint32_t SimSX127x::symbolTimeNs() const
+{
+    const uint8_t sf = regs[SX127X_REG_MODEM_CONFIG_2] >> 4;
+    return bandwidthHz ? (uint32_t)((1ULL << sf) * 1000000000ULL / bandwidthHz) : 0;
+}
+
+uint32_t SimSX127x::timeOnAirNs(uint8_t len) const
+{
+    // SX1276 datasheet 4.1.1.7
+    const int sf = regs[SX127X_REG_MODEM_CONFIG_2] >> 4;
+    const int cr = (regs[SX127X_REG_MODEM_CONFIG_1] >> 1) & 0b111;
+    const int implicitHeader = regs[SX127X_REG_MODEM_CONFIG_1] & SX1278_HEADER_IMPL_MODE;
+    const int crc = (regs[SX127X_REG_MODEM_CONFIG_2] >> 2) & 1;
+    const int lowDataRate = (regs[SX1278_REG_MODEM_CONFIG_3] >> 3) & 1;
+    const uint16_t preamble = ((uint16_t)regs[SX127X_REG_PREAMBLE_MSB] << 8) | regs[SX127X_REG_PREAMBLE_LSB];
+
+    const double num = 8.0 * len - 4.0 * sf + 28 + 16 * crc - 20 * implicitHeader;
+    const double den = 4.0 * (sf - 2 * lowDataRate);
+    double payloadSymbols = ceil(num / den) * (cr + 4);
+    if (payloadSymbols < 0)
+        payloadSymbols = 0;
+    const double symbols = preamble + 4.25 + 8 + payloadSymbols;
+    return (uint32_t)(symbols * symbolTimeNs());
+}
+
+void SimSX127x::setMode(uint8_t newMode)
+{
+    const uint64_t now = SimClock::nowNs();
+    ++modeGeneration;
+    transmitting = false;
+    listening = false;
+    listenUntilNs = UINT64_MAX;
+    SimAir::portChanged(this);
+
+    switch (newMode)
+    {
+    case SX127x_OPMODE_TX:
+    {
+        const uint8_t len = regs[SX127X_REG_PAYLOAD_LENGTH];
+        uint8_t data[256];
+        for (uint16_t i = 0; i < len; ++i)
+            data[i] = fifo[(uint8_t)(regs[SX127X_REG_FIFO_TX_BASE_ADDR] + i)];
+        const uint32_t toa = timeOnAirNs(len);
+        transmitting = true;
+        SimAir::transmit(this, data, len, toa);
+        SimClock::schedule(now + toa, &txDoneEvent, this, modeGeneration);
+        break;
+    }
+    case SX127x_OPMODE_RXSINGLE:
+    {
+        const uint16_t symbols = ((uint16_t)(regs[SX127X_REG_MODEM_CONFIG_2] & 0b11) << 8) | regs[SX127X_REG_SYMB_TIMEOUT_LSB];
+        listenUntilNs = now + (uint64_t)symbols * symbolTimeNs();
+        SimClock::schedule(listenUntilNs, &rxTimeoutEvent, this, modeGeneration);
+    }
+    // fallthrough
+    case SX127x_OPMODE_RXCONTINUOUS:
+        listening = true;
+        listenSinceNs = now;
+        rxWritePtr = regs[SX127X_REG_FIFO_RX_BASE_ADDR];
+        break;
+    default:
+        break;
+    }
+}
+
+void SimSX127x::txDoneEvent(void *ctx, uint32_t generation)
+{
+    SimSX127x *chip = (SimSX127x *)ctx;
+    if (generation != chip->modeGeneration)
+        return; // the transmission was aborted by a mode change
+
+    chip->regs[SX127X_REG_OP_MODE] = (chip->regs[SX127X_REG_OP_MODE] & ~SIM_SX127X_MODE_MASK) | SX127x_OPMODE_STANDBY;
+    chip->setMode(SX127x_OPMODE_STANDBY);
+    chip->raiseIrq(SX127X_CLEAR_IRQ_FLAG_TX_DONE);
+}
+
+void SimSX127x::rxTimeoutEvent(void *ctx, uint32_t generation)
+{
+    SimSX127x *chip = (SimSX127x *)ctx;
+    if (generation != chip->modeGeneration || chip->lockedPacket != 0)
+        return; // left RX single already, or a preamble was detected in time
+
+    chip->regs[SX127X_REG_OP_MODE] = (chip->regs[SX127X_REG_OP_MODE] & ~SIM_SX127X_MODE_MASK) | SX127x_OPMODE_STANDBY;
+    chip->setMode(SX127x_OPMODE_STANDBY);
+    chip->raiseIrq(SX127X_CLEAR_IRQ_FLAG_RX_TIMEOUT);
+}
+
+void SimSX127x::airReceive(const uint8_t *data, uint8_t len, int8_t rssi, int8_t snr, int32_t freqErrorHz)
+{
+    const uint8_t start = rxWritePtr;
+    for (uint8_t i = 0; i < len; ++i)
+        fifo[rxWritePtr++] = data[i];
+    regs[SX127X_REG_FIFO_RX_CURRENT_ADDR] = start;
+    regs[SX127X_REG_RX_NB_BYTES] = len;
+
+    int rssiReg = rssi + 157;
+    regs[SX127X_REG_PKT_RSSI_VALUE] = (rssiReg < 0) ? 0 : (rssiReg > 255) ? 255 : rssiReg;
+    regs[SX127X_REG_PKT_SNR_VALUE] = (uint8_t)(int8_t)(snr * 4);
+
+    // Inverse of SX127xDriver::GetFrequencyError(), 20 bit two's complement.
+    // The chip reports the offset of its own LO from the received carrier.
+    const uint8_t bwIdx = regs[SX127X_REG_MODEM_CONFIG_1] >> 4;
+    int32_t fei = (int32_t)((int64_t)-freqErrorHz * 128 / bandwidthNormalisedShifted[bwIdx < 10 ? bwIdx : 9]);
+    if (fei > 0x7ffff)
+        fei = 0x7ffff;
+    if (fei < -0x80000)
+        fei = -0x80000;
+    const uint32_t feiReg = (uint32_t)fei & 0xfffff;
+    regs[SX127X_REG_FEI_MSB] = feiReg >> 16;
+    regs[SX127X_REG_FEI_MID] = feiReg >> 8;
+    regs[SX127X_REG_FEI_LSB] = feiReg;
+
+    if (mode() == SX127x_OPMODE_RXSINGLE)
+    {
+        // RX single returns to standby as soon as the packet is received
+        regs[SX127X_REG_OP_MODE] = (regs[SX127X_REG_OP_MODE] & ~SIM_SX127X_MODE_MASK) | SX127x_OPMODE_STANDBY;
+        setMode(SX127x_OPMODE_STANDBY);
+    }
+    raiseIrq(SX127X_CLEAR_IRQ_FLAG_RX_DONE);
+}
+
+void SimSX127x::raiseIrq(uint8_t flags)
+{
+    regs[SX127X_REG_IRQ_FLAGS] |= flags;
+    // DIO0 mapping 0b11 (set by the driver) fires on both RX done and TX done
+    const bool dio0Mapped = (regs[SX127X_REG_DIO_MAPPING_1] >> 6) == 0b11
+        || ((regs[SX127X_REG_DIO_MAPPING_1] >> 6) == 0b00 && (flags & SX127X_CLEAR_IRQ_FLAG_RX_DONE))
+        || ((regs[SX127X_REG_DIO_MAPPING_1] >> 6) == 0b01 && (flags & SX127X_CLEAR_IRQ_FLAG_TX_DONE));
+    if (dio0Mapped && (flags & (SX127X_CLEAR_IRQ_FLAG_RX_DONE | SX127X_CLEAR_IRQ_FLAG_TX_DONE)) && dio0)
+        dio0(dio0Ctx);
+}
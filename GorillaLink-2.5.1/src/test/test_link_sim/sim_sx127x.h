@@ -0,0 +1,44 @@
+#pragma once
+
+#include "sim_air.h"
+
+/**
+ * Register level model of an SX127x in LoRa mode, enough of it for the
+ * ExpressLRS SX127xDriver: FIFO, OP_MODE transitions, TX done / RX done on
+ * DIO0, RX single timeout, packet RSSI/SNR and the FEI registers used for
+ * frequency correction. SPI accesses take no simulated time.
+ **/
+class SimSX127x : public SimRadioPort
+{
+public:
+    SimSX127x();
+
+    void reset();
+    uint8_t readRegister(uint8_t reg);
+    void writeRegister(uint8_t reg, uint8_t value);
+
+    void airReceive(const uint8_t *data, uint8_t len, int8_t rssi, int8_t snr, int32_t freqErrorHz);
+
+    // Time on air of a packet of len bytes with the current modem settings
+    uint32_t timeOnAirNs(uint8_t len) const;
+
+    // DIO0 rising edge, called from the simulation event that raised it
+    void (*dio0)(void *ctx);
+    void *dio0Ctx;
+
+private:
+    uint8_t regs[0x80];
+    uint8_t fifo[256];
+    uint8_t rxWritePtr;
+    uint32_t modeGeneration;
+
+    uint8_t mode() const;
+    void setMode(uint8_t mode);
+    void updateCarrier();
+    void updateModem();
+    uint32_t symbolTimeNs() const;
+    void raiseIrq(uint8_t flags);
+
+    static void txDoneEvent(void *ctx, uint32_t generation);
+    static void rxTimeoutEvent(void *ctx, uint32_t generation);
+};
@@ -0,0 +1,149 @@
+/**
+ * SX127xHal for a simulated node, included inside the node's namespace after
+ * SX127xDriver.h. SPI transactions go straight to the node's SimSX127x and
+ * DIO0 is delivered as an ISR on the node. The register shadow works as in
+ * SX127xHal.cpp, every transaction that reaches the chip is counted on it.
+ **/
+
+static SimSX127x *simSX127x;
+
+SX127xHal *SX127xHal::instance = NULL;
+
+SX127xHal::SX127xHal()
+{
+    instance = this;
+}
+
+void SX127xHal::init()
+{
+    invalidateRegisters();
+}
+
+void SX127xHal::end()
+{
+    IsrCallback = nullptr;
+}
+
+void ICACHE_RAM_ATTR SX127xHal::dioISR()
+{
+    instance->IsrMicros = micros();
+    if (instance->IsrCallback)
+        instance->IsrCallback();
+}
+
+static void simSX127xDio0(void *ctx)
+{
+    (void)ctx;
+    const uint32_t spiTransfers = simSX127x->spiTransfers;
+    simNode->radioIsrEnter();
+    SX127xHal::dioISR();
+    simNode->isrExit();
+    ++simSX127x->isrCount;
+    simSX127x->isrSpiTransfers += simSX127x->spiTransfers - spiTransfers;
+}
+
+static void simSX127xSpi()
+{
+    ++simSX127x->spiTransfers;
+    simNode->spiTransaction();
+}
+
+void ICACHE_RAM_ATTR SX127xHal::TXenable() {}
+void ICACHE_RAM_ATTR SX127xHal::RXenable() {}
+void ICACHE_RAM_ATTR SX127xHal::TXRXdisable() {}
+
+uint8_t ICACHE_RAM_ATTR SX127xHal::getRegValue(uint8_t reg, uint8_t msb, uint8_t lsb)
+{
+    if ((msb > 7) || (lsb > 7) || (lsb > msb))
+    {
+        return (ERR_INVALID_BIT_RANGE);
+    }
+    uint8_t rawValue = readRegister(reg);
+    uint8_t maskedValue = rawValue & ((0b11111111 << lsb) & (0b11111111 >> (7 - msb)));
+    return (maskedValue);
+}
+
+uint8_t ICACHE_RAM_ATTR SX127xHal::readRegister(uint8_t reg)
+{
+    uint8_t value;
+    if (shadowGet(reg, &value))
+        return value;
+    simSX127xSpi();
+    value = simSX127x->readRegister(reg);
+    shadowSet(reg, value);
+    return value;
+}
+
+void ICACHE_RAM_ATTR SX127xHal::readRegisterBurst(uint8_t reg, uint8_t numBytes, uint8_t *inBytes)
+{
+    simSX127xSpi();
+    for (uint8_t i = 0; i < numBytes; ++i)
+    {
+        inBytes[i] = simSX127x->readRegister(reg + i);
+        shadowSet(reg + i, inBytes[i]);
+    }
+}
+
+uint8_t ICACHE_RAM_ATTR SX127xHal::setRegValue(uint8_t reg, uint8_t value, uint8_t msb, uint8_t lsb)
+{
+    if ((msb > 7) || (lsb > 7) || (lsb > msb))
+    {
+        return (ERR_INVALID_BIT_RANGE);
+    }
+
+    uint8_t currentValue = readRegister(reg);
+    uint8_t mask = ~((0b11111111 << (msb + 1)) | (0b11111111 >> (8 - lsb)));
+    uint8_t newValue = (currentValue & ~mask) | (value & mask);
+    writeRegister(reg, newValue);
+    return (ERR_NONE);
+}
+
+void ICACHE_RAM_ATTR SX127xHal::writeRegister(uint8_t reg, uint8_t data)
+{
+    if (shadowMatches(reg, &data, 1))
+        return;
+    simSX127xSpi();
+    simSX127x->writeRegister(reg, data);
+    shadowSet(reg, data);
+}
+
+void ICACHE_RAM_ATTR SX127xHal::writeRegisterFIFO(volatile uint8_t *data, uint8_t numBytes)
+{
+    simSX127xSpi();
+    for (uint8_t i = 0; i < numBytes; ++i)
+        simSX127x->writeRegister(SX127X_REG_FIFO, data[i]);
+    invalidateRegister(SX127X_REG_FIFO_ADDR_PTR);
+}
+
+void ICACHE_RAM_ATTR SX127xHal::readRegisterFIFO(volatile uint8_t *data, uint8_t numBytes)
+{
+    simSX127xSpi();
+    for (uint8_t i = 0; i < numBytes; ++i)
+        data[i] = simSX127x->readRegister(SX127X_REG_FIFO);
+    invalidateRegister(SX127X_REG_FIFO_ADDR_PTR);
+}
+
+void ICACHE_RAM_ATTR SX127xHal::writeRegisterBurst(uint8_t reg, uint8_t *data, uint8_t numBytes)
+{
+    if (shadowMatches(reg, data, numBytes))
+        return;
+    simSX127xSpi();
+    for (uint8_t i = 0; i < numBytes; ++i)
+    {
+        simSX127x->writeRegister(reg + i, data[i]);
+        shadowSet(reg + i, data[i]);
+    }
+}
+
+void ICACHE_RAM_ATTR SX127xHal::writeRaw(const uint8_t *data, uint8_t numBytes)
+{
+    const uint8_t reg = data[0] & ~SPI_WRITE;
+    if (shadowMatches(reg, data + 1, numBytes - 1))
+        return;
+    simSX127xSpi();
+    for (uint8_t i = 1; i < numBytes; ++i)
+    {
+        simSX127x->writeRegister(reg + i - 1, data[i]);
+        shadowSet(reg + i - 1, data[i]);
+    }
+}
@@ -0,0 +1,403 @@
+#include "sim_sx1280.h"
+#include "sim_clock.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "SX1280_Regs.h"
+
+#define SIM_SX1280_FREQ_STEP (52000000.0 / 262144.0)
+#define SIM_SX1280_TIMEOUT_CONTINUOUS 0xFFFF
+
+// Circuit mode field of the status byte, by SX1280_RadioOperatingModes_t
+static const uint8_t statusModes[] = {0x0, 0x0, 0x2, 0x3, 0x4, 0x5, 0x6, 0x0};
+
+// Period base of SetRx/SetTx in ns, by SX1280_RadioTickSizes_t
+static const uint32_t tickNs[] = {15625, 62500, 1000000, 4000000};
+
+SimSX1280::SimSX1280()
+    : dio1(nullptr), dio1Ctx(nullptr)
+{
+    reset();
+}
+
+void SimSX1280::reset()
+{
+    mode = SX1280_MODE_STDBY_RC;
+    autoFs = false;
+    rxContinuous = false;
+    packetType = SX1280_PACKET_TYPE_GFSK;
+    memset(modParams, 0, sizeof(modParams));
+    memset(packetParams, 0, sizeof(packetParams));
+    frequency = 0;
+    txBase = 0;
+    rxBase = 0;
+    rxStart = 0;
+    rxLength = 0;
+    irqStatus = 0;
+    irqMask = 0;
+    dio1Mask = 0;
+    memset(packetStatus, 0, sizeof(packetStatus));
+    memset(buffer, 0, sizeof(buffer));
+    memset(regs, 0, sizeof(regs));
+    regs[REG_LR_FIRMWARE_VERSION_MSB] = 0xA9;
+    regs[REG_LR_FIRMWARE_VERSION_MSB + 1] = 0xB5;
+    modeGeneration = 0;
+    listening = false;
+    transmitting = false;
+    updateModem();
+    updateCarrier();
+}
+
+uint8_t SimSX1280::status() const
+{
+    // Command status 0x1, processed successfully
+    return (statusModes[mode] << 5) | (0x1 << 2);
+}
+
+uint8_t SimSX1280::payloadLength() const
+{
+    return (packetType == SX1280_PACKET_TYPE_FLRC) ? packetParams[4] : packetParams[2];
+}
+
+void SimSX1280::transfer(uint8_t *data, uint8_t len)
+{
+    if (len == 0)
+        return;
+    ++spiTransfers;
+    uint8_t mosi[256];
+    memcpy(mosi, data, len);
+    // Every byte clocked out before the response is the status
+    memset(data, status(), len);
+
+    const uint8_t opcode = mosi[0];
+    switch (opcode)
+    {
+    case SX1280_RADIO_WRITE_REGISTER:
+    {
+        const uint16_t addr = ((uint16_t)mosi[1] << 8) | mosi[2];
+        for (uint8_t i = 3; i < len; ++i)
+            regs[(addr + i - 3) & 0xFFF] = mosi[i];
+        updateModem();
+        break;
+    }
+    case SX1280_RADIO_READ_REGISTER:
+    {
+        const uint16_t addr = ((uint16_t)mosi[1] << 8) | mosi[2];
+        for (uint8_t i = 4; i < len; ++i)
+            data[i] = regs[(addr + i - 4) & 0xFFF];
+        break;
+    }
+    case SX1280_RADIO_WRITE_BUFFER:
+        for (uint8_t i = 2; i < len; ++i)
+            buffer[(uint8_t)(mosi[1] + i - 2)] = mosi[i];
+        break;
+    case SX1280_RADIO_READ_BUFFER:
+        for (uint8_t i = 3; i < len; ++i)
+            data[i] = buffer[(uint8_t)(mosi[1] + i - 3)];
+        break;
+    case SX1280_RADIO_GET_RXBUFFERSTATUS:
+        if (len > 2)
+            data[2] = rxLength;
+        if (len > 3)
+            data[3] = rxStart;
+        break;
+    case SX1280_RADIO_GET_PACKETSTATUS:
+        for (uint8_t i = 2; i < len && i < 2 + sizeof(packetStatus); ++i)
+            data[i] = packetStatus[i - 2];
+        break;
+    case SX1280_RADIO_GET_IRQSTATUS:
+        if (len > 2)
+            data[2] = irqStatus >> 8;
+        if (len > 3)
+            data[3] = irqStatus;
+        break;
+    case SX1280_RADIO_GET_PACKETTYPE:
+        if (len > 2)
+            data[2] = packetType;
+        break;
+    default:
+        command(mosi, len);
+        break;
+    }
+}
+
+void SimSX1280::command(uint8_t *data, uint8_t len)
+{
+    // Missing parameter bytes read as zero
+    uint8_t p[9] = {0};
+    memcpy(p, data + 1, (len - 1 < (int)sizeof(p)) ? len - 1 : sizeof(p));
+
+    switch (data[0])
+    {
+    case SX1280_RADIO_SET_SLEEP:
+        setMode(SX1280_MODE_SLEEP);
+        break;
+    case SX1280_RADIO_SET_STANDBY:
+        setMode(p[0] == SX1280_STDBY_XOSC ? SX1280_MODE_STDBY_XOSC : SX1280_MODE_STDBY_RC);
+        break;
+    case SX1280_RADIO_SET_FS:
+        setMode(SX1280_MODE_FS);
+        break;
+    case SX1280_RADIO_SET_TX:
+        setMode(SX1280_MODE_TX);
+        break;
+    case SX1280_RADIO_SET_RX:
+    {
+        const uint16_t count = ((uint16_t)p[1] << 8) | p[2];
+        setMode(SX1280_MODE_RX);
+        rxContinuous = count == SIM_SX1280_TIMEOUT_CONTINUOUS;
+        if (count != 0 && count != SIM_SX1280_TIMEOUT_CONTINUOUS)
+        {
+            listenUntilNs = SimClock::nowNs() + (uint64_t)count * tickNs[p[0] & 0b11];
+            SimClock::schedule(listenUntilNs, &rxTimeoutEvent, this, modeGeneration);
+        }
+        break;
+    }
+    case SX1280_RADIO_SET_PACKETTYPE:
+        packetType = p[0];
+        updateModem();
+        break;
+    case SX1280_RADIO_SET_RFFREQUENCY:
+        frequency = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+        updateCarrier();
+        break;
+    case SX1280_RADIO_SET_BUFFERBASEADDRESS:
+        txBase = p[0];
+        rxBase = p[1];
+        break;
+    case SX1280_RADIO_SET_MODULATIONPARAMS:
+        memcpy(modParams, p, sizeof(modParams));
+        updateModem();
+        break;
+    case SX1280_RADIO_SET_PACKETPARAMS:
+        memcpy(packetParams, p, sizeof(packetParams));
+        updateModem();
+        break;
+    case SX1280_RADIO_SET_DIOIRQPARAMS:
+        irqMask = ((uint16_t)p[0] << 8) | p[1];
+        dio1Mask = ((uint16_t)p[2] << 8) | p[3];
+        break;
+    case SX1280_RADIO_CLR_IRQSTATUS:
+        irqStatus &= ~(((uint16_t)p[0] << 8) | p[1]);
+        break;
+    case SX1280_RADIO_SET_AUTOFS:
+        autoFs = p[0] != 0;
+        break;
+    default:
+        break; // TX params, regulator mode and the rest don't change the link
+    }
+}
+
+void SimSX1280::updateCarrier()
+{
+    const int64_t carrier = (int64_t)(frequency * SIM_SX1280_FREQ_STEP * (1.0 + crystalPpm * 1e-6));
+    if (carrier != carrierHz)
+    {
+        carrierHz = carrier;
+        SimAir::portChanged(this);
+    }
+}
+
+void SimSX1280::updateModem()
+{
+    // The coding rate (modParams[2] for LoRa, [1] for FLRC) and the fixed
+    // payload length go in payloadKey, a packet with others is decoded wrong
+    uint32_t key = ((uint32_t)packetType << 24);
+    uint32_t payload = 0;
+    if (packetType == SX1280_PACKET_TYPE_FLRC)
+    {
+        switch (modParams[0])
+        {
+        case SX1280_FLRC_BR_1_300_BW_1_2:
+        case SX1280_FLRC_BR_1_000_BW_1_2:
+            bandwidthHz = 1200000;
+            break;
+        case SX1280_FLRC_BR_0_650_BW_0_6:
+        case SX1280_FLRC_BR_0_520_BW_0_6:
+            bandwidthHz = 600000;
+            break;
+        default:
+            bandwidthHz = 300000;
+            break;
+        }
+        key |= ((uint32_t)modParams[0] << 16) | modParams[2];
+        // Only a matching sync word is received
+        for (uint8_t i = 0; i < 4; ++i)
+            key ^= (uint32_t)regs[SX1280_REG_FLRC_SYNC_WORD_1 + i] << (i * 8);
+        payload = modParams[1] | ((uint32_t)packetParams[4] << 8) | ((uint32_t)packetParams[5] << 16);
+    }
+    else
+    {
+        switch (modParams[1])
+        {
+        case SX1280_LORA_BW_1600:
+            bandwidthHz = 1625000;
+            break;
+        case SX1280_LORA_BW_0800:
+            bandwidthHz = 812500;
+            break;
+        case SX1280_LORA_BW_0400:
+            bandwidthHz = 406250;
+            break;
+        default:
+            bandwidthHz = 203125;
+            break;
+        }
+        key |= ((uint32_t)modParams[0] << 16) | ((uint32_t)modParams[1] << 8);
+        // IQ must agree, in implicit header mode the coding rate and payload length too
+        key ^= (uint32_t)(packetParams[4] & SX1280_LORA_IQ_NORMAL) << 1;
+        if (packetParams[1] == SX1280_LORA_PACKET_IMPLICIT)
+            payload = modParams[2] | ((uint32_t)packetParams[2] << 8);
+        else
+            key ^= (uint32_t)modParams[2] << 4;
+    }
+    if (key != modemKey || payload != payloadKey)
+    {
+        modemKey = key;
+        payloadKey = payload;
+        SimAir::portChanged(this);
+    }
+}
+
+uint32_t SimSX1280::timeOnAirNs(uint8_t len) const
+{
+    if (packetType == SX1280_PACKET_TYPE_FLRC)
+    {
+        uint32_t bitrate;
+        switch (modParams[0])
+        {
+        case SX1280_FLRC_BR_1_300_BW_1_2: bitrate = 1300000; break;
+        case SX1280_FLRC_BR_1_000_BW_1_2: bitrate = 1040000; break;
+        case SX1280_FLRC_BR_0_650_BW_0_6: bitrate = 650000; break;
+        case SX1280_FLRC_BR_0_520_BW_0_6: bitrate = 520000; break;
+        case SX1280_FLRC_BR_0_325_BW_0_3: bitrate = 325000; break;
+        default: bitrate = 260000; break;
+        }
+        // SX1280 datasheet 7.4.3: the preamble and sync word are uncoded,
+        // the header, payload, CRC and 6 tail bits go through the coder
+        const uint32_t preambleBits = ((packetParams[0] >> 4) + 1) * 4;
+        const uint32_t syncBits = (packetParams[1] == SX1280_FLRC_SYNC_WORD_LEN_P32S) ? 32 : 0;
+        const uint32_t headerBits = (packetParams[3] == SX1280_FLRC_PACKET_VARIABLE_LENGTH) ? 16 : 0;
+        const uint32_t crcBytes = (packetParams[5] >> 4) ? (packetParams[5] >> 4) + 1 : 0;
+        const uint32_t codedBits = headerBits + (len + crcBytes) * 8 + 6;
+        uint32_t airBits;
+        switch (modParams[1])
+        {
+        case SX1280_FLRC_CR_1_2: airBits = codedBits * 2; break;
+        case SX1280_FLRC_CR_3_4: airBits = (codedBits * 4 + 2) / 3; break;
+        default: airBits = codedBits; break;
+        }
+        return (uint32_t)((uint64_t)(preambleBits + syncBits + airBits) * 1000000000ULL / bitrate);
+    }
+
+    // SX1280 datasheet 7.4.1, the interleaved coding rates as their plain equivalent
+    const int sf = modParams[0] >> 4;
+    const int cr = modParams[2] & 0b11 ? (modParams[2] & 0b11) : 4;
+    const int implicitHeader = packetParams[1] == SX1280_LORA_PACKET_IMPLICIT;
+    const int crc = packetParams[3] == SX1280_LORA_CRC_ON;
+    const double preamble = (packetParams[0] & 0x0F) * (double)(1 << (packetParams[0] >> 4));
+    const double symbolNs = bandwidthHz ? (double)(1 << sf) * 1e9 / bandwidthHz : 0;
+
+    double symbols;
+    const double num = 8.0 * len + 16 * crc - 4.0 * sf + (implicitHeader ? 0 : 20);
+    if (sf < 7)
+        symbols = preamble + 6.25 + 8 + ceil((num > 0 ? num : 0) / (4.0 * sf)) * (cr + 4);
+    else if (sf <= 10)
+        symbols = preamble + 4.25 + 8 + ceil((num + 8 > 0 ? num + 8 : 0) / (4.0 * sf)) * (cr + 4);
+    else
+        symbols = preamble + 4.25 + 8 + ceil((num + 8 > 0 ? num + 8 : 0) / (4.0 * (sf - 2))) * (cr + 4);
+    return (uint32_t)(symbols * symbolNs);
+}
+
+void SimSX1280::setMode(uint8_t newMode)
+{
+    const uint64_t now = SimClock::nowNs();
+    ++modeGeneration;
+    mode = newMode;
+    transmitting = false;
+    listening = false;
+    listenUntilNs = UINT64_MAX;
+    SimAir::portChanged(this);
+
+    switch (newMode)
+    {
+    case SX1280_MODE_TX:
+    {
+        const uint8_t len = payloadLength();
+        uint8_t data[256];
+        for (uint16_t i = 0; i < len; ++i)
+            data[i] = buffer[(uint8_t)(txBase + i)];
+        const uint32_t toa = timeOnAirNs(len);
+        transmitting = true;
+        SimAir::transmit(this, data, len, toa);
+        SimClock::schedule(now + toa, &txDoneEvent, this, modeGeneration);
+        break;
+    }
+    case SX1280_MODE_RX:
+        listening = true;
+        listenSinceNs = now;
+        break;
+    default:
+        break;
+    }
+}
+
+void SimSX1280::idleAfterPacket()
+{
+    // Single TX/RX end in STDBY_RC, or FS with auto FS on
+    setMode(autoFs ? SX1280_MODE_FS : SX1280_MODE_STDBY_RC);
+}
+
+void SimSX1280::txDoneEvent(void *ctx, uint32_t generation)
+{
+    SimSX1280 *chip = (SimSX1280 *)ctx;
+    if (generation != chip->modeGeneration)
+        return; // the transmission was aborted by a mode change
+
+    chip->idleAfterPacket();
+    chip->raiseIrq(SX1280_IRQ_TX_DONE);
+}
+
+void SimSX1280::rxTimeoutEvent(void *ctx, uint32_t generation)
+{
+    SimSX1280 *chip = (SimSX1280 *)ctx;
+    if (generation != chip->modeGeneration || chip->lockedPacket != 0)
+        return; // left RX already, or the sync word was detected in time
+
+    chip->idleAfterPacket();
+    chip->raiseIrq(SX1280_IRQ_RX_TX_TIMEOUT);
+}
+
+void SimSX1280::airReceive(const uint8_t *data, uint8_t len, int8_t rssi, int8_t snr, int32_t freqErrorHz)
+{
+    (void)freqErrorHz;
+    rxStart = rxBase;
+    rxLength = len;
+    for (uint8_t i = 0; i < len; ++i)
+        buffer[(uint8_t)(rxBase + i)] = data[i];
+
+    memset(packetStatus, 0, sizeof(packetStatus));
+    const uint8_t rssiSync = (uint8_t)(-rssi * 2);
+    if (packetType == SX1280_PACKET_TYPE_FLRC)
+    {
+        packetStatus[1] = rssiSync;
+    }
+    else
+    {
+        packetStatus[0] = rssiSync;
+        packetStatus[1] = (uint8_t)(int8_t)(snr * 4);
+    }
+
+    // Continuous RX keeps listening, single or timed RX goes idle
+    if (!rxContinuous)
+        idleAfterPacket();
+    raiseIrq(SX1280_IRQ_RX_DONE);
+}
+
+void SimSX1280::raiseIrq(uint16_t flags)
+{
+    irqStatus |= flags & irqMask;
+    if ((flags & irqMask & dio1Mask) && dio1)
+        dio1(dio1Ctx);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "sim_air.h"
+
+/**
+ * Command level model of an SX1280 in LoRa or FLRC mode, enough of it for
+ * the ExpressLRS SX1280Driver: the SPI commands it sends, the data buffer,
+ * auto FS after TX/RX, RX timeout, TX done / RX done on DIO1 and the packet
+ * status. SPI transactions take no simulated time and BUSY is never set.
+ **/
+class SimSX1280 : public SimRadioPort
+{
+public:
+    SimSX1280();
+
+    void reset();
+    // One SPI transaction, the MISO bytes replace data like SPI.transfer() does
+    void transfer(uint8_t *data, uint8_t len);
+
+    void airReceive(const uint8_t *data, uint8_t len, int8_t rssi, int8_t snr, int32_t freqErrorHz);
+
+    // Time on air of a packet of len bytes with the current packet type and params
+    uint32_t timeOnAirNs(uint8_t len) const;
+
+    // DIO1 rising edge, called from the simulation event that raised it
+    void (*dio1)(void *ctx);
+    void *dio1Ctx;
+
+private:
+    uint8_t mode;
+    bool autoFs;
+    bool rxContinuous;
+    uint8_t packetType;
+    uint8_t modParams[3];
+    uint8_t packetParams[7];
+    uint32_t frequency;
+    uint8_t txBase;
+    uint8_t rxBase;
+    uint8_t rxStart;
+    uint8_t rxLength;
+    uint16_t irqStatus;
+    uint16_t irqMask;
+    uint16_t dio1Mask;
+    uint8_t packetStatus[5];
+    uint8_t buffer[256];
+    uint8_t regs[0x1000];
+    uint32_t modeGeneration;
+
+    uint8_t status() const;
+    uint8_t payloadLength() const;
+    void command(uint8_t *data, uint8_t len);
+    void setMode(uint8_t newMode);
+    void idleAfterPacket();
+    void updateCarrier();
+    void updateModem();
+    void raiseIrq(uint16_t flags);
+
+    static void txDoneEvent(void *ctx, uint32_t generation);
+    static void rxTimeoutEvent(void *ctx, uint32_t generation);
+};
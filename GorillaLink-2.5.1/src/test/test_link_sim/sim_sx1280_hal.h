@@ -0,0 +1,176 @@
+/**
+ * SX1280Hal for a simulated node, included inside the node's namespace after
+ * SX1280Driver.h. Every transaction is framed exactly as SX1280_hal.cpp puts
+ * it on the SPI bus and handed to the node's SimSX1280, DIO1 is delivered as
+ * an ISR on the node. BUSY never blocks, the chip model takes no time, but
+ * the wait the real hal would spin out after BusyDelay() is counted on the
+ * radio port along with the NSS cycles.
+ **/
+
+static SimSX1280 *simSX1280;
+
+SX1280Hal *SX1280Hal::instance = NULL;
+
+SX1280Hal::SX1280Hal()
+{
+    instance = this;
+    BusyDelayDuration = 0;
+}
+
+void SX1280Hal::init() {}
+
+void SX1280Hal::end()
+{
+    IsrCallback = nullptr;
+}
+
+void SX1280Hal::reset()
+{
+    simSX1280->reset();
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::dioISR()
+{
+    instance->IsrMicros = micros();
+    if (instance->IsrCallback)
+        instance->IsrCallback();
+}
+
+static void simSX1280Dio1(void *ctx)
+{
+    (void)ctx;
+    const uint32_t spiTransfers = simSX1280->spiTransfers;
+    const uint32_t busyWaitUs = simSX1280->busyWaitUs;
+    simNode->radioIsrEnter();
+    SX1280Hal::dioISR();
+    simNode->isrExit();
+    ++simSX1280->isrCount;
+    simSX1280->isrSpiTransfers += simSX1280->spiTransfers - spiTransfers;
+    simSX1280->isrBusyWaitUs += simSX1280->busyWaitUs - busyWaitUs;
+}
+
+bool ICACHE_RAM_ATTR SX1280Hal::WaitOnBusy()
+{
+    // What is left of the BusyDelay() window, read off the local clock rather
+    // than micros() so that checking it doesn't count as the loop spinning
+    const uint32_t elapsed = (uint32_t)(simNode->localNs() / 1000) - BusyDelayStart;
+    if (elapsed < BusyDelayDuration)
+        simSX1280->busyWaitUs += BusyDelayDuration - elapsed;
+    BusyDelayDuration = 0;
+    return true;
+}
+
+// One NSS cycle with the BUSY handling of SX1280_hal.cpp around it
+static void simSX1280Frame(uint8_t *frame, uint8_t len)
+{
+    const bool isWrite = !SX1280Hal::IsReadCommand(frame[0]);
+    SX1280Hal::instance->WaitOnBusy();
+    simNode->spiTransaction();
+    simSX1280->transfer(frame, len);
+    if (isWrite)
+        SX1280Hal::instance->BusyDelay(12);
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::TransferBatch(uint8_t *const frames[], const uint8_t sizes[], uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++)
+        simSX1280Frame(frames[i], sizes[i]);
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::TXenable() {}
+void ICACHE_RAM_ATTR SX1280Hal::RXenable() {}
+void ICACHE_RAM_ATTR SX1280Hal::TXRXdisable() {}
+
+void ICACHE_RAM_ATTR SX1280Hal::WriteCommand(SX1280_RadioCommands_t command, uint8_t val)
+{
+    uint8_t frame[2] = {(uint8_t)command, val};
+    simSX1280Frame(frame, sizeof(frame));
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::WriteCommand(SX1280_RadioCommands_t command, uint8_t *buffer, uint8_t size)
+{
+    uint8_t frame[size + 1];
+    frame[0] = (uint8_t)command;
+    memcpy(frame + 1, buffer, size);
+    simSX1280Frame(frame, sizeof(frame));
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::WriteRaw(const uint8_t *buffer, uint8_t size)
+{
+    uint8_t frame[size];
+    memcpy(frame, buffer, size);
+    simSX1280Frame(frame, sizeof(frame));
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::ReadCommand(SX1280_RadioCommands_t command, uint8_t *buffer, uint8_t size)
+{
+    if (command == SX1280_RADIO_GET_STATUS)
+    {
+        uint8_t frame[3] = {(uint8_t)command, 0x00, 0x00};
+        simSX1280Frame(frame, sizeof(frame));
+        buffer[0] = frame[0];
+        return;
+    }
+    uint8_t frame[size + 2];
+    frame[0] = (uint8_t)command;
+    frame[1] = 0x00;
+    memcpy(frame + 2, buffer, size);
+    simSX1280Frame(frame, sizeof(frame));
+    memcpy(buffer, frame + 2, size);
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::WriteRegister(uint16_t address, uint8_t *buffer, uint8_t size)
+{
+    uint8_t frame[size + 3];
+    frame[0] = SX1280_RADIO_WRITE_REGISTER;
+    frame[1] = address >> 8;
+    frame[2] = address & 0xFF;
+    memcpy(frame + 3, buffer, size);
+    simSX1280Frame(frame, sizeof(frame));
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::WriteRegister(uint16_t address, uint8_t value)
+{
+    WriteRegister(address, &value, 1);
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::ReadRegister(uint16_t address, uint8_t *buffer, uint8_t size)
+{
+    uint8_t frame[size + 4];
+    frame[0] = SX1280_RADIO_READ_REGISTER;
+    frame[1] = address >> 8;
+    frame[2] = address & 0xFF;
+    frame[3] = 0x00;
+    memset(frame + 4, 0, size);
+    simSX1280Frame(frame, sizeof(frame));
+    memcpy(buffer, frame + 4, size);
+}
+
+uint8_t ICACHE_RAM_ATTR SX1280Hal::ReadRegister(uint16_t address)
+{
+    uint8_t data;
+    ReadRegister(address, &data, 1);
+    return data;
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::WriteBuffer(uint8_t offset, volatile uint8_t *buffer, uint8_t size)
+{
+    uint8_t frame[size + 2];
+    frame[0] = SX1280_RADIO_WRITE_BUFFER;
+    frame[1] = offset;
+    for (uint8_t i = 0; i < size; ++i)
+        frame[i + 2] = buffer[i];
+    simSX1280Frame(frame, sizeof(frame));
+}
+
+void ICACHE_RAM_ATTR SX1280Hal::ReadBuffer(uint8_t offset, volatile uint8_t *buffer, uint8_t size)
+{
+    uint8_t frame[size + 3];
+    frame[0] = SX1280_RADIO_READ_BUFFER;
+    frame[1] = offset;
+    frame[2] = 0x00;
+    memset(frame + 3, 0, size);
+    simSX1280Frame(frame, sizeof(frame));
+    for (uint8_t i = 0; i < size; ++i)
+        buffer[i] = frame[i + 3];
+}
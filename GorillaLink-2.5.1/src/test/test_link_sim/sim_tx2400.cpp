@@ -0,0 +1,10 @@
+/**
+ * The same TX firmware as sim_tx900.cpp for a 2.4GHz SX1280 module, LoRa and
+ * FLRC air rates.
+ **/
+
+#define SIM_TX_NODE SimTx2400
+#define SIM_TX_FACTORY simTx2400
+#define Regulatory_Domain_ISM_2400 1
+
+#include "sim_tx900.cpp"
@@ -0,0 +1,261 @@
+/**
+ * The TX firmware (src/tx_main.cpp) for a 900MHz SX127x module, built into
+ * namespace SimTx900 as one node of the link simulation. The handset talks
+ * to it over CRSF::Port exactly as a radio would. sim_tx900_dma.cpp builds
+ * it again with the CRSF input on the DMA ring, sim_tx2400.cpp for a 2.4GHz
+ * SX1280 module.
+ **/
+
+#include "sim_firmware.h"
+#if defined(Regulatory_Domain_ISM_2400)
+#include "sim_sx1280.h"
+#else
+#include "sim_sx127x.h"
+#endif
+
+#ifndef SIM_TX_NODE
+#define SIM_TX_NODE SimTx900
+#define SIM_TX_FACTORY simTx900
+#endif
+
+#define TARGET_TX 1
+#define FEATURE_OPENTX_SYNC
+#undef CRSF_RX_MODULE
+#ifndef LATEST_COMMIT
+#define LATEST_COMMIT 0
+#endif
+#ifndef LATEST_VERSION
+#define LATEST_VERSION 0
+#endif
+
+namespace SIM_TX_NODE {
+
+#include "sim_platform.h"
+
+#if defined(Regulatory_Domain_ISM_2400)
+#include "SX1280Driver.h"
+#else
+#include "SX127xDriver.h"
+#endif
+// The mod settings in common.h are only declared outside of unit tests
+#undef UNIT_TEST
+#include "common.h"
+#define UNIT_TEST 1
+#if defined(Regulatory_Domain_ISM_2400)
+#include "sim_sx1280_hal.h"
+#else
+#include "sim_sx127x_hal.h"
+#endif
+
+#include "../../src/tx_main.cpp"
+#include "../../src/common.cpp"
+#include "../../src/options.cpp"
+#if defined(Regulatory_Domain_ISM_2400)
+#include "../../lib/SX1280Driver/SX1280.cpp"
+#else
+#include "../../lib/SX127xDriver/SX127x.cpp"
+#endif
+#include "../../lib/CRSF/CRSF.cpp"
+#include "../../lib/CRSF/devCRSF.cpp"
+#include "../../lib/LUA/lua.cpp"
+#include "../../lib/DEVICE/device.cpp"
+#include "../../lib/FHSS/FHSS.cpp"
+#include "../../lib/FHSS/random.cpp"
+#include "../../lib/CRC/crc.cpp"
+#include "../../lib/HWTIMER/NATIVE_hwTimer.cpp"
+// Only the packers for this side of the link, as in the firmware build
+#undef UNIT_TEST
+#include "../../lib/OTA/OTA.cpp"
+#define UNIT_TEST 1
+#include "../../lib/CONFIG/config.cpp"
+#include "../../lib/MSP/msp.cpp"
+#include "../../lib/StubbornSender/stubborn_sender.cpp"
+#include "../../lib/StubbornReceiver/stubborn_receiver.cpp"
+#include "../../lib/TelemetryDelta/telemetry_delta.cpp"
+
+// devLUA.cpp and devVTX.cpp serve the handset menu and the VTX MSP, and their
+// static device callbacks would collide with devCRSF.cpp in this single TU
+device_t LUA_device = {};
+device_t VTX_device = {};
+void VtxTriggerSend() {}
+
+#if defined(CRSF_RX_DMA_ACTIVE)
+// The DMA writes the handset's bytes straight into the ring and the line goes idle after each frame
+CRSFRxRing<CRSF_RX_RING_SIZE> CRSFRxDMA::ring;
+static uint16_t simDmaPos;
+static bool simDmaRunning;
+
+void CRSFRxDMA::start(HardwareSerial &port)
+{
+    (void)port;
+    simDmaPos = 0;
+    simDmaRunning = true;
+    ring.reset();
+}
+
+bool CRSFRxDMA::running() { return simDmaRunning; }
+uint16_t CRSFRxDMA::writePos() { return simDmaPos; }
+
+static void simDmaReceive(const uint8_t *data, size_t len)
+{
+    while (len--)
+    {
+        CRSFRxDMA::ring.buffer[simDmaPos] = *data++;
+        simDmaPos = (simDmaPos + 1) % CRSF_RX_RING_SIZE;
+    }
+    CRSFRxDMA::ring.markIdle(simDmaPos, micros());
+}
+#endif
+
+class Node : public SimTxNode
+{
+public:
+    Node() : rate(RATE_DEFAULT), switchMode(0), handsetFrameLen(0), syncRate(0), syncOffset(0)
+    {
+        simNode = this;
+        CRSF::Port.sink = &handsetReceive;
+        CRSF::Port.sinkCtx = this;
+#if defined(Regulatory_Domain_ISM_2400)
+        simSX1280 = &chip;
+        chip.dio1 = &simSX1280Dio1;
+#else
+        simSX127x = &chip;
+        chip.dio0 = &simSX127xDio0;
+#endif
+    }
+
+    SimRadioPort *radio() { return &chip; }
+
+    uint8_t rateCount() { return RATE_MAX; }
+    void setRate(uint8_t index) { rate = index; }
+    void setSwitchMode(uint8_t mode) { switchMode = mode; }
+
+    void handsetChannels(const uint16_t channels[16])
+    {
+        uint8_t frame[CRSF_FRAME_SIZE(sizeof(crsf_channels_t)) + 2];
+        crsf_channels_t *packed = (crsf_channels_t *)&frame[3];
+        frame[0] = CRSF_ADDRESS_CRSF_TRANSMITTER;
+        frame[1] = CRSF_FRAME_SIZE(sizeof(crsf_channels_t));
+        frame[2] = CRSF_FRAMETYPE_RC_CHANNELS_PACKED;
+        packed->ch0 = channels[0];
+        packed->ch1 = channels[1];
+        packed->ch2 = channels[2];
+        packed->ch3 = channels[3];
+        packed->ch4 = channels[4];
+        packed->ch5 = channels[5];
+        packed->ch6 = channels[6];
+        packed->ch7 = channels[7];
+        packed->ch8 = channels[8];
+        packed->ch9 = channels[9];
+        packed->ch10 = channels[10];
+        packed->ch11 = channels[11];
+        packed->ch12 = channels[12];
+        packed->ch13 = channels[13];
+        packed->ch14 = channels[14];
+        packed->ch15 = channels[15];
+        frame[sizeof(frame) - 1] = crsf_crc.calc(&frame[2], sizeof(frame) - 3);
+#if defined(CRSF_RX_DMA_ACTIVE)
+        simDmaReceive(frame, sizeof(frame));
+#else
+        CRSF::Port.simReceive(frame, sizeof(frame));
+#endif
+    }
+
+    void setCommitErases(bool erases) { simEepromErases = erases; }
+
+    void changeConfig()
+    {
+        config.SetDvrAux(config.GetDvrAux() + 1);
+        config.Commit();
+    }
+
+    uint32_t timerPauseUs()
+    {
+        const uint32_t count = NativeClock::eventCount();
+        for (uint32_t i = count; i-- > 0 && count - i <= NATIVE_EVENT_LOG_SIZE;)
+        {
+            if (NativeClock::event(i).event == nativeTimerPause)
+                return NativeClock::event(i).value;
+        }
+        return 0;
+    }
+
+    bool opentxSync(uint32_t *rate, int32_t *offset)
+    {
+        *rate = syncRate;
+        *offset = syncOffset;
+        return syncRate != 0;
+    }
+
+    bool connected() { return connectionState == SIM_TX_NODE::connected; }
+    uint8_t downlinkLQ() { return crsf.LinkStatistics.downlink_Link_quality; }
+    uint8_t uplinkLQReported() { return crsf.LinkStatistics.uplink_Link_quality; }
+
+protected:
+    void setup()
+    {
+        SIM_TX_NODE::setup();
+        // Start at the requested rate as if it had been stored by a previous session
+        config.SetRate(rate);
+        if (switchMode)
+            config.SetSwitchMode(switchMode);
+        config.Commit();
+        ChangeRadioParams();
+        connectionState = noCrossfire;
+    }
+
+    void loop() { SIM_TX_NODE::loop(); }
+
+private:
+#if defined(Regulatory_Domain_ISM_2400)
+    SimSX1280 chip;
+#else
+    SimSX127x chip;
+#endif
+    uint8_t rate;
+    uint8_t switchMode;
+    uint8_t handsetFrame[CRSF_MAX_PACKET_LEN];
+    uint8_t handsetFrameLen;
+    uint32_t syncRate;
+    int32_t syncOffset;
+
+    // Handset side of the CRSF UART, reassembles frames from the written bytes
+    static void handsetReceive(void *ctx, const uint8_t *data, size_t len)
+    {
+        Node *node = (Node *)ctx;
+        while (len--)
+            node->handsetByte(*data++);
+    }
+
+    void handsetByte(uint8_t c)
+    {
+        if (handsetFrameLen == 0 && c != CRSF_ADDRESS_RADIO_TRANSMITTER)
+            return;
+        if (handsetFrameLen == 1 && (c < 2 || c > CRSF_MAX_PACKET_LEN - 2))
+        {
+            handsetFrameLen = 0;
+            return;
+        }
+        handsetFrame[handsetFrameLen++] = c;
+        if (handsetFrameLen < 2 || handsetFrameLen < handsetFrame[1] + 2)
+            return;
+
+        handsetFrameLen = 0;
+        const uint8_t crc = crsf_crc.calc(&handsetFrame[2], handsetFrame[1] - 1);
+        // [type] [dest] [origin] [subtype] [rate BE] [offset BE] [crc]
+        if (crc != handsetFrame[handsetFrame[1] + 1] || handsetFrame[1] != 13 ||
+            handsetFrame[2] != CRSF_FRAMETYPE_RADIO_ID || handsetFrame[5] != CRSF_FRAMETYPE_OPENTX_SYNC)
+            return;
+
+        syncRate = (uint32_t)handsetFrame[6] << 24 | handsetFrame[7] << 16 | handsetFrame[8] << 8 | handsetFrame[9];
+        syncOffset = (uint32_t)handsetFrame[10] << 24 | handsetFrame[11] << 16 | handsetFrame[12] << 8 | handsetFrame[13];
+    }
+};
+
+} // namespace SIM_TX_NODE
+
+SimTxNode &SIM_TX_FACTORY()
+{
+    static SIM_TX_NODE::Node node;
+    return node;
+}
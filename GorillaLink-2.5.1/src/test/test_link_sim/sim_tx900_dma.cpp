@@ -0,0 +1,11 @@
+/**
+ * The same TX firmware as sim_tx900.cpp with USE_CRSF_RX_DMA, the handset's
+ * frames are written into the CRSF DMA ring and parsed in place.
+ **/
+
+#define SIM_TX_NODE SimTx900Dma
+#define SIM_TX_FACTORY simTx900Dma
+#define USE_CRSF_RX_DMA
+#define HAS_CRSF_RX_DMA
+
+#include "sim_tx900.cpp"
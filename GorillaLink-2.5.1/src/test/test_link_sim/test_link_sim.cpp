@@ -0,0 +1,796 @@
+#include <cstdint>
+#include <unity.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "sim_clock.h"
+#include "sim_air.h"
+#include "sim_node.h"
+
+/**
+ * End to end link simulation: the real TX and RX firmware exchanging packets
+ * through simulated SX127x or SX1280 radios on a virtual clock. The firmware keeps its
+ * state in globals, so every scenario runs in a forked child and reports its
+ * result back over a pipe.
+ **/
+
+#define HANDSET_INTERVAL_US 4000
+#define SAMPLE_INTERVAL_US 1000
+// CRSF channel values used to tag handset frames, multiples of 8 survive the 10 bit OTA packing
+#define LATENCY_TAG_BASE 172
+#define LATENCY_TAG_STEP 8
+#define LATENCY_TAG_COUNT 200
+// Histogram of the RX phase error, |offset| in us: <2, <4, <8, <16, <32, >=32
+#define PHASE_BUCKETS 6
+
+typedef struct {
+    bool ism2400;               // 2.4GHz SX1280 nodes instead of 900MHz SX127x
+    uint8_t rateIndex;
+    uint64_t seed;
+    uint32_t durationMs;
+    SimChannelParams uplink;    // TX -> RX, applied at the RX
+    SimChannelParams downlink;  // RX -> TX, applied at the TX
+    double txClockPpm;
+    double rxClockPpm;
+    double txRadioPpm;
+    double rxRadioPpm;
+    bool crsfRxDma;             // TX reads the handset through the CRSF DMA ring
+    uint8_t switchMode;         // OtaSwitchMode_e, 0 for the config default
+    uint8_t jammedCount;        // carriers with extra loss in both directions
+    const int64_t *jammedHz;
+    double jammedLossPercent;
+    uint32_t rxIsrLatencyUs;    // SimNode::isrLatencyMaxUs of the RX
+    uint32_t rxSpiJitterUs;     // SimNode::spiJitterMaxUs of the RX
+    uint32_t txConfigChangeMs;  // the TX config is changed and written out then, 0 for never
+    bool txCommitErases;        // and writing it out erases the flash
+    uint32_t handsetIntervalUs; // between handset frames, 0 for HANDSET_INTERVAL_US
+    uint32_t handsetShiftMs;    // from then on the handset frames come handsetShiftUs earlier, 0 for never
+    uint32_t handsetShiftUs;
+    uint32_t txStartMs;         // the TX is powered on then, the RX scans from the start
+} LinkScenario;
+
+typedef struct {
+    int32_t rxConnectMs;    // first time the RX was connected, -1 if never
+    int32_t txConnectMs;    // first time the TX saw telemetry, -1 if never
+    int32_t rxLockMs;       // first time the RX timer was locked, -1 if never
+    uint32_t rxDisconnects; // times the RX lost the link once connected
+    int32_t rxFreqPpm;      // RX clock error learnt by the phase lock, average over the last quarter
+    uint8_t rxRateIndex;
+    uint32_t uplinkLQ;      // average over the samples taken while connected, percent
+    uint32_t uplinkLQEarly; // the same over the first 3s once the LQ window has filled
+    uint32_t uplinkLQLate;  // the same over the last quarter of the run
+    uint32_t downlinkLQ;
+    uint32_t rcFrames;      // channel frames written to the flight controller
+    uint32_t latencyCount;
+    uint32_t latencyAvgUs;  // handset frame in to RX frame out
+    uint32_t latencyMaxUs;
+    uint16_t lastChannels[16];  // last channel frame written to the flight controller
+    uint32_t txPackets;
+    uint32_t rxPackets;
+    uint32_t txSpiTransfers;
+    uint32_t rxSpiTransfers;
+    uint32_t txIsrCount;    // DIO ISRs and the SPI cost inside them
+    uint32_t txIsrSpiTransfers;
+    uint32_t txIsrBusyWaitUs;
+    uint32_t rxIsrCount;
+    uint32_t rxIsrSpiTransfers;
+    uint32_t rxIsrBusyWaitUs;
+    uint32_t phaseHistogram[PHASE_BUCKETS]; // sampled every ms while connected
+    uint32_t phaseSamples;
+    uint32_t phaseRmsUs;
+    uint32_t txTimerPauseUs;    // last hwTimer.pause() of the TX, 0 if none
+    uint32_t syncRate;          // last OpenTX sync the TX sent the handset, 0.1us, 0 if none
+    int32_t syncOffset;
+    int32_t syncOffsetShift;    // the offset of the last one before the handset shift
+    uint64_t finalNs;
+    double wallSeconds;
+} LinkResult;
+
+static const LinkScenario *scenario;
+static SimTxNode *tx;
+static SimRxNode *rx;
+static LinkResult result;
+static uint64_t uplinkLQSum, downlinkLQSum;
+static uint32_t rxLQSamples, txLQSamples;
+static uint64_t uplinkLQEarlySum, uplinkLQLateSum;
+static uint32_t rxLQEarlySamples, rxLQLateSamples;
+static int64_t rxFreqLateSum;
+static uint64_t latencySumNs;
+static uint64_t phaseSquareSum;
+static uint64_t tagSentNs[LATENCY_TAG_COUNT];
+static uint32_t handsetSeq;
+static bool rxWasConnected;
+static bool handsetShifted;
+static uint16_t lastCh0;
+
+static void handsetEvent(void *ctx, uint32_t arg)
+{
+    uint16_t channels[16];
+    // Odd values on the AUX channels only arrive unchanged at full resolution
+    for (uint8_t ch = 0; ch < 16; ++ch)
+        channels[ch] = 1001 + ch * 2;
+    const uint32_t tag = handsetSeq++ % LATENCY_TAG_COUNT;
+    channels[0] = LATENCY_TAG_BASE + tag * LATENCY_TAG_STEP;
+    tagSentNs[tag] = SimClock::nowNs();
+    tx->handsetChannels(channels);
+
+    uint32_t intervalUs = scenario->handsetIntervalUs ? scenario->handsetIntervalUs : HANDSET_INTERVAL_US;
+    if (scenario->handsetShiftMs && !handsetShifted && SimClock::nowNs() >= scenario->handsetShiftMs * 1000000ULL)
+    {
+        handsetShifted = true;
+        intervalUs -= scenario->handsetShiftUs;
+        uint32_t rate;
+        tx->opentxSync(&rate, &result.syncOffsetShift);
+    }
+    SimClock::schedule(SimClock::nowNs() + intervalUs * 1000ULL, &handsetEvent, ctx);
+}
+
+static void rcFrame(void *ctx, const uint16_t channels[16])
+{
+    ++result.rcFrames;
+    memcpy(result.lastChannels, channels, sizeof(result.lastChannels));
+    if (channels[0] == lastCh0)
+        return;
+    lastCh0 = channels[0];
+
+    const uint32_t tag = (channels[0] - LATENCY_TAG_BASE) / LATENCY_TAG_STEP;
+    if (channels[0] < LATENCY_TAG_BASE || tag >= LATENCY_TAG_COUNT || tagSentNs[tag] == 0)
+        return;
+    const uint64_t latencyNs = SimClock::nowNs() - tagSentNs[tag];
+    ++result.latencyCount;
+    latencySumNs += latencyNs;
+    if (latencyNs / 1000 > result.latencyMaxUs)
+        result.latencyMaxUs = latencyNs / 1000;
+}
+
+static void sampleEvent(void *ctx, uint32_t arg)
+{
+    const int32_t nowMs = SimClock::nowNs() / 1000000;
+    if (rxWasConnected && !rx->connected())
+        ++result.rxDisconnects;
+    rxWasConnected = rx->connected();
+    if (scenario->txConfigChangeMs && !result.txTimerPauseUs)
+        result.txTimerPauseUs = tx->timerPauseUs();
+    if (rx->connected())
+    {
+        if (result.rxLockMs < 0 && rx->timerLocked())
+            result.rxLockMs = nowMs;
+        if (result.rxConnectMs < 0)
+            result.rxConnectMs = nowMs;
+        // Skip the first second while the LQ window fills
+        else if (nowMs - result.rxConnectMs > 1000)
+        {
+            uplinkLQSum += rx->uplinkLQ();
+            ++rxLQSamples;
+            const int32_t offset = rx->phaseOffset();
+            const uint32_t absOffset = offset < 0 ? -offset : offset;
+            uint8_t bucket = 0;
+            while (bucket < PHASE_BUCKETS - 1 && absOffset >= (2U << bucket))
+                ++bucket;
+            ++result.phaseHistogram[bucket];
+            ++result.phaseSamples;
+            phaseSquareSum += (uint64_t)absOffset * absOffset;
+            if (nowMs - result.rxConnectMs <= 4000)
+            {
+                uplinkLQEarlySum += rx->uplinkLQ();
+                ++rxLQEarlySamples;
+            }
+            if (nowMs >= (int32_t)scenario->durationMs * 3 / 4)
+            {
+                uplinkLQLateSum += rx->uplinkLQ();
+                rxFreqLateSum += rx->timerFreqPpm();
+                ++rxLQLateSamples;
+            }
+        }
+    }
+    if (tx->connected())
+    {
+        if (result.txConnectMs < 0)
+            result.txConnectMs = nowMs;
+        else if (nowMs - result.txConnectMs > 1000)
+        {
+            downlinkLQSum += tx->downlinkLQ();
+            ++txLQSamples;
+        }
+    }
+    SimClock::schedule(SimClock::nowNs() + SAMPLE_INTERVAL_US * 1000ULL, &sampleEvent, ctx);
+}
+
+static void txStartEvent(void *ctx, uint32_t arg)
+{
+    tx->start();
+    SimClock::schedule(SimClock::nowNs() + 10000000ULL, &handsetEvent, nullptr);
+}
+
+static void configChangeEvent(void *ctx, uint32_t arg)
+{
+    tx->setCommitErases(scenario->txCommitErases);
+    tx->changeConfig();
+}
+
+static double jammerLoss(int64_t carrierHz)
+{
+    for (uint8_t i = 0; i < scenario->jammedCount; ++i)
+    {
+        const int64_t offset = carrierHz - scenario->jammedHz[i];
+        if (offset > -200000 && offset < 200000)
+            return scenario->jammedLossPercent;
+    }
+    return 0.0;
+}
+
+static void runScenario(const LinkScenario *s)
+{
+    struct timespec wallStart, wallEnd;
+    clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+    scenario = s;
+    SimClock::reset(s->seed);
+    SimAir::reset();
+    if (s->jammedCount)
+        SimAir::carrierLossPercent = &jammerLoss;
+    if (s->ism2400)
+    {
+        tx = &simTx2400();
+        rx = &simRx2400();
+    }
+    else
+    {
+        tx = s->crsfRxDma ? &simTx900Dma() : &simTx900();
+        rx = &simRx900();
+    }
+
+    tx->clockPpm = s->txClockPpm;
+    rx->clockPpm = s->rxClockPpm;
+    rx->isrLatencyMaxUs = s->rxIsrLatencyUs;
+    rx->spiJitterMaxUs = s->rxSpiJitterUs;
+    // The two MCUs did not boot at the same moment
+    rx->bootOffsetNs = 1000000ULL + (SimClock::random() % 1000000);
+    tx->radio()->crystalPpm = s->txRadioPpm;
+    rx->radio()->crystalPpm = s->rxRadioPpm;
+    tx->radio()->channel = s->downlink;
+    rx->radio()->channel = s->uplink;
+    SimAir::attach(tx->radio());
+    SimAir::attach(rx->radio());
+
+    rx->rcFrameCallback = &rcFrame;
+    tx->setRate(s->rateIndex);
+    tx->setSwitchMode(s->switchMode);
+
+    memset(&result, 0, sizeof(result));
+    result.rxConnectMs = -1;
+    result.txConnectMs = -1;
+    result.rxLockMs = -1;
+
+    if (s->txStartMs)
+        SimClock::schedule(s->txStartMs * 1000000ULL, &txStartEvent, nullptr);
+    else
+        txStartEvent(nullptr, 0);
+    rx->start();
+    SimClock::schedule(0, &sampleEvent, nullptr);
+    if (s->txConfigChangeMs)
+        SimClock::schedule(s->txConfigChangeMs * 1000000ULL, &configChangeEvent, nullptr);
+    SimClock::runUntil(s->durationMs * 1000000ULL);
+
+    result.rxRateIndex = rx->rateIndex();
+    tx->opentxSync(&result.syncRate, &result.syncOffset);
+    result.rxFreqPpm = rxLQLateSamples ? rxFreqLateSum / (int64_t)rxLQLateSamples : rx->timerFreqPpm();
+    result.uplinkLQ = rxLQSamples ? uplinkLQSum / rxLQSamples : 0;
+    result.uplinkLQEarly = rxLQEarlySamples ? uplinkLQEarlySum / rxLQEarlySamples : 0;
+    result.uplinkLQLate = rxLQLateSamples ? uplinkLQLateSum / rxLQLateSamples : 0;
+    result.downlinkLQ = txLQSamples ? downlinkLQSum / txLQSamples : 0;
+    result.latencyAvgUs = result.latencyCount ? latencySumNs / result.latencyCount / 1000 : 0;
+    result.phaseRmsUs = result.phaseSamples ? (uint32_t)sqrt((double)phaseSquareSum / result.phaseSamples) : 0;
+    result.txPackets = tx->radio()->txPackets;
+    result.rxPackets = rx->radio()->rxDelivered;
+    result.txSpiTransfers = tx->radio()->spiTransfers;
+    result.rxSpiTransfers = rx->radio()->spiTransfers;
+    result.txIsrCount = tx->radio()->isrCount;
+    result.txIsrSpiTransfers = tx->radio()->isrSpiTransfers;
+    result.txIsrBusyWaitUs = tx->radio()->isrBusyWaitUs;
+    result.rxIsrCount = rx->radio()->isrCount;
+    result.rxIsrSpiTransfers = rx->radio()->isrSpiTransfers;
+    result.rxIsrBusyWaitUs = rx->radio()->isrBusyWaitUs;
+    result.finalNs = SimClock::nowNs();
+
+    clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+    result.wallSeconds = (wallEnd.tv_sec - wallStart.tv_sec) + (wallEnd.tv_nsec - wallStart.tv_nsec) * 1e-9;
+}
+
+static LinkResult simulate(const LinkScenario *s)
+{
+    LinkResult r;
+    memset(&r, 0, sizeof(r));
+    r.rxConnectMs = -1;
+    r.txConnectMs = -1;
+    r.rxLockMs = -1;
+
+    int fds[2];
+    if (pipe(fds) != 0)
+        return r;
+    fflush(stdout);
+    const pid_t pid = fork();
+    if (pid == 0)
+    {
+        close(fds[0]);
+        runScenario(s);
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid > 0)
+    {
+        if (read(fds[0], &r, sizeof(r)) != sizeof(r))
+            r.rxConnectMs = r.txConnectMs = -1;
+        waitpid(pid, nullptr, 0);
+    }
+    close(fds[0]);
+    return r;
+}
+
+static LinkScenario cleanScenario(uint8_t rateIndex)
+{
+    LinkScenario s;
+    memset(&s, 0, sizeof(s));
+    s.rateIndex = rateIndex;
+    s.seed = 0x454c5253;
+    s.durationMs = 15000;
+    s.uplink.rssi = -60;
+    s.uplink.snr = 10;
+    s.downlink.rssi = -60;
+    s.downlink.snr = 10;
+    return s;
+}
+
+static void printResult(const char *name, const LinkScenario *s, const LinkResult *r)
+{
+    printf("%-10s rate=%u rxSync=%dms txSync=%dms LQ up=%u%% down=%u%% latency avg=%uus max=%uus frames=%u speedup=%.0fx\n",
+        name, s->rateIndex, r->rxConnectMs, r->txConnectMs, r->uplinkLQ, r->downlinkLQ,
+        r->latencyAvgUs, r->latencyMaxUs, r->rcFrames,
+        r->wallSeconds > 0 ? (r->finalNs * 1e-9) / r->wallSeconds : 0.0);
+}
+
+void test_link_all_rates(void)
+{
+    const uint8_t rates = simTx900().rateCount();
+    for (uint8_t rate = 0; rate < rates; ++rate)
+    {
+        LinkScenario s = cleanScenario(rate);
+        LinkResult r = simulate(&s);
+        printResult("clean", &s, &r);
+
+        TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+        TEST_ASSERT_NOT_EQUAL(-1, r.txConnectMs);
+        TEST_ASSERT_EQUAL(rate, r.rxRateIndex);
+        TEST_ASSERT_GREATER_OR_EQUAL(95, r.uplinkLQ);
+        TEST_ASSERT_GREATER_THAN(0, r.rcFrames);
+        TEST_ASSERT_GREATER_THAN(0, r.latencyCount);
+        // Faster than real time
+        TEST_ASSERT_GREATER_THAN(1.0, (r.finalNs * 1e-9) / r.wallSeconds);
+    }
+}
+
+void test_link_deterministic(void)
+{
+    LinkScenario s = cleanScenario(0);
+    s.durationMs = 5000;
+    s.uplink.lossPercent = 10;
+    s.downlink.lossPercent = 10;
+    LinkResult first = simulate(&s);
+    LinkResult second = simulate(&s);
+
+    TEST_ASSERT_NOT_EQUAL(-1, first.rxConnectMs);
+    TEST_ASSERT_EQUAL(first.rxConnectMs, second.rxConnectMs);
+    TEST_ASSERT_EQUAL(first.txConnectMs, second.txConnectMs);
+    TEST_ASSERT_EQUAL(first.uplinkLQ, second.uplinkLQ);
+    TEST_ASSERT_EQUAL(first.downlinkLQ, second.downlinkLQ);
+    TEST_ASSERT_EQUAL(first.rcFrames, second.rcFrames);
+    TEST_ASSERT_EQUAL(first.latencyAvgUs, second.latencyAvgUs);
+    TEST_ASSERT_EQUAL(first.txPackets, second.txPackets);
+    TEST_ASSERT_EQUAL(first.rxPackets, second.rxPackets);
+}
+
+void test_link_uplink_loss(void)
+{
+    LinkScenario s = cleanScenario(0);
+    s.uplink.lossPercent = 30;
+    LinkResult r = simulate(&s);
+    printResult("loss30", &s, &r);
+
+    TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+    TEST_ASSERT_INT_WITHIN(10, 70, r.uplinkLQ);
+}
+
+void test_link_corruption(void)
+{
+    // Corrupted packets must be rejected by the OTA CRC and count as lost
+    LinkScenario s = cleanScenario(0);
+    s.uplink.corruptPercent = 20;
+    LinkResult r = simulate(&s);
+    printResult("corrupt20", &s, &r);
+
+    TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+    TEST_ASSERT_INT_WITHIN(10, 80, r.uplinkLQ);
+}
+
+void test_link_drift_and_delay(void)
+{
+    LinkScenario s = cleanScenario(1);
+    s.txClockPpm = -40;
+    s.rxClockPpm = 40;
+    s.txRadioPpm = 10;
+    s.rxRadioPpm = -10;
+    s.uplink.delayUs = 50;
+    s.downlink.delayUs = 50;
+    LinkResult r = simulate(&s);
+    printResult("drift", &s, &r);
+
+    TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+    TEST_ASSERT_NOT_EQUAL(-1, r.txConnectMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(95, r.uplinkLQ);
+}
+
+void test_link_crsf_rx_dma(void)
+{
+    LinkScenario s = cleanScenario(0);
+    s.crsfRxDma = true;
+    LinkResult r = simulate(&s);
+    printResult("crsfdma", &s, &r);
+
+    TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+    TEST_ASSERT_NOT_EQUAL(-1, r.txConnectMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(95, r.uplinkLQ);
+    TEST_ASSERT_GREATER_THAN(0, r.latencyCount);
+}
+
+void test_link_full_res(void)
+{
+    // smFullRes on the TX, the RX has to find it from the CRC errors of its
+    // long packets on the standard rate with the same modulation
+    LinkScenario s = cleanScenario(0);
+    s.switchMode = 3; // smFullRes
+    LinkResult r = simulate(&s);
+    printResult("fullres", &s, &r);
+
+    TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+    TEST_ASSERT_NOT_EQUAL(-1, r.txConnectMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(95, r.uplinkLQ);
+    TEST_ASSERT_GREATER_THAN(0, r.latencyCount);
+    // Every channel but the latency tag in channel 0 arrives exactly
+    for (uint8_t ch = 1; ch < 12; ++ch)
+        TEST_ASSERT_EQUAL(1001 + ch * 2, r.lastChannels[ch]);
+}
+
+void test_link_jammed_channels(void)
+{
+    // A jammer wiping out four neighbouring channels of the 40, the RX has to
+    // find them and both ends hop around them
+    static const int64_t jammed[] = {906500000, 907100000, 907700000, 908300000};
+    LinkScenario s = cleanScenario(0);
+    s.durationMs = 30000;
+    s.jammedCount = sizeof(jammed) / sizeof(jammed[0]);
+    s.jammedHz = jammed;
+    s.jammedLossPercent = 100;
+    LinkResult r = simulate(&s);
+    printResult("jammed", &s, &r);
+    printf("jammed     LQ up first 3s=%u%% last quarter=%u%%\n", r.uplinkLQEarly, r.uplinkLQLate);
+
+    TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+    TEST_ASSERT_NOT_EQUAL(-1, r.txConnectMs);
+    // About one packet in ten is lost before the blacklist kicks in, none after
+    TEST_ASSERT_LESS_OR_EQUAL(93, r.uplinkLQEarly);
+    TEST_ASSERT_GREATER_OR_EQUAL(97, r.uplinkLQLate);
+}
+
+void test_link_2400_all_rates(void)
+{
+    const uint8_t rates = simTx2400().rateCount();
+    for (uint8_t rate = 0; rate < rates; ++rate)
+    {
+        LinkScenario s = cleanScenario(rate);
+        s.ism2400 = true;
+        s.txRadioPpm = 10;
+        s.rxRadioPpm = -10;
+        LinkResult r = simulate(&s);
+        printResult("2400", &s, &r);
+
+        TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+        TEST_ASSERT_NOT_EQUAL(-1, r.txConnectMs);
+        TEST_ASSERT_EQUAL(rate, r.rxRateIndex);
+        TEST_ASSERT_GREATER_OR_EQUAL(95, r.uplinkLQ);
+        TEST_ASSERT_GREATER_THAN(0, r.latencyCount);
+    }
+}
+
+void test_link_2400_flrc_1000hz(void)
+{
+    // FLRC is the last 2.4GHz rate. Packet, telemetry turnaround and hop all
+    // have to fit the 1ms slot or packets get cut short by the next one.
+    const uint8_t flrcRate = simTx2400().rateCount() - 1;
+    for (uint8_t switchMode = 0; switchMode <= 3; switchMode += 3)
+    {
+        LinkScenario s = cleanScenario(flrcRate);
+        s.ism2400 = true;
+        s.switchMode = switchMode; // default and smFullRes
+        s.txClockPpm = -40;
+        s.rxClockPpm = 40;
+        s.uplink.delayUs = 5;
+        s.downlink.delayUs = 5;
+        LinkResult r = simulate(&s);
+        printResult(switchMode ? "flrc-full" : "flrc", &s, &r);
+
+        TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+        TEST_ASSERT_NOT_EQUAL(-1, r.txConnectMs);
+        TEST_ASSERT_EQUAL(flrcRate, r.rxRateIndex);
+        TEST_ASSERT_GREATER_OR_EQUAL(95, r.uplinkLQ);
+        TEST_ASSERT_GREATER_OR_EQUAL(90, r.downlinkLQ);
+        // A packet every ms but the telemetry slots, none of them cut short
+        TEST_ASSERT_GREATER_OR_EQUAL(s.durationMs * 95 / 100, r.txPackets);
+        TEST_ASSERT_GREATER_OR_EQUAL((s.durationMs - r.rxConnectMs) * 95 / 100, r.rxPackets);
+        TEST_ASSERT_LESS_THAN(10000, r.latencyAvgUs);
+    }
+}
+
+static void printIsrSpi(const char *name, uint32_t count, uint32_t transfers, uint32_t busyWaitUs)
+{
+    printf("%-10s isr=%u spi/isr=%.2f busy/isr=%.2fus\n", name, count,
+        count ? (double)transfers / count : 0.0, count ? (double)busyWaitUs / count : 0.0);
+}
+
+void test_link_2400_isr_spi(void)
+{
+    // What the radio DIO ISRs cost on the SPI bus: NSS cycles and the time
+    // spent waiting on BUSY by the hal of a board without a BUSY pin. An RX
+    // done is 5 commands, the IRQ clear goes last so none of them waits, where
+    // clearing first used to cost 12us. The TX still waits when its TX done
+    // callback starts the telemetry RX behind the clear.
+    const uint8_t rates[] = {0, (uint8_t)(simTx2400().rateCount() - 1)};
+    for (uint8_t i = 0; i < sizeof(rates); ++i)
+    {
+        LinkScenario s = cleanScenario(rates[i]);
+        s.ism2400 = true;
+        s.durationMs = 10000;
+        LinkResult r = simulate(&s);
+        printResult("isrspi", &s, &r);
+        printIsrSpi("isrspi tx", r.txIsrCount, r.txIsrSpiTransfers, r.txIsrBusyWaitUs);
+        printIsrSpi("isrspi rx", r.rxIsrCount, r.rxIsrSpiTransfers, r.rxIsrBusyWaitUs);
+
+        TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+        TEST_ASSERT_GREATER_THAN(0, r.txIsrCount);
+        TEST_ASSERT_GREATER_THAN(0, r.rxIsrCount);
+        TEST_ASSERT_LESS_OR_EQUAL(5 * r.txIsrCount, r.txIsrSpiTransfers);
+        TEST_ASSERT_LESS_OR_EQUAL(5 * r.rxIsrCount, r.rxIsrSpiTransfers);
+        // Under 1us per ISR on average
+        TEST_ASSERT_LESS_THAN(r.rxIsrCount, r.rxIsrBusyWaitUs);
+    }
+}
+
+void test_link_spi_per_packet(void)
+{
+    // SPI transactions of the SX127x per packet, the TX sending one and the
+    // RX receiving one, telemetry included
+    LinkScenario s = cleanScenario(0);
+    s.durationMs = 10000;
+    LinkResult r = simulate(&s);
+    printResult("spi", &s, &r);
+    printf("spi        tx=%.2f/packet rx=%.2f/packet\n",
+        (double)r.txSpiTransfers / r.txPackets, (double)r.rxSpiTransfers / r.rxPackets);
+
+    TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+    TEST_ASSERT_GREATER_THAN(0, r.txPackets);
+    TEST_ASSERT_GREATER_THAN(0, r.rxPackets);
+    // 5.4 and 7.6 without the register shadow, which drops the RX's repeated
+    // writes of an unchanged PPM offset
+    TEST_ASSERT_LESS_OR_EQUAL(6 * r.txPackets, r.txSpiTransfers);
+    TEST_ASSERT_LESS_OR_EQUAL(7 * r.rxPackets, r.rxSpiTransfers);
+}
+
+void test_link_phase_jitter(void)
+{
+    // The RX times the packet from the DIO edge, so the ISR latency and the
+    // SPI reads after it shouldn't show up in the phase error the timer sees
+    LinkScenario s = cleanScenario(0);
+    s.durationMs = 10000;
+    s.rxIsrLatencyUs = 3;
+    s.rxSpiJitterUs = 10;
+    LinkResult r = simulate(&s);
+    printResult("jitter", &s, &r);
+    printf("jitter     phase rms=%uus |offset| <2:%u <4:%u <8:%u <16:%u <32:%u >=32:%u\n", r.phaseRmsUs,
+        r.phaseHistogram[0], r.phaseHistogram[1], r.phaseHistogram[2],
+        r.phaseHistogram[3], r.phaseHistogram[4], r.phaseHistogram[5]);
+
+    TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+    TEST_ASSERT_GREATER_OR_EQUAL(95, r.uplinkLQ);
+    TEST_ASSERT_GREATER_THAN(0, r.phaseSamples);
+    // Timed in ProcessRFPacket after the SPI reads it was 7us rms, a third of it 8us or more
+    TEST_ASSERT_LESS_OR_EQUAL(3, r.phaseRmsUs);
+    TEST_ASSERT_EQUAL(0, r.phaseHistogram[3] + r.phaseHistogram[4] + r.phaseHistogram[5]);
+}
+
+void test_link_phase_lock(void)
+{
+    // Time to lock and steady state phase error of the RX timer against the
+    // TX, the MCU crystals off in opposite directions. The phase lock has to
+    // learn the clock error and hold it through lost packets.
+    typedef struct {
+        bool ism2400;
+        double ppm;
+        uint8_t lossPercent;
+    } PhaseLockCase;
+    const PhaseLockCase cases[] = {
+        {false, 0, 0}, {false, 50, 0}, {false, -75, 0}, {false, 50, 30},
+        {true, 0, 0}, {true, 50, 0}, {true, -75, 0}, {true, 50, 30},
+    };
+    for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        LinkScenario s = cleanScenario(0);
+        s.ism2400 = cases[i].ism2400;
+        s.durationMs = 6000;
+        s.txClockPpm = -cases[i].ppm;
+        s.rxClockPpm = cases[i].ppm;
+        s.uplink.lossPercent = cases[i].lossPercent;
+        s.rxIsrLatencyUs = 3;
+        LinkResult r = simulate(&s);
+        printResult("phaselock", &s, &r);
+        printf("phaselock  ppm=%+d/%+d loss=%u%% lock=%dms after sync learnt=%+dppm phase rms=%uus |offset| <2:%u <4:%u <8:%u >=8:%u\n",
+            (int)s.rxClockPpm, (int)s.txClockPpm, cases[i].lossPercent,
+            r.rxLockMs - r.rxConnectMs, r.rxFreqPpm, r.phaseRmsUs,
+            r.phaseHistogram[0], r.phaseHistogram[1], r.phaseHistogram[2],
+            r.phaseHistogram[3] + r.phaseHistogram[4] + r.phaseHistogram[5]);
+
+        TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+        TEST_ASSERT_NOT_EQUAL(-1, r.rxLockMs);
+        // It used to take at least ConsiderConnGoodMillis (1s)
+        TEST_ASSERT_LESS_OR_EQUAL(200, r.rxLockMs - r.rxConnectMs);
+        TEST_ASSERT_INT_WITHIN(10, (int32_t)(s.rxClockPpm - s.txClockPpm), r.rxFreqPpm);
+        TEST_ASSERT_GREATER_THAN(0, r.phaseSamples);
+        TEST_ASSERT_LESS_OR_EQUAL(2, r.phaseRmsUs);
+        TEST_ASSERT_EQUAL(0, r.phaseHistogram[3] + r.phaseHistogram[4] + r.phaseHistogram[5]);
+    }
+}
+
+void test_link_config_commit_pause(void)
+{
+    // A config change written out while connected. When the last slice has
+    // to erase the flash CommitConfigSlice() pauses the TX timer over it for
+    // ceil(65000us / interval) + 1 intervals and makes the nonce and FHSS
+    // catch up, the RX keeps the link through the gap.
+    typedef struct {
+        bool ism2400;
+        uint8_t rateIndex;
+        uint32_t changeMs;  // once the RX has cycled through to the rate
+        bool erases;
+        uint32_t pauseUs;
+    } CommitCase;
+    const CommitCase cases[] = {
+        {false, 0, 3000, false, 0},
+        {false, 0, 3000, true, 14 * 5000}, {false, 1, 6000, true, 8 * 10000},
+        {false, 2, 9000, true, 5 * 20000}, {false, 3, 12000, true, 3 * 40000},
+        {true, 0, 3000, true, 34 * 2000}, {true, 4, 10000, true, 66 * 1000},
+    };
+    for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        LinkScenario s = cleanScenario(cases[i].rateIndex);
+        s.ism2400 = cases[i].ism2400;
+        s.durationMs = cases[i].changeMs + 5000;
+        s.txConfigChangeMs = cases[i].changeMs;
+        s.txCommitErases = cases[i].erases;
+        LinkResult r = simulate(&s);
+        printResult("commit", &s, &r);
+        printf("commit     erases=%u pause=%uus LQ late=%u%% rx disconnects=%u\n",
+            cases[i].erases, r.txTimerPauseUs, r.uplinkLQLate, r.rxDisconnects);
+
+        TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+        TEST_ASSERT_LESS_THAN(cases[i].changeMs, r.rxConnectMs);
+        TEST_ASSERT_EQUAL(cases[i].pauseUs, r.txTimerPauseUs);
+        TEST_ASSERT_EQUAL(0, r.rxDisconnects);
+        TEST_ASSERT_GREATER_OR_EQUAL(95, r.uplinkLQLate);
+    }
+}
+
+void test_link_opentx_sync(void)
+{
+    // The handset sends a frame every packet interval, then moves its frames
+    // earlier once the link is up. The OpenTX sync the TX sends back has to
+    // report the packet interval and move its offset by the shift, give or
+    // take the loop interval the TX may take to read a frame. The offset is a
+    // phase, so it only counts modulo the interval.
+    typedef struct {
+        bool ism2400;
+        uint8_t rateIndex;
+        uint32_t intervalUs;
+        uint32_t shiftUs;
+        uint32_t shiftMs;   // once the RX has cycled through to the rate
+    } SyncCase;
+    const SyncCase cases[] = {
+        {false, 0, 5000, 1000, 1000}, {false, 0, 5000, 3000, 1000}, {false, 1, 10000, 6000, 5000},
+        {true, 0, 2000, 600, 1000}, {true, 1, 4000, 1500, 4000},
+    };
+    for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        LinkScenario s = cleanScenario(cases[i].rateIndex);
+        s.ism2400 = cases[i].ism2400;
+        s.durationMs = cases[i].shiftMs + 2000;
+        s.handsetIntervalUs = cases[i].intervalUs;
+        s.handsetShiftMs = cases[i].shiftMs;
+        s.handsetShiftUs = cases[i].shiftUs;
+        LinkResult r = simulate(&s);
+        printResult("otxsync", &s, &r);
+        printf("otxsync    interval=%uus shift=%uus rate=%u offset=%d then %d\n",
+            cases[i].intervalUs, cases[i].shiftUs, r.syncRate, r.syncOffsetShift, r.syncOffset);
+
+        TEST_ASSERT_NOT_EQUAL(-1, r.txConnectMs);
+        TEST_ASSERT_LESS_THAN(cases[i].shiftMs, r.txConnectMs);
+        TEST_ASSERT_EQUAL(cases[i].intervalUs * 10, r.syncRate);
+        const int32_t rate = r.syncRate;
+        int32_t moved = (r.syncOffset - r.syncOffsetShift - (int32_t)cases[i].shiftUs * 10) % rate;
+        if (moved > rate / 2)
+            moved -= rate;
+        else if (moved < -rate / 2)
+            moved += rate;
+        TEST_ASSERT_INT_WITHIN(simTx900().loopIntervalUs * 10, 0, moved);
+    }
+}
+
+void test_link_acquisition_time(void)
+{
+    // The RX has been scanning for a while when the TX is powered on. Without
+    // ENABLE_FULL_RES_SCAN it only goes round the standard rates, so it finds
+    // the TX within one pass of them: the cycle intervals of all the rates,
+    // 9.7s at 900MHz and 8.3s at 2.4GHz, plus the time to sync.
+    const uint32_t starts[] = {4000, 12000, 20000};
+    for (uint8_t band = 0; band < 2; ++band)
+    {
+        const uint8_t rates = band ? simTx2400().rateCount() : simTx900().rateCount();
+        const uint32_t scanPassMs = band ? 9000 : 10500;
+        for (uint8_t rate = 0; rate < rates; ++rate)
+        {
+            for (uint8_t i = 0; i < sizeof(starts) / sizeof(starts[0]); ++i)
+            {
+                LinkScenario s = cleanScenario(rate);
+                s.ism2400 = band;
+                s.txStartMs = starts[i];
+                s.durationMs = s.txStartMs + scanPassMs + 1000;
+                LinkResult r = simulate(&s);
+                printResult("acquire", &s, &r);
+
+                TEST_ASSERT_NOT_EQUAL(-1, r.rxConnectMs);
+                TEST_ASSERT_EQUAL(rate, r.rxRateIndex);
+                TEST_ASSERT_LESS_THAN(scanPassMs, r.rxConnectMs - (int32_t)s.txStartMs);
+            }
+        }
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_link_all_rates);
+    RUN_TEST(test_link_deterministic);
+    RUN_TEST(test_link_uplink_loss);
+    RUN_TEST(test_link_corruption);
+    RUN_TEST(test_link_drift_and_delay);
+    RUN_TEST(test_link_crsf_rx_dma);
+    RUN_TEST(test_link_full_res);
+    RUN_TEST(test_link_jammed_channels);
+    RUN_TEST(test_link_2400_all_rates);
+    RUN_TEST(test_link_2400_flrc_1000hz);
+    RUN_TEST(test_link_2400_isr_spi);
+    RUN_TEST(test_link_spi_per_packet);
+    RUN_TEST(test_link_phase_jitter);
+    RUN_TEST(test_link_phase_lock);
+    RUN_TEST(test_link_config_commit_pause);
+    RUN_TEST(test_link_opentx_sync);
+    RUN_TEST(test_link_acquisition_time);
+    UNITY_END();
+
+    return 0;
+}
@@ -1,9 +1,12 @@
+#include <cstdio>
 #include <unity.h>
 #include "msp.h"
 #include "msptypes.h"
 #include "mock_serial.h"
 
 #include "CRSF.h"
+#include "stubborn_sender.h"
+#include "stubborn_receiver.h"
 
 // Mock out the serial port using a string stream
 std::string buf;
@@ -97,3 +100,222 @@ void test_encapsulated_msp_send_too_long(void)
     TEST_ASSERT_EQUAL(NULL, data);
     TEST_ASSERT_EQUAL(0, len);
 }
+
+static void makeSettingsPacket(mspPacket_t *packet, const uint8_t *settings)
+{
+    packet->reset();
+    packet->makeCommand();
+    packet->function = 0x59; // MSP_SET_VTX_CONFIG
+    for (uint8_t i = 0; i < ENCAPSULATED_MSP_MAX_PAYLOAD_SIZE; i++)
+    {
+        packet->addByte(settings[i]);
+    }
+}
+
+/**
+ * Splits a message the way rx_main does, returns how many frames were in it
+ **/
+static uint8_t splitFrames(const uint8_t *message, uint16_t length, uint8_t *frames, uint16_t *framesLength)
+{
+    uint8_t count = 0;
+    uint16_t offset = 0;
+    while (offset + CRSF_FRAME_NOT_COUNTED_BYTES <= length && message[offset + CRSF_TELEMETRY_LENGTH_INDEX] != 0)
+    {
+        const uint16_t frameSize = CRSF_FRAME_SIZE(message[offset + CRSF_TELEMETRY_LENGTH_INDEX]);
+        if (frameSize > length - offset)
+        {
+            break;
+        }
+        memcpy(&frames[*framesLength], &message[offset], frameSize);
+        *framesLength += frameSize;
+        offset += frameSize;
+        count++;
+    }
+    return count;
+}
+
+void test_encapsulated_msp_batched(void)
+{
+    // TEST CASE:
+    // GIVEN several writes have been queued with AddMspMessage()
+    // WHEN GetMspMessage() is called
+    // THEN as many of them as fit in ELRS_MSP_BUFFER come back as one message
+    // AND the rest come in the next message once it is unlocked
+
+    crsf.ResetMspQueue();
+
+    const uint8_t settings[ENCAPSULATED_MSP_MAX_PAYLOAD_SIZE] = {0x18, 0x00, 0x01, 0x00};
+    const uint8_t frameSize = 14;
+    const uint8_t perMessage = ELRS_MSP_BUFFER / frameSize;
+    mspPacket_t packet;
+    makeSettingsPacket(&packet, settings);
+    for (uint8_t i = 0; i < perMessage + 2; i++)
+    {
+        TEST_ASSERT_TRUE(crsf.AddMspMessage(&packet));
+    }
+
+    uint8_t *data;
+    uint8_t len;
+    crsf.GetMspMessage(&data, &len);
+    TEST_ASSERT_NOT_EQUAL(NULL, data);
+    TEST_ASSERT_EQUAL(perMessage * frameSize, len);
+
+    uint8_t frames[ELRS_MSP_BUFFER];
+    uint16_t framesLength = 0;
+    TEST_ASSERT_EQUAL(perMessage, splitFrames(data, ELRS_MSP_BUFFER, frames, &framesLength));
+    for (uint8_t i = 0; i < perMessage; i++)
+    {
+        TEST_ASSERT_EQUAL(0x30, frames[i * frameSize + 5]);
+        TEST_ASSERT_EQUAL(0x5E, frames[i * frameSize + 13]);
+    }
+
+    // Handed out already, so more writes do not change it
+    TEST_ASSERT_TRUE(crsf.AddMspMessage(&packet));
+    crsf.GetMspMessage(&data, &len);
+    TEST_ASSERT_EQUAL(perMessage * frameSize, len);
+
+    crsf.UnlockMspMessage();
+    crsf.GetMspMessage(&data, &len);
+    TEST_ASSERT_EQUAL(3 * frameSize, len);
+    framesLength = 0;
+    TEST_ASSERT_EQUAL(3, splitFrames(data, ELRS_MSP_BUFFER, frames, &framesLength));
+
+    crsf.UnlockMspMessage();
+    crsf.GetMspMessage(&data, &len);
+    TEST_ASSERT_EQUAL(NULL, data);
+    TEST_ASSERT_EQUAL(0, len);
+}
+
+/**
+ * A 1KB settings dump from the handset over the MSP uplink, following
+ * tx_main and rx_main at 250Hz with the 1:2 telemetry boost: the TX sends
+ * MSP in every other RC slot, the RX acks it in LINK telemetry which it sends
+ * early when the ack changes. The handset writes as fast as the queue takes
+ * them. Batched takes the messages from GetMspMessage(), otherwise every
+ * write is its own message as before. Returns the seconds to get it all to
+ * the RX, which checks it is all there in order.
+ **/
+static float simulateSettingsDump(const uint8_t *settings, uint16_t settingsLength, uint8_t lossPercent, bool batched)
+{
+    const uint32_t hz = 250;
+    const uint8_t tlmRatio = 2;
+    StubbornSender mspSender(ELRS_MSP_MAX_PACKAGES, ELRS_MSP_WINDOW, ELRS_MSP_FEC_GROUP);
+    StubbornReceiver mspReceiver(ELRS_MSP_MAX_PACKAGES, ELRS_MSP_FEC_GROUP);
+    static uint8_t sent[4096];
+    static uint8_t received[4096];
+    uint16_t sentLength = 0;
+    uint16_t receivedLength = 0;
+    uint8_t mspData[ELRS_MSP_BUFFER] = {0};
+    uint8_t airPacket[ELRS_MSP_BYTES_PER_CALL];
+    uint16_t settingsSent = 0;
+    uint32_t lcg = 12345 + lossPercent;
+    bool nextPacketIsMsp = true;
+    bool nextTlmIsLink = true;
+    uint8_t burstCount = 0;
+    uint8_t burstMax = 512U * hz / tlmRatio / 1000U - 1;
+
+    crsf.ResetMspQueue();
+    mspReceiver.SetDataToReceive(sizeof(mspData), mspData, ELRS_MSP_BYTES_PER_CALL);
+    const uint16_t dumpLength = settingsLength / ENCAPSULATED_MSP_MAX_PAYLOAD_SIZE * 14;
+    uint32_t nonce;
+    for (nonce = 0; nonce < hz * 600 && receivedLength < dumpLength; nonce++)
+    {
+        lcg = lcg * 1664525 + 1013904223;
+        const bool lost = (lcg >> 8) % 100 < lossPercent;
+
+        // The handset side, and the TX loop looking for the next message
+        if (!mspSender.IsActive())
+        {
+            crsf.UnlockMspMessage();
+        }
+        mspPacket_t packet;
+        makeSettingsPacket(&packet, &settings[settingsSent]);
+        if (settingsSent < settingsLength && (batched || !mspSender.IsActive()) && crsf.AddMspMessage(&packet))
+        {
+            settingsSent += ENCAPSULATED_MSP_MAX_PAYLOAD_SIZE;
+        }
+        if (!mspSender.IsActive())
+        {
+            uint8_t *message;
+            uint8_t messageLength;
+            crsf.GetMspMessage(&message, &messageLength);
+            if (message != nullptr)
+            {
+                memcpy(&sent[sentLength], message, messageLength);
+                sentLength += messageLength;
+                mspSender.SetDataToTransmit(messageLength, message, ELRS_MSP_BYTES_PER_CALL);
+            }
+        }
+
+        if ((nonce + 1) % tlmRatio == 0)
+        {
+            const bool linkSlot = nextTlmIsLink;
+            if (linkSlot)
+            {
+                nextTlmIsLink = false;
+                burstCount = 1;
+            }
+            else if (burstCount < burstMax)
+                burstCount++;
+            else
+                nextTlmIsLink = true;
+            if (linkSlot && !lost)
+                mspSender.ConfirmCurrentPayload(mspReceiver.GetCurrentAck());
+        }
+        else if (nextPacketIsMsp && mspSender.IsActive())
+        {
+            uint8_t *data;
+            uint8_t maxLength;
+            uint8_t packageIndex;
+            mspSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+            for (uint8_t i = 0; i < sizeof(airPacket); i++)
+                airPacket[i] = i < maxLength ? data[i] : 0;
+            nextPacketIsMsp = false;
+            if (lost)
+                continue;
+
+            const uint8_t ack = mspReceiver.GetCurrentAck();
+            mspReceiver.ReceiveData(packageIndex, airPacket);
+            if (ack != mspReceiver.GetCurrentAck())
+                nextTlmIsLink = true;
+            if (mspReceiver.HasFinishedData())
+            {
+                splitFrames(mspData, sizeof(mspData), received, &receivedLength);
+                memset(mspData, 0, sizeof(mspData));
+                mspReceiver.Unlock();
+            }
+        }
+        else
+        {
+            nextPacketIsMsp = true;
+        }
+    }
+
+    TEST_ASSERT_EQUAL(dumpLength, receivedLength);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(sent, received, sentLength);
+    for (uint16_t i = 0; i < settingsLength; i++)
+    {
+        TEST_ASSERT_EQUAL(settings[i], received[i / ENCAPSULATED_MSP_MAX_PAYLOAD_SIZE * 14 + 8 + i % ENCAPSULATED_MSP_MAX_PAYLOAD_SIZE]);
+    }
+    return (float)nonce / hz;
+}
+
+void test_encapsulated_msp_settings_dump_throughput(void)
+{
+    uint8_t settings[1024];
+    for (uint16_t i = 0; i < sizeof(settings); i++)
+    {
+        settings[i] = i * 13 + 5;
+    }
+
+    const uint8_t losses[] = {0, 10, 30};
+    printf("1KB settings dump at 250Hz 1:2, seconds with one write / a batch per message\n");
+    for (uint8_t l = 0; l < sizeof(losses); l++)
+    {
+        const float single = simulateSettingsDump(settings, sizeof(settings), losses[l], false);
+        const float batched = simulateSettingsDump(settings, sizeof(settings), losses[l], true);
+        printf("  %2u%% loss %5.1f / %5.1f\n", losses[l], single, batched);
+        TEST_ASSERT_TRUE(batched < single);
+    }
+    crsf.ResetMspQueue();
+}
@@ -1,3 +1,4 @@
+#include <cstring>
 #include <unity.h>
 #include "msp.h"
 #include "mock_serial.h"
@@ -101,8 +102,101 @@ void test_msp_send(void)
     TEST_ASSERT_EQUAL(224, (uint8_t)buf[9]);     // crc
 }
 
+extern uint8_t crc8_dvb_s2(uint8_t crc, unsigned char a);
+
+static uint8_t streamed[1024];
+static uint16_t streamedLength;
+static uint8_t streamedChunks;
+
+static void streamPayload(const mspPacket_t *packet, uint16_t offset, const uint8_t *data, uint8_t len)
+{
+    // A chunk at offset 0 starts a new packet
+    if (offset == 0)
+    {
+        streamedLength = 0;
+        streamedChunks = 0;
+    }
+    TEST_ASSERT_EQUAL(streamedLength, offset);
+    TEST_ASSERT_TRUE(offset + len <= packet->payloadSize);
+    memcpy(&streamed[offset], data, len);
+    streamedLength += len;
+    streamedChunks++;
+}
+
+// Returns what processReceivedByte() returned for the last byte
+static bool sendLargePacket(MSP &msp, const uint8_t *payload, uint16_t size, bool corrupt)
+{
+    uint8_t header[] = {0, 0x34, 0x12, (uint8_t)size, (uint8_t)(size >> 8)};
+    uint8_t crc = 0;
+    msp.processReceivedByte('$');
+    msp.processReceivedByte('X');
+    msp.processReceivedByte('>');
+    for (uint8_t i = 0; i < sizeof(header); i++)
+    {
+        crc = crc8_dvb_s2(crc, header[i]);
+        TEST_ASSERT_FALSE(msp.processReceivedByte(header[i]));
+    }
+    for (uint16_t i = 0; i < size; i++)
+    {
+        crc = crc8_dvb_s2(crc, payload[i]);
+        TEST_ASSERT_FALSE(msp.processReceivedByte(payload[i]));
+    }
+    return msp.processReceivedByte(corrupt ? crc ^ 1 : crc);
+}
+
+void test_msp_receive_streamed(void)
+{
+    // TEST CASE:
+    // GIVEN an instance of the MSP class with a payload callback
+    // WHEN a packet with a 1KB payload is send to processReceivedByte() one byte at a time
+    // THEN the whole payload is passed to the callback in order in chunks of MSP_PORT_CHUNK_SIZE
+    // AND the start of it is kept in the received packet
+
+    MSP msp;
+    uint8_t payload[sizeof(streamed)];
+    for (uint16_t i = 0; i < sizeof(payload); i++)
+    {
+        payload[i] = i * 7 + (i >> 8);
+    }
+    msp.setPayloadCallback(&streamPayload);
+
+    TEST_ASSERT_TRUE(sendLargePacket(msp, payload, sizeof(payload), false));
+    TEST_ASSERT_EQUAL(sizeof(payload), streamedLength);
+    TEST_ASSERT_EQUAL(sizeof(payload) / MSP_PORT_CHUNK_SIZE, streamedChunks);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, streamed, sizeof(payload));
+
+    mspPacket_t *packet = msp.getReceivedPacket();
+    TEST_ASSERT_EQUAL(MSP_PACKET_RESPONSE, packet->type);
+    TEST_ASSERT_EQUAL(0x1234, packet->function);
+    TEST_ASSERT_EQUAL(sizeof(payload), packet->payloadSize);
+    for (uint8_t i = 0; i < MSP_PORT_INBUF_SIZE; i++)
+    {
+        TEST_ASSERT_EQUAL(payload[i], packet->readByte());
+    }
+    TEST_ASSERT_FALSE(packet->readError);
+    packet->readByte();
+    TEST_ASSERT_TRUE(packet->readError);
+    msp.markPacketReceived();
+
+    // A corrupt packet is not completed, and the next one starts over with a
+    // short last chunk
+    TEST_ASSERT_FALSE(sendLargePacket(msp, payload, sizeof(payload), true));
+    TEST_ASSERT_TRUE(sendLargePacket(msp, payload + 1, 100, false));
+    TEST_ASSERT_EQUAL(100, streamedLength);
+    TEST_ASSERT_EQUAL(2, streamedChunks);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(payload + 1, streamed, 100);
+    msp.markPacketReceived();
+
+    // Without a payload at all
+    TEST_ASSERT_TRUE(sendLargePacket(msp, payload, 0, false));
+    TEST_ASSERT_EQUAL(0, msp.getReceivedPacket()->payloadSize);
+    TEST_ASSERT_EQUAL(2, streamedChunks);
+}
+
 extern void test_encapsulated_msp_send(void);
 extern void test_encapsulated_msp_send_too_long(void);
+extern void test_encapsulated_msp_batched(void);
+extern void test_encapsulated_msp_settings_dump_throughput(void);
 
 // Unity setup/teardown
 void setUp() {}
@@ -113,9 +207,12 @@ int main(int argc, char **argv)
     UNITY_BEGIN();
     RUN_TEST(test_msp_receive);
     RUN_TEST(test_msp_send);
+    RUN_TEST(test_msp_receive_streamed);
 
     RUN_TEST(test_encapsulated_msp_send);
     RUN_TEST(test_encapsulated_msp_send_too_long);
+    RUN_TEST(test_encapsulated_msp_batched);
+    RUN_TEST(test_encapsulated_msp_settings_dump_throughput);
 
     UNITY_END();
 
@@ -9,6 +9,9 @@
 
 
 #include <unity.h>
+#include <string.h>
+#include <stdio.h>
+#include <chrono>
 
 #include "targets.h"
 // #include "common.h"
@@ -44,6 +47,18 @@ void test_crsfToN()
     TEST_ASSERT_EQUAL(0b1111111, CRSF_to_N(CRSF_CHANNEL_VALUE_MAX, 128));
 }
 
+void test_crsfToNConst()
+{
+    // The multiply by reciprocal must match the division for every 11 bit input
+    for (uint16_t val = 0; val < 2048; ++val)
+    {
+        TEST_ASSERT_EQUAL(CRSF_to_N(val, 6), CRSF_to_N<6>(val));
+        TEST_ASSERT_EQUAL(CRSF_to_N(val, 16), CRSF_to_N<16>(val));
+        TEST_ASSERT_EQUAL(CRSF_to_N(val, 64), CRSF_to_N<64>(val));
+        TEST_ASSERT_EQUAL(CRSF_to_N(val, 128), CRSF_to_N<128>(val));
+    }
+}
+
 void test_nToCrsf()
 {
     // 6-bit
@@ -223,6 +238,26 @@ void test_decodingHybrid8_all()
     //     test_decodingHybrid8(7, val);
 }
 
+void test_decodingHybrid8_tables()
+{
+    // Every value the round-robin switch can carry decodes to what the
+    // crsf_protocol.h helpers give for it
+    uint8_t TXdataBuffer[8] = {0};
+    OtaSetSwitchMode(smHybrid);
+    for (uint8_t val = 0; val < 8; ++val)
+    {
+        TXdataBuffer[6] = (2 << 3) | val; // switch 3, AUX4
+        UnpackChannelData(TXdataBuffer, &crsf, 0, 0);
+        TEST_ASSERT_EQUAL(SWITCH3b_to_CRSF(val), crsf.PackedRCdataOut.ch7);
+    }
+    for (uint8_t val = 0; val < 16; ++val)
+    {
+        TXdataBuffer[6] = (6 << 3) | val; // switch 7, AUX8, its high bit in the index
+        UnpackChannelData(TXdataBuffer, &crsf, 0, 0);
+        TEST_ASSERT_EQUAL(N_to_CRSF(val, 15), crsf.PackedRCdataOut.ch11);
+    }
+}
+
 /* Check the HybridWide encoding of a packet for OTA tx
 */
 void test_encodingHybridWide(bool highRes, uint8_t nonce)
@@ -410,6 +445,108 @@ void test_decodingHybridWide_AUXX_low()
         test_decodingHybridWide(false, i, 0, CRSF_CHANNEL_VALUE_1000);
 }
 
+/* Check the FullRes packet layout, 12 channels of 11 bits LSB first
+*/
+void test_encodingFullRes()
+{
+    uint8_t TXdataBuffer[OTA_FULLRES_PAYLOAD_LENGTH];
+    memset(TXdataBuffer, 0xAA, sizeof(TXdataBuffer));
+
+    for (int i = 0; i < 16; ++i)
+        crsf.ChannelDataIn[i] = 0;
+    crsf.ChannelDataIn[0] = 0x7FF;
+    crsf.ChannelDataIn[1] = 0x123;
+    crsf.ChannelDataIn[11] = 0x5A5;
+
+    OtaSetSwitchMode(smFullRes);
+    PackChannelData(TXdataBuffer, &crsf, true, 0, 1);
+
+    TEST_ASSERT_EQUAL(RC_DATA_PACKET, TXdataBuffer[0]);
+    TEST_ASSERT_EQUAL(0xFF, TXdataBuffer[1]);                               // ch0 bits 0-7
+    TEST_ASSERT_EQUAL(0x07 | ((0x123 & 0x1F) << 3), TXdataBuffer[2]);      // ch0 bits 8-10, ch1 bits 0-4
+    TEST_ASSERT_EQUAL(0x123 >> 5, TXdataBuffer[3]);                         // ch1 bits 5-10, ch2 bits 0-1
+    // ch11 starts at bit 121: bits 0-6 in byte 16, bits 7-10 in byte 17 under the telemetry bit
+    TEST_ASSERT_EQUAL((0x5A5 & 0x7F) << 1, TXdataBuffer[16]);
+    TEST_ASSERT_EQUAL((0x5A5 >> 7) | (1 << 4), TXdataBuffer[17]);
+    // The CRC byte is left for the caller
+    TEST_ASSERT_EQUAL(0xAA, TXdataBuffer[18]);
+}
+
+/* Check every channel survives the round trip at full resolution
+*/
+void test_decodingFullRes()
+{
+    uint8_t TXdataBuffer[OTA_FULLRES_PAYLOAD_LENGTH];
+    OtaSetSwitchMode(smFullRes);
+
+    for (uint16_t base = 0; base < 2048; base += 37)
+    {
+        for (int i = 0; i < 16; ++i)
+            crsf.ChannelDataIn[i] = (base + i * 171) & 0x7FF;
+        const bool telem = base & 1;
+        PackChannelData(TXdataBuffer, &crsf, telem, base, 4);
+        memset(&crsf.PackedRCdataOut, 0, sizeof(crsf.PackedRCdataOut));
+
+        TEST_ASSERT_EQUAL(telem, UnpackChannelData(TXdataBuffer, &crsf, base, 4));
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[0], crsf.PackedRCdataOut.ch0);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[1], crsf.PackedRCdataOut.ch1);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[2], crsf.PackedRCdataOut.ch2);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[3], crsf.PackedRCdataOut.ch3);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[4], crsf.PackedRCdataOut.ch4);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[5], crsf.PackedRCdataOut.ch5);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[6], crsf.PackedRCdataOut.ch6);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[7], crsf.PackedRCdataOut.ch7);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[8], crsf.PackedRCdataOut.ch8);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[9], crsf.PackedRCdataOut.ch9);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[10], crsf.PackedRCdataOut.ch10);
+        TEST_ASSERT_EQUAL(crsf.ChannelDataIn[11], crsf.PackedRCdataOut.ch11);
+        // Channels past the 12th are not sent
+        TEST_ASSERT_EQUAL(0, crsf.PackedRCdataOut.ch12);
+    }
+}
+
+#if defined(OTA_BENCHMARK)
+/* Native throughput of the packers and unpackers, reported in ns per call.
+ * Takes a few seconds, so only built with -D OTA_BENCHMARK
+*/
+static void benchmarkSwitchMode(const char *name, OtaSwitchMode_e mode)
+{
+    constexpr uint32_t ITERATIONS = 1000000;
+    uint8_t TXdataBuffer[OTA_FULLRES_PAYLOAD_LENGTH] = {0};
+    for (int i = 0; i < 16; ++i)
+        crsf.ChannelDataIn[i] = CRSF_CHANNEL_VALUE_MID;
+    OtaSetSwitchMode(mode);
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ITERATIONS; ++i)
+    {
+        // Keep the switch values changing so nothing can be hoisted out of the loop
+        crsf.ChannelDataIn[5 + (i & 7)] = CRSF_CHANNEL_VALUE_1000 + (i & 1023);
+        PackChannelData(TXdataBuffer, &crsf, i & 1, i, 8);
+    }
+    auto packed = std::chrono::steady_clock::now();
+    uint32_t telem = 0;
+    for (uint32_t i = 0; i < ITERATIONS; ++i)
+    {
+        TXdataBuffer[6] = i;
+        telem += UnpackChannelData(TXdataBuffer, &crsf, i, 8);
+    }
+    auto unpacked = std::chrono::steady_clock::now();
+
+    const double packNs = std::chrono::duration<double, std::nano>(packed - start).count() / ITERATIONS;
+    const double unpackNs = std::chrono::duration<double, std::nano>(unpacked - packed).count() / ITERATIONS;
+    printf("%-8s pack %.1fns unpack %.1fns (%u)\n", name, packNs, unpackNs, telem);
+    TEST_ASSERT_GREATER_THAN(0, packNs);
+}
+
+void test_benchmarkPackUnpack()
+{
+    benchmarkSwitchMode("Hybrid", smHybrid);
+    benchmarkSwitchMode("Wide", smHybridWide);
+    benchmarkSwitchMode("FullRes", smFullRes);
+}
+#endif
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -421,10 +558,12 @@ int main(int argc, char **argv)
     RUN_TEST(test_bitToCrsf);
     RUN_TEST(test_crsfToN);
     RUN_TEST(test_nToCrsf);
+    RUN_TEST(test_crsfToNConst);
 
     RUN_TEST(test_encodingHybrid8_3);
     RUN_TEST(test_encodingHybrid8_7);
     RUN_TEST(test_decodingHybrid8_all);
+    RUN_TEST(test_decodingHybrid8_tables);
 
     RUN_TEST(test_encodingHybridWide_high);
     RUN_TEST(test_encodingHybridWide_low);
@@ -432,6 +571,13 @@ int main(int argc, char **argv)
     RUN_TEST(test_decodingHybridWide_AUXX_high);
     RUN_TEST(test_decodingHybridWide_AUXX_low);
 
+    RUN_TEST(test_encodingFullRes);
+    RUN_TEST(test_decodingFullRes);
+
+#if defined(OTA_BENCHMARK)
+    RUN_TEST(test_benchmarkPackUnpack);
+#endif
+
     UNITY_END();
 
     return 0;
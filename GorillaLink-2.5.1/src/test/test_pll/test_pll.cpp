@@ -0,0 +1,131 @@
+#include <cstdint>
+#include <math.h>
+#include <unity.h>
+#include "PLL.h"
+
+PLL pll;
+// The shift the last tick asked for, the next tock moves by it
+static int32_t inFlight;
+
+static void start(uint32_t interval)
+{
+    pll.init(interval);
+    inFlight = 0;
+}
+
+/**
+ * The RX timer as updatePhaseLock() drives it: the phase error of each tock
+ * grows by the clock error and the shift asked for at a tick moves the tock
+ * after the next one. Returns the last phase error, us.
+ **/
+static double runLoop(uint32_t interval, double ppm, double error, uint32_t updates, uint32_t lossEvery = 0)
+{
+    const double drift = interval * ppm * 1e-6;
+    for (uint32_t k = 0; k < updates; ++k)
+    {
+        const bool missed = lossEvery && (k % lossEvery) == 0;
+        const int32_t shift = missed ? pll.coast() : pll.update((int32_t)lround(error), true);
+        error += drift - inFlight;
+        inFlight = shift;
+    }
+    return error;
+}
+
+void test_pll_learns_clock_error(void)
+{
+    // 25Hz to 1000Hz, the crystals 80ppm apart either way
+    const uint32_t intervals[] = {1000, 2000, 5000, 20000, 40000};
+    for (uint8_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); ++i)
+    {
+        for (int8_t sign = -1; sign <= 1; sign += 2)
+        {
+            start(intervals[i]);
+            const double error = runLoop(intervals[i], sign * 80.0, 0, 20 * PLL_MAX_UPDATES);
+            TEST_ASSERT_INT_WITHIN(2, sign * 80, pll.getFreqPpm());
+            TEST_ASSERT_TRUE(fabs(error) <= 1.0);
+            TEST_ASSERT_TRUE(pll.isLocked());
+        }
+    }
+}
+
+void test_pll_pulls_in_phase(void)
+{
+    // A phase step is pulled in without winding up the frequency, then
+    // settles without ringing far past it
+    start(2000);
+    double error = 300;
+    double worst = 0;
+    for (uint16_t k = 0; k < 10 * 20; ++k)
+    {
+        error = runLoop(2000, 0, error, 1);
+        if (-error > worst)
+            worst = -error;
+    }
+    TEST_ASSERT_TRUE(fabs(error) <= 1.0);
+    TEST_ASSERT_TRUE(worst <= 300 * 0.02);
+    TEST_ASSERT_INT_WITHIN(1, 0, pll.getFreqPpm());
+}
+
+void test_pll_coasts_through_loss(void)
+{
+    start(2000);
+    runLoop(2000, 50, 0, 400);
+    const int32_t learnt = pll.getFreqPpm();
+    TEST_ASSERT_INT_WITHIN(2, 50, learnt);
+
+    // Only missed packets, the learnt frequency keeps the timer on time
+    int32_t total = 0;
+    for (uint16_t k = 0; k < 1000; ++k)
+        total += pll.coast();
+    TEST_ASSERT_EQUAL(learnt, pll.getFreqPpm());
+    // 1000 intervals at 50ppm of 2000us
+    TEST_ASSERT_INT_WITHIN(10, 100, total);
+
+    // and every other packet lost still locks
+    start(2000);
+    const double error = runLoop(2000, -50, 0, 800, 2);
+    TEST_ASSERT_INT_WITHIN(2, -50, pll.getFreqPpm());
+    TEST_ASSERT_TRUE(fabs(error) <= 1.0);
+}
+
+void test_pll_limits(void)
+{
+    start(2000);
+    // Outliers never touch the frequency and the shift stays in what the timer takes
+    for (uint16_t k = 0; k < 1000; ++k)
+    {
+        const int32_t shift = pll.update(k % 2 ? 2000 : -2000, true);
+        TEST_ASSERT_TRUE(shift <= 2000 / 4 && shift >= -2000 / 4);
+    }
+    TEST_ASSERT_EQUAL(0, pll.getFreqPpm());
+    TEST_ASSERT_FALSE(pll.isLocked());
+
+    // A clock error the timer couldn't keep up with stops at the limit
+    pll.reset();
+    for (uint16_t k = 0; k < 1000; ++k)
+        pll.update(10, true);
+    TEST_ASSERT_INT_WITHIN(1, PLL_MAX_FREQ_PPM, pll.getFreqPpm());
+
+    // Acquiring never touches the frequency
+    pll.reset();
+    for (uint16_t k = 0; k < 100; ++k)
+        pll.update(k % 2 ? 400 : -400, false);
+    TEST_ASSERT_EQUAL(0, pll.getFreqPpm());
+    TEST_ASSERT_FALSE(pll.isLocked());
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_pll_learns_clock_error);
+    RUN_TEST(test_pll_pulls_in_phase);
+    RUN_TEST(test_pll_coasts_through_loss);
+    RUN_TEST(test_pll_limits);
+    UNITY_END();
+
+    return 0;
+}
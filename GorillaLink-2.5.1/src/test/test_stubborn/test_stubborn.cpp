@@ -2,9 +2,11 @@
 #include <telemetry_protocol.h>
 #include <stubborn_sender.h>
 #include <stubborn_receiver.h>
+#include "crsf_protocol.h"
 #include <unity.h>
 #include <iostream>
 #include <bitset>
+#include <cstdio>
 #include "targets.h"
 #include "helpers.h"
 
@@ -378,6 +380,489 @@ static void test_stubborn_link_resync_then_send(void)
     TEST_ASSERT_EQUAL_UINT8_ARRAY(testSequence2, buffer, ARRAY_SIZE(testSequence2));
 }
 
+void test_stubborn_window_resends_only_lost(void)
+{
+    StubbornSender windowSender(ELRS_MSP_MAX_PACKAGES, 4);
+    StubbornReceiver windowReceiver(ELRS_MSP_MAX_PACKAGES);
+    uint8_t message[32];
+    uint8_t buffer[ELRS_MSP_BUFFER] = {0};
+    uint8_t *data;
+    uint8_t maxLength;
+    uint8_t packageIndex;
+    for (uint8_t i = 0; i < sizeof(message); i++)
+        message[i] = i * 7 + 1;
+
+    windowReceiver.SetDataToReceive(sizeof(buffer), buffer, ELRS_MSP_BYTES_PER_CALL);
+    windowSender.SetDataToTransmit(sizeof(message), message, ELRS_MSP_BYTES_PER_CALL);
+
+    // The whole window goes out without waiting, package 2 is lost
+    for (uint8_t i = 1; i <= 4; i++)
+    {
+        windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+        TEST_ASSERT_EQUAL(i, packageIndex);
+        if (i != 2)
+            windowReceiver.ReceiveData(packageIndex, data);
+    }
+    // and the sender goes round what is not acked yet
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(1, packageIndex);
+
+    // The ack has 2 missing with 3 and 4 after it, so only 2 is sent again
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(5, packageIndex);
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(2, packageIndex);
+    windowReceiver.ReceiveData(packageIndex, data);
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(5, packageIndex);
+    windowReceiver.ReceiveData(packageIndex, data);
+
+    // 1 to 5 are in, the window moves on past all of them
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+    for (uint8_t i = 6; i <= 7; i++)
+    {
+        windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+        TEST_ASSERT_EQUAL(i, packageIndex);
+        windowReceiver.ReceiveData(packageIndex, data);
+    }
+    TEST_ASSERT_EQUAL(2, maxLength);
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+
+    // Then the end of the message
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(0, packageIndex);
+    windowReceiver.ReceiveData(packageIndex, data);
+    TEST_ASSERT_TRUE(windowReceiver.HasFinishedData());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(message, buffer, sizeof(message));
+    TEST_ASSERT_TRUE(windowSender.IsActive());
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+    TEST_ASSERT_FALSE(windowSender.IsActive());
+
+    // The ack carries on into the next message, which does not start until the first is unlocked
+    windowSender.SetDataToTransmit(sizeof(message), message, ELRS_MSP_BYTES_PER_CALL);
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    windowReceiver.ReceiveData(packageIndex, data);
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(2, packageIndex);
+    windowReceiver.Unlock();
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(3, packageIndex);
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(4, packageIndex);
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(1, packageIndex);
+    windowReceiver.ReceiveData(packageIndex, data);
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(5, packageIndex);
+}
+
+void test_stubborn_window_resync_then_send(void)
+{
+    StubbornSender windowSender(ELRS_MSP_MAX_PACKAGES, 4);
+    StubbornReceiver windowReceiver(ELRS_MSP_MAX_PACKAGES);
+    uint8_t testSequence1[] = {1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20};
+    uint8_t testSequence2[] = {21,22,23,24,25,26,27,28,29,30};
+    uint8_t buffer[ELRS_MSP_BUFFER] = {0};
+    const uint8_t zeros[ELRS_MSP_BUFFER] = {0};
+    uint8_t *data;
+    uint8_t maxLength;
+    uint8_t packageIndex;
+
+    windowReceiver.SetDataToReceive(sizeof(buffer), buffer, ELRS_MSP_BYTES_PER_CALL);
+    windowSender.SetDataToTransmit(sizeof(testSequence1), testSequence1, ELRS_MSP_BYTES_PER_CALL);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+        windowReceiver.ReceiveData(packageIndex, data);
+    }
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+
+    // Abort the transfer, the RESYNC comes before the new message
+    windowSender.SetDataToTransmit(sizeof(testSequence2), testSequence2, ELRS_MSP_BYTES_PER_CALL);
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(ELRS_MSP_MAX_PACKAGES, packageIndex);
+    // An ack from before the receiver has it does not finish the resync
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+    windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(ELRS_MSP_MAX_PACKAGES, packageIndex);
+    windowReceiver.ReceiveData(packageIndex, data);
+    windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+
+    for (int sends = 0; sends < 20 && !windowReceiver.HasFinishedData(); sends++)
+    {
+        windowSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+        windowReceiver.ReceiveData(packageIndex, data);
+        windowSender.ConfirmCurrentPayload(windowReceiver.GetCurrentAck());
+    }
+    TEST_ASSERT_TRUE(windowReceiver.HasFinishedData());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(testSequence2, buffer, sizeof(testSequence2));
+    // Nothing is left of the message given up on past the end of the new one
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(zeros, buffer + sizeof(testSequence2), sizeof(buffer) - sizeof(testSequence2));
+    windowReceiver.Unlock();
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(zeros, buffer, sizeof(buffer));
+}
+
+// As the packet goes over the air, with zeros after the end of a short package
+static void receivePadded(StubbornReceiver &to, uint8_t packageIndex, const uint8_t *data, uint8_t maxLength)
+{
+    uint8_t airPacket[ELRS_MSP_BYTES_PER_CALL] = {0};
+    for (uint8_t i = 0; i < maxLength; i++)
+        airPacket[i] = data[i];
+    to.ReceiveData(packageIndex, airPacket);
+}
+
+void test_stubborn_fec_rebuilds_lost(void)
+{
+    StubbornSender fecSender(ELRS_MSP_MAX_PACKAGES, 4, 4);
+    StubbornReceiver fecReceiver(ELRS_MSP_MAX_PACKAGES, 4);
+    uint8_t message[27];
+    uint8_t buffer[ELRS_MSP_BUFFER] = {0};
+    uint8_t *data;
+    uint8_t maxLength;
+    uint8_t packageIndex;
+    for (uint8_t i = 0; i < sizeof(message); i++)
+        message[i] = 0xA0 ^ (i * 13);
+
+    fecReceiver.SetDataToReceive(sizeof(buffer), buffer, ELRS_MSP_BYTES_PER_CALL);
+    fecSender.SetDataToTransmit(sizeof(message), message, ELRS_MSP_BYTES_PER_CALL);
+
+    // 3 of the first group arrive, then its parity goes out before any resend
+    for (uint8_t i = 1; i <= 4; i++)
+    {
+        fecSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+        TEST_ASSERT_EQUAL(i, packageIndex);
+        if (i != 3)
+            receivePadded(fecReceiver, packageIndex, data, maxLength);
+    }
+    fecSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(ELRS_MSP_MAX_PACKAGES + 4, packageIndex);
+    receivePadded(fecReceiver, packageIndex, data, maxLength);
+
+    // which puts 3 back together, so the ack is for all of the group
+    TEST_ASSERT_EQUAL(4, fecReceiver.GetCurrentAck());
+    fecSender.ConfirmCurrentPayload(fecReceiver.GetCurrentAck());
+
+    // The last group is 5 and 6, 6 short. Its parity arrives before the rest of it
+    fecSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(5, packageIndex);
+    fecSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(6, packageIndex);
+    TEST_ASSERT_EQUAL(2, maxLength);
+    receivePadded(fecReceiver, packageIndex, data, maxLength);
+    fecSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(ELRS_MSP_MAX_PACKAGES + 6, packageIndex);
+    receivePadded(fecReceiver, packageIndex, data, maxLength);
+    fecSender.ConfirmCurrentPayload(fecReceiver.GetCurrentAck());
+
+    fecSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+    TEST_ASSERT_EQUAL(0, packageIndex);
+    receivePadded(fecReceiver, packageIndex, data, maxLength);
+    TEST_ASSERT_TRUE(fecReceiver.HasFinishedData());
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(message, buffer, sizeof(message));
+
+    // A receiver without FEC ignores the parity
+    StubbornReceiver plainReceiver(ELRS_MSP_MAX_PACKAGES);
+    uint8_t parity[ELRS_MSP_BYTES_PER_CALL] = {1, 2, 3, 4, 5};
+    plainReceiver.SetDataToReceive(sizeof(buffer), buffer, ELRS_MSP_BYTES_PER_CALL);
+    plainReceiver.ReceiveData(ELRS_MSP_MAX_PACKAGES + 4, parity);
+    TEST_ASSERT_EQUAL(0, plainReceiver.GetCurrentAck());
+}
+
+typedef struct {
+    uint8_t windowSize;
+    uint8_t fecGroup;
+    uint8_t tlmRatio;
+    uint8_t lossPercent;
+    uint8_t burstLength;    // average run of lost packets, 1 for independent losses
+    uint8_t messageLength;
+} stubbornSim_t;
+
+/**
+ * Uplink MSP over a lossy link, following tx_main and rx_main: the TX sends
+ * MSP in every other RC slot, and the RX acks it in its LINK telemetry,
+ * which it sends early when the ack changes but otherwise only once per
+ * burst of DATA. The TX boosts the ratio to 1:2 for MSP, the other ratios
+ * are what a transfer gets without the boost. Losses in bursts go between
+ * a good state with none and a bad state with all lost (Gilbert-Elliott).
+ * Returns the messages completed in 10 minutes at 250Hz.
+ **/
+static uint32_t simulateMspUplink(const stubbornSim_t &sim)
+{
+    const uint32_t hz = 250;
+    const uint32_t packets = hz * 600;
+    StubbornSender mspSender(ELRS_MSP_MAX_PACKAGES, sim.windowSize, sim.fecGroup);
+    StubbornReceiver mspReceiver(ELRS_MSP_MAX_PACKAGES, sim.fecGroup);
+    uint8_t message[ELRS_MSP_BUFFER];
+    uint8_t mspData[ELRS_MSP_BUFFER];
+    uint8_t airPacket[ELRS_MSP_BYTES_PER_CALL];
+    uint32_t lcg = 12345 + sim.tlmRatio * 100 + sim.lossPercent;
+    uint32_t messages = 0;
+    bool nextPacketIsMsp = true;
+    bool nextTlmIsLink = true;
+    bool badState = false;
+    uint8_t burstCount = 0;
+    uint8_t burstMax = 512U * hz / sim.tlmRatio / 1000U;
+    burstMax = burstMax > 1 ? burstMax - 1 : 1;
+    // Out of the bad state after burstLength on average, into it often enough to lose lossPercent
+    const uint32_t leaveBad = 1000 / sim.burstLength;
+    const uint32_t enterBad = leaveBad * sim.lossPercent / (100 - sim.lossPercent);
+
+    mspReceiver.SetDataToReceive(sizeof(mspData), mspData, ELRS_MSP_BYTES_PER_CALL);
+    for (uint32_t nonce = 0; nonce < packets; nonce++)
+    {
+        lcg = lcg * 1664525 + 1013904223;
+        const uint32_t roll = (lcg >> 8) % 1000;
+        bool lost;
+        if (sim.burstLength > 1)
+        {
+            badState = badState ? roll >= leaveBad : roll < enterBad;
+            lost = badState;
+        }
+        else
+        {
+            lost = roll < sim.lossPercent * 10U;
+        }
+
+        if (!mspSender.IsActive())
+        {
+            for (uint8_t i = 0; i < sim.messageLength; i++)
+                message[i] = messages + i;
+            mspSender.SetDataToTransmit(sim.messageLength, message, ELRS_MSP_BYTES_PER_CALL);
+        }
+
+        if ((nonce + 1) % sim.tlmRatio == 0)
+        {
+            // The RX always has telemetry to send, only LINK carries the MSP ack
+            const bool linkSlot = nextTlmIsLink;
+            if (linkSlot)
+            {
+                nextTlmIsLink = false;
+                burstCount = 1;
+            }
+            else if (burstCount < burstMax)
+                burstCount++;
+            else
+                nextTlmIsLink = true;
+            if (linkSlot && !lost)
+                mspSender.ConfirmCurrentPayload(mspReceiver.GetCurrentAck());
+        }
+        else if (nextPacketIsMsp && mspSender.IsActive())
+        {
+            uint8_t *data;
+            uint8_t maxLength;
+            uint8_t packageIndex;
+            mspSender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+            for (uint8_t i = 0; i < sizeof(airPacket); i++)
+                airPacket[i] = i < maxLength ? data[i] : 0;
+            nextPacketIsMsp = false;
+            if (lost)
+                continue;
+
+            const uint8_t ack = mspReceiver.GetCurrentAck();
+            mspReceiver.ReceiveData(packageIndex, airPacket);
+            if (ack != mspReceiver.GetCurrentAck())
+                nextTlmIsLink = true;
+            if (mspReceiver.HasFinishedData())
+            {
+                TEST_ASSERT_EQUAL_UINT8_ARRAY(message, mspData, sim.messageLength);
+                ++messages;
+                mspReceiver.Unlock();
+            }
+        }
+        else
+        {
+            nextPacketIsMsp = true;
+        }
+    }
+    return messages;
+}
+
+/**
+ * Downlink telemetry over a lossy link, following rx_main and tx_main: the
+ * RX sends a DATA chunk in each telemetry slot of a burst, with a LINK slot
+ * between bursts, and the TX acks it in every RC packet. The losses are as
+ * in simulateMspUplink(), for the RC and the telemetry packets alike. On the
+ * air the ack is the one TelemetryStatus bit, so the window is 1 and there
+ * is no FEC; a larger window takes the whole ack byte in the RC packets,
+ * which they do not have room for, so those runs show what it could buy.
+ * Returns the messages completed in 10 minutes at 250Hz.
+ **/
+static uint32_t simulateTelemetryDownlink(const stubbornSim_t &sim)
+{
+    const uint32_t hz = 250;
+    const uint32_t packets = hz * 600;
+    StubbornSender telemetrySender(ELRS_TELEMETRY_MAX_PACKAGES, sim.windowSize, sim.fecGroup);
+    StubbornReceiver telemetryReceiver(ELRS_TELEMETRY_MAX_PACKAGES, sim.fecGroup);
+    uint8_t message[CRSF_MAX_PACKET_LEN];
+    uint8_t telemetryData[CRSF_MAX_PACKET_LEN + 1];
+    uint8_t airPacket[ELRS_TELEMETRY_BYTES_PER_CALL];
+    uint32_t lcg = 54321 + sim.tlmRatio * 100 + sim.lossPercent;
+    uint32_t messages = 0;
+    bool nextTlmIsLink = true;
+    bool badState = false;
+    uint8_t burstCount = 0;
+    uint8_t burstMax = 512U * hz / sim.tlmRatio / 1000U;
+    burstMax = burstMax > 1 ? burstMax - 1 : 1;
+    const uint32_t leaveBad = 1000 / sim.burstLength;
+    const uint32_t enterBad = leaveBad * sim.lossPercent / (100 - sim.lossPercent);
+
+    telemetryReceiver.SetDataToReceive(sizeof(telemetryData), telemetryData, ELRS_TELEMETRY_BYTES_PER_CALL);
+    for (uint32_t nonce = 0; nonce < packets; nonce++)
+    {
+        lcg = lcg * 1664525 + 1013904223;
+        const uint32_t roll = (lcg >> 8) % 1000;
+        bool lost;
+        if (sim.burstLength > 1)
+        {
+            badState = badState ? roll >= leaveBad : roll < enterBad;
+            lost = badState;
+        }
+        else
+        {
+            lost = roll < sim.lossPercent * 10U;
+        }
+
+        if (!telemetrySender.IsActive())
+        {
+            for (uint8_t i = 0; i < sim.messageLength; i++)
+                message[i] = messages + i;
+            telemetrySender.SetDataToTransmit(sim.messageLength, message, ELRS_TELEMETRY_BYTES_PER_CALL);
+        }
+
+        if ((nonce + 1) % sim.tlmRatio == 0)
+        {
+            // LINK once per burst, or whenever there is no DATA to send
+            const bool linkSlot = nextTlmIsLink || !telemetrySender.IsActive();
+            if (linkSlot)
+            {
+                nextTlmIsLink = false;
+                burstCount = 1;
+                continue;
+            }
+            if (burstCount < burstMax)
+                burstCount++;
+            else
+                nextTlmIsLink = true;
+
+            uint8_t *data;
+            uint8_t maxLength;
+            uint8_t packageIndex;
+            telemetrySender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+            for (uint8_t i = 0; i < sizeof(airPacket); i++)
+                airPacket[i] = i < maxLength ? data[i] : 0;
+            if (lost)
+                continue;
+
+            telemetryReceiver.ReceiveData(packageIndex, airPacket);
+            if (telemetryReceiver.HasFinishedData())
+            {
+                TEST_ASSERT_EQUAL_UINT8_ARRAY(message, telemetryData, sim.messageLength);
+                ++messages;
+                telemetryReceiver.Unlock();
+            }
+        }
+        else if (!lost)
+        {
+            if (sim.windowSize > 1)
+                telemetrySender.ConfirmCurrentPayload(telemetryReceiver.GetCurrentAck());
+            else
+                telemetrySender.ConfirmCurrentPayload(telemetryReceiver.GetCurrentConfirm());
+        }
+    }
+    return messages;
+}
+
+void test_stubborn_window_throughput(void)
+{
+    const uint8_t ratios[] = {2, 4, 8, 16, 32, 64, 128};
+    const uint8_t losses[] = {0, 10, 30};
+    printf("MSP uplink bytes/s at 250Hz, stop-and-wait / window of %u\n", ELRS_MSP_WINDOW);
+    for (uint8_t r = 0; r < sizeof(ratios); r++)
+    {
+        printf("  1:%-3u", ratios[r]);
+        for (uint8_t l = 0; l < sizeof(losses); l++)
+        {
+            stubbornSim_t sim = {1, 0, ratios[r], losses[l], 1, 60};
+            const uint32_t stopAndWait = simulateMspUplink(sim) * sim.messageLength / 600;
+            sim.windowSize = ELRS_MSP_WINDOW;
+            const uint32_t windowed = simulateMspUplink(sim) * sim.messageLength / 600;
+            printf("  %2u%% loss %4u / %4u", losses[l], stopAndWait, windowed);
+            TEST_ASSERT_TRUE(windowed > 0);
+            TEST_ASSERT_TRUE(windowed >= stopAndWait);
+        }
+        printf("\n");
+    }
+}
+
+void test_stubborn_fec_throughput(void)
+{
+    // The frame sizes Telemetry::GetNextPayload() gives: vario, battery, GPS and device info
+    const uint8_t lengths[] = {6, 12, 19, 60};
+    const uint8_t ratios[] = {2, 8, 32};
+    const uint8_t losses[] = {20, 40};
+    const uint8_t bursts[] = {1, 4};
+    // FEC is off in the firmware unless ENABLE_MSP_FEC, this is what turning it on would get
+    const uint8_t fecGroup = ELRS_MSP_WINDOW;
+    printf("MSP uplink frames/min at 250Hz, window of %u without / with FEC groups of %u\n", ELRS_MSP_WINDOW, fecGroup);
+    for (uint8_t b = 0; b < sizeof(bursts); b++)
+    {
+        for (uint8_t r = 0; r < sizeof(ratios); r++)
+        {
+            for (uint8_t l = 0; l < sizeof(losses); l++)
+            {
+                printf("  %s 1:%-3u %2u%% loss", bursts[b] > 1 ? "bursts" : "random", ratios[r], losses[l]);
+                for (uint8_t n = 0; n < sizeof(lengths); n++)
+                {
+                    stubbornSim_t sim = {ELRS_MSP_WINDOW, 0, ratios[r], losses[l], bursts[b], lengths[n]};
+                    const uint32_t plain = simulateMspUplink(sim) / 10;
+                    sim.fecGroup = fecGroup;
+                    const uint32_t fec = simulateMspUplink(sim) / 10;
+                    printf("  %2uB %4u / %4u", lengths[n], plain, fec);
+                    TEST_ASSERT_TRUE(fec > 0);
+                }
+                printf("\n");
+            }
+        }
+    }
+}
+
+void test_stubborn_downlink_fec_throughput(void)
+{
+    // The frame sizes Telemetry::GetNextPayload() gives: vario, battery, GPS and device info
+    const uint8_t lengths[] = {6, 12, 19, 60};
+    const uint8_t ratios[] = {2, 8, 32};
+    const uint8_t losses[] = {20, 40};
+    const uint8_t bursts[] = {1, 4};
+    printf("Telemetry downlink frames/min at 250Hz, stop-and-wait / window of %u / with FEC groups of %u\n", ELRS_STUBBORN_MAX_WINDOW, ELRS_STUBBORN_MAX_WINDOW);
+    for (uint8_t b = 0; b < sizeof(bursts); b++)
+    {
+        for (uint8_t r = 0; r < sizeof(ratios); r++)
+        {
+            for (uint8_t l = 0; l < sizeof(losses); l++)
+            {
+                printf("  %s 1:%-3u %2u%% loss", bursts[b] > 1 ? "bursts" : "random", ratios[r], losses[l]);
+                for (uint8_t n = 0; n < sizeof(lengths); n++)
+                {
+                    stubbornSim_t sim = {1, 0, ratios[r], losses[l], bursts[b], lengths[n]};
+                    const uint32_t stopAndWait = simulateTelemetryDownlink(sim) / 10;
+                    sim.windowSize = ELRS_STUBBORN_MAX_WINDOW;
+                    const uint32_t windowed = simulateTelemetryDownlink(sim) / 10;
+                    sim.fecGroup = ELRS_STUBBORN_MAX_WINDOW;
+                    const uint32_t fec = simulateTelemetryDownlink(sim) / 10;
+                    printf("  %2uB %4u / %4u / %4u", lengths[n], stopAndWait, windowed, fec);
+                    TEST_ASSERT_TRUE(stopAndWait > 0);
+                    TEST_ASSERT_TRUE(fec > 0);
+                }
+                printf("\n");
+            }
+        }
+    }
+}
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -396,6 +881,12 @@ int main(int argc, char **argv)
     RUN_TEST(test_stubborn_link_multiple_packages);
     RUN_TEST(test_stubborn_link_resyncs_during_last_confirm);
     RUN_TEST(test_stubborn_link_resync_then_send);
+    RUN_TEST(test_stubborn_window_resends_only_lost);
+    RUN_TEST(test_stubborn_window_resync_then_send);
+    RUN_TEST(test_stubborn_fec_rebuilds_lost);
+    RUN_TEST(test_stubborn_window_throughput);
+    RUN_TEST(test_stubborn_fec_throughput);
+    RUN_TEST(test_stubborn_downlink_fec_throughput);
     UNITY_END();
 
     return 0;
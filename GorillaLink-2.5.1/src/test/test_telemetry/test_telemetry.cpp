@@ -1,6 +1,10 @@
 #include <cstdint>
+#include <cstdio>
 #include <telemetry.h>
+#include <stubborn_sender.h>
+#include <stubborn_receiver.h>
 #include <unity.h>
+#include "targets.h"
 
 Telemetry telemetry;
 
@@ -204,6 +208,328 @@ void test_function_uart_in(void)
     TEST_ASSERT_EQUAL(true, telemetry.RXhandleUARTin(0xEC));
 }
 
+void test_scheduler_priority_when_due(void)
+{
+    NativeClock::reset();
+    telemetry.ResetState();
+    NativeClock::advance(1000000);
+    uint8_t attitudeSequence[] = {0xEC,8, CRSF_FRAMETYPE_ATTITUDE,1,0,0,0,0,0,48};
+    uint8_t gpsSequence[] = {0xEC,17, CRSF_FRAMETYPE_GPS,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,50};
+    uint8_t batterySequence[] = {0xEC,10, CRSF_FRAMETYPE_BATTERY_SENSOR,1,0,0,0,0,0,0,0,46};
+    TEST_ASSERT_TRUE(telemetry.AppendTelemetryPackage(attitudeSequence));
+    TEST_ASSERT_TRUE(telemetry.AppendTelemetryPackage(gpsSequence));
+    TEST_ASSERT_TRUE(telemetry.AppendTelemetryPackage(batterySequence));
+
+    // The same time since they were sent, so in order of priority / interval
+    uint8_t* data;
+    uint8_t receivedLength;
+    const uint8_t expected[] = {CRSF_FRAMETYPE_GPS, CRSF_FRAMETYPE_BATTERY_SENSOR, CRSF_FRAMETYPE_ATTITUDE};
+    for (uint8_t i = 0; i < sizeof(expected); i++)
+    {
+        TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+        TEST_ASSERT_EQUAL(expected[i], data[CRSF_TELEMETRY_TYPE_INDEX]);
+    }
+    TEST_ASSERT_FALSE(telemetry.GetNextPayload(&receivedLength, &data));
+}
+
+void test_scheduler_interval(void)
+{
+    NativeClock::reset();
+    telemetry.ResetState();
+    NativeClock::advance(1000000);
+    uint8_t attitudeSequence[] = {0xEC,8, CRSF_FRAMETYPE_ATTITUDE,1,0,0,0,0,0,48};
+    uint8_t gpsSequence[] = {0xEC,17, CRSF_FRAMETYPE_GPS,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,50};
+    uint8_t* data;
+    uint8_t receivedLength;
+
+    telemetry.AppendTelemetryPackage(gpsSequence);
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_EQUAL(CRSF_FRAMETYPE_GPS, data[CRSF_TELEMETRY_TYPE_INDEX]);
+
+    // GPS was just sent so is not due again, the lower priority attitude is
+    TEST_ASSERT_FALSE(telemetry.GetNextPayload(&receivedLength, &data));
+    NativeClock::advance(50000);
+    telemetry.AppendTelemetryPackage(gpsSequence);
+    telemetry.AppendTelemetryPackage(attitudeSequence);
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_EQUAL(CRSF_FRAMETYPE_ATTITUDE, data[CRSF_TELEMETRY_TYPE_INDEX]);
+
+    // Nothing else waiting, so GPS goes early rather than leave the link idle
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_EQUAL(CRSF_FRAMETYPE_GPS, data[CRSF_TELEMETRY_TYPE_INDEX]);
+}
+
+void test_scheduler_drops_stale(void)
+{
+    NativeClock::reset();
+    telemetry.ResetState();
+    uint8_t attitudeSequence[] = {0xEC,8, CRSF_FRAMETYPE_ATTITUDE,1,0,0,0,0,0,48};
+    uint8_t flightModeSequence[] = {0xEC,4, CRSF_FRAMETYPE_FLIGHT_MODE,'A','C',0x5C};
+    uint8_t* data;
+    uint8_t receivedLength;
+
+    telemetry.AppendTelemetryPackage(attitudeSequence);
+    telemetry.AppendTelemetryPackage(flightModeSequence);
+    NativeClock::advance(10000000);
+
+    // The attitude is too old to send, the flight mode is kept until it is sent
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_EQUAL(CRSF_FRAMETYPE_FLIGHT_MODE, data[CRSF_TELEMETRY_TYPE_INDEX]);
+    TEST_ASSERT_FALSE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_EQUAL(0, telemetry.UpdatedPayloadCount());
+}
+
+void test_scheduler_fills_message(void)
+{
+    NativeClock::reset();
+    telemetry.ResetState();
+    uint8_t attitudeSequence[] = {0xEC,8, CRSF_FRAMETYPE_ATTITUDE,1,0,0,0,0,0,48};
+    uint8_t gpsSequence[] = {0xEC,17, CRSF_FRAMETYPE_GPS,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,50};
+    uint8_t* data;
+    uint8_t receivedLength;
+
+    telemetry.AppendTelemetryPackage(gpsSequence);
+    telemetry.AppendTelemetryPackage(attitudeSequence);
+
+    // Only the attitude fits in what is left, GPS waits for the next message
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data, sizeof(gpsSequence) - 1));
+    TEST_ASSERT_EQUAL(CRSF_FRAMETYPE_ATTITUDE, data[CRSF_TELEMETRY_TYPE_INDEX]);
+    TEST_ASSERT_FALSE(telemetry.GetNextPayload(&receivedLength, &data, sizeof(gpsSequence) - 1));
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_EQUAL(CRSF_FRAMETYPE_GPS, data[CRSF_TELEMETRY_TYPE_INDEX]);
+}
+
+/**
+ * A flight controller sending the usual CRSF telemetry, period in ms
+ **/
+typedef struct {
+    uint8_t type;
+    uint8_t payloadSize;
+    uint16_t period;
+    const char *name;
+} fcStream_t;
+
+static const fcStream_t fcStream[] = {
+    {CRSF_FRAMETYPE_ATTITUDE, CRSF_FRAME_ATTITUDE_PAYLOAD_SIZE, 20, "ATT"},
+    {CRSF_FRAMETYPE_VARIO, CRSF_FRAME_VARIO_PAYLOAD_SIZE, 40, "VARIO"},
+    {CRSF_FRAMETYPE_BARO_ALTITUDE, CRSF_FRAME_BARO_ALTITUDE_PAYLOAD_SIZE, 100, "BARO"},
+    {CRSF_FRAMETYPE_GPS, CRSF_FRAME_GPS_PAYLOAD_SIZE, 100, "GPS"},
+    {CRSF_FRAMETYPE_BATTERY_SENSOR, CRSF_FRAME_BATTERY_SENSOR_PAYLOAD_SIZE, 200, "BATT"},
+    {CRSF_FRAMETYPE_FLIGHT_MODE, CRSF_FRAME_FLIGHT_MODE_PAYLOAD_SIZE, 500, "MODE"},
+};
+#define FC_STREAM_TYPES (sizeof(fcStream) / sizeof(fcStream[0]))
+
+typedef struct {
+    uint32_t delivered;
+    uint32_t staleSum;  // ms the TX's frame is old, summed over every packet
+} tlmLatency_t;
+
+/**
+ * Sends the FC stream down a loss free link for a minute at 250Hz, the way
+ * rx_main does: one DATA chunk per telemetry slot with a LINK every burst,
+ * the next frame picked once the last one is acked by an RC packet.
+ * roundRobin picks the frame like GetNextPayload did before the scheduler,
+ * the next slot updated after the one last sent.
+ **/
+static void simulateTelemetry(uint8_t tlmRatio, bool roundRobin, tlmLatency_t *latency)
+{
+    const uint32_t hz = 250;
+    const uint32_t packets = hz * 60;
+    StubbornSender sender(ELRS_TELEMETRY_MAX_PACKAGES);
+    StubbornReceiver receiver(ELRS_TELEMETRY_MAX_PACKAGES);
+    uint8_t received[CRSF_MAX_PACKET_LEN];
+    uint8_t frames[FC_STREAM_TYPES][CRSF_MAX_PACKET_LEN];
+    uint32_t nextFrameAt[FC_STREAM_TYPES];
+    uint32_t frameAt[FC_STREAM_TYPES];
+    uint32_t deliveredAt[FC_STREAM_TYPES];  // when the FC sent the one the TX has
+    bool updated[FC_STREAM_TYPES] = {};
+    int8_t sending = -1;
+    uint32_t sendingFrameAt = 0;
+    uint8_t lastSent = 0;
+    bool nextTlmIsLink = true;
+    uint8_t burstCount = 0;
+    uint8_t burstMax = 512U * hz / tlmRatio / 1000U;
+    burstMax = burstMax > 1 ? burstMax - 1 : 1;
+
+    NativeClock::reset();
+    telemetry.ResetState();
+    sender.UpdateTelemetryRate(hz, tlmRatio, burstMax);
+    receiver.SetDataToReceive(sizeof(received), received, ELRS_TELEMETRY_BYTES_PER_CALL);
+    for (uint8_t t = 0; t < FC_STREAM_TYPES; t++)
+    {
+        nextFrameAt[t] = t * 3;
+        latency[t].delivered = 0;
+        latency[t].staleSum = 0;
+        deliveredAt[t] = 0;
+    }
+
+    for (uint32_t nonce = 0; nonce < packets; nonce++)
+    {
+        const uint32_t now = millis();
+        for (uint8_t t = 0; t < FC_STREAM_TYPES; t++)
+        {
+            if ((int32_t)(now - nextFrameAt[t]) < 0)
+                continue;
+            nextFrameAt[t] += fcStream[t].period;
+
+            // No zeros, which would be trimmed off the end
+            uint8_t *frame = frames[t];
+            if (roundRobin && updated[t] && sending == t)
+                continue;
+            frame[0] = CRSF_ADDRESS_CRSF_RECEIVER;
+            frame[CRSF_TELEMETRY_LENGTH_INDEX] = fcStream[t].payloadSize + 2;
+            frame[CRSF_TELEMETRY_TYPE_INDEX] = fcStream[t].type;
+            for (uint8_t i = 0; i <= fcStream[t].payloadSize; i++)
+                frame[3 + i] = 0x11 + i + nonce;
+            frame[3 + fcStream[t].payloadSize] |= 1;
+            if (roundRobin || telemetry.AppendTelemetryPackage(frame))
+            {
+                updated[t] = true;
+                frameAt[t] = now;
+            }
+        }
+
+        if (!sender.IsActive())
+        {
+            uint8_t length = 0;
+            uint8_t *data = nullptr;
+            if (sending >= 0 && roundRobin)
+                updated[sending] = false;
+            sending = -1;
+            if (roundRobin)
+            {
+                for (uint8_t i = 1; i <= FC_STREAM_TYPES && sending < 0; i++)
+                {
+                    const uint8_t t = (lastSent + i) % FC_STREAM_TYPES;
+                    if (updated[t])
+                        sending = lastSent = t;
+                }
+                if (sending >= 0)
+                {
+                    data = frames[sending];
+                    length = CRSF_FRAME_SIZE(data[CRSF_TELEMETRY_LENGTH_INDEX]);
+                }
+            }
+            else if (telemetry.GetNextPayload(&length, &data))
+            {
+                for (uint8_t t = 0; t < FC_STREAM_TYPES; t++)
+                {
+                    if (fcStream[t].type == data[CRSF_TELEMETRY_TYPE_INDEX])
+                        sending = t;
+                }
+            }
+            if (sending >= 0)
+            {
+                sendingFrameAt = frameAt[sending];
+                sender.SetDataToTransmit(length, data, ELRS_TELEMETRY_BYTES_PER_CALL);
+            }
+        }
+
+        if ((nonce + 1) % tlmRatio == 0)
+        {
+            const bool linkSlot = nextTlmIsLink || !sender.IsActive();
+            if (linkSlot)
+            {
+                nextTlmIsLink = false;
+                burstCount = 1;
+            }
+            else
+            {
+                if (burstCount < burstMax)
+                    burstCount++;
+                else
+                    nextTlmIsLink = true;
+
+                uint8_t *data;
+                uint8_t maxLength;
+                uint8_t packageIndex;
+                uint8_t airPacket[ELRS_TELEMETRY_BYTES_PER_CALL];
+                sender.GetCurrentPayload(&packageIndex, &maxLength, &data);
+                for (uint8_t i = 0; i < sizeof(airPacket); i++)
+                    airPacket[i] = i < maxLength ? data[i] : 0;
+                receiver.ReceiveData(packageIndex, airPacket);
+                if (receiver.HasFinishedData())
+                {
+                    TEST_ASSERT_EQUAL(fcStream[sending].type, received[CRSF_TELEMETRY_TYPE_INDEX]);
+                    latency[sending].delivered++;
+                    deliveredAt[sending] = sendingFrameAt;
+                    receiver.Unlock();
+                }
+            }
+        }
+        else
+        {
+            sender.ConfirmCurrentPayload(receiver.GetCurrentAck());
+        }
+        for (uint8_t t = 0; t < FC_STREAM_TYPES; t++)
+            latency[t].staleSum += now - deliveredAt[t];
+        NativeClock::advance(1000000 / hz);
+    }
+}
+
+void test_scheduler_msp_response_order(void)
+{
+    NativeClock::reset();
+    telemetry.ResetState();
+    NativeClock::advance(1000000);
+    uint8_t earlierResponse[] = {0xC8,6, CRSF_FRAMETYPE_MSP_RESP,CRSF_ADDRESS_RADIO_TRANSMITTER,CRSF_ADDRESS_FLIGHT_CONTROLLER,0x30,0x01,0x55};
+    uint8_t firstChunk[] = {0xC8,6, CRSF_FRAMETYPE_MSP_RESP,CRSF_ADDRESS_RADIO_TRANSMITTER,CRSF_ADDRESS_FLIGHT_CONTROLLER,0x31,0x02,0x55};
+    uint8_t secondChunk[] = {0xC8,6, CRSF_FRAMETYPE_MSP_RESP,CRSF_ADDRESS_RADIO_TRANSMITTER,CRSF_ADDRESS_FLIGHT_CONTROLLER,0x22,0x03,0x55};
+    uint8_t* data;
+    uint8_t receivedLength;
+
+    // The first response slot was just sent, so on urgency alone the second one would go first
+    TEST_ASSERT_TRUE(telemetry.AppendTelemetryPackage(earlierResponse));
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_FALSE(telemetry.GetNextPayload(&receivedLength, &data));
+    NativeClock::advance(10000);
+
+    TEST_ASSERT_TRUE(telemetry.AppendTelemetryPackage(firstChunk));
+    TEST_ASSERT_TRUE(telemetry.AppendTelemetryPackage(secondChunk));
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_EQUAL(0x31, data[CRSF_TELEMETRY_TYPE_INDEX + 3]);
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_EQUAL(0x22, data[CRSF_TELEMETRY_TYPE_INDEX + 3]);
+
+    // Nor does the second chunk go ahead when the first does not fit in the message
+    uint8_t longFirstChunk[] = {0xC8,8, CRSF_FRAMETYPE_MSP_RESP,CRSF_ADDRESS_RADIO_TRANSMITTER,CRSF_ADDRESS_FLIGHT_CONTROLLER,0x31,0x02,0x03,0x04,0x55};
+    TEST_ASSERT_FALSE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_TRUE(telemetry.AppendTelemetryPackage(longFirstChunk));
+    TEST_ASSERT_TRUE(telemetry.AppendTelemetryPackage(secondChunk));
+    TEST_ASSERT_FALSE(telemetry.GetNextPayload(&receivedLength, &data, sizeof(secondChunk)));
+    TEST_ASSERT_TRUE(telemetry.GetNextPayload(&receivedLength, &data));
+    TEST_ASSERT_EQUAL(0x31, data[CRSF_TELEMETRY_TYPE_INDEX + 3]);
+}
+
+void test_scheduler_latency(void)
+{
+    const uint8_t ratios[] = {2, 4, 8, 16, 32, 64};
+    const uint32_t packets = 250 * 60;
+    printf("Telemetry at 250Hz, frames/s and mean age in ms of what the TX has, round robin / scheduler\n");
+    for (uint8_t r = 0; r < sizeof(ratios); r++)
+    {
+        tlmLatency_t roundRobin[FC_STREAM_TYPES];
+        tlmLatency_t scheduled[FC_STREAM_TYPES];
+        simulateTelemetry(ratios[r], true, roundRobin);
+        simulateTelemetry(ratios[r], false, scheduled);
+
+        printf("  1:%-3u", ratios[r]);
+        for (uint8_t t = 0; t < FC_STREAM_TYPES; t++)
+        {
+            const tlmLatency_t &a = roundRobin[t];
+            const tlmLatency_t &b = scheduled[t];
+            printf("  %s %4.1f/%4.1f %4u/%4u", fcStream[t].name, a.delivered / 60.0, b.delivered / 60.0,
+                a.staleSum / packets, b.staleSum / packets);
+            // Nothing starves
+            TEST_ASSERT_TRUE(b.delivered > 0);
+        }
+        printf("\n");
+        // GPS and battery have the most weight, so are fresher than when every type had a turn
+        TEST_ASSERT_TRUE(scheduled[3].staleSum <= roundRobin[3].staleSum);
+        TEST_ASSERT_TRUE(scheduled[4].staleSum <= roundRobin[4].staleSum);
+    }
+}
+
 // Unity setup/teardown
 void setUp() {}
 void tearDown() {}
@@ -221,6 +547,12 @@ int main(int argc, char **argv)
     RUN_TEST(test_function_store_unknown_type);
     RUN_TEST(test_function_store_unknown_type_two_slots);
     RUN_TEST(test_function_store_ardupilot_status_text);
+    RUN_TEST(test_scheduler_priority_when_due);
+    RUN_TEST(test_scheduler_interval);
+    RUN_TEST(test_scheduler_drops_stale);
+    RUN_TEST(test_scheduler_fills_message);
+    RUN_TEST(test_scheduler_msp_response_order);
+    RUN_TEST(test_scheduler_latency);
     UNITY_END();
 
     return 0;
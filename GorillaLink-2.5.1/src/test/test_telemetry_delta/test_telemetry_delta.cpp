@@ -0,0 +1,467 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <telemetry_delta.h>
+#include <unity.h>
+#include "../CRC/crc.h"
+
+static const GENERIC_CRC8<CRSF_CRC_POLY> crsf_crc;
+
+static uint32_t lcg = 1;
+static uint32_t rand32()
+{
+    lcg = lcg * 1664525 + 1013904223;
+    return lcg;
+}
+
+/**
+ * A CRSF frame as the FC sends it, fields big endian
+ **/
+class FrameBuilder
+{
+public:
+    FrameBuilder(uint8_t type) : length(3)
+    {
+        frame[0] = CRSF_ADDRESS_CRSF_RECEIVER;
+        frame[CRSF_TELEMETRY_TYPE_INDEX] = type;
+    }
+    FrameBuilder &field(uint8_t size, uint32_t value)
+    {
+        for (uint8_t i = size; i > 0; i--)
+        {
+            frame[length + i - 1] = value;
+            value >>= 8;
+        }
+        length += size;
+        return *this;
+    }
+    FrameBuilder &string(const char *text, uint8_t size)
+    {
+        memset(frame + length, 0, size);
+        strncpy((char *)frame + length, text, size - 1);
+        length += size;
+        return *this;
+    }
+    const uint8_t *done()
+    {
+        // Type, payload and CRC
+        frame[CRSF_TELEMETRY_LENGTH_INDEX] = length - 1;
+        frame[length] = crsf_crc.calc(frame + CRSF_TELEMETRY_TYPE_INDEX, length - CRSF_TELEMETRY_TYPE_INDEX);
+        return frame;
+    }
+private:
+    uint8_t frame[CRSF_MAX_PACKET_LEN];
+    uint8_t length;
+};
+
+static const uint8_t *gpsFrame(int32_t lat, int32_t lon, uint16_t speed, uint16_t heading, uint16_t altitude, uint8_t sats)
+{
+    static FrameBuilder builder(CRSF_FRAMETYPE_GPS);
+    builder = FrameBuilder(CRSF_FRAMETYPE_GPS);
+    return builder.field(4, lat).field(4, lon).field(2, speed).field(2, heading).field(2, altitude).field(1, sats).done();
+}
+
+static const uint8_t *batteryFrame(uint16_t voltage, uint16_t current, uint32_t capacity, uint8_t remaining)
+{
+    static FrameBuilder builder(CRSF_FRAMETYPE_BATTERY_SENSOR);
+    builder = FrameBuilder(CRSF_FRAMETYPE_BATTERY_SENSOR);
+    return builder.field(2, voltage).field(2, current).field(3, capacity).field(1, remaining).done();
+}
+
+static const uint8_t *attitudeFrame(int16_t pitch, int16_t roll, int16_t yaw)
+{
+    static FrameBuilder builder(CRSF_FRAMETYPE_ATTITUDE);
+    builder = FrameBuilder(CRSF_FRAMETYPE_ATTITUDE);
+    return builder.field(2, pitch).field(2, roll).field(2, yaw).done();
+}
+
+static const uint8_t *flightModeFrame(const char *mode)
+{
+    static FrameBuilder builder(CRSF_FRAMETYPE_FLIGHT_MODE);
+    builder = FrameBuilder(CRSF_FRAMETYPE_FLIGHT_MODE);
+    return builder.string(mode, CRSF_FRAME_FLIGHT_MODE_PAYLOAD_SIZE).done();
+}
+
+/**
+ * Sends frame from rx to tx, true if the TX got it back exactly
+ **/
+static bool roundTrip(TelemetryDelta &rx, TelemetryDelta &tx, const uint8_t *frame, uint8_t *messageLength = nullptr)
+{
+    uint8_t message[CRSF_MAX_PACKET_LEN];
+    uint8_t decoded[CRSF_MAX_PACKET_LEN];
+    uint8_t used;
+    const uint8_t length = rx.Encode(frame, message);
+    if (messageLength)
+        *messageLength = length;
+    TEST_ASSERT_TRUE(length <= CRSF_FRAME_SIZE(frame[CRSF_TELEMETRY_LENGTH_INDEX]));
+    const bool forwarded = tx.Decode(message, length, &used, decoded);
+    // It takes the message apart whether or not it applies
+    TEST_ASSERT_EQUAL(length, used);
+    if (!forwarded)
+        return false;
+    // The TX forwards everything but the address
+    return memcmp(frame + 1, decoded + 1, CRSF_FRAME_SIZE(frame[CRSF_TELEMETRY_LENGTH_INDEX]) - 1) == 0;
+}
+
+static const uint8_t *varioFrame(int16_t speed)
+{
+    static FrameBuilder builder(CRSF_FRAMETYPE_VARIO);
+    builder = FrameBuilder(CRSF_FRAMETYPE_VARIO);
+    return builder.field(2, speed).done();
+}
+
+void test_delta_round_trip(void)
+{
+    TelemetryDelta rx;
+    TelemetryDelta tx;
+    lcg = 1;
+    int32_t lat = 473977000;
+    int32_t lon = 85456000;
+    uint16_t voltage = 1680;
+    int16_t roll = 0;
+    for (uint16_t i = 0; i < 2000; i++)
+    {
+        // Small steps mostly, and now and then anything at all, wrapping round included
+        const uint32_t r = rand32();
+        if (r % 16 == 0)
+        {
+            lat = rand32();
+            lon = rand32();
+            roll = rand32();
+            voltage = rand32();
+        }
+        else
+        {
+            lat += (int8_t)(r >> 8);
+            lon += (int8_t)(r >> 16);
+            roll += (int8_t)(r >> 24) * 4;
+            voltage -= (r >> 20) & 1;
+        }
+        TEST_ASSERT_TRUE(roundTrip(rx, tx, gpsFrame(lat, lon, r >> 12, r >> 3, 0xFFFF - (r & 3), (r >> 28) + 3)));
+        TEST_ASSERT_TRUE(roundTrip(rx, tx, batteryFrame(voltage, r >> 9, i * 2100, 100 - i / 20)));
+        TEST_ASSERT_TRUE(roundTrip(rx, tx, attitudeFrame(r >> 5, roll, i * 13)));
+        TEST_ASSERT_TRUE(roundTrip(rx, tx, flightModeFrame((r & 0x300) ? "ACRO" : "!FS!")));
+    }
+}
+
+void test_delta_is_shorter(void)
+{
+    TelemetryDelta rx;
+    TelemetryDelta tx;
+    uint8_t length;
+
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, gpsFrame(473977000, 85456000, 120, 9000, 1100, 12), &length));
+    TEST_ASSERT_EQUAL(CRSF_FRAME_SIZE(CRSF_FRAME_GPS_PAYLOAD_SIZE + 2), length);
+
+    // Header, mask and a byte each for lat and lon
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, gpsFrame(473977020, 85455990, 120, 9000, 1100, 12), &length));
+    TEST_ASSERT_EQUAL(4, length);
+
+    // Nothing changed
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, gpsFrame(473977020, 85455990, 120, 9000, 1100, 12), &length));
+    TEST_ASSERT_EQUAL(2, length);
+
+    // Only the first letter of the flight mode: header, count, two mask bytes and the letter
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, flightModeFrame("ANGL"), &length));
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, flightModeFrame("HNGL"), &length));
+    TEST_ASSERT_EQUAL(5, length);
+}
+
+void test_delta_keyframes(void)
+{
+    TelemetryDelta rx;
+    TelemetryDelta tx;
+    uint8_t length;
+    uint8_t keyframes = 0;
+
+    for (uint8_t i = 0; i < ELRS_TELEMETRY_DELTA_KEYFRAMES * 3; i++)
+    {
+        TEST_ASSERT_TRUE(roundTrip(rx, tx, attitudeFrame(i, -i, 100), &length));
+        if (length == CRSF_FRAME_SIZE(CRSF_FRAME_ATTITUDE_PAYLOAD_SIZE + 2))
+            keyframes++;
+    }
+    TEST_ASSERT_EQUAL(3, keyframes);
+}
+
+void test_delta_dropped_until_keyframe(void)
+{
+    TelemetryDelta rx;
+    TelemetryDelta tx;
+    uint8_t message[CRSF_MAX_PACKET_LEN];
+
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, batteryFrame(1680, 100, 0, 100)));
+    // The TX misses one, so the deltas after it do not apply
+    rx.Encode(batteryFrame(1679, 110, 10, 99), message);
+    uint8_t dropped = 0;
+    uint8_t i = 2;
+    while (!roundTrip(rx, tx, batteryFrame(1680 - i, 100 + i, 10 * i, 100 - i)))
+    {
+        dropped++;
+        i++;
+    }
+    TEST_ASSERT_EQUAL(ELRS_TELEMETRY_DELTA_KEYFRAMES - 2, dropped);
+
+    // A TX that starts afresh waits for the keyframe too
+    tx.ResetState();
+    TEST_ASSERT_FALSE(roundTrip(rx, tx, batteryFrame(1500, 100, 10, 50)));
+    rx.ResetState();
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, batteryFrame(1500, 100, 10, 50)));
+}
+
+/**
+ * A delta lost and then the keyframe after it lost too. The TX must not take
+ * the deltas after the second keyframe for ones on the first.
+ **/
+void test_delta_lost_keyframe(void)
+{
+    TelemetryDelta rx;
+    TelemetryDelta tx;
+    uint8_t message[CRSF_MAX_PACKET_LEN];
+    uint8_t length;
+
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, varioFrame(135)));
+    rx.Encode(varioFrame(140), message);
+    uint8_t i;
+    for (i = 2; i < ELRS_TELEMETRY_DELTA_KEYFRAMES; i++)
+        TEST_ASSERT_FALSE(roundTrip(rx, tx, varioFrame(135 + i)));
+    length = rx.Encode(varioFrame(247), message);
+    TEST_ASSERT_EQUAL(CRSF_FRAME_SIZE(CRSF_FRAME_VARIO_PAYLOAD_SIZE + 2), length);
+    // Every delta on the lost keyframe is dropped, none is put on 135
+    for (i = 1; i < ELRS_TELEMETRY_DELTA_KEYFRAMES; i++)
+        TEST_ASSERT_FALSE(roundTrip(rx, tx, varioFrame(247 + (i & 1))));
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, varioFrame(250), &length));
+    TEST_ASSERT_EQUAL(CRSF_FRAME_SIZE(CRSF_FRAME_VARIO_PAYLOAD_SIZE + 2), length);
+    TEST_ASSERT_TRUE(roundTrip(rx, tx, varioFrame(251), &length));
+    TEST_ASSERT_TRUE(length < CRSF_FRAME_SIZE(CRSF_FRAME_VARIO_PAYLOAD_SIZE + 2));
+
+    // Any messages lost: what the TX forwards is always the frame the RX had
+    lcg = 3;
+    uint16_t forwarded = 0;
+    for (uint16_t n = 0; n < 5000; n++)
+    {
+        const uint32_t r = rand32();
+        const uint8_t *frame = (r & 1) ? varioFrame(r >> 20) : gpsFrame(r >> 4, 85456000, r >> 16, 9000, 1100, r >> 28);
+        uint8_t decoded[CRSF_MAX_PACKET_LEN];
+        uint8_t used;
+        length = rx.Encode(frame, message);
+        if ((r >> 8) % 16 == 0)
+            continue;
+        if (tx.Decode(message, length, &used, decoded))
+        {
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(frame + 1, decoded + 1, CRSF_FRAME_SIZE(frame[CRSF_TELEMETRY_LENGTH_INDEX]) - 1);
+            forwarded++;
+        }
+    }
+    // One in 16 lost costs the rest of the keyframe interval of the type
+    TEST_ASSERT_TRUE(forwarded > 2500);
+}
+
+void test_delta_batch(void)
+{
+    TelemetryDelta rx;
+    TelemetryDelta tx;
+    uint8_t message[CRSF_MAX_PACKET_LEN + 1];
+    const uint8_t *frames[3];
+    uint8_t copies[3][CRSF_MAX_PACKET_LEN];
+
+    for (uint8_t n = 0; n < 20; n++)
+    {
+        frames[0] = gpsFrame(473977000 + n * 20, 85456000 - n * 10, 120, 9000, 1100, 12);
+        frames[1] = batteryFrame(1680 - n, 100, n * 10, 100);
+        frames[2] = flightModeFrame(n < 10 ? "ANGL" : "ACRO");
+        // The builders are reused, keep what went in
+        for (uint8_t i = 0; i < 3; i++)
+            memcpy(copies[i], frames[i], CRSF_FRAME_SIZE(frames[i][CRSF_TELEMETRY_LENGTH_INDEX]));
+
+        uint8_t length = 0;
+        for (uint8_t i = 0; i < 3; i++)
+            length += rx.Encode(copies[i], message + length);
+        TEST_ASSERT_TRUE(length <= sizeof(message));
+
+        uint8_t offset = 0;
+        for (uint8_t i = 0; i < 3; i++)
+        {
+            uint8_t decoded[CRSF_MAX_PACKET_LEN];
+            uint8_t used;
+            TEST_ASSERT_TRUE(tx.Decode(message + offset, length - offset, &used, decoded));
+            TEST_ASSERT_EQUAL_UINT8_ARRAY(copies[i] + 1, decoded + 1, CRSF_FRAME_SIZE(copies[i][CRSF_TELEMETRY_LENGTH_INDEX]) - 1);
+            offset += used;
+        }
+        TEST_ASSERT_EQUAL(length, offset);
+    }
+
+    // Cut short, it takes nothing
+    uint8_t used;
+    uint8_t decoded[CRSF_MAX_PACKET_LEN];
+    const uint8_t length = rx.Encode(gpsFrame(1, 2, 3, 4, 5, 6), message);
+    TEST_ASSERT_FALSE(tx.Decode(message, length - 1, &used, decoded));
+    TEST_ASSERT_EQUAL(0, used);
+}
+
+void test_delta_other_frames_as_is(void)
+{
+    TelemetryDelta rx;
+    TelemetryDelta tx;
+    uint8_t message[CRSF_MAX_PACKET_LEN];
+    uint8_t decoded[CRSF_MAX_PACKET_LEN];
+    uint8_t used;
+
+    // An MSP response, which has no field layout
+    const uint8_t msp[] = {CRSF_SYNC_BYTE, 8, CRSF_FRAMETYPE_MSP_RESP, CRSF_ADDRESS_RADIO_TRANSMITTER, CRSF_ADDRESS_FLIGHT_CONTROLLER, 0x30, 1, 2, 3, 0x5A};
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        TEST_ASSERT_EQUAL(sizeof(msp), rx.Encode(msp, message));
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(msp, message, sizeof(msp));
+        TEST_ASSERT_TRUE(tx.Decode(message, sizeof(msp), &used, decoded));
+        TEST_ASSERT_EQUAL(sizeof(msp), used);
+        TEST_ASSERT_EQUAL_UINT8_ARRAY(msp, decoded, sizeof(msp));
+    }
+
+    // A longer frame of a delta type than there is room to keep goes whole too
+    FrameBuilder builder(CRSF_FRAMETYPE_VARIO);
+    for (uint8_t i = 0; i < TELEMETRY_DELTA_MAX_FRAME; i++)
+        builder.field(1, i);
+    const uint8_t *vario = builder.done();
+    const uint8_t length = CRSF_FRAME_SIZE(vario[CRSF_TELEMETRY_LENGTH_INDEX]);
+    TEST_ASSERT_EQUAL(length, rx.Encode(vario, message));
+    TEST_ASSERT_EQUAL(length, rx.Encode(vario, message));
+    TEST_ASSERT_TRUE(tx.Decode(message, length, &used, decoded));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(vario + 1, decoded + 1, length - 1);
+}
+
+static uint32_t airSlots(uint8_t length)
+{
+    // 5 bytes a slot and one to end the message
+    return (length + ELRS_TELEMETRY_BYTES_PER_CALL - 1) / ELRS_TELEMETRY_BYTES_PER_CALL + 1;
+}
+
+/**
+ * Packs frames into telemetry messages, a count byte and as many frames as fit
+ **/
+class Batcher
+{
+public:
+    Batcher() : length(0), slots(0) {}
+    void add(uint8_t frameLength)
+    {
+        if (length + frameLength > CRSF_MAX_PACKET_LEN + 1)
+            finish();
+        if (length == 0)
+            length = 1;
+        length += frameLength;
+    }
+    void finish()
+    {
+        if (length)
+            slots += airSlots(length);
+        length = 0;
+    }
+    uint32_t Slots() { finish(); return slots; }
+private:
+    uint8_t length;
+    uint32_t slots;
+};
+
+/**
+ * Ten minutes of telemetry from a synthetic flight, at the rates Betaflight
+ * sends CRSF: a climb out, laps of a 150m circle at 12m/s with the attitude
+ * following the turn plus stick noise, and the battery sagging with throttle.
+ * Compares the bytes of each type raw and as deltas, and the telemetry slots
+ * the StubbornSender takes for all of it: a raw frame a message as before,
+ * raw frames packed into messages, and deltas packed into messages. Frames
+ * are packed in the order they come, which is what the RX does when the link
+ * is busy, the case the air time matters in.
+ **/
+void test_delta_bytes_saved(void)
+{
+    TelemetryDelta rx;
+    TelemetryDelta tx;
+    const char *names[] = {"GPS", "BATT", "ATT", "MODE"};
+    const uint16_t periods[] = {100, 200, 20, 500};
+    uint32_t rawBytes[4] = {};
+    uint32_t deltaBytes[4] = {};
+    uint32_t rawSlots = 0;
+    Batcher rawBatches;
+    Batcher deltaBatches;
+    uint32_t capacity = 0;
+    lcg = 7;
+
+    for (uint32_t ms = 0; ms < 600000; ms += 20)
+    {
+        const double t = ms / 1000.0;
+        const double angle = t * 12.0 / 150.0;
+        const double climb = t < 20 ? t / 20 : 1;
+        const int32_t noise = (int32_t)(rand32() >> 24) - 128;
+        const uint16_t current = 150 + 50 * climb + (noise & 31);
+        capacity += current;
+
+        for (uint8_t type = 0; type < 4; type++)
+        {
+            if (ms % periods[type])
+                continue;
+            const uint8_t *frame;
+            switch (type)
+            {
+            case 0:
+                // 1e-7 degrees, about 1.1cm a unit of latitude
+                frame = gpsFrame(473977000 + (int32_t)(13500 * sin(angle)), 85456000 + (int32_t)(20000 * cos(angle)),
+                    1200 * climb + (noise & 7), (uint16_t)(fmod(angle * 5729.6 + 9000, 36000)), 1000 + 80 * climb + (noise & 1), 14);
+                break;
+            case 1:
+                frame = batteryFrame(1680 - t / 6 - current / 20, current, capacity / 360000, 100 - t / 7);
+                break;
+            case 2:
+                // 1e-4 radians
+                frame = attitudeFrame(-2000 * climb + noise * 4, 4500 * climb + noise * 4, (int16_t)(fmod(angle, 6.2832) * 10000 - 31416));
+                break;
+            default:
+                frame = flightModeFrame(t < 300 ? "ANGL" : "HOR");
+                break;
+            }
+
+            uint8_t length;
+            TEST_ASSERT_TRUE(roundTrip(rx, tx, frame, &length));
+            const uint8_t raw = CRSF_FRAME_SIZE(frame[CRSF_TELEMETRY_LENGTH_INDEX]);
+            rawBytes[type] += raw;
+            deltaBytes[type] += length;
+            rawSlots += airSlots(raw);
+            rawBatches.add(raw);
+            deltaBatches.add(length);
+        }
+    }
+
+    printf("Telemetry of a 10 minute flight, bytes raw / delta\n");
+    for (uint8_t type = 0; type < 4; type++)
+    {
+        printf("  %-4s %6u / %6u bytes  %.2fx\n", names[type], rawBytes[type], deltaBytes[type],
+            (double)rawBytes[type] / deltaBytes[type]);
+        TEST_ASSERT_TRUE(deltaBytes[type] < rawBytes[type]);
+    }
+    const uint32_t rawBatchedSlots = rawBatches.Slots();
+    const uint32_t deltaBatchedSlots = deltaBatches.Slots();
+    printf("  air slots: %u a frame a message, %u packed, %u packed deltas, %.2fx\n",
+        rawSlots, rawBatchedSlots, deltaBatchedSlots, (double)rawSlots / deltaBatchedSlots);
+    TEST_ASSERT_TRUE(deltaBatchedSlots < rawBatchedSlots);
+    TEST_ASSERT_TRUE(deltaBatchedSlots * 2 < rawSlots);
+}
+
+// Unity setup/teardown
+void setUp() {}
+void tearDown() {}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_delta_round_trip);
+    RUN_TEST(test_delta_is_shorter);
+    RUN_TEST(test_delta_keyframes);
+    RUN_TEST(test_delta_dropped_until_keyframe);
+    RUN_TEST(test_delta_lost_keyframe);
+    RUN_TEST(test_delta_batch);
+    RUN_TEST(test_delta_other_frames_as_is);
+    RUN_TEST(test_delta_bytes_saved);
+    UNITY_END();
+
+    return 0;
+}